@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "archive.h"
+#include "replay.h"
+
+
+// Source of all the padding and end-of-archive blocks
+static const char zeros[2 * TAR_BLOCK_SIZE];
+
+
+void archive_init(struct archive* archive) {
+    archive->count = 0;
+    archive->length = 0;
+    archive->truncate_at = ARCHIVE_NO_TRUNCATION;
+    archive->overflow = false;
+}
+
+
+void archive_add_raw(struct archive* archive, const void* bytes, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    if (archive->count == ARCHIVE_MAX_PARTS) {
+        archive->overflow = true;
+        return;
+    }
+    archive->parts[archive->count].iov_base = (void*) bytes;
+    archive->parts[archive->count].iov_len = len;
+    archive->count++;
+    archive->length += len;
+}
+
+
+void archive_add_zeros(struct archive* archive, size_t len) {
+    while (len > 0) {
+        size_t chunk = len < sizeof(zeros) ? len : sizeof(zeros);
+        archive_add_raw(archive, zeros, chunk);
+        len -= chunk;
+    }
+}
+
+
+void archive_add_member(struct archive* archive, const struct tar_t* header, const void* data, size_t data_len, bool pad) {
+    archive_add_raw(archive, header, sizeof(struct tar_t));
+    archive_add_raw(archive, data, data_len);
+
+    // Pad the data with null bytes (it has to be a 512-byte block)
+    if (pad && data_len % TAR_BLOCK_SIZE) {
+        archive_add_zeros(archive, TAR_BLOCK_SIZE - data_len % TAR_BLOCK_SIZE);
+    }
+}
+
+
+void archive_end(struct archive* archive, int blocks) {
+    archive_add_zeros(archive, (size_t) blocks * TAR_BLOCK_SIZE);
+}
+
+
+void archive_splice(struct archive* archive, size_t offset, size_t removed, const void* bytes, size_t len) {
+    struct iovec parts[ARCHIVE_MAX_PARTS];
+    int count = archive->count;
+    memcpy(parts, archive->parts, sizeof(parts[0]) * count);
+
+    size_t end_of_range = offset + removed;
+    size_t start = 0;
+    bool inserted = false;
+    archive->count = 0;
+    archive->length = 0;
+
+    for (int i = 0; i < count; i++) {
+        char* base = parts[i].iov_base;
+        size_t end = start + parts[i].iov_len;
+
+        // What is before the range, then the new bytes, then what is after the range
+        if (start < offset) {
+            archive_add_raw(archive, base, (end < offset ? end : offset) - start);
+        }
+        if (!inserted && offset <= end) {
+            archive_add_raw(archive, bytes, len);
+            inserted = true;
+        }
+        if (end > end_of_range) {
+            size_t from = start > end_of_range ? start : end_of_range;
+            archive_add_raw(archive, base + (from - start), end - from);
+        }
+        start = end;
+    }
+
+    if (!inserted) {
+        archive_add_raw(archive, bytes, len);
+    }
+}
+
+
+void archive_truncate(struct archive* archive, size_t length) {
+    archive->truncate_at = length;
+}
+
+
+int archive_parts(const struct archive* archive, struct iovec* parts, size_t* length) {
+    size_t left = archive->truncate_at;
+    int count = 0;
+
+    for (int i = 0; i < archive->count && left > 0; i++) {
+        parts[count] = archive->parts[i];
+        if (parts[count].iov_len > left) {
+            parts[count].iov_len = left;
+        }
+        left -= parts[count].iov_len;
+        count++;
+    }
+
+    *length = archive->truncate_at < archive->length ? archive->truncate_at : archive->length;
+    return count;
+}
+
+
+size_t archive_gather(const struct archive* archive, size_t offset, void* buffer, size_t len) {
+    size_t length = archive->truncate_at < archive->length ? archive->truncate_at : archive->length;
+    if (offset >= length) {
+        return 0;
+    }
+    if (len > length - offset) {
+        len = length - offset;
+    }
+
+    size_t start = 0;
+    size_t copied = 0;
+    for (int i = 0; i < archive->count && copied < len; i++) {
+        size_t end = start + archive->parts[i].iov_len;
+        if (end > offset + copied) {
+            size_t from = offset + copied - start;
+            size_t n = end - (offset + copied);
+            n = n < len - copied ? n : len - copied;
+            memcpy((char*) buffer + copied, (const char*) archive->parts[i].iov_base + from, n);
+            copied += n;
+        }
+        start = end;
+    }
+    return copied;
+}
+
+
+/**
+ * Writes the archive to a file, and records it in the replay log if asked
+ */
+static int write_archive(const struct archive* archive, const char* filename, bool record) {
+    if (archive->overflow) {
+        fprintf(stderr, "%s: too many parts in the archive\n", filename);
+        return -1;
+    }
+
+    struct iovec parts[ARCHIVE_MAX_PARTS];
+    size_t length;
+    int count = archive_parts(archive, parts, &length);
+
+    // Keep a trace of the archive to be able to write it again
+    if (record) {
+        replay_record(parts, count, length);
+    }
+
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        perror(filename);
+        return -1;
+    }
+
+    // Local files: writev() writes everything at once unless the disk is full
+    ssize_t written = writev(fd, parts, count);
+    close(fd);
+    if (written != (ssize_t) length) {
+        perror(filename);
+        return -1;
+    }
+    return 0;
+}
+
+
+int archive_write(const struct archive* archive, const char* filename) {
+    return write_archive(archive, filename, true);
+}
+
+
+int archive_write_unrecorded(const struct archive* archive, const char* filename) {
+    return write_archive(archive, filename, false);
+}
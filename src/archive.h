@@ -0,0 +1,123 @@
+#ifndef FUZZER_ARCHIVE_H
+#define FUZZER_ARCHIVE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+#include "tar.h"
+
+// Maximum number of parts of an archive (a member takes up to 3: header, data, padding)
+#define ARCHIVE_MAX_PARTS 256
+
+// No truncation
+#define ARCHIVE_NO_TRUNCATION ((size_t) -1)
+
+/**
+ * Archive being built: the list of its parts, written with a single writev().
+ * Headers and data are not copied, they must stay valid until the archive is written.
+ */
+struct archive {
+    struct iovec parts[ARCHIVE_MAX_PARTS];
+    int count;
+    // Length of the archive before truncation
+    size_t length;
+    // Length at which the archive is cut when written
+    size_t truncate_at;
+    // Set when a part did not fit, the archive is then not written
+    bool overflow;
+};
+
+/**
+ * Starts an empty archive
+ * @param archive the archive
+ */
+void archive_init(struct archive* archive);
+
+/**
+ * Adds raw bytes (a partial header, garbage...)
+ * @param archive the archive
+ * @param bytes the bytes
+ * @param len number of bytes
+ */
+void archive_add_raw(struct archive* archive, const void* bytes, size_t len);
+
+/**
+ * Adds null bytes
+ * @param archive the archive
+ * @param len number of null bytes
+ */
+void archive_add_zeros(struct archive* archive, size_t len);
+
+/**
+ * Adds a member: its header, its data, and the null bytes up to the next block if asked
+ * @param archive the archive
+ * @param header header of the member (its size field is not checked against data_len)
+ * @param data data of the member, can be NULL if data_len is 0
+ * @param data_len number of bytes of data
+ * @param pad whether to pad the data to a multiple of 512 bytes
+ */
+void archive_add_member(struct archive* archive, const struct tar_t* header, const void* data, size_t data_len, bool pad);
+
+/**
+ * Adds the end-of-archive marker, normally 2 blocks of null bytes
+ * @param archive the archive
+ * @param blocks number of null blocks
+ */
+void archive_end(struct archive* archive, int blocks);
+
+/**
+ * Replaces a range of the archive with other bytes, the parts around it are split but not copied.
+ * A range past the end of the archive is shortened, bytes inserted past the end are appended.
+ * @param archive the archive
+ * @param offset where the range starts
+ * @param removed length of the range, 0 to only insert
+ * @param bytes the bytes to put instead, they are not copied and have to live as long as the archive
+ * @param len number of bytes to put, 0 to only remove
+ */
+void archive_splice(struct archive* archive, size_t offset, size_t removed, const void* bytes, size_t len);
+
+/**
+ * Cuts the archive at a given length when written (a no-op if it is not shorter)
+ * @param archive the archive
+ * @param length the length to cut at
+ */
+void archive_truncate(struct archive* archive, size_t length);
+
+/**
+ * Gathers the parts of the archive as written, truncation applied
+ * @param archive the archive
+ * @param parts where to store the parts (ARCHIVE_MAX_PARTS entries)
+ * @param length where to store the length of the archive
+ * @return the number of parts
+ */
+int archive_parts(const struct archive* archive, struct iovec* parts, size_t* length);
+
+/**
+ * Copies bytes of the archive as written, truncation applied
+ * @param archive the archive
+ * @param offset where the bytes start
+ * @param buffer where to copy them
+ * @param len number of bytes to copy
+ * @return the number of bytes copied, less than len at the end of the archive
+ */
+size_t archive_gather(const struct archive* archive, size_t offset, void* buffer, size_t len);
+
+/**
+ * Writes the archive to a file with a single writev(), and records it in the replay log
+ * @param archive the archive
+ * @param filename name of the file to create
+ * @return 0 on success, -1 on error
+ */
+int archive_write(const struct archive* archive, const char* filename);
+
+/**
+ * Same as archive_write(), without the replay log: for an archive that is not a test case
+ * (e.g. one extracted to prepare the test cases)
+ * @param archive the archive
+ * @param filename name of the file to create
+ * @return 0 on success, -1 on error
+ */
+int archive_write_unrecorded(const struct archive* archive, const char* filename);
+
+#endif
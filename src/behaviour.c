@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "behaviour.h"
+#include "prng.h"
+
+
+static bool enabled = false;
+
+// Initial number of slots of the set, it doubles when half full
+#define INITIAL_SLOTS 4096
+
+// The set of classes: open addressing, 0 marks an empty slot (a class equal to 0 is stored as 1)
+static uint64_t* slots = NULL;
+static size_t slot_count = 0;
+static unsigned long class_count = 0;
+
+// Pruning of the sweeps: position of the last test case of each suite, and number of cases in a row without news
+static unsigned int prune_after = 0;
+static struct {
+    unsigned int position;
+    unsigned int without_news;
+} streaks[SUITE_COUNT];
+
+
+void behaviour_enable(void) {
+    enabled = true;
+}
+
+
+bool behaviour_enabled(void) {
+    return enabled;
+}
+
+
+uint64_t behaviour_class(bool crashed, int status, uint64_t fingerprint, uint64_t trace_hash) {
+    uint64_t class = prng_mix(fingerprint, ((uint64_t) crashed << 32) ^ (uint32_t) status);
+    return prng_mix(class, trace_hash);
+}
+
+
+/**
+ * Inserts a class in the set
+ * @return true if it was not in the set
+ */
+static bool insert(uint64_t class) {
+    size_t mask = slot_count - 1;
+    for (size_t i = class & mask;; i = (i + 1) & mask) {
+        if (slots[i] == class) {
+            return false;
+        }
+        if (slots[i] == 0) {
+            slots[i] = class;
+            class_count++;
+            return true;
+        }
+    }
+}
+
+
+static void grow(void) {
+    uint64_t* old = slots;
+    size_t old_count = slot_count;
+
+    slot_count = slot_count ? slot_count * 2 : INITIAL_SLOTS;
+    slots = calloc(slot_count, sizeof(*slots));
+    if (slots == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    class_count = 0;
+    for (size_t i = 0; i < old_count; i++) {
+        if (old[i] != 0) {
+            insert(old[i]);
+        }
+    }
+    free(old);
+}
+
+
+bool behaviour_record(uint64_t class) {
+    if (class == 0) {
+        class = 1;
+    }
+    if (2 * (class_count + 1) > slot_count) {
+        grow();
+    }
+    bool new_class = insert(class);
+
+    // The field sweeps and the header sweep are the suites numbered by position * 256 + character
+    uint64_t case_id = campaign_case_id();
+    enum suite suite = case_id >> 32;
+    unsigned int position = (unsigned int) case_id / 256;
+    if (suite <= SUITE_CHKSUM || suite == SUITE_HEADER) {
+        if (new_class || streaks[suite].position != position) {
+            streaks[suite].without_news = 0;
+        }
+        streaks[suite].position = position;
+        if (!new_class) {
+            streaks[suite].without_news++;
+        }
+    }
+    return new_class;
+}
+
+
+unsigned long behaviour_count(void) {
+    return class_count;
+}
+
+
+void behaviour_set_prune(unsigned int n) {
+    prune_after = n;
+}
+
+
+bool behaviour_pruned(enum suite suite, unsigned int position) {
+    return enabled && prune_after > 0 && streaks[suite].position == position && streaks[suite].without_news >= prune_after;
+}
@@ -0,0 +1,66 @@
+#ifndef FUZZER_BEHAVIOUR_H
+#define FUZZER_BEHAVIOUR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "campaign.h"
+
+/*
+ * Behaviour classes of the executions: what the extractor printed (crash or not), how it ended, and what it left
+ * in its directory (see scratch_clean_fingerprint()), plus its syscall trace when it is traced.
+ * The classes seen by this process are kept in a hash set, so that an archive that makes the extractor do something
+ * new can be told apart from the thousands of archives that do the same thing.
+ *
+ * The field sweeps and the header sweep can be pruned with it: once N test cases in a row at the same position of
+ * a field gave no new class, the rest of the characters of that position are skipped.
+ */
+
+/**
+ * Fingerprints the extracted trees and records the classes of the executions
+ */
+void behaviour_enable(void);
+
+/**
+ * @return true if the classes of the executions are recorded
+ */
+bool behaviour_enabled(void);
+
+/**
+ * Computes the class of an execution
+ * @param crashed whether the extractor printed its crash message
+ * @param status status returned by wait4()
+ * @param fingerprint fingerprint of the extracted tree
+ * @param trace_hash hash of the syscall trace, 0 if not traced
+ * @return the class
+ */
+uint64_t behaviour_class(bool crashed, int status, uint64_t fingerprint, uint64_t trace_hash);
+
+/**
+ * Adds the class of an execution of the current test case to the set
+ * @param class the class
+ * @return true if it was not in the set
+ */
+bool behaviour_record(uint64_t class);
+
+/**
+ * @return the number of classes seen by this process
+ */
+unsigned long behaviour_count(void);
+
+/**
+ * Skips the rest of a position of a field sweep after N test cases without a new class, 0 never skips (the default).
+ * Only has an effect once behaviour_enable() is called.
+ * @param n the number of test cases
+ */
+void behaviour_set_prune(unsigned int n);
+
+/**
+ * Tells if a position of a field sweep was pruned, see behaviour_set_prune()
+ * @param suite the suite of the sweep
+ * @param position the position in the field (the test case index divided by 256)
+ * @return true if the test cases of this position can be skipped
+ */
+bool behaviour_pruned(enum suite suite, unsigned int position);
+
+#endif
@@ -0,0 +1,684 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <dirent.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "campaign.h"
+
+
+static const char* suite_names[SUITE_COUNT] = {
+    [SUITE_NAME] = "name",
+    [SUITE_MODE] = "mode",
+    [SUITE_UID] = "uid",
+    [SUITE_GID] = "gid",
+    [SUITE_SIZE] = "size",
+    [SUITE_MTIME] = "mtime",
+    [SUITE_TYPEFLAG] = "typeflag",
+    [SUITE_LINKNAME] = "linkname",
+    [SUITE_MAGIC] = "magic",
+    [SUITE_VERSION] = "version",
+    [SUITE_UNAME] = "uname",
+    [SUITE_GNAME] = "gname",
+    [SUITE_CHKSUM] = "chksum",
+    [SUITE_CHECKSUM] = "checksum",
+    [SUITE_NULL] = "null",
+    [SUITE_FILESIZE] = "filesize",
+    [SUITE_NUMERIC] = "numeric",
+    [SUITE_OCTAL] = "octal",
+    [SUITE_MEMBERS] = "members",
+    [SUITE_GRAPH] = "graph",
+    [SUITE_EXTENSION] = "extension",
+    [SUITE_TRUNCATION] = "truncation",
+    [SUITE_FAULT] = "fault",
+    [SUITE_CORPUS] = "corpus",
+    [SUITE_HEADER] = "header",
+};
+
+// The field sweeps stop at their first crash, the other suites run all their test cases
+#define SUITE_STOPS_AT_CRASH(suite) ((suite) <= SUITE_CHKSUM)
+
+// Name of the checkpoint file, in the working directory of the process
+#define CHECKPOINT_FILE "checkpoint"
+#define CHECKPOINT_VERSION 1
+#define MAX_CHECKPOINT_HOOKS 16
+#define MAX_CRASH_HOOKS 4
+#define MAX_COMMIT_HOOKS 4
+// Longest line of the checkpoint, the states of the scheduler take most of it
+#define MAX_CHECKPOINT_LINE 4096
+
+// State saved in the checkpoint by another module
+struct checkpoint_hook {
+    const char* key;
+    void (*save)(FILE* file);
+    int (*load)(const char* value);
+};
+
+// State of the campaign of this process
+static struct {
+    unsigned int shard_index;
+    unsigned int shard_count;
+    unsigned int worker_index;
+    unsigned int worker_count;
+    FILE* results;
+    enum suite suite;
+    unsigned int index;
+    // Whether the current test case is running and not yet finished
+    bool in_flight;
+    // Per suite, every test case below this index is finished
+    unsigned int progress[SUITE_COUNT];
+    unsigned long executed[SUITE_COUNT];
+    unsigned long crashes[SUITE_COUNT];
+    unsigned int checkpoint_interval;
+    time_t last_checkpoint;
+    struct checkpoint_hook hooks[MAX_CHECKPOINT_HOOKS];
+    int hook_count;
+    void (*crash_hooks[MAX_CRASH_HOOKS])(const char* artifact);
+    int crash_hook_count;
+    void (*commit_hooks[MAX_COMMIT_HOOKS])(void);
+    int commit_hook_count;
+    // Current slice of the scheduler: test cases left and end, 0 when there is no slice
+    unsigned long slice_executions;
+    double slice_end;
+    bool slice_over;
+} campaign = { .shard_index = 0, .shard_count = 1, .worker_index = 0, .worker_count = 1 };
+
+// Set by SIGINT/SIGTERM: save a checkpoint and stop before the next test case
+static volatile sig_atomic_t stop_requested = 0;
+
+
+const char* suite_name(enum suite suite) {
+    if (suite >= SUITE_COUNT) {
+        return "unknown";
+    }
+    return suite_names[suite];
+}
+
+
+int campaign_parse_shard(const char* arg, unsigned int* index, unsigned int* count) {
+    char* end;
+
+    errno = 0;
+    unsigned long i = strtoul(arg, &end, 10);
+    if (end == arg || *end != '/' || errno) {
+        return -1;
+    }
+
+    const char* count_str = end + 1;
+    unsigned long n = strtoul(count_str, &end, 10);
+    if (end == count_str || *end != '\0' || errno) {
+        return -1;
+    }
+
+    if (n == 0 || n > UINT_MAX || i >= n) {
+        return -1;
+    }
+
+    *index = (unsigned int) i;
+    *count = (unsigned int) n;
+    return 0;
+}
+
+
+static void handle_stop_signal(__attribute__((unused)) int sig) {
+    stop_requested = 1;
+}
+
+
+void campaign_add_checkpoint_hook(const char* key, void (*save)(FILE* file), int (*load)(const char* value)) {
+    if (campaign.hook_count == MAX_CHECKPOINT_HOOKS) {
+        fprintf(stderr, "Too many checkpoint hooks, '%s' ignored\n", key);
+        return;
+    }
+    campaign.hooks[campaign.hook_count].key = key;
+    campaign.hooks[campaign.hook_count].save = save;
+    campaign.hooks[campaign.hook_count].load = load;
+    campaign.hook_count++;
+}
+
+
+/**
+ * Reads the checkpoint of the working directory back in the campaign state
+ * @return 0 on success, -1 if there is no usable checkpoint
+ */
+static int load_checkpoint(void) {
+    FILE* file = fopen(CHECKPOINT_FILE, "r");
+    if (file == NULL) {
+        perror(CHECKPOINT_FILE);
+        return -1;
+    }
+
+    char line[MAX_CHECKPOINT_LINE];
+    int version = 0;
+    int rv = 0;
+    while (rv == 0 && fgets(line, sizeof(line), file) != NULL) {
+        line[strcspn(line, "\n")] = '\0';
+
+        char key[32];
+        int consumed = 0;
+        if (sscanf(line, "%31s %n", key, &consumed) != 1) {
+            continue;
+        }
+        const char* value = line + consumed;
+
+        if (strcmp(key, "fuzzer-checkpoint") == 0) {
+            version = atoi(value);
+        } else if (strcmp(key, "shard") == 0) {
+            unsigned int i, n, k, j;
+            if (sscanf(value, "%u %u %u %u", &i, &n, &k, &j) != 4 || i != campaign.shard_index ||
+                n != campaign.shard_count || k != campaign.worker_index || j != campaign.worker_count) {
+                fprintf(stderr, "The checkpoint was written by another shard (%s)\n", value);
+                rv = -1;
+            }
+        } else if (strcmp(key, "suite") == 0) {
+            char name[32];
+            unsigned int progress;
+            unsigned long executed, crashes;
+            if (sscanf(value, "%31s %u %lu %lu", name, &progress, &executed, &crashes) != 4) {
+                rv = -1;
+                continue;
+            }
+            for (int suite = 0; suite < SUITE_COUNT; suite++) {
+                if (strcmp(suite_names[suite], name) == 0) {
+                    campaign.progress[suite] = progress;
+                    campaign.executed[suite] = executed;
+                    campaign.crashes[suite] = crashes;
+                }
+            }
+        } else {
+            for (int h = 0; h < campaign.hook_count; h++) {
+                if (strcmp(campaign.hooks[h].key, key) == 0 && campaign.hooks[h].load(value) == -1) {
+                    fprintf(stderr, "Invalid '%s' state in the checkpoint\n", key);
+                    rv = -1;
+                }
+            }
+        }
+    }
+    fclose(file);
+
+    if (version != CHECKPOINT_VERSION) {
+        fprintf(stderr, "Unsupported checkpoint version %d\n", version);
+        rv = -1;
+    }
+    return rv;
+}
+
+
+int campaign_checkpoint(void) {
+    // Write a new file and rename it over the old one: a crash leaves either the old or the new checkpoint
+    FILE* file = fopen(CHECKPOINT_FILE ".tmp", "w");
+    if (file == NULL) {
+        perror(CHECKPOINT_FILE ".tmp");
+        return -1;
+    }
+
+    fprintf(file, "fuzzer-checkpoint %d\n", CHECKPOINT_VERSION);
+    fprintf(file, "shard %u %u %u %u\n",
+            campaign.shard_index, campaign.shard_count, campaign.worker_index, campaign.worker_count);
+    for (int suite = 0; suite < SUITE_COUNT; suite++) {
+        fprintf(file, "suite %s %u %lu %lu", suite_names[suite],
+                campaign.progress[suite], campaign.executed[suite], campaign.crashes[suite]);
+        // Position and character of the next test case of the field sweeps, for the humans reading it
+        if (suite <= SUITE_CHKSUM && campaign.progress[suite] != UINT_MAX) {
+            fprintf(file, " position=%u character=0x%02x", campaign.progress[suite] / 256, campaign.progress[suite] % 256);
+        }
+        fputc('\n', file);
+    }
+    for (int h = 0; h < campaign.hook_count; h++) {
+        fprintf(file, "%s ", campaign.hooks[h].key);
+        campaign.hooks[h].save(file);
+        fputc('\n', file);
+    }
+
+    if (fflush(file) == EOF || fsync(fileno(file)) == -1) {
+        perror(CHECKPOINT_FILE ".tmp");
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    if (rename(CHECKPOINT_FILE ".tmp", CHECKPOINT_FILE) == -1) {
+        perror(CHECKPOINT_FILE);
+        return -1;
+    }
+
+    campaign.last_checkpoint = time(NULL);
+    for (int h = 0; h < campaign.commit_hook_count; h++) {
+        campaign.commit_hooks[h]();
+    }
+    return 0;
+}
+
+
+int campaign_open(const char* out_dir, unsigned int shard_index, unsigned int shard_count,
+                  unsigned int worker_index, unsigned int worker_count,
+                  bool resume, unsigned int checkpoint_interval) {
+    campaign.shard_index = shard_index;
+    campaign.shard_count = shard_count;
+    campaign.worker_index = worker_index;
+    campaign.worker_count = worker_count;
+    campaign.checkpoint_interval = checkpoint_interval;
+    campaign.last_checkpoint = time(NULL);
+
+    // Stop cleanly between two test cases, so that the checkpoint does not skip an interrupted one
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_stop_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    // Legacy behaviour: work in the current directory without results file
+    if (out_dir == NULL) {
+        return resume ? load_checkpoint() : 0;
+    }
+
+    // The output directory is shared between the shards, it may already exist
+    if (mkdir(out_dir, 0755) == -1 && errno != EEXIST) {
+        perror(out_dir);
+        return -1;
+    }
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/results-%u-of-%u.%u-of-%u.tsv",
+             out_dir, shard_index, shard_count, worker_index, worker_count);
+    // A resumed shard keeps the records of its previous runs
+    campaign.results = fopen(path, resume ? "a" : "w");
+    if (campaign.results == NULL) {
+        perror(path);
+        return -1;
+    }
+    // One line per record, so that an interrupted shard still leaves complete lines
+    setvbuf(campaign.results, NULL, _IOLBF, 0);
+
+    // Each shard extracts in its own directory, the archive and file names of the suites are fixed
+    snprintf(path, sizeof(path), "%s/shard-%u-of-%u.%u-of-%u",
+             out_dir, shard_index, shard_count, worker_index, worker_count);
+    if (mkdir(path, 0755) == -1 && errno != EEXIST) {
+        perror(path);
+        return -1;
+    }
+    if (chdir(path) == -1) {
+        perror(path);
+        return -1;
+    }
+
+    return resume ? load_checkpoint() : 0;
+}
+
+
+static double monotonic_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+bool campaign_claim(enum suite suite, unsigned int index) {
+    // Already finished before the campaign was resumed
+    if (index < campaign.progress[suite]) {
+        return false;
+    }
+
+    // Offset by the suite so that the single test case suites do not all land on shard 0
+    unsigned int slot = index + (unsigned int) suite;
+    if (slot % campaign.shard_count != campaign.shard_index) {
+        return false;
+    }
+
+    // The local workers split the slice of the shard, whatever the number of workers of the other hosts
+    if ((slot / campaign.shard_count) % campaign.worker_count != campaign.worker_index) {
+        return false;
+    }
+
+    // The slice of the scheduler is spent: the test case is left for a later slice
+    if (campaign_slice_spent()) {
+        return false;
+    }
+
+    // The previous test case may have been interrupted by the signal: keep it in the checkpoint
+    if (stop_requested) {
+        campaign_checkpoint();
+        printf("Interrupted, the campaign can be continued with --resume.\n");
+        exit(130);
+    }
+
+    // Claiming a new test case means the previous one is finished
+    if (campaign.in_flight) {
+        campaign.progress[campaign.suite] = campaign.index + 1;
+    }
+
+    if (campaign.checkpoint_interval && time(NULL) - campaign.last_checkpoint >= campaign.checkpoint_interval) {
+        campaign_checkpoint();
+    }
+
+    campaign.suite = suite;
+    campaign.index = index;
+    campaign.in_flight = true;
+    campaign.executed[suite]++;
+    if (campaign.slice_end != 0) {
+        campaign.slice_executions--;
+    }
+    return true;
+}
+
+
+bool campaign_stop_requested(void) {
+    return stop_requested != 0;
+}
+
+
+unsigned int campaign_progress(enum suite suite) {
+    return campaign.progress[suite];
+}
+
+
+void campaign_start_slice(unsigned long executions, double seconds) {
+    campaign.slice_executions = executions;
+    campaign.slice_end = monotonic_seconds() + seconds;
+    campaign.slice_over = false;
+}
+
+
+bool campaign_end_slice(void) {
+    bool over = campaign.slice_over;
+    campaign.slice_end = 0;
+    campaign.slice_over = false;
+    return over;
+}
+
+
+bool campaign_slice_spent(void) {
+    if (campaign.slice_end == 0) {
+        return false;
+    }
+    if (!campaign.slice_over && campaign.slice_executions > 0 && monotonic_seconds() < campaign.slice_end) {
+        return false;
+    }
+    // The test case running when it was spent is finished
+    if (campaign.in_flight) {
+        campaign.progress[campaign.suite] = campaign.index + 1;
+        campaign.in_flight = false;
+    }
+    campaign.slice_over = true;
+    return true;
+}
+
+
+bool campaign_slice_over(void) {
+    return campaign.slice_over;
+}
+
+
+void campaign_totals(unsigned long* executed, unsigned long* crashes) {
+    *executed = 0;
+    *crashes = 0;
+    for (int suite = 0; suite < SUITE_COUNT; suite++) {
+        *executed += campaign.executed[suite];
+        *crashes += campaign.crashes[suite];
+    }
+}
+
+
+uint64_t campaign_case_id(void) {
+    return ((uint64_t) campaign.suite << 32) | campaign.index;
+}
+
+
+void campaign_record_crash(const char* artifact) {
+    campaign.crashes[campaign.suite]++;
+
+    // The field sweeps do not go further once they found a crash
+    if (SUITE_STOPS_AT_CRASH(campaign.suite)) {
+        campaign.progress[campaign.suite] = UINT_MAX;
+    } else {
+        campaign.progress[campaign.suite] = campaign.index + 1;
+    }
+    campaign.in_flight = false;
+
+    for (int h = 0; h < campaign.crash_hook_count; h++) {
+        campaign.crash_hooks[h](artifact);
+    }
+    if (campaign.results == NULL) {
+        return;
+    }
+
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        strcpy(cwd, ".");
+    }
+
+    // suite, index, outcome, detail: sorting on the first two columns merges the shards
+    fprintf(campaign.results, "%s\t%u\tcrash\t%s/%s\n",
+            suite_name(campaign.suite), campaign.index, cwd, artifact);
+}
+
+
+void campaign_add_crash_hook(void (*hook)(const char* artifact)) {
+    if (campaign.crash_hook_count == MAX_CRASH_HOOKS) {
+        fprintf(stderr, "Too many crash hooks, one ignored\n");
+        return;
+    }
+    campaign.crash_hooks[campaign.crash_hook_count++] = hook;
+}
+
+
+void campaign_add_commit_hook(void (*hook)(void)) {
+    if (campaign.commit_hook_count == MAX_COMMIT_HOOKS) {
+        fprintf(stderr, "Too many commit hooks, one ignored\n");
+        return;
+    }
+    campaign.commit_hooks[campaign.commit_hook_count++] = hook;
+}
+
+
+void campaign_record_finding(const char* outcome, const char* artifact, const char* detail) {
+    campaign_record_case_finding(campaign_case_id(), outcome, artifact, detail);
+}
+
+
+void campaign_record_case_finding(uint64_t case_id, const char* outcome, const char* artifact, const char* detail) {
+    if (campaign.results == NULL) {
+        return;
+    }
+
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        strcpy(cwd, ".");
+    }
+    fprintf(campaign.results, "%s\t%u\t%s\t%s/%s\t%s\n",
+            suite_name(case_id >> 32), (unsigned int) case_id, outcome, cwd, artifact, detail);
+}
+
+
+void campaign_close(bool finished) {
+    if (campaign.in_flight) {
+        campaign.progress[campaign.suite] = campaign.index + 1;
+        campaign.in_flight = false;
+    }
+    // Nothing left to do for a resumed run
+    campaign_checkpoint();
+
+    if (campaign.results == NULL) {
+        return;
+    }
+
+    // Test cases left (budget spent): the merge reports the shard as incomplete until a resumed run finishes it
+    for (int suite = 0; suite < SUITE_COUNT; suite++) {
+        fprintf(campaign.results, "%s\t*\t%s\texecuted=%lu crashes=%lu\n", suite_name(suite),
+                finished ? "summary" : "unfinished", campaign.executed[suite], campaign.crashes[suite]);
+    }
+
+    fclose(campaign.results);
+    campaign.results = NULL;
+}
+
+
+// A crash line of a results file, kept to print the merged results in test case order
+struct merged_crash {
+    int suite;
+    unsigned long index;
+    char* line;
+};
+
+
+static int compare_merged_crash(const void* a, const void* b) {
+    const struct merged_crash* x = a;
+    const struct merged_crash* y = b;
+    if (x->suite != y->suite) {
+        return x->suite < y->suite ? -1 : 1;
+    }
+    if (x->index != y->index) {
+        return x->index < y->index ? -1 : 1;
+    }
+    return 0;
+}
+
+
+int suite_from_name(const char* name) {
+    for (int suite = 0; suite < SUITE_COUNT; suite++) {
+        if (strcmp(suite_names[suite], name) == 0) {
+            return suite;
+        }
+    }
+    return -1;
+}
+
+
+int campaign_merge(const char* out_dir) {
+    DIR* dir = opendir(out_dir);
+    if (dir == NULL) {
+        perror(out_dir);
+        return -1;
+    }
+
+    unsigned long executed[SUITE_COUNT] = {0};
+    unsigned long crashes[SUITE_COUNT] = {0};
+    struct merged_crash* merged = NULL;
+    size_t merged_count = 0;
+    size_t merged_capacity = 0;
+
+    // Workers that finished, per shard (all the results files must agree on the number of shards)
+    unsigned int shard_count = 0;
+    unsigned int* finished = NULL;
+    unsigned int* expected = NULL;
+    int rv = 0;
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        unsigned int i, n, k, j;
+        char tail;
+        if (sscanf(entry->d_name, "results-%u-of-%u.%u-of-%u.ts%c", &i, &n, &k, &j, &tail) != 5 || tail != 'v') {
+            continue;
+        }
+        if (n == 0 || i >= n || j == 0 || k >= j) {
+            continue;
+        }
+
+        if (shard_count == 0) {
+            shard_count = n;
+            finished = calloc(n, sizeof(unsigned int));
+            expected = calloc(n, sizeof(unsigned int));
+        } else if (n != shard_count) {
+            fprintf(stderr, "%s: %u shards instead of %u, ignored\n", entry->d_name, n, shard_count);
+            rv = 1;
+            continue;
+        }
+        expected[i] = j;
+
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", out_dir, entry->d_name);
+        FILE* file = fopen(path, "r");
+        if (file == NULL) {
+            perror(path);
+            rv = 1;
+            continue;
+        }
+
+        char line[PATH_MAX + 128];
+        bool complete = false;
+        bool unfinished = false;
+        unsigned long file_executed[SUITE_COUNT] = {0};
+        unsigned long file_crashes[SUITE_COUNT] = {0};
+        while (fgets(line, sizeof(line), file) != NULL) {
+            char name[32], index[32], outcome[32];
+            unsigned long count_executed, count_crashes;
+            if (sscanf(line, "%31[^\t]\t%31[^\t]\t%31[^\t]\t", name, index, outcome) != 3) {
+                continue;
+            }
+            int suite = suite_from_name(name);
+            if (suite == -1) {
+                continue;
+            }
+
+            if (strcmp(outcome, "summary") == 0 || strcmp(outcome, "unfinished") == 0) {
+                // A resumed shard writes cumulative summaries again, only the last ones count
+                char* detail = strrchr(line, '\t') + 1;
+                if (sscanf(detail, "executed=%lu crashes=%lu", &count_executed, &count_crashes) == 2) {
+                    file_executed[suite] = count_executed;
+                    file_crashes[suite] = count_crashes;
+                    unfinished = strcmp(outcome, "unfinished") == 0;
+                    complete = !unfinished;
+                }
+            } else {
+                if (merged_count == merged_capacity) {
+                    merged_capacity = merged_capacity ? merged_capacity * 2 : 64;
+                    merged = realloc(merged, merged_capacity * sizeof(struct merged_crash));
+                }
+                merged[merged_count].suite = suite;
+                merged[merged_count].index = strtoul(index, NULL, 10);
+                merged[merged_count].line = strdup(line);
+                merged_count++;
+            }
+        }
+        fclose(file);
+
+        for (int suite = 0; suite < SUITE_COUNT; suite++) {
+            executed[suite] += file_executed[suite];
+            crashes[suite] += file_crashes[suite];
+        }
+
+        if (complete) {
+            finished[i]++;
+        } else if (unfinished) {
+            printf("Shard %u/%u worker %u/%u stopped with test cases left (budget spent), continue it with --resume.\n",
+                   i, n, k, j);
+            rv = 1;
+        } else {
+            printf("Shard %u/%u worker %u/%u has not finished yet.\n", i, n, k, j);
+            rv = 1;
+        }
+    }
+    closedir(dir);
+
+    if (shard_count == 0) {
+        fprintf(stderr, "No results file found in %s\n", out_dir);
+        return -1;
+    }
+
+    for (unsigned int i = 0; i < shard_count; i++) {
+        if (expected[i] == 0 || finished[i] < expected[i]) {
+            printf("Shard %u/%u is missing or incomplete.\n", i, shard_count);
+            rv = 1;
+        }
+    }
+
+    qsort(merged, merged_count, sizeof(struct merged_crash), compare_merged_crash);
+    for (size_t m = 0; m < merged_count; m++) {
+        fputs(merged[m].line, stdout);
+        free(merged[m].line);
+    }
+    for (int suite = 0; suite < SUITE_COUNT; suite++) {
+        printf("%s\t*\tsummary\texecuted=%lu crashes=%lu\n", suite_names[suite], executed[suite], crashes[suite]);
+    }
+
+    free(merged);
+    free(finished);
+    free(expected);
+    return rv;
+}
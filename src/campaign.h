@@ -0,0 +1,214 @@
+#ifndef FUZZER_CAMPAIGN_H
+#define FUZZER_CAMPAIGN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Every group of test cases the fuzzer can run.
+ * A test case is identified by its suite and an index inside that suite,
+ * the index being stable from one run to another (e.g. position * 256 + character for the field sweeps).
+ */
+enum suite {
+    SUITE_NAME,
+    SUITE_MODE,
+    SUITE_UID,
+    SUITE_GID,
+    SUITE_SIZE,
+    SUITE_MTIME,
+    SUITE_TYPEFLAG,
+    SUITE_LINKNAME,
+    SUITE_MAGIC,
+    SUITE_VERSION,
+    SUITE_UNAME,
+    SUITE_GNAME,
+    SUITE_CHKSUM,
+    SUITE_CHECKSUM,
+    SUITE_NULL,
+    SUITE_FILESIZE,
+    SUITE_NUMERIC,
+    SUITE_OCTAL,
+    SUITE_MEMBERS,
+    SUITE_GRAPH,
+    SUITE_EXTENSION,
+    SUITE_TRUNCATION,
+    SUITE_FAULT,
+    SUITE_CORPUS,
+    SUITE_HEADER,
+    SUITE_COUNT
+};
+
+/**
+ * Returns the name of a suite, as used in the results files
+ * @param suite the suite
+ * @return a static string
+ */
+const char* suite_name(enum suite suite);
+
+/**
+ * Finds a suite from its name
+ * @param name the name of the suite, as used in the results files
+ * @return the suite, -1 if there is none with this name
+ */
+int suite_from_name(const char* name);
+
+/**
+ * Parses a shard specification of the form "i/N" (0 <= i < N)
+ * @param arg the string to parse
+ * @param index where to store i
+ * @param count where to store N
+ * @return 0 on success, -1 if the specification is invalid
+ */
+int campaign_parse_shard(const char* arg, unsigned int* index, unsigned int* count);
+
+/**
+ * Starts the campaign of this process.
+ * When out_dir is NULL the fuzzer works in the current directory and no results file is written.
+ * Otherwise a private working directory "<out_dir>/shard-i-of-N.k-of-J" is created and becomes the current directory,
+ * and the results are written to "<out_dir>/results-i-of-N.k-of-J.tsv".
+ * @param out_dir the shared output directory, or NULL
+ * @param shard_index index of the shard handled by this host
+ * @param shard_count total number of shards
+ * @param worker_index index of this process among the local workers of the shard
+ * @param worker_count number of local workers sharing the shard
+ * @param resume continue from the checkpoint of the working directory instead of starting over
+ * @param checkpoint_interval seconds between two checkpoints, 0 to only write one at the end
+ * @return 0 on success, -1 on error
+ */
+int campaign_open(const char* out_dir, unsigned int shard_index, unsigned int shard_count,
+                  unsigned int worker_index, unsigned int worker_count,
+                  bool resume, unsigned int checkpoint_interval);
+
+/**
+ * Registers some state of another module to be saved in the checkpoint, as a line "<key> <value>".
+ * Has to be called before campaign_open() for the state to be restored by --resume.
+ * @param key name of the line in the checkpoint file
+ * @param save writes the value (without new line) to the checkpoint file
+ * @param load restores the state from the value, returns -1 if it is invalid
+ */
+void campaign_add_checkpoint_hook(const char* key, void (*save)(FILE* file), int (*load)(const char* value));
+
+/**
+ * Writes the progress of every suite, the statistics and the registered states to the checkpoint file.
+ * The file is replaced atomically, an interrupted write leaves the previous checkpoint.
+ * @return 0 on success, -1 on error
+ */
+int campaign_checkpoint(void);
+
+/**
+ * Decides if a test case belongs to this process and marks it as the current one if so.
+ * The assignment is deterministic and balanced: every suite is split evenly between the shards.
+ * Test cases finished before a resume are not claimed again.
+ * Claiming also writes the periodic checkpoints, and stops the process after one if SIGINT/SIGTERM was received.
+ * @param suite the suite of the test case
+ * @param index the index of the test case inside its suite
+ * @return true if the test case has to be executed by this process
+ */
+bool campaign_claim(enum suite suite, unsigned int index);
+
+/**
+ * @return whether SIGINT/SIGTERM was received: the current test case may have been cut short, the process stops at
+ * the next campaign_claim()
+ */
+bool campaign_stop_requested(void);
+
+/**
+ * @param suite the suite
+ * @return the first test case of the suite this process has not finished, those before it are never claimed again
+ */
+unsigned int campaign_progress(enum suite suite);
+
+/**
+ * Starts a slice of the scheduler: once it claimed a number of test cases or after some time, campaign_claim()
+ * refuses the other test cases without marking them finished, so that the suite running returns quickly and
+ * can go on from there in a later slice
+ * @param executions number of test cases of the slice
+ * @param seconds duration of the slice
+ */
+void campaign_start_slice(unsigned long executions, double seconds);
+
+/**
+ * Ends the slice, the test cases are claimed without limit again
+ * @return true if the slice was spent: a test case was refused, the suite that ran may not be finished
+ */
+bool campaign_end_slice(void);
+
+/**
+ * Tells if the slice is spent, as campaign_claim() would: no other test case is claimed in it
+ * @return true if the slice is spent, false without a slice
+ */
+bool campaign_slice_spent(void);
+
+/**
+ * @return true if a test case was refused since the slice started: the suite that ran may not be finished
+ */
+bool campaign_slice_over(void);
+
+/**
+ * Counts what this process did, every suite together, the runs before a resume included
+ * @param executed where to store the number of test cases executed
+ * @param crashes where to store the number of crashes
+ */
+void campaign_totals(unsigned long* executed, unsigned long* crashes);
+
+/**
+ * @return the identifier of the current test case: suite in the high 32 bits, index in the low ones
+ */
+uint64_t campaign_case_id(void);
+
+/**
+ * Records a crash of the current test case in the results file
+ * @param artifact name of the archive that made the extractor crash
+ */
+void campaign_record_crash(const char* artifact);
+
+/**
+ * Registers a function called with every crash recorded, e.g. to save a report next to the archive.
+ * The hooks are called in the order they were added.
+ * @param hook called with the name of the archive, relative to the current directory
+ */
+void campaign_add_crash_hook(void (*hook)(const char* artifact));
+
+/**
+ * Registers a function called each time a checkpoint was written: what the test cases it marks finished did can
+ * be made final, --resume will not run them again
+ * @param hook called after the checkpoint file is replaced
+ */
+void campaign_add_commit_hook(void (*hook)(void));
+
+/**
+ * Records another kind of finding of the current test case in the results file (e.g. a resource bug).
+ * Unlike a crash, it does not stop the field sweeps.
+ * @param outcome the kind of finding, third column of the results file
+ * @param artifact name of the archive, in the current directory
+ * @param detail what was found, on one line
+ */
+void campaign_record_finding(const char* outcome, const char* artifact, const char* detail);
+
+/**
+ * Records a finding of any test case in the results file, e.g. the confirmation of a crash by another process
+ * @param case_id the test case, see campaign_case_id()
+ * @param outcome the kind of finding, third column of the results file
+ * @param artifact name of the file of the finding, in the working directory
+ * @param detail what was found
+ */
+void campaign_record_case_finding(uint64_t case_id, const char* outcome, const char* artifact, const char* detail);
+
+/**
+ * Writes the per-suite statistics and closes the results file
+ * @param finished whether every test case was run: otherwise (budget of the scheduler spent) the statistics are
+ *                 written as "unfinished" lines instead of "summary" ones, and the merge reports the shard as
+ *                 incomplete
+ */
+void campaign_close(bool finished);
+
+/**
+ * Merges the results files of all the shards found in a directory and prints them.
+ * Reports the shards that are missing or did not finish, stopped with their budget spent included.
+ * @param out_dir the shared output directory
+ * @return 0 if every shard finished, 1 if some are missing, -1 on error
+ */
+int campaign_merge(const char* out_dir);
+
+#endif
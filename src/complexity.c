@@ -0,0 +1,668 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "complexity.h"
+#include "archive.h"
+#include "executor.h"
+#include "mutate.h"
+#include "numeric.h"
+#include "prng.h"
+#include "scratch.h"
+#include "tar.h"
+
+
+// Number of inputs kept in the corpus, and number of worst inputs saved at the end
+#define CORPUS_SIZE 16
+#define REPORTED 8
+
+// An input that would enter the corpus is measured this many times, the lowest cost is kept: the noise of a
+// single execution is not an improvement
+#define MEASUREMENTS 3
+
+// Archive given to the extractor
+#define CANDIDATE "complexity_candidate.tar"
+
+// Number of mutations stacked on a parent, at most
+#define MAX_STACKED 4
+
+static const struct {
+    const char* name;
+    const char* unit;
+} metrics[COMPLEXITY_METRIC_COUNT] = {
+    [COMPLEXITY_CPU] = {"cpu", "ms"},
+    [COMPLEXITY_INSTRUCTIONS] = {"instructions", "instructions"},
+    [COMPLEXITY_RSS] = {"rss", "KB"},
+};
+
+// Numeric fields set by the mutations: offset and width in the header
+static const struct {
+    size_t offset;
+    size_t width;
+} numeric_fields[] = {
+    {124, 12}, // size, picked more often than the others
+    {124, 12},
+    {124, 12},
+    {100, 8},  // mode
+    {108, 8},  // uid
+    {116, 8},  // gid
+    {136, 12}, // mtime
+};
+#define NUMERIC_FIELD_COUNT (sizeof(numeric_fields) / sizeof(numeric_fields[0]))
+
+enum mutation {
+    MUTATION_NUMERIC,
+    MUTATION_DUPLICATE,
+    MUTATION_DEEP_PATH,
+    MUTATION_COPY_RANGE,
+    MUTATION_REMOVE,
+    MUTATION_TRUNCATE,
+    MUTATION_COUNT
+};
+
+static const char* mutation_names[MUTATION_COUNT] = {
+    [MUTATION_NUMERIC] = "numeric",
+    [MUTATION_DUPLICATE] = "duplicate",
+    [MUTATION_DEEP_PATH] = "deep path",
+    [MUTATION_COPY_RANGE] = "copy range",
+    [MUTATION_REMOVE] = "remove",
+    [MUTATION_TRUNCATE] = "truncate",
+};
+
+// Share of the mutations (in %), those that make the extractor work more come first
+static const unsigned int weights[MUTATION_COUNT] = {
+    [MUTATION_NUMERIC] = 30,
+    [MUTATION_DUPLICATE] = 25,
+    [MUTATION_DEEP_PATH] = 15,
+    [MUTATION_COPY_RANGE] = 15,
+    [MUTATION_REMOVE] = 10,
+    [MUTATION_TRUNCATE] = 5,
+};
+
+// An input that entered the corpus, kept after it is evicted for the cost curves of its descendants
+struct ancestor {
+    // Index of the input it was mutated from, -1 for a seed
+    long parent;
+    unsigned int generation;
+    // Execution that found it
+    unsigned long execution;
+    double cost;
+    size_t length;
+    char how[48];
+};
+
+// An input of the corpus
+struct entry {
+    unsigned char* bytes;
+    size_t length;
+    double cost;
+    size_t ancestor;
+};
+
+static struct ancestor* ancestors = NULL;
+static size_t ancestor_count = 0;
+static size_t ancestor_capacity = 0;
+
+static struct entry corpus[CORPUS_SIZE];
+static int corpus_count = 0;
+
+static unsigned char candidate[COMPLEXITY_MAX_LENGTH];
+static size_t candidate_length;
+
+
+int complexity_parse_metric(const char* name) {
+    for (int m = 0; m < COMPLEXITY_METRIC_COUNT; m++) {
+        if (strcmp(metrics[m].name, name) == 0) {
+            return m;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * @return the unit of the metric, which depends on the counter for the instructions
+ */
+static const char* metric_unit(enum complexity_metric metric) {
+    if (metric == COMPLEXITY_INSTRUCTIONS && executor_counter() == COUNTER_TASK_CLOCK) {
+        return "ns (task clock)";
+    }
+    return metrics[metric].unit;
+}
+
+
+/**
+ * Copies an archive built with the archive builder into the candidate
+ */
+static void flatten(const struct archive* archive) {
+    struct iovec parts[ARCHIVE_MAX_PARTS];
+    size_t length;
+    int count = archive_parts(archive, parts, &length);
+
+    candidate_length = 0;
+    for (int i = 0; i < count; i++) {
+        size_t len = parts[i].iov_len;
+        if (candidate_length + len > COMPLEXITY_MAX_LENGTH) {
+            len = COMPLEXITY_MAX_LENGTH - candidate_length;
+        }
+        memcpy(candidate + candidate_length, parts[i].iov_base, len);
+        candidate_length += len;
+    }
+}
+
+
+/**
+ * Builds a seed in the candidate: the archives of test_filesize(), then those of test_multiple_members()
+ * (with their 2 end blocks)
+ * @param index the seed
+ * @param how where to describe it
+ * @param len size of how
+ * @return false if there is no such seed
+ */
+static bool build_seed(unsigned int index, char* how, size_t len) {
+    static const int member_counts[] = {2, 3, 8};
+    static const int data_sizes[] = {0, 1, 511, 512, 513};
+    static char data[513];
+    struct tar_t headers[8];
+    memset(data, 'a', sizeof(data));
+
+    struct archive archive;
+    archive_init(&archive);
+
+    if (index < 8) {
+        bool too_big = index & 1;
+        bool with_data = index & 2;
+        bool multiple_files = index & 4;
+        int data_len = with_data ? 20 : 0;
+
+        generate_tar_header(&headers[0], "file.txt", "0000664", "0001750", "0001750",
+                            too_big ? "77777779999" : "00000000001",
+                            "14413537165", "0", "", "ustar", "00", "michal", "michal");
+        calculate_checksum(&headers[0]);
+        generate_tar_header(&headers[1], "file2.txt", "0000664", "0001750", "0001750",
+                            with_data ? "00000000024" : "00000000000",
+                            "14413537165", "0", "", "ustar", "00", "michal", "michal");
+        calculate_checksum(&headers[1]);
+
+        archive_add_member(&archive, &headers[0], data, data_len, true);
+        if (multiple_files) {
+            archive_add_member(&archive, &headers[1], data, data_len, true);
+        }
+        snprintf(how, len, "filesize %s%s%s", too_big ? "big" : "small", with_data ? ", data" : "",
+                 multiple_files ? ", 2 files" : "");
+    } else if (index < 8 + 15) {
+        int members = member_counts[(index - 8) / 5];
+        int data_size = data_sizes[(index - 8) % 5];
+        char size[12];
+        char names[8][24];
+        snprintf(size, sizeof(size), "%011o", data_size);
+
+        for (int i = 0; i < members; i++) {
+            snprintf(names[i], sizeof(names[i]), "file%d.txt", i + 1);
+            generate_tar_header(&headers[i], names[i], "0000664", "0001750", "0001750", size,
+                                "14413537165", "0", "", "ustar", "00", "michal", "michal");
+            calculate_checksum(&headers[i]);
+            archive_add_member(&archive, &headers[i], data, data_size, true);
+        }
+        archive_end(&archive, 2);
+        snprintf(how, len, "%d members of %d bytes", members, data_size);
+    } else {
+        return false;
+    }
+
+    flatten(&archive);
+    return true;
+}
+
+
+/**
+ * Parses the size field of a header, as octal
+ * @return the size, or 0 if the field is not octal
+ */
+static size_t header_size(const unsigned char* header) {
+    size_t size = 0;
+    for (size_t i = 124; i < 136 && header[i] >= '0' && header[i] <= '7'; i++) {
+        size = size * 8 + (header[i] - '0');
+    }
+    return size;
+}
+
+
+/**
+ * Sets a numeric field of a header to a random value: sizes up to COMPLEXITY_MAX_SIZE, mostly small,
+ * any 21-bit value for the other fields
+ */
+static void mutate_numeric(struct prng* prng, unsigned char* header) {
+    unsigned int field = (unsigned int) prng_below(prng, NUMERIC_FIELD_COUNT);
+    struct numeric_value value = {false, 0};
+
+    if (numeric_fields[field].offset == 124) {
+        // Log-uniform, so that small sizes (a few blocks) are as likely as the big ones
+        unsigned int bits = (unsigned int) prng_below(prng, 25);
+        value.magnitude = prng_below(prng, (uint64_t) 1 << bits);
+    } else {
+        value.magnitude = prng_below(prng, 1 << 21);
+    }
+
+    static const enum numeric_encoding encodings[] = {OCTAL_NUL, OCTAL_NUL, OCTAL_SPACE, OCTAL_FULL, BASE256};
+    enum numeric_encoding encoding = encodings[prng_below(prng, sizeof(encodings) / sizeof(encodings[0]))];
+    numeric_encode((char*) header + numeric_fields[field].offset, numeric_fields[field].width, value, encoding);
+}
+
+
+/**
+ * Copies a member (its header and its data) right after itself, or at the end of the input
+ * @param member where to copy it, it has to live as long as the archive
+ */
+static void mutate_duplicate(struct prng* prng, struct archive* archive, size_t header, unsigned char* member) {
+    size_t length = archive_gather(archive, header, member, TAR_BLOCK_SIZE);
+    if (length == TAR_BLOCK_SIZE) {
+        size_t data = (header_size(member) + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+        if (data > COMPLEXITY_MAX_LENGTH - TAR_BLOCK_SIZE) {
+            data = COMPLEXITY_MAX_LENGTH - TAR_BLOCK_SIZE;
+        }
+        length += archive_gather(archive, header + TAR_BLOCK_SIZE, member + TAR_BLOCK_SIZE, data);
+    }
+
+    size_t offset = prng_below(prng, 2) ? header + length : archive->length;
+    unsigned int copies = 1 + (unsigned int) prng_below(prng, 8);
+    for (unsigned int i = 0; i < copies; i++) {
+        archive_splice(archive, offset, 0, member, length);
+    }
+}
+
+
+/**
+ * Makes the name or the prefix of a header a long path of short components ("a/a/a/...")
+ */
+static void mutate_deep_path(struct prng* prng, unsigned char* header) {
+    static const struct {
+        size_t offset;
+        size_t width;
+    } paths[] = {{0, 100}, {345, 155}};
+
+    unsigned int which = (unsigned int) prng_below(prng, 2);
+    size_t depth = 1 + prng_below(prng, paths[which].width / 2 - 1);
+    char* path = (char*) header + paths[which].offset;
+    char component = (char) ('a' + prng_below(prng, 26));
+
+    memset(path, 0, paths[which].width);
+    for (size_t i = 0; i < depth; i++) {
+        path[2 * i] = component;
+        path[2 * i + 1] = '/';
+    }
+    // A name ends with a file, a prefix with a directory
+    if (which == 0) {
+        path[2 * depth - 1] = '\0';
+    }
+}
+
+
+/**
+ * Fixes the checksum of every header of the candidate
+ */
+static void fix_checksums(void) {
+    for (size_t offset = 0; offset + TAR_BLOCK_SIZE <= candidate_length; offset += TAR_BLOCK_SIZE) {
+        if (memcmp(candidate + offset + 257, "ustar", 5) == 0) {
+            struct tar_t header;
+            memcpy(&header, candidate + offset, sizeof(header));
+            calculate_checksum(&header);
+            memcpy(candidate + offset, &header, sizeof(header));
+        }
+    }
+}
+
+
+/**
+ * Builds the candidate from an input of the corpus with a few random mutations: those that make the extractor
+ * work more, and the generic ones of the truncation mutator. The archive points at the input, only the blocks
+ * changed are copied.
+ * @return the first mutation applied
+ */
+static enum mutation mutate(struct prng* prng, const struct entry* parent) {
+    static struct mutation_case mutation;
+    static unsigned char copies[MAX_STACKED][COMPLEXITY_MAX_LENGTH];
+    archive_init(&mutation.archive);
+    archive_add_raw(&mutation.archive, parent->bytes, parent->length);
+    mutation.description[0] = '\0';
+
+    struct archive* archive = &mutation.archive;
+    unsigned int stacked = 1 + (unsigned int) prng_below(prng, MAX_STACKED);
+    enum mutation first = 0;
+
+    for (unsigned int s = 0; s < stacked; s++) {
+        unsigned int roll = (unsigned int) prng_below(prng, 100);
+        enum mutation kind = 0;
+        while (kind < MUTATION_COUNT - 1 && roll >= weights[kind]) {
+            roll -= weights[kind];
+            kind++;
+        }
+
+        size_t header = mutate_pick_header(prng, archive);
+        if (header + TAR_BLOCK_SIZE > archive->length) {
+            // Too short for a header
+            kind = MUTATION_COPY_RANGE;
+        }
+        if (s == 0) {
+            first = kind;
+        }
+
+        size_t offset = mutate_pick_offset(prng, archive->length);
+        switch (kind) {
+            case MUTATION_NUMERIC:
+            case MUTATION_DEEP_PATH:
+                // In a copy of the header, put in place of it
+                archive_gather(archive, header, copies[s], TAR_BLOCK_SIZE);
+                if (kind == MUTATION_NUMERIC) {
+                    mutate_numeric(prng, copies[s]);
+                } else {
+                    mutate_deep_path(prng, copies[s]);
+                }
+                archive_splice(archive, header, TAR_BLOCK_SIZE, copies[s], TAR_BLOCK_SIZE);
+                break;
+            case MUTATION_DUPLICATE:
+                mutate_duplicate(prng, archive, header, copies[s]);
+                break;
+            case MUTATION_COPY_RANGE: {
+                size_t from = mutate_pick_offset(prng, archive->length);
+                size_t len = archive_gather(archive, from, copies[s], 1 + prng_below(prng, 4 * TAR_BLOCK_SIZE));
+                archive_splice(archive, offset, 0, copies[s], len);
+                break;
+            }
+            case MUTATION_REMOVE:
+                mutate_generic(prng, &mutation, MUTATE_REMOVE, offset, mutate_pick_length(prng));
+                break;
+            default:
+                mutate_generic(prng, &mutation, MUTATE_TRUNCATE, offset, 0);
+                break;
+        }
+    }
+    flatten(archive);
+
+    // Most of the time: a wrong checksum stops most extractors before anything expensive
+    if (prng_below(prng, 10) != 0) {
+        fix_checksums();
+    }
+    return first;
+}
+
+
+/**
+ * Checks that the extractor cannot create anything outside of its directory: the mutations move the headers,
+ * so every block is checked as if it was one. No absolute path or "..", no FIFO or device node
+ * (an extractor running as root would create real ones).
+ */
+static bool safe_to_extract(void) {
+    static const struct {
+        size_t offset;
+        size_t width;
+    } paths[] = {{0, 100}, {157, 100}, {345, 155}};
+
+    for (size_t block = 0; block < candidate_length; block += TAR_BLOCK_SIZE) {
+        size_t available = candidate_length - block;
+        for (int p = 0; p < 3; p++) {
+            if (paths[p].offset >= available) {
+                continue;
+            }
+            const char* path = (const char*) candidate + block + paths[p].offset;
+            size_t width = paths[p].width < available - paths[p].offset ? paths[p].width : available - paths[p].offset;
+            if (path[0] == '/' || memmem(path, width, "..", 2) != NULL) {
+                return false;
+            }
+        }
+        if (available > 156) {
+            char typeflag = (char) candidate[block + 156];
+            if (typeflag == '3' || typeflag == '4' || typeflag == '6') {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+/**
+ * Runs the extractor on the candidate
+ * @return the cost of the execution, -1 if the extractor could not be launched
+ */
+static double measure(const char* extractor, enum complexity_metric metric) {
+    struct archive archive;
+    archive_init(&archive);
+    archive_add_raw(&archive, candidate, candidate_length);
+    if (archive_write(&archive, CANDIDATE) == -1) {
+        return -1;
+    }
+
+    struct execution execution;
+    int rv = executor_run(extractor, COMPLEXITY_DIRECTORY, CANDIDATE, false, &execution);
+    scratch_clean(COMPLEXITY_DIRECTORY);
+    if (rv == -1) {
+        return -1;
+    }
+
+    switch (metric) {
+        case COMPLEXITY_CPU:
+            return execution.user_time + execution.sys_time;
+        case COMPLEXITY_INSTRUCTIONS:
+            return (double) execution.counter;
+        default:
+            return (double) execution.max_rss;
+    }
+}
+
+
+/**
+ * Adds the candidate to the corpus if it costs more than the cheapest input, which is then evicted
+ * @return true if it was added
+ */
+static bool keep(double cost, long parent, unsigned long execution, const char* how) {
+    int slot = corpus_count;
+    if (corpus_count == CORPUS_SIZE) {
+        slot = 0;
+        for (int i = 1; i < corpus_count; i++) {
+            if (corpus[i].cost < corpus[slot].cost) {
+                slot = i;
+            }
+        }
+        if (cost <= corpus[slot].cost) {
+            return false;
+        }
+        free(corpus[slot].bytes);
+    } else {
+        corpus_count++;
+    }
+
+    if (ancestor_count == ancestor_capacity) {
+        ancestor_capacity = ancestor_capacity ? ancestor_capacity * 2 : 256;
+        ancestors = realloc(ancestors, ancestor_capacity * sizeof(*ancestors));
+        if (ancestors == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    struct ancestor* ancestor = &ancestors[ancestor_count];
+    ancestor->parent = parent;
+    ancestor->generation = parent == -1 ? 0 : ancestors[parent].generation + 1;
+    ancestor->execution = execution;
+    ancestor->cost = cost;
+    ancestor->length = candidate_length;
+    snprintf(ancestor->how, sizeof(ancestor->how), "%s", how);
+
+    corpus[slot].bytes = malloc(candidate_length ? candidate_length : 1);
+    if (corpus[slot].bytes == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    memcpy(corpus[slot].bytes, candidate, candidate_length);
+    corpus[slot].length = candidate_length;
+    corpus[slot].cost = cost;
+    corpus[slot].ancestor = ancestor_count++;
+    return true;
+}
+
+
+/**
+ * @return the input of the corpus to mutate: the most expensive of two picked at random
+ */
+static int select_parent(struct prng* prng) {
+    int a = (int) prng_below(prng, corpus_count);
+    int b = (int) prng_below(prng, corpus_count);
+    return corpus[a].cost >= corpus[b].cost ? a : b;
+}
+
+
+static int compare_cost(const void* a, const void* b) {
+    double ca = ((const struct entry*) a)->cost;
+    double cb = ((const struct entry*) b)->cost;
+    return ca < cb ? 1 : ca > cb ? -1 : 0;
+}
+
+
+/**
+ * Saves the worst inputs and prints them with their cost curve, from the seed to the input
+ */
+static int report(enum complexity_metric metric, unsigned long executions) {
+    qsort(corpus, corpus_count, sizeof(corpus[0]), compare_cost);
+
+    FILE* file = fopen("complexity_report.tsv", "w");
+    if (file == NULL) {
+        perror("complexity_report.tsv");
+        return -1;
+    }
+    fprintf(file, "rank\tartifact\tcost\tunit\tlength\tgeneration\tcurve\n");
+
+    printf("\033[1;32m~~~~~%lu executions, worst inputs by %s (%s):~~~~~\033[0m\n", executions,
+           metrics[metric].name, metric_unit(metric));
+
+    for (int rank = 0; rank < corpus_count && rank < REPORTED; rank++) {
+        char artifact[64];
+        snprintf(artifact, sizeof(artifact), "complexity_worst_%d.tar", rank + 1);
+        struct archive archive;
+        archive_init(&archive);
+        archive_add_raw(&archive, corpus[rank].bytes, corpus[rank].length);
+        archive_write(&archive, artifact);
+
+        const struct ancestor* ancestor = &ancestors[corpus[rank].ancestor];
+        printf("        > %s: cost %.0f, %zu bytes, generation %u\n", artifact, corpus[rank].cost,
+               corpus[rank].length, ancestor->generation);
+        fprintf(file, "%d\t%s\t%.0f\t%s\t%zu\t%u\t", rank + 1, artifact, corpus[rank].cost, metric_unit(metric),
+                corpus[rank].length, ancestor->generation);
+
+        // From the input back to its seed
+        for (long a = (long) corpus[rank].ancestor; a != -1; a = ancestors[a].parent) {
+            printf("            generation %u, execution %lu: cost %.0f, %zu bytes (%s)\n", ancestors[a].generation,
+                   ancestors[a].execution, ancestors[a].cost, ancestors[a].length, ancestors[a].how);
+            fprintf(file, "%s%.0f@%u", a == (long) corpus[rank].ancestor ? "" : ",", ancestors[a].cost,
+                    ancestors[a].generation);
+        }
+        fprintf(file, "\n");
+    }
+    printf("\n");
+
+    fclose(file);
+    return 0;
+}
+
+
+int complexity_run(const char* extractor, const char* out_dir, enum complexity_metric metric,
+                   unsigned long executions, uint64_t seed) {
+    if (out_dir != NULL && (scratch_mkdirs(out_dir) == -1 || chdir(out_dir) == -1)) {
+        perror(out_dir);
+        return -1;
+    }
+    if (scratch_mkdirs(COMPLEXITY_DIRECTORY) == -1 || scratch_clean(COMPLEXITY_DIRECTORY) == -1) {
+        return -1;
+    }
+    if (metric == COMPLEXITY_INSTRUCTIONS) {
+        executor_enable_counter();
+    }
+
+    FILE* curve = fopen("complexity_curve.tsv", "w");
+    if (curve == NULL) {
+        perror("complexity_curve.tsv");
+        return -1;
+    }
+    fprintf(curve, "execution\tworst cost\tlength\n");
+
+    struct prng prng;
+    prng_seed(&prng, prng_derive(seed, metric));
+
+    printf("Looking for the archives that cost the extractor the most %s.\n", metrics[metric].name);
+
+    double worst = -1;
+    unsigned long execution = 0;
+    unsigned int next_seed = 0;
+    char how[48];
+
+    while (execution < executions) {
+        long parent = -1;
+        if (build_seed(next_seed, how, sizeof(how))) {
+            // The seeds first, whatever their cost
+            next_seed++;
+        } else if (corpus_count == 0) {
+            fprintf(stderr, "No seed could be measured\n");
+            fclose(curve);
+            return -1;
+        } else {
+            int selected = select_parent(&prng);
+            parent = (long) corpus[selected].ancestor;
+            snprintf(how, sizeof(how), "%s", mutation_names[mutate(&prng, &corpus[selected])]);
+            if (!safe_to_extract()) {
+                continue;
+            }
+        }
+
+        double cost = measure(extractor, metric);
+        execution++;
+        if (cost < 0) {
+            fclose(curve);
+            return -1;
+        }
+        if (metric == COMPLEXITY_INSTRUCTIONS && executor_counter() == COUNTER_NONE) {
+            fprintf(stderr, "No performance counter is available, use --complexity cpu\n");
+            fclose(curve);
+            return -1;
+        }
+
+        // Measure again what would enter the corpus, noise is not an improvement
+        bool full = corpus_count == CORPUS_SIZE;
+        for (int m = 1; m < MEASUREMENTS && parent != -1 && full && execution < executions; m++) {
+            double lowest = 0;
+            for (int i = 0; i < corpus_count; i++) {
+                if (i == 0 || corpus[i].cost < lowest) {
+                    lowest = corpus[i].cost;
+                }
+            }
+            if (cost <= lowest) {
+                break;
+            }
+            double again = measure(extractor, metric);
+            execution++;
+            if (again >= 0 && again < cost) {
+                cost = again;
+            }
+        }
+
+        if (keep(cost, parent, execution, how) && cost > worst) {
+            worst = cost;
+            fprintf(curve, "%lu\t%.0f\t%zu\n", execution, cost, candidate_length);
+            if (parent != -1) {
+                printf("        > Execution %lu: cost %.0f %s, %zu bytes (%s, generation %u)\n", execution, cost,
+                       metric_unit(metric), candidate_length, how, ancestors[ancestor_count - 1].generation);
+            }
+        }
+    }
+    fclose(curve);
+    remove(CANDIDATE);
+
+    int rv = report(metric, execution);
+    for (int i = 0; i < corpus_count; i++) {
+        free(corpus[i].bytes);
+    }
+    free(ancestors);
+    rmdir(COMPLEXITY_DIRECTORY);
+    return rv;
+}
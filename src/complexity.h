@@ -0,0 +1,56 @@
+#ifndef FUZZER_COMPLEXITY_H
+#define FUZZER_COMPLEXITY_H
+
+#include <stdint.h>
+
+/*
+ * Algorithmic-complexity mode: instead of looking for crashes, a mutation loop looks for the archives that cost
+ * the extractor the most, to find quadratic path handling or memory blowups before someone else does.
+ * The corpus starts from the archives of test_filesize() and test_multiple_members(), keeps the most expensive
+ * inputs found so far, and mutates them: numeric fields (sizes up to COMPLEXITY_MAX_SIZE), duplicated members,
+ * deep paths, inserted, removed or cut ranges. Every input is at most COMPLEXITY_MAX_LENGTH bytes long, so the
+ * loop looks for what costs the most per byte, not for the longest archive.
+ *
+ * At the end, the worst inputs are saved as complexity_worst_<rank>.tar, with their cost curve: the cost of each
+ * input they were mutated from, down to their seed. complexity_curve.tsv has the worst cost after each improvement.
+ */
+
+// Longest input of the mode
+#define COMPLEXITY_MAX_LENGTH (64 * 1024)
+
+// Largest member size written by the mutations: the mode looks for algorithmic cost, not for big declared sizes
+#define COMPLEXITY_MAX_SIZE (1 << 24)
+
+// Where the archives are extracted, emptied before each execution
+#define COMPLEXITY_DIRECTORY "complexity"
+
+// What the mode maximizes
+enum complexity_metric {
+    // User + system time of the extractor, in milliseconds
+    COMPLEXITY_CPU,
+    // Instructions retired, or CPU time in nanoseconds when there is no hardware counter (see executor_counter())
+    COMPLEXITY_INSTRUCTIONS,
+    // Peak resident set size, in kilobytes
+    COMPLEXITY_RSS,
+    COMPLEXITY_METRIC_COUNT
+};
+
+/**
+ * @param name name of a metric: "cpu", "instructions" or "rss"
+ * @return the metric, -1 if the name is unknown
+ */
+int complexity_parse_metric(const char* name);
+
+/**
+ * Runs the mode in the current directory, or in an output directory
+ * @param extractor absolute path of the extractor
+ * @param out_dir where to write the archives and the report, created if needed, NULL for the current directory
+ * @param metric what to maximize
+ * @param executions number of executions of the extractor, the seeds included
+ * @param seed seed of the mutations
+ * @return 0 on success, -1 on error
+ */
+int complexity_run(const char* extractor, const char* out_dir, enum complexity_metric metric,
+                   unsigned long executions, uint64_t seed);
+
+#endif
@@ -0,0 +1,405 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "confirm.h"
+#include "campaign.h"
+#include "executor.h"
+#include "faults.h"
+#include "scratch.h"
+#include "store.h"
+
+
+// The copy of the directory of the last crash, until the crash is recorded
+#define PENDING_STATE CONFIRM_QUEUE "/pending" CONFIRM_STATE_EXTENSION
+// Where an entry of a state goes while it is reduced
+#define ASIDE CONFIRM_QUEUE "/aside"
+
+// Room for the crashes waiting for the helper (the default of a pipe holds about 180 of them)
+#define QUEUE_PIPE_SIZE (1024 * 1024)
+
+// Most entries of a directory of a state looked at by the reduction
+#define MAX_STATE_ENTRIES 256
+
+static const char* label_names[CONFIRM_LABEL_COUNT] = {
+    [CONFIRM_DETERMINISTIC] = "deterministic",
+    [CONFIRM_FLAKY] = "flaky",
+    [CONFIRM_ENVIRONMENT] = "environment",
+};
+
+static const enum store_outcome label_outcomes[CONFIRM_LABEL_COUNT] = {
+    [CONFIRM_DETERMINISTIC] = STORE_DETERMINISTIC,
+    [CONFIRM_FLAKY] = STORE_FLAKY,
+    [CONFIRM_ENVIRONMENT] = STORE_ENVIRONMENT,
+};
+
+// The files of the campaign in the working directory, never part of a state: archives, reports, logs, checkpoint,
+// and the directories where the suites extract
+static const char* campaign_files[] = {
+    "*.tar", "*.crash", "*.fault", "*" CONFIRM_STATE_EXTENSION, "*.log", "*.tsv", "*.tmp", "*.map", "*.bloom",
+    "checkpoint", "fault_counts", "extract", "extension", "truncation", "header", "graph", "reference", "complexity",
+    "corpus", "store", CONFIRM_DIRECTORY, CONFIRM_QUEUE,
+};
+#define CAMPAIGN_FILE_COUNT (sizeof(campaign_files) / sizeof(campaign_files[0]))
+
+// A crash waiting for the helper, written to the pipe at once (smaller than PIPE_BUF)
+struct job {
+    unsigned int number;
+    uint64_t case_id;
+    bool state;
+    char artifact[64];
+    // Where the extractor ran, NULL being ""
+    char directory[256];
+    char schedule[FAULT_SCHEDULE_SIZE];
+};
+
+static unsigned int runs = 0;
+static pid_t helper = -1;
+static int queue_fd = -1;
+static unsigned int queued = 0;
+static time_t started;
+// The last run of the helper, for the record of the crash in the store
+static struct execution last_run;
+
+// What confirm_capture() took for the last crash
+static struct {
+    bool captured;
+    bool state;
+    char directory[256];
+    char schedule[FAULT_SCHEDULE_SIZE];
+} pending;
+
+
+void confirm_enable(unsigned int count) {
+    runs = count;
+}
+
+
+bool confirm_enabled(void) {
+    return runs > 0;
+}
+
+
+/**
+ * Tells which entries of the working directory are left out of a state: the files of the campaign, and what did not
+ * change since the worker started (e.g. the sources next to a campaign run without --out)
+ */
+static bool skip_entry(const char* name) {
+    for (size_t f = 0; f < CAMPAIGN_FILE_COUNT; f++) {
+        if (fnmatch(campaign_files[f], name, FNM_PERIOD) == 0) {
+            return true;
+        }
+    }
+    struct stat st;
+    return lstat(name, &st) == -1 || st.st_ctime < started;
+}
+
+
+/**
+ * Removes a file or a tree
+ */
+static void remove_entry(const char* path) {
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+        scratch_clean(path);
+        rmdir(path);
+    } else {
+        unlink(path);
+    }
+}
+
+
+void confirm_forget(void) {
+    if (pending.captured) {
+        remove_entry(PENDING_STATE);
+        pending.captured = false;
+    }
+}
+
+
+void confirm_capture(const char* directory) {
+    if (helper == -1) {
+        return;
+    }
+    // "graph/d1/.../root": the tree is "graph", what escaped through ".." included
+    char tree[PATH_MAX];
+    snprintf(tree, sizeof(tree), "%s", directory != NULL ? directory : ".");
+    char* slash = strchr(tree, '/');
+    if (slash != NULL) {
+        *slash = '\0';
+    }
+
+    const char* schedule = getenv(FAULT_SCHEDULE_VARIABLE);
+    snprintf(pending.directory, sizeof(pending.directory), "%s", directory != NULL ? directory : "");
+    snprintf(pending.schedule, sizeof(pending.schedule), "%s", schedule != NULL ? schedule : "");
+    remove_entry(PENDING_STATE);
+    pending.state = scratch_copy_tree(tree, PENDING_STATE, directory == NULL ? skip_entry : NULL) == 0;
+    if (!pending.state) {
+        perror(PENDING_STATE);
+    }
+    pending.captured = true;
+}
+
+
+/**
+ * Crash hook: queues the crash for the helper, with a copy of the archive and of the state taken at the crash
+ */
+static void queue_crash(const char* artifact) {
+    struct job job;
+    memset(&job, 0, sizeof(job));
+    job.number = queued++;
+    job.case_id = campaign_case_id();
+    snprintf(job.artifact, sizeof(job.artifact), "%s", artifact);
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), CONFIRM_QUEUE "/%u.tar", job.number);
+    if (scratch_copy_file(artifact, path) == -1) {
+        perror(path);
+        return;
+    }
+    if (pending.captured) {
+        snprintf(job.directory, sizeof(job.directory), "%s", pending.directory);
+        snprintf(job.schedule, sizeof(job.schedule), "%s", pending.schedule);
+        snprintf(path, sizeof(path), CONFIRM_QUEUE "/%u" CONFIRM_STATE_EXTENSION, job.number);
+        job.state = pending.state && rename(PENDING_STATE, path) == 0;
+        pending.captured = false;
+    }
+
+    // Blocks only if the helper is far behind
+    if (write(queue_fd, &job, sizeof(job)) != sizeof(job)) {
+        perror("confirm");
+    }
+}
+
+
+/**
+ * Runs an archive once in a new directory
+ * @param state copy of the directory to run it in, NULL for an empty one
+ * @param nesting where the extractor runs in it, NULL for the top
+ * @return true if it crashed
+ */
+static bool crashes_once(const char* extractor, const char* archive, const char* state, const char* nesting) {
+    char directory[PATH_MAX];
+    snprintf(directory, sizeof(directory), CONFIRM_DIRECTORY "%s%s", nesting != NULL ? "/" : "",
+             nesting != NULL ? nesting : "");
+    if (scratch_clean(CONFIRM_DIRECTORY) == -1 ||
+        (state != NULL && scratch_copy_tree(state, CONFIRM_DIRECTORY, NULL) == -1) || scratch_mkdirs(directory) == -1) {
+        perror(CONFIRM_DIRECTORY);
+        return false;
+    }
+    bool injected = getenv(FAULT_SCHEDULE_VARIABLE) != NULL;
+    return executor_run(extractor, directory, archive, injected, &last_run) == 0 && last_run.crashed &&
+           last_run.limit == LIMIT_NONE;
+}
+
+
+/**
+ * @return how many of the runs crashed
+ */
+static unsigned int count_crashes(const char* extractor, const char* archive, const char* state, const char* nesting) {
+    unsigned int crashes = 0;
+    for (unsigned int r = 0; r < runs; r++) {
+        crashes += crashes_once(extractor, archive, state, nesting);
+    }
+    return crashes;
+}
+
+
+/**
+ * Removes the entries of a directory of a state one by one, and keeps them out if the archive still crashes
+ * without them, then does the same in the directories kept
+ * @param state the whole state
+ * @param path a directory in the state
+ * @param reductions executions left
+ * @return the number of entries kept under path
+ */
+static unsigned int reduce(const char* extractor, const char* archive, const char* state, const char* nesting,
+                           const char* path, unsigned int* reductions) {
+    // Listed first: the directory changes on the way
+    char* names[MAX_STATE_ENTRIES];
+    size_t count = 0;
+    DIR* dir = opendir(path);
+    if (dir == NULL) {
+        return 0;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL && count < MAX_STATE_ENTRIES) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+            names[count] = strdup(entry->d_name);
+            count += names[count] != NULL;
+        }
+    }
+    closedir(dir);
+
+    unsigned int kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        char entry_path[PATH_MAX];
+        snprintf(entry_path, sizeof(entry_path), "%s/%s", path, names[i]);
+        free(names[i]);
+        if (*reductions == 0 || rename(entry_path, ASIDE) == -1) {
+            kept++;
+            continue;
+        }
+        (*reductions)--;
+        if (crashes_once(extractor, archive, state, nesting)) {
+            remove_entry(ASIDE);
+            continue;
+        }
+        rename(ASIDE, entry_path);
+        kept++;
+        struct stat st;
+        if (lstat(entry_path, &st) == 0 && S_ISDIR(st.st_mode)) {
+            kept += reduce(extractor, archive, state, nesting, entry_path, reductions);
+        }
+    }
+    return kept;
+}
+
+
+/**
+ * Confirms a crash, and writes its line, its record in the results file of the worker and in the store
+ * @return its label
+ */
+static enum confirm_label confirm_job(const char* extractor, const struct job* job, FILE* results) {
+    char archive[PATH_MAX];
+    char state[PATH_MAX];
+    snprintf(archive, sizeof(archive), CONFIRM_QUEUE "/%u.tar", job->number);
+    snprintf(state, sizeof(state), CONFIRM_QUEUE "/%u" CONFIRM_STATE_EXTENSION, job->number);
+    const char* slash = strchr(job->directory, '/');
+    const char* nesting = slash != NULL ? slash + 1 : NULL;
+
+    // The faults the crash was found with
+    if (job->schedule[0] != '\0') {
+        setenv(FAULT_SCHEDULE_VARIABLE, job->schedule, 1);
+    }
+
+    enum confirm_label label = CONFIRM_FLAKY;
+    unsigned int state_crashes = 0;
+    unsigned int kept = 0;
+    unsigned int fresh = count_crashes(extractor, archive, NULL, nesting);
+    if (fresh == runs) {
+        label = CONFIRM_DETERMINISTIC;
+    } else if (fresh == 0 && job->state && (state_crashes = count_crashes(extractor, archive, state, nesting)) == runs) {
+        label = CONFIRM_ENVIRONMENT;
+        unsigned int reductions = CONFIRM_MAX_REDUCTIONS;
+        kept = reduce(extractor, archive, state, nesting, state, &reductions);
+
+        char kept_state[PATH_MAX];
+        snprintf(kept_state, sizeof(kept_state), "%s" CONFIRM_STATE_EXTENSION, job->artifact);
+        remove_entry(kept_state);
+        if (rename(state, kept_state) == -1) {
+            perror(kept_state);
+        }
+    }
+    fprintf(results, "%s\t%s\t%u/%u\t%u/%u\t%u\n", job->artifact, label_names[label], fresh, runs,
+            state_crashes, job->state && fresh == 0 ? runs : 0, kept);
+    char detail[96];
+    snprintf(detail, sizeof(detail), "%s empty=%u/%u state=%u/%u kept=%u", label_names[label], fresh, runs,
+             state_crashes, job->state && fresh == 0 ? runs : 0, kept);
+    campaign_record_case_finding(job->case_id, "confirmed", job->artifact, detail);
+    // With the schedule of the crash: the record goes with its object
+    store_add_case(archive, label_outcomes[label], &last_run, job->case_id);
+    unsetenv(FAULT_SCHEDULE_VARIABLE);
+    remove(archive);
+    remove_entry(state);
+    return label;
+}
+
+
+/**
+ * Main loop of the helper: confirms the crashes until the worker closes the queue
+ */
+static void run_helper(const char* extractor, int fd) {
+    // A process per run, the state of the extractor would be another environment
+    executor_plain();
+
+    FILE* results = fopen(CONFIRM_FILE, "a");
+    if (results == NULL) {
+        perror(CONFIRM_FILE);
+        _exit(1);
+    }
+    setvbuf(results, NULL, _IOLBF, 0);
+    if (ftell(results) == 0) {
+        fprintf(results, "archive\tlabel\tempty\tstate\tkept\n");
+    }
+
+    unsigned int counts[CONFIRM_LABEL_COUNT] = {0};
+    struct job job;
+    while (read(fd, &job, sizeof(job)) == sizeof(job)) {
+        counts[confirm_job(extractor, &job, results)]++;
+    }
+    fclose(results);
+    // The worker is done, or was interrupted and left the crashes queued to this process
+    scratch_clean(CONFIRM_DIRECTORY);
+    rmdir(CONFIRM_DIRECTORY);
+    scratch_clean(CONFIRM_QUEUE);
+    rmdir(CONFIRM_QUEUE);
+
+    printf("%u crashes confirmed in %u runs each: %u deterministic, %u flaky, %u depending on the directory\n",
+           counts[CONFIRM_DETERMINISTIC] + counts[CONFIRM_FLAKY] + counts[CONFIRM_ENVIRONMENT], runs,
+           counts[CONFIRM_DETERMINISTIC], counts[CONFIRM_FLAKY], counts[CONFIRM_ENVIRONMENT]);
+    fflush(stdout);
+    _exit(0);
+}
+
+
+int confirm_start(const char* extractor) {
+    if (runs == 0) {
+        return 0;
+    }
+    started = time(NULL);
+
+    // The crashes queued by a run that was killed are lost with its helper
+    if (scratch_clean(CONFIRM_QUEUE) == -1 || scratch_mkdirs(CONFIRM_QUEUE) == -1) {
+        perror(CONFIRM_QUEUE);
+        return -1;
+    }
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) == -1) {
+        perror("pipe");
+        return -1;
+    }
+    fcntl(fds[1], F_SETPIPE_SZ, QUEUE_PIPE_SIZE);
+
+    // Nothing buffered twice
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(fds[1]);
+        run_helper(extractor, fds[0]);
+    }
+    close(fds[0]);
+    queue_fd = fds[1];
+    helper = pid;
+    campaign_add_crash_hook(queue_crash);
+    return 0;
+}
+
+
+void confirm_finish(void) {
+    if (helper == -1) {
+        return;
+    }
+    close(queue_fd);
+    queue_fd = -1;
+    fflush(stdout);
+    waitpid(helper, NULL, 0);
+    helper = -1;
+}
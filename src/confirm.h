@@ -0,0 +1,83 @@
+#ifndef FUZZER_CONFIRM_H
+#define FUZZER_CONFIRM_H
+
+#include <stdbool.h>
+
+/*
+ * Confirmation of the crashes: a crash seen once may come from what the previous executions left in the directory
+ * where the extractor ran. Each crash recorded by a worker is handed to a helper process, forked by the worker when
+ * the campaign starts, which runs the archive again, a process per run, in an empty directory while the worker goes
+ * on fuzzing. The crash is labelled:
+ *  - deterministic: it crashed every time
+ *  - flaky: it crashed some of the times, or never again, even in the directory it was found in
+ *  - environment: it never crashed in an empty directory, but crashes every time in a copy of the directory as the
+ *    crash left it (only what changed since the worker started, without the files of the campaign)
+ * For the last ones, the copy is reduced to the entries the crash needs, removed one by one, and kept as
+ * "<archive>.state": the minimal state to extract the archive in.
+ *
+ * The archive, the fault schedule and the copy of the directory are taken when the crash happens, the archive being
+ * reused by the suites. The labels go to CONFIRM_FILE in the working directory, to the results file of the worker
+ * (outcome "confirmed") and to the store (outcomes "deterministic", "flaky" and "environment"). A worker interrupted by a signal
+ * exits at once, its helper confirms the crashes already queued before it exits too.
+ */
+
+// Where the helper runs the archives, and where the crashes wait for it, in the working directory
+#define CONFIRM_DIRECTORY "confirm"
+#define CONFIRM_QUEUE "confirm-queue"
+
+// One line per crash: archive, label, crashes in an empty directory and with the state, entries of the state kept
+#define CONFIRM_FILE "confirm.tsv"
+
+// Added to the name of the archive for the state it needs
+#define CONFIRM_STATE_EXTENSION ".state"
+
+// Most runs of each crash
+#define CONFIRM_MAX_RUNS 100
+
+// Executions of the extractor to reduce a state, one per entry removed
+#define CONFIRM_MAX_REDUCTIONS 64
+
+enum confirm_label {
+    CONFIRM_DETERMINISTIC,
+    CONFIRM_FLAKY,
+    CONFIRM_ENVIRONMENT,
+    CONFIRM_LABEL_COUNT
+};
+
+/**
+ * Enables the confirmation of the crashes
+ * @param runs executions of each crash in an empty directory, and with its state
+ */
+void confirm_enable(unsigned int runs);
+
+/**
+ * @return whether the crashes are confirmed
+ */
+bool confirm_enabled(void);
+
+/**
+ * Forks the helper and confirms the crashes recorded from then on, in the working directory of the campaign
+ * @param extractor absolute path of the extractor
+ * @return 0 on success, -1 on error
+ */
+int confirm_start(const char* extractor);
+
+/**
+ * Forgets what was taken for the previous execution, called before each one: a crash is only queued with what was
+ * taken after its own execution
+ */
+void confirm_forget(void);
+
+/**
+ * Takes what the confirmation of a crash needs, after the execution and before anything is cleaned: the directory
+ * where the extractor ran, and the fault schedule. The crash is queued when it is recorded.
+ * @param directory where the extractor ran, NULL for the working directory
+ */
+void confirm_capture(const char* directory);
+
+/**
+ * Waits for the helper to confirm the crashes left, it prints how many of each label it found
+ */
+void confirm_finish(void);
+
+#endif
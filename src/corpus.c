@@ -0,0 +1,421 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "corpus.h"
+#include "campaign.h"
+#include "scratch.h"
+#include "tar.h"
+
+
+#define PACK_FILE "corpus.pack"
+#define INDEX_FILE "corpus.idx"
+
+// Most blocks a test case copies to change them, the rest of the archive stays in the mapping
+#define MAX_COPIES 4
+
+// Absolute path of the corpus open for appending, so that it does not depend on the current directory
+static char corpus_directory[PATH_MAX];
+static int pack_fd = -1;
+static int index_fd = -1;
+static uint32_t corpus_worker;
+
+// Source of the padding
+static const uint8_t zeros[TAR_BLOCK_SIZE];
+
+enum corpus_mutation {
+    MUTATION_FIELD,
+    MUTATION_SPLICE,
+    MUTATION_REMOVE,
+    MUTATION_INSERT,
+    MUTATION_TRUNCATE,
+    MUTATION_COUNT
+};
+
+// Share of each mutation (in %)
+static const unsigned int weights[MUTATION_COUNT] = {
+    [MUTATION_FIELD] = 45,
+    [MUTATION_SPLICE] = 20,
+    [MUTATION_REMOVE] = 15,
+    [MUTATION_INSERT] = 10,
+    [MUTATION_TRUNCATE] = 10,
+};
+
+
+/**
+ * Creates a file of the corpus with its header, see scratch_create_file()
+ * @param name name of the file in the corpus
+ * @param magic its magic
+ * @param unit size of its blocks or entries
+ * @param header_size space taken by the header, the rest is null bytes
+ * @return 0 on success, -1 on error
+ */
+static int create_file(const char* name, const char* magic, uint32_t unit, size_t header_size) {
+    char path[PATH_MAX + 32];
+    snprintf(path, sizeof(path), "%s/%s", corpus_directory, name);
+
+    uint8_t block[TAR_BLOCK_SIZE];
+    memset(block, 0, sizeof(block));
+    struct corpus_header* header = (struct corpus_header*) block;
+    memcpy(header->magic, magic, sizeof(header->magic));
+    header->version = CORPUS_VERSION;
+    header->unit = unit;
+    return scratch_create_file(path, block, header_size);
+}
+
+
+/**
+ * Opens a file of the corpus for appending
+ */
+static int open_for_append(const char* name) {
+    char path[PATH_MAX + 32];
+    snprintf(path, sizeof(path), "%s/%s", corpus_directory, name);
+    int fd = open(path, O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd == -1) {
+        perror(path);
+    }
+    return fd;
+}
+
+
+int corpus_open(const char* path, uint32_t worker) {
+    if (mkdir(path, 0755) == -1 && errno != EEXIST) {
+        perror(path);
+        return -1;
+    }
+    if (realpath(path, corpus_directory) == NULL) {
+        perror(path);
+        return -1;
+    }
+    if (create_file(PACK_FILE, CORPUS_PACK_MAGIC, TAR_BLOCK_SIZE, TAR_BLOCK_SIZE) == -1 ||
+        create_file(INDEX_FILE, CORPUS_INDEX_MAGIC, sizeof(struct corpus_entry), sizeof(struct corpus_header)) == -1) {
+        return -1;
+    }
+    pack_fd = open_for_append(PACK_FILE);
+    index_fd = open_for_append(INDEX_FILE);
+    if (pack_fd == -1 || index_fd == -1) {
+        corpus_close();
+        return -1;
+    }
+    corpus_worker = worker;
+    return 0;
+}
+
+
+const char* corpus_path(void) {
+    return pack_fd != -1 ? corpus_directory : NULL;
+}
+
+
+int corpus_add(const char* archive, uint64_t case_id, uint64_t behaviour, unsigned int reasons) {
+    if (pack_fd == -1) {
+        return 0;
+    }
+
+    size_t len = 0;
+    uint8_t* content = scratch_read_file(archive, &len);
+    if (content == NULL) {
+        perror(archive);
+        return -1;
+    }
+    if (len > UINT32_MAX) {
+        fprintf(stderr, "%s: too large for the corpus\n", archive);
+        free(content);
+        return -1;
+    }
+
+    // A single writev with O_APPEND: the archives of the workers never interleave, and each one ends on a block
+    struct iovec parts[2] = {
+        {.iov_base = content, .iov_len = len},
+        {.iov_base = (void*) zeros, .iov_len = (TAR_BLOCK_SIZE - len % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE},
+    };
+    size_t padded = len + parts[1].iov_len;
+    ssize_t written = writev(pack_fd, parts, 2);
+    // The position of our descriptor is the end of what we wrote, whatever the other workers appended since
+    off_t end = lseek(pack_fd, 0, SEEK_CUR);
+
+    struct corpus_entry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.length = (uint32_t) len;
+    entry.hash = prng_hash64(content, len, 0);
+    free(content);
+    if (written != (ssize_t) padded || end == -1) {
+        perror(CORPUS_DIRECTORY "/" PACK_FILE);
+        return -1;
+    }
+
+    entry.offset = (uint64_t) end - padded;
+    entry.worker = corpus_worker;
+    entry.case_id = case_id;
+    entry.behaviour = behaviour;
+    entry.time = time(NULL);
+    entry.reasons = (uint8_t) reasons;
+    if (write(index_fd, &entry, sizeof(entry)) != sizeof(entry)) {
+        perror(CORPUS_DIRECTORY "/" INDEX_FILE);
+        return -1;
+    }
+    return 0;
+}
+
+
+void corpus_close(void) {
+    if (pack_fd != -1) {
+        close(pack_fd);
+        pack_fd = -1;
+    }
+    if (index_fd != -1) {
+        close(index_fd);
+        index_fd = -1;
+    }
+}
+
+
+/**
+ * Maps a file of the corpus at its current size, and checks its header
+ * @return the mapping, NULL on error
+ */
+static const uint8_t* map_file(int fd, const char* magic, uint32_t unit, size_t header_size, size_t* size) {
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t) st.st_size < header_size) {
+        return NULL;
+    }
+    const uint8_t* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+    const struct corpus_header* header = (const struct corpus_header*) map;
+    if (memcmp(header->magic, magic, sizeof(header->magic)) != 0 || header->version != CORPUS_VERSION ||
+        header->unit != unit) {
+        munmap((void*) map, st.st_size);
+        return NULL;
+    }
+    *size = st.st_size;
+    return map;
+}
+
+
+int corpus_map(struct corpus* corpus, const char* path) {
+    memset(corpus, 0, sizeof(*corpus));
+    char pack[PATH_MAX + 32];
+    char index[PATH_MAX + 32];
+    snprintf(pack, sizeof(pack), "%s/" PACK_FILE, path);
+    snprintf(index, sizeof(index), "%s/" INDEX_FILE, path);
+
+    int pack_fd = open(pack, O_RDONLY | O_CLOEXEC);
+    if (pack_fd == -1) {
+        perror(pack);
+        return -1;
+    }
+    int index_fd = open(index, O_RDONLY | O_CLOEXEC);
+    if (index_fd == -1) {
+        perror(index);
+        close(pack_fd);
+        return -1;
+    }
+
+    // The index first: the archives of its entries are then all in the pack
+    corpus->index = map_file(index_fd, CORPUS_INDEX_MAGIC, sizeof(struct corpus_entry), sizeof(struct corpus_header),
+                             &corpus->index_size);
+    if (corpus->index != NULL) {
+        corpus->pack = map_file(pack_fd, CORPUS_PACK_MAGIC, TAR_BLOCK_SIZE, TAR_BLOCK_SIZE, &corpus->pack_size);
+    }
+    close(pack_fd);
+    close(index_fd);
+    if (corpus->pack == NULL) {
+        fprintf(stderr, "%s: not a packed corpus, or another version\n", path);
+        corpus_unmap(corpus);
+        return -1;
+    }
+    corpus->entries = (const struct corpus_entry*) (corpus->index + sizeof(struct corpus_header));
+    // An entry being appended is not complete yet
+    corpus->count = (corpus->index_size - sizeof(struct corpus_header)) / sizeof(struct corpus_entry);
+    return 0;
+}
+
+
+void corpus_unmap(struct corpus* corpus) {
+    if (corpus->index != NULL) {
+        munmap((void*) corpus->index, corpus->index_size);
+    }
+    if (corpus->pack != NULL) {
+        munmap((void*) corpus->pack, corpus->pack_size);
+    }
+    memset(corpus, 0, sizeof(*corpus));
+}
+
+
+const uint8_t* corpus_record(const struct corpus* corpus, size_t entry, size_t* length) {
+    if (entry >= corpus->count) {
+        return NULL;
+    }
+    const struct corpus_entry* e = &corpus->entries[entry];
+    if (e->offset < TAR_BLOCK_SIZE || e->offset > corpus->pack_size || e->length > corpus->pack_size - e->offset) {
+        return NULL;
+    }
+    *length = e->length;
+    return corpus->pack + e->offset;
+}
+
+
+/**
+ * Overwrites a field of a header in a copy of its block, fixes the checksum 3 times out of 4,
+ * and puts the copy in place of the block
+ */
+static void overwrite_field(struct prng* prng, struct mutation_case* mutation, uint8_t* copy) {
+    struct archive* archive = &mutation->archive;
+    size_t offset = mutate_pick_header(prng, archive);
+    memset(copy, 0, TAR_BLOCK_SIZE);
+    size_t available = archive_gather(archive, offset, copy, TAR_BLOCK_SIZE);
+
+    const struct tar_field* f = &tar_fields[prng_below(prng, TAR_FIELD_COUNT)];
+    uint8_t* field = copy + f->offset;
+    size_t size = f->size;
+    switch (prng_below(prng, 4)) {
+        case 0:
+            // One byte, anything
+            field[prng_below(prng, size)] = (uint8_t) prng_below(prng, 256);
+            mutate_describe(mutation, ", %s byte changed in the block at %zu", f->name, offset);
+            break;
+        case 1:
+            // The whole field, without a terminator
+            memset(field, (int) prng_below(prng, 256), size);
+            mutate_describe(mutation, ", %s filled in the block at %zu", f->name, offset);
+            break;
+        case 2:
+            // The largest octal number of the field
+            memset(field, '7', size);
+            mutate_describe(mutation, ", %s of 7s in the block at %zu", f->name, offset);
+            break;
+        default:
+            // Empty
+            memset(field, 0, size);
+            mutate_describe(mutation, ", %s emptied in the block at %zu", f->name, offset);
+            break;
+    }
+    if (prng_below(prng, 4) != 0) {
+        calculate_checksum((struct tar_t*) copy);
+    }
+    archive_splice(archive, offset, available, copy, available > 0 ? available : TAR_BLOCK_SIZE);
+}
+
+
+void corpus_build_case(const struct corpus* corpus, struct prng* prng, struct mutation_case* mutation) {
+    static uint8_t copies[MAX_COPIES][TAR_BLOCK_SIZE];
+    size_t entry = prng_below(prng, corpus->count);
+    size_t length;
+    const uint8_t* record = corpus_record(corpus, entry, &length);
+    if (record == NULL) {
+        length = 0;
+    }
+
+    // The archive points at the mapping, only the blocks changed are copied
+    archive_init(&mutation->archive);
+    archive_add_raw(&mutation->archive, record, length);
+    snprintf(mutation->description, sizeof(mutation->description), "corpus entry %zu (%s:%u)", entry,
+             suite_name(corpus->entries[entry].case_id >> 32), (unsigned int) corpus->entries[entry].case_id);
+
+    struct archive* archive = &mutation->archive;
+    unsigned int copies_used = 0;
+    unsigned int steps = 1 + (unsigned int) prng_below(prng, 4);
+    for (unsigned int s = 0; s < steps; s++) {
+        unsigned int roll = (unsigned int) prng_below(prng, 100);
+        enum corpus_mutation kind = 0;
+        while (kind < MUTATION_COUNT - 1 && roll >= weights[kind]) {
+            roll -= weights[kind];
+            kind++;
+        }
+        if (kind == MUTATION_FIELD && copies_used == MAX_COPIES) {
+            kind = MUTATION_SPLICE;
+        }
+
+        size_t offset = mutate_pick_offset(prng, archive->length);
+        size_t len = mutate_pick_length(prng);
+        switch (kind) {
+            case MUTATION_FIELD:
+                overwrite_field(prng, mutation, copies[copies_used++]);
+                break;
+            case MUTATION_SPLICE: {
+                // A block of another archive of the corpus, on a block boundary, read in place
+                size_t donor_length;
+                size_t donor = prng_below(prng, corpus->count);
+                const uint8_t* other = corpus_record(corpus, donor, &donor_length);
+                if (other == NULL || donor_length == 0) {
+                    break;
+                }
+                size_t block = prng_below(prng, (donor_length + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE);
+                size_t block_length = donor_length - block * TAR_BLOCK_SIZE;
+                offset = prng_below(prng, archive->length / TAR_BLOCK_SIZE + 1) * TAR_BLOCK_SIZE;
+                archive_splice(archive, offset, 0, other + block * TAR_BLOCK_SIZE,
+                               block_length < TAR_BLOCK_SIZE ? block_length : TAR_BLOCK_SIZE);
+                mutate_describe(mutation, ", block of entry %zu inserted at %zu", donor, offset);
+                break;
+            }
+            case MUTATION_REMOVE:
+                mutate_generic(prng, mutation, MUTATE_REMOVE, offset, len);
+                break;
+            case MUTATION_INSERT:
+                mutate_generic(prng, mutation, MUTATE_INSERT, offset, len);
+                break;
+            default:
+                mutate_generic(prng, mutation, MUTATE_TRUNCATE, offset, len);
+                break;
+        }
+    }
+}
+
+
+static int compare_hashes(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a;
+    uint64_t y = *(const uint64_t*) b;
+    return x < y ? -1 : x > y;
+}
+
+
+long corpus_list(const char* path) {
+    struct corpus corpus;
+    if (corpus_map(&corpus, path) == -1) {
+        return -1;
+    }
+
+    printf("entry\toffset\tlength\tsuite\tindex\treasons\tbehaviour\thash\tworker\ttime\n");
+    uint64_t* hashes = malloc(corpus.count * sizeof(*hashes) + 1);
+    size_t bytes = 0;
+    for (size_t i = 0; i < corpus.count; i++) {
+        const struct corpus_entry* e = &corpus.entries[i];
+        printf("%zu\t%llu\t%u\t%s\t%u\t%s%s\t%016llx\t%016llx\t%u.%u\t%lld\n",
+               i, (unsigned long long) e->offset, e->length, suite_name(e->case_id >> 32), (unsigned int) e->case_id,
+               e->reasons & CORPUS_SYSCALLS ? "s" : "", e->reasons & CORPUS_CLASS ? "c" : "",
+               (unsigned long long) e->behaviour, (unsigned long long) e->hash, e->worker >> 16, e->worker & 0xffff,
+               (long long) e->time);
+        if (hashes != NULL) {
+            hashes[i] = e->hash;
+        }
+        bytes += e->length;
+    }
+
+    // Summary on stderr, the entries can be piped
+    size_t distinct = 0;
+    if (hashes != NULL) {
+        qsort(hashes, corpus.count, sizeof(*hashes), compare_hashes);
+        for (size_t i = 0; i < corpus.count; i++) {
+            distinct += i == 0 || hashes[i] != hashes[i - 1];
+        }
+    }
+    fprintf(stderr, "%zu entries, %zu distinct archives, %zu bytes of archives in %zu bytes\n",
+            corpus.count, distinct, bytes, corpus.pack_size);
+
+    free(hashes);
+    long count = (long) corpus.count;
+    corpus_unmap(&corpus);
+    return count;
+}
@@ -0,0 +1,152 @@
+#ifndef FUZZER_CORPUS_H
+#define FUZZER_CORPUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mutate.h"
+#include "prng.h"
+
+/*
+ * Packed corpus, shared by all the shards and workers of an output directory: the archives that showed a new
+ * behaviour (syscall feedback, behaviour class) are appended to a single file "corpus.pack", each one starting on
+ * a 512-byte block and padded with null bytes to the next one, and a fixed-size entry per archive is appended to
+ * "corpus.idx" (where it is, its length, test case, behaviour...). Both files are arrays after a header, mapped as
+ * they are: the archives are read and mutated in place, with no file per archive to open, read and close.
+ *
+ * An archive is appended with a single writev() to the pack opened with O_APPEND, and the offset where it landed is
+ * the position of the file descriptor after it, so that the workers never take a lock. The entry is written
+ * afterwards, with a single write() to the index: a reader that sees an entry sees the archive.
+ */
+
+// Name of the corpus in the output directory
+#define CORPUS_DIRECTORY "corpus"
+
+#define CORPUS_PACK_MAGIC "TARPACK1"
+#define CORPUS_INDEX_MAGIC "TARPIDX1"
+#define CORPUS_VERSION 1
+
+// Test cases of the corpus suite, each one a mutation of an archive picked at random, and with a time budget
+#define CORPUS_CASES 16384
+#define CORPUS_BUDGET_CASES (1U << 20)
+
+// Why an archive entered the corpus, the bits can be combined
+enum corpus_reason {
+    // New pair of system calls, or a count of another order of magnitude
+    CORPUS_SYSCALLS = 1,
+    // New behaviour class (see behaviour.h)
+    CORPUS_CLASS = 2
+};
+
+// Beginning of the pack and of the index (the pack keeps the rest of its first block empty)
+struct corpus_header {
+    char magic[8];
+    uint32_t version;
+    // Size of the blocks of the pack, or of the entries of the index
+    uint32_t unit;
+    uint8_t reserved[48];
+};
+
+// One archive of the corpus, 64 bytes
+struct corpus_entry {
+    // Where the archive starts in the pack, a multiple of 512, and its length without the padding
+    uint64_t offset;
+    uint32_t length;
+    // Shard in the high 16 bits, local worker in the low ones
+    uint32_t worker;
+    // Test case: suite in the high 32 bits, index in the low ones
+    uint64_t case_id;
+    // Behaviour class, or hash of the syscall trace
+    uint64_t behaviour;
+    // Hash of the content
+    uint64_t hash;
+    // When it was added, seconds since the epoch
+    int64_t time;
+    // enum corpus_reason
+    uint8_t reasons;
+    uint8_t reserved[15];
+};
+
+_Static_assert(sizeof(struct corpus_header) == 64, "the header is 64 bytes");
+_Static_assert(sizeof(struct corpus_entry) == 64, "an entry is 64 bytes");
+
+// A corpus mapped for reading
+struct corpus {
+    const uint8_t* pack;
+    size_t pack_size;
+    const uint8_t* index;
+    size_t index_size;
+    // Complete entries, after the header of the index
+    const struct corpus_entry* entries;
+    size_t count;
+};
+
+/**
+ * Opens the corpus for appending, creating it if needed. Several processes can open the same corpus.
+ * @param path directory of the corpus
+ * @param worker identifier of this process, shard in the high 16 bits and local worker in the low ones
+ * @return 0 on success, -1 on error
+ */
+int corpus_open(const char* path, uint32_t worker);
+
+/**
+ * @return the directory of the corpus open for appending, NULL if none
+ */
+const char* corpus_path(void);
+
+/**
+ * Appends an archive to the corpus, does nothing if the corpus is not open
+ * @param archive path of the archive
+ * @param case_id the test case that wrote it
+ * @param behaviour its behaviour class or syscall trace hash
+ * @param reasons why it is kept, enum corpus_reason
+ * @return 0 on success, -1 on error
+ */
+int corpus_add(const char* archive, uint64_t case_id, uint64_t behaviour, unsigned int reasons);
+
+/**
+ * Closes the corpus open for appending
+ */
+void corpus_close(void);
+
+/**
+ * Maps a corpus for reading, as it is now: what is appended afterwards is not seen
+ * @param corpus the mapping to set up
+ * @param path directory of the corpus
+ * @return 0 on success, -1 on error
+ */
+int corpus_map(struct corpus* corpus, const char* path);
+
+/**
+ * Unmaps a corpus
+ * @param corpus a mapped corpus
+ */
+void corpus_unmap(struct corpus* corpus);
+
+/**
+ * Gives an archive of the corpus, in place in the mapping of the pack
+ * @param corpus a mapped corpus
+ * @param entry number of the entry
+ * @param length where to store the length of the archive
+ * @return the archive, NULL if the entry is out of range or points outside of the pack
+ */
+const uint8_t* corpus_record(const struct corpus* corpus, size_t entry, size_t* length);
+
+/**
+ * Builds a mutation of an archive of the corpus picked at random: header fields overwritten (and the checksum fixed
+ * most of the time), blocks of another archive inserted, ranges removed or inserted, cuts. The archive points at the
+ * mapping, only the changed blocks are copied, so the corpus has to stay mapped until it is written.
+ * @param corpus a mapped corpus, not empty
+ * @param prng generator seeded for this test case
+ * @param mutation where to build the archive
+ */
+void corpus_build_case(const struct corpus* corpus, struct prng* prng, struct mutation_case* mutation);
+
+/**
+ * Lists the entries of a corpus, one per line, then the number of entries and of distinct archives
+ * @param path directory of the corpus
+ * @return the number of entries, -1 if the corpus cannot be read
+ */
+long corpus_list(const char* path);
+
+#endif
@@ -0,0 +1,266 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dedup.h"
+#include "campaign.h"
+#include "prng.h"
+#include "scratch.h"
+
+
+#define WORDS_PER_BLOCK (DEDUP_BLOCK_SIZE / sizeof(uint64_t))
+
+static struct dedup_header* filter = NULL;
+static uint64_t* blocks;
+static size_t filter_size;
+static unsigned long skipped = 0;
+
+// Keys of the test cases not finished in a checkpoint yet, open addressing, a power of 2 of slots
+static struct dedup_key* pending = NULL;
+static size_t pending_size = 0;
+static size_t pending_count = 0;
+
+
+/**
+ * Checks the header of an existing filter
+ * @return its size, 0 if it cannot be used
+ */
+static size_t check_filter(int fd) {
+    struct dedup_header header;
+    struct stat st;
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header) || fstat(fd, &st) == -1 ||
+        memcmp(header.magic, DEDUP_MAGIC, sizeof(header.magic)) != 0 || header.version != DEDUP_VERSION ||
+        header.block_size != DEDUP_BLOCK_SIZE || header.blocks == 0 ||
+        (uint64_t) st.st_size != (header.blocks + 1) * DEDUP_BLOCK_SIZE) {
+        return 0;
+    }
+    return st.st_size;
+}
+
+
+/**
+ * Creates an empty filter, renamed over the old one
+ * @return its file descriptor, -1 on error
+ */
+static int create_filter(const char* path, unsigned long capacity, size_t* size) {
+    char temporary[PATH_MAX];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+
+    struct dedup_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DEDUP_MAGIC, sizeof(header.magic));
+    header.version = DEDUP_VERSION;
+    header.block_size = DEDUP_BLOCK_SIZE;
+    header.capacity = capacity;
+    header.blocks = ((uint64_t) capacity * DEDUP_BITS_PER_ENTRY + DEDUP_BLOCK_SIZE * 8 - 1) / (DEDUP_BLOCK_SIZE * 8);
+    *size = (header.blocks + 1) * DEDUP_BLOCK_SIZE;
+
+    // A sparse file: the blocks take room as they are set
+    int fd = open(temporary, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        perror(temporary);
+        return -1;
+    }
+    if (ftruncate(fd, *size) == -1 || pwrite(fd, &header, sizeof(header), 0) != sizeof(header) ||
+        rename(temporary, path) == -1) {
+        perror(temporary);
+        close(fd);
+        unlink(temporary);
+        return -1;
+    }
+    return fd;
+}
+
+
+/**
+ * Sets the bits of a key in the filter, shared with the other workers
+ */
+static void set_bits(const struct dedup_key* key) {
+    uint64_t* block = blocks + (key->hash[0] % filter->blocks) * WORDS_PER_BLOCK;
+    uint64_t bits = key->hash[1];
+    bool added = false;
+    for (int h = 0; h < DEDUP_HASHES; h++, bits >>= 9) {
+        unsigned int bit = bits & (DEDUP_BLOCK_SIZE * 8 - 1);
+        uint64_t mask = 1ULL << (bit % 64);
+        added |= !(__atomic_fetch_or(&block[bit / 64], mask, __ATOMIC_RELAXED) & mask);
+    }
+    // Another worker may have run the same archive at the same time
+    if (added) {
+        __atomic_fetch_add(&filter->added, 1, __ATOMIC_RELAXED);
+    }
+}
+
+
+/**
+ * Looks up a key among the pending ones
+ * @return its slot, or the empty slot where it goes
+ */
+static struct dedup_key* pending_slot(const struct dedup_key* key) {
+    size_t mask = pending_size - 1;
+    size_t i = key->hash[1] & mask;
+    while (pending[i].valid && (pending[i].hash[0] != key->hash[0] || pending[i].hash[1] != key->hash[1])) {
+        i = (i + 1) & mask;
+    }
+    return &pending[i];
+}
+
+
+/**
+ * Doubles the pending keys, at most half full
+ * @return 0 on success, -1 on error
+ */
+static int grow_pending(void) {
+    size_t size = pending_size > 0 ? pending_size * 2 : 1024;
+    struct dedup_key* old = pending;
+    size_t old_size = pending_size;
+    pending = calloc(size, sizeof(*pending));
+    if (pending == NULL) {
+        perror("calloc");
+        pending = old;
+        return -1;
+    }
+    pending_size = size;
+    for (size_t i = 0; i < old_size; i++) {
+        if (old[i].valid) {
+            *pending_slot(&old[i]) = old[i];
+        }
+    }
+    free(old);
+    return 0;
+}
+
+
+/**
+ * Adds the pending keys to the filter, once the checkpoint marking their test cases finished is written
+ */
+static void commit_pending(void) {
+    if (filter == NULL || pending_count == 0) {
+        return;
+    }
+    for (size_t i = 0; i < pending_size; i++) {
+        if (pending[i].valid) {
+            set_bits(&pending[i]);
+        }
+    }
+    memset(pending, 0, pending_size * sizeof(*pending));
+    pending_count = 0;
+}
+
+
+int dedup_open(const char* path, unsigned long capacity, bool resume) {
+    int fd = -1;
+    size_t size = 0;
+    if (resume) {
+        fd = open(path, O_RDWR | O_CLOEXEC);
+        if (fd != -1 && (size = check_filter(fd)) == 0) {
+            fprintf(stderr, "%s: not a filter of executed archives, starting with an empty one\n", path);
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd == -1 && (fd = create_filter(path, capacity, &size)) == -1) {
+        return -1;
+    }
+
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(path);
+        return -1;
+    }
+    // Set at random: no read ahead
+    madvise(map, size, MADV_RANDOM);
+    filter = map;
+    blocks = (uint64_t*) ((uint8_t*) map + DEDUP_BLOCK_SIZE);
+    filter_size = size;
+    campaign_add_commit_hook(commit_pending);
+    return 0;
+}
+
+
+bool dedup_enabled(void) {
+    return filter != NULL;
+}
+
+
+bool dedup_seen(const char* archive, const char* context, struct dedup_key* key) {
+    key->valid = false;
+    if (filter == NULL) {
+        return false;
+    }
+    size_t len;
+    uint8_t* content = scratch_read_file(archive, &len);
+    if (content == NULL) {
+        return false;
+    }
+    // The context then the archive, on the same two lanes
+    key->hash[0] = 0x6465647570210000ULL;
+    key->hash[1] = ~key->hash[0];
+    prng_hash(context, strlen(context), key->hash);
+    prng_hash(content, len, key->hash);
+    free(content);
+    key->valid = true;
+
+    // Run earlier by this worker, since the last checkpoint
+    if (pending_count > 0 && pending_slot(key)->valid) {
+        skipped++;
+        return true;
+    }
+
+    // The first hash picks the block, the second one the bits in it
+    const uint64_t* block = blocks + (key->hash[0] % filter->blocks) * WORDS_PER_BLOCK;
+    uint64_t bits = key->hash[1];
+    for (int h = 0; h < DEDUP_HASHES; h++, bits >>= 9) {
+        unsigned int bit = bits & (DEDUP_BLOCK_SIZE * 8 - 1);
+        if (!(__atomic_load_n(&block[bit / 64], __ATOMIC_RELAXED) & (1ULL << (bit % 64)))) {
+            return false;
+        }
+    }
+    skipped++;
+    return true;
+}
+
+
+void dedup_add(const struct dedup_key* key) {
+    if (filter == NULL || !key->valid) {
+        return;
+    }
+    // Without room to keep it until the checkpoint, it is added at once
+    if (2 * (pending_count + 1) > pending_size && grow_pending() == -1) {
+        set_bits(key);
+        return;
+    }
+    struct dedup_key* slot = pending_slot(key);
+    if (!slot->valid) {
+        *slot = *key;
+        pending_count++;
+    }
+}
+
+
+unsigned long dedup_skipped(void) {
+    return skipped;
+}
+
+
+unsigned long dedup_count(void) {
+    return filter != NULL ? __atomic_load_n(&filter->added, __ATOMIC_RELAXED) : 0;
+}
+
+
+void dedup_close(void) {
+    free(pending);
+    pending = NULL;
+    pending_size = 0;
+    pending_count = 0;
+    if (filter != NULL) {
+        munmap(filter, filter_size);
+        filter = NULL;
+    }
+}
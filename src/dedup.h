@@ -0,0 +1,99 @@
+#ifndef FUZZER_DEDUP_H
+#define FUZZER_DEDUP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Deduplication of the executions: the suites write the same archive more than once (the same too big uid in the
+ * numeric suite and in the boundaries, the golden header in every sweep, the mutations of the corpus...), and an
+ * archive run again in the same way tells nothing new. Every archive run to its end without a finding is added to a
+ * Bloom filter with how it was run (directory, fault schedule), and an archive found in the filter is not run again.
+ * The crashes and the other findings are never added: they are run, and recorded, every time.
+ *
+ * An archive is only added to the filter once the checkpoint that marks its test case finished is written: until
+ * then it waits with the other keys of the worker, which looks them up too. A worker interrupted or killed between
+ * two checkpoints runs those test cases again with --resume, instead of taking them for done.
+ *
+ * The filter is a file mapped by all the workers of a shard, created before they are forked and kept by --resume.
+ * It is split in blocks of 64 bytes, a cache line: an archive sets DEDUP_HASHES bits of a single block, with atomic
+ * operations so that the workers never take a lock. With DEDUP_BITS_PER_ENTRY bits per archive, about one archive in
+ * a thousand is wrongly taken for one already run once the filter holds its capacity.
+ */
+
+#define DEDUP_MAGIC "TARBLOM1"
+#define DEDUP_VERSION 2
+
+// Executions of a shard the filter is sized for with --dedup, when --dedup-capacity is not given (32 MB)
+#define DEDUP_DEFAULT_CAPACITY (1UL << 24)
+#define DEDUP_BITS_PER_ENTRY 16
+#define DEDUP_BLOCK_SIZE 64
+#define DEDUP_HASHES 7
+
+// Beginning of the filter, followed by the blocks
+struct dedup_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t block_size;
+    uint64_t capacity;
+    uint64_t blocks;
+    // Archives added, updated by all the workers
+    uint64_t added;
+    uint8_t reserved[24];
+};
+
+_Static_assert(sizeof(struct dedup_header) == DEDUP_BLOCK_SIZE, "the header is a block");
+
+// An archive and how it is run, as looked up in the filter
+struct dedup_key {
+    uint64_t hash[2];
+    // false if the archive could not be read, it is then never added
+    bool valid;
+};
+
+/**
+ * Opens the filter, mapped for this process and the ones it forks afterwards, and registers the commit hook of the
+ * campaign that adds the archives of the finished test cases
+ * @param path the file of the filter
+ * @param capacity number of archives it is sized for, used when it is created
+ * @param resume keep the filter of an interrupted run if there is one, instead of starting with an empty one
+ * @return 0 on success, -1 on error
+ */
+int dedup_open(const char* path, unsigned long capacity, bool resume);
+
+/**
+ * @return whether the filter is open
+ */
+bool dedup_enabled(void);
+
+/**
+ * Looks up an archive in the filter, counts it as skipped if it is there
+ * @param archive path of the archive
+ * @param context how it is run, e.g. the directory and the fault schedule
+ * @param key where to store the key of the archive, for dedup_add()
+ * @return true if the same archive was already run in the same context (or a false positive of the filter)
+ */
+bool dedup_seen(const char* archive, const char* context, struct dedup_key* key);
+
+/**
+ * Adds an archive to the filter once it has been run without a finding, at the next checkpoint
+ * @param key the key given by dedup_seen()
+ */
+void dedup_add(const struct dedup_key* key);
+
+/**
+ * @return the number of executions skipped by this process
+ */
+unsigned long dedup_skipped(void);
+
+/**
+ * @return the number of archives in the filter, added by all the workers
+ */
+unsigned long dedup_count(void);
+
+/**
+ * Unmaps the filter
+ */
+void dedup_close(void);
+
+#endif
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "differential.h"
+#include "executor.h"
+#include "scratch.h"
+
+
+// Longest command line of the reference
+#define MAX_ARGUMENTS 32
+#define MAX_COMMAND 1024
+
+static char command_line[MAX_COMMAND];
+// The words of the command line, then the archive and NULL
+static char* arguments[MAX_ARGUMENTS + 2];
+static int argument_count = 0;
+
+// The reference running, -1 if none
+static pid_t reference = -1;
+
+// The pairs of trees reported, by the low bits of their hash
+#define MISMATCH_SLOTS 65536
+static uint64_t mismatches[MISMATCH_SLOTS];
+
+
+int differential_enable(const char* command) {
+    if (strlen(command) >= sizeof(command_line)) {
+        return -1;
+    }
+    strcpy(command_line, command);
+
+    argument_count = 0;
+    char* saveptr;
+    for (char* word = strtok_r(command_line, " \t", &saveptr); word != NULL; word = strtok_r(NULL, " \t", &saveptr)) {
+        if (argument_count == MAX_ARGUMENTS) {
+            return -1;
+        }
+        arguments[argument_count++] = word;
+    }
+    return argument_count > 0 ? 0 : -1;
+}
+
+
+bool differential_enabled(void) {
+    return argument_count > 0;
+}
+
+
+int differential_start(const char* subdirectory, const char* archive) {
+    // The reference runs elsewhere: give it an absolute path
+    char archive_path[PATH_MAX * 2];
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        perror("getcwd");
+        return -1;
+    }
+    snprintf(archive_path, sizeof(archive_path), "%s/%s", cwd, archive);
+
+    char directory[PATH_MAX];
+    snprintf(directory, sizeof(directory), DIFFERENTIAL_DIRECTORY "%s%s", subdirectory != NULL ? "/" : "",
+             subdirectory != NULL ? subdirectory : "");
+    if (scratch_mkdirs(directory) == -1) {
+        perror(directory);
+        return -1;
+    }
+
+    reference = fork();
+    if (reference == -1) {
+        perror("fork");
+        return -1;
+    }
+
+    if (reference == 0) {
+        // Its messages would be mixed with those of the extractor, and only its tree matters
+        int null = open("/dev/null", O_WRONLY | O_CLOEXEC);
+        if (null != -1) {
+            dup2(null, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+        }
+        // The same limits as the extractor: the reference reads the same archives
+        executor_apply_limits();
+        arguments[argument_count] = archive_path;
+        arguments[argument_count + 1] = NULL;
+        if (chdir(directory) == 0) {
+            execvp(arguments[0], arguments);
+        }
+        _exit(127);
+    }
+    return 0;
+}
+
+
+int differential_finish(uint64_t* fingerprint, int* status) {
+    if (reference == -1) {
+        return -1;
+    }
+    pid_t pid = reference;
+    reference = -1;
+    while (waitpid(pid, status, 0) == -1) {
+        if (errno != EINTR) {
+            perror("waitpid");
+            return -1;
+        }
+    }
+
+    if (scratch_clean_fingerprint(DIFFERENTIAL_DIRECTORY, fingerprint) == -1) {
+        perror(DIFFERENTIAL_DIRECTORY);
+    }
+    return 0;
+}
+
+
+bool differential_new_mismatch(uint64_t fingerprint, uint64_t reference_fingerprint) {
+    uint64_t pair = (fingerprint ^ (reference_fingerprint * 0x9e3779b97f4a7c15ULL)) | 1;
+    uint64_t* slot = &mismatches[(pair >> 1) % MISMATCH_SLOTS];
+    if (*slot == pair) {
+        return false;
+    }
+    *slot = pair;
+    return true;
+}
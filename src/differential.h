@@ -0,0 +1,57 @@
+#ifndef FUZZER_DIFFERENTIAL_H
+#define FUZZER_DIFFERENTIAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Differential oracle: a wrong extraction that does not crash is invisible to extract(). A reference extractor
+ * (e.g. the system tar) extracts every archive too, in its own directory and at the same time as the extractor,
+ * so that it adds latency but no CPU time on a box with a core to spare. The two trees are compared by their
+ * fingerprints (see scratch_clean_fingerprint()): when the extractor neither crashed nor ran into a limit,
+ * a different tree is a semantic bug, such as a path that is not handled the same way.
+ */
+
+// Where the reference extractor runs, emptied after each execution
+#define DIFFERENTIAL_DIRECTORY "reference"
+
+/**
+ * Runs a reference extractor on every archive
+ * @param command the command line of the reference, split on spaces, the path of the archive is appended
+ *                (e.g. "tar --no-same-owner -xf")
+ * @return 0 on success, -1 if the command is empty or too long
+ */
+int differential_enable(const char* command);
+
+/**
+ * @return true if a reference extractor runs on every archive
+ */
+bool differential_enabled(void);
+
+/**
+ * Starts the reference extractor on an archive without waiting for it
+ * @param subdirectory where it runs in DIFFERENTIAL_DIRECTORY, created if needed, NULL for DIFFERENTIAL_DIRECTORY:
+ *                     the same nesting as the extractor, so that what goes through ".." lands at the same place
+ * @param archive path of the archive, relative to the current directory
+ * @return 0 on success, -1 if it could not be started
+ */
+int differential_start(const char* subdirectory, const char* archive);
+
+/**
+ * Waits for the reference extractor, then empties DIFFERENTIAL_DIRECTORY
+ * @param fingerprint where to store the fingerprint of DIFFERENTIAL_DIRECTORY
+ * @param status where to store the status returned by waitpid()
+ * @return 0 on success, -1 if it was not started or could not be waited for
+ */
+int differential_finish(uint64_t* fingerprint, int* status);
+
+/**
+ * Tells if a pair of different trees was not reported yet: a sweep gives the same pair for most of its characters.
+ * The pairs are kept in a table of fixed size, a pair evicted by another one may be reported again.
+ * @param fingerprint fingerprint of the tree of the extractor
+ * @param reference_fingerprint fingerprint of the tree of the reference
+ * @return true if the pair is new
+ */
+bool differential_new_mismatch(uint64_t fingerprint, uint64_t reference_fingerprint);
+
+#endif
@@ -0,0 +1,1022 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/ptrace.h>
+#include <sys/signalfd.h>
+#include <linux/perf_event.h>
+
+#include "executor.h"
+#include "systrace.h"
+#include "triage.h"
+#include "scratch.h"
+
+
+// What the extractor prints when it catches a crash
+#define CRASH_MESSAGE "*** The program has crashed ***\n"
+
+// The resources that can be limited, and how a limit hit is described
+static const struct {
+    const char* name;
+    int resource;
+    // Errors of the calls failing because of the limit (strerror()), only to describe a limit hit found from the
+    // signal or the costs: any failed call prints them. An allocation that fails unchecked shows up later as a bad
+    // address given to a system call.
+    int errors[2];
+    // Signal sent when the limit is reached, 0 if none
+    int signal;
+} limits[LIMIT_COUNT] = {
+    [LIMIT_AS] = {"as", RLIMIT_AS, {ENOMEM, EFAULT}, 0},
+    [LIMIT_FSIZE] = {"fsize", RLIMIT_FSIZE, {EFBIG, 0}, SIGXFSZ},
+    [LIMIT_NOFILE] = {"nofile", RLIMIT_NOFILE, {EMFILE, 0}, 0},
+    [LIMIT_CPU] = {"cpu", RLIMIT_CPU, {0, 0}, SIGXCPU},
+};
+
+// Value of each limit, 0 if there is none
+static rlim_t limit_values[LIMIT_COUNT] = {
+    [LIMIT_AS] = 1024 * 1024 * 1024,
+    [LIMIT_FSIZE] = 64 * 1024 * 1024,
+    [LIMIT_NOFILE] = 256,
+    [LIMIT_CPU] = 10,
+};
+
+// Longest message searched for in the errors of the extractor
+#define MAX_ERROR_MESSAGE 64
+
+// An allocation fails at the limit of the address space without a signal: the limit is taken as hit when the peak
+// RSS of the extractor reached this share of it (in percent), the rest being its code and mappings not touched
+#define AS_PEAK_PERCENT 75
+
+// Persistent mode: how long the harness has to say it is ready (ms), and the archives run again in a new process
+// to check that it puts everything back, the first ones and one in an interval
+#define PERSISTENT_START_TIMEOUT 5000
+#define PERSISTENT_FIRST_CHECKS 8
+#define PERSISTENT_CHECK_INTERVAL 64
+// Starts of the server failing in a row before the executor stays with a process per archive
+#define PERSISTENT_START_ATTEMPTS 3
+
+// Performance counter: requested, and the one that could be opened
+static bool counter_enabled = false;
+// Syscall tracing: requested, and the signalfd that wakes the tracer up when the child stops
+static bool trace_enabled = false;
+static int child_signals = -1;
+// Crash triage: the child is traced too, to be stopped before its fatal signal
+static bool triage_enabled = false;
+static bool counter_probed = false;
+// Value of LD_PRELOAD in the extractor, empty if nothing is preloaded
+static char preload[PATH_MAX * 4] = "";
+static enum executor_counter counter_kind = COUNTER_NONE;
+
+// Answer of the persistent harness after each archive, see src/preload/persistent.c
+struct persistent_status {
+    int32_t exit_code;
+    int32_t crash_signal;
+    uint32_t leaks;
+    uint32_t reserved;
+    int64_t user_us;
+    int64_t sys_us;
+    int64_t max_rss;
+    int64_t minor_faults;
+    int64_t major_faults;
+    uint64_t bytes_written;
+    int64_t total_user_us;
+    int64_t total_sys_us;
+};
+
+// Persistent mode: the harness, preloaded before the other libraries, and the server running
+static bool persistent_enabled = false;
+static char persistent_library[PATH_MAX] = "";
+static struct {
+    pid_t pid;
+    // The process that started it: the workers forked later start their own
+    pid_t owner;
+    char extractor[PATH_MAX];
+    // Socket of the requests and answers, standard output and error of the extractor
+    int socket;
+    int output;
+    int errors;
+    // CPU time of the server when it answered the last archive, to know what the next one cost if it dies
+    double user_time;
+    double sys_time;
+} server = {.pid = -1};
+static unsigned long persistent_runs = 0;
+static unsigned int persistent_failures = 0;
+
+
+int executor_parse_limit(const char* arg) {
+    const char* equal = strchr(arg, '=');
+    if (equal == NULL) {
+        return -1;
+    }
+    char* end;
+    unsigned long long value = strtoull(equal + 1, &end, 10);
+    if (end == equal + 1 || *end != '\0') {
+        return -1;
+    }
+
+    for (int l = LIMIT_NONE + 1; l < LIMIT_COUNT; l++) {
+        if (strlen(limits[l].name) == (size_t) (equal - arg) && strncmp(limits[l].name, arg, equal - arg) == 0) {
+            limit_values[l] = (rlim_t) value;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+
+void executor_describe_limit(const struct execution* execution, char* buf, size_t len) {
+    enum executor_limit limit = execution->limit;
+    if (limit == LIMIT_NONE) {
+        snprintf(buf, len, "none");
+        return;
+    }
+
+    const char* how;
+    if (WIFSIGNALED(execution->status) && (limits[limit].signal == WTERMSIG(execution->status) ||
+                                           (limit == LIMIT_CPU && WTERMSIG(execution->status) == SIGKILL))) {
+        how = strsignal(WTERMSIG(execution->status));
+    } else if (execution->limit_error != 0) {
+        how = strerror(execution->limit_error);
+    } else if (limit == LIMIT_AS) {
+        how = "peak RSS";
+    } else {
+        how = "write cut short";
+    }
+    snprintf(buf, len, "%s=%llu (%s)", limits[limit].name, (unsigned long long) limit_values[limit], how);
+}
+
+
+/**
+ * Applies the limits to the current process
+ * @param cpu false for the persistent server: the CPU time adds up over the archives, its limit is a timeout
+ */
+static void apply_limits(bool cpu) {
+    for (int l = LIMIT_NONE + 1; l < LIMIT_COUNT; l++) {
+        if (limits[l].signal != 0) {
+            // An ignored signal stays ignored after execv(), e.g. when the fuzzer is started from Python
+            signal(limits[l].signal, SIG_DFL);
+        }
+        if (limit_values[l] > 0 && (cpu || l != LIMIT_CPU)) {
+            struct rlimit rlimit = {limit_values[l], limit_values[l]};
+            if (l == LIMIT_CPU) {
+                // SIGXCPU at the soft limit, SIGKILL if the extractor goes on
+                rlimit.rlim_max++;
+            }
+            if (setrlimit(limits[l].resource, &rlimit) == -1) {
+                perror("setrlimit");
+            }
+        }
+    }
+}
+
+
+void executor_apply_limits(void) {
+    apply_limits(true);
+}
+
+
+/**
+ * Looks for the errors of a limit in what the extractor printed on stderr, to describe a limit hit
+ * @param errors what it printed
+ * @param len number of bytes
+ * @param error where to store the error found
+ * @return the limit, LIMIT_NONE if there is none
+ */
+static enum executor_limit find_limit_error(const char* errors, size_t len, int* error) {
+    for (int l = LIMIT_NONE + 1; l < LIMIT_COUNT; l++) {
+        for (int e = 0; e < 2 && limit_values[l] > 0 && limits[l].errors[e] != 0; e++) {
+            const char* message = strerror(limits[l].errors[e]);
+            if (memmem(errors, len, message, strlen(message)) != NULL) {
+                *error = limits[l].errors[e];
+                return l;
+            }
+        }
+    }
+    return LIMIT_NONE;
+}
+
+
+/**
+ * Copies the errors just read to stderr and looks for the errors of a limit in them
+ * @param window the end of the previous errors (kept bytes), then the new ones (n bytes)
+ * @param kept number of bytes kept from the previous errors, updated
+ * @param n number of bytes read
+ * @param error_limit the limit of the first error found so far, updated
+ * @param error the error, updated
+ */
+static void scan_errors(char* window, size_t* kept, size_t n, enum executor_limit* error_limit, int* error) {
+    if (write(STDERR_FILENO, window + *kept, n) == -1) {
+        // The errors are only copied for the user
+    }
+    if (*error_limit == LIMIT_NONE) {
+        *error_limit = find_limit_error(window, *kept + n, error);
+    }
+    size_t total = *kept + n;
+    *kept = total < MAX_ERROR_MESSAGE ? total : MAX_ERROR_MESSAGE;
+    memmove(window, window + total - *kept, *kept);
+}
+
+
+int executor_add_preload(const char* library) {
+    // The extractor runs in another directory: an absolute path
+    char path[PATH_MAX];
+    if (realpath(library, path) == NULL) {
+        perror(library);
+        return -1;
+    }
+    if (preload[0] == '\0') {
+        // Keep what the fuzzer itself was started with
+        const char* inherited = getenv("LD_PRELOAD");
+        snprintf(preload, sizeof(preload), "%s", inherited != NULL ? inherited : "");
+    }
+    size_t len = strlen(preload);
+    if (len + 1 + strlen(path) + 1 > sizeof(preload)) {
+        fprintf(stderr, "Too many preloaded libraries\n");
+        return -1;
+    }
+    snprintf(preload + len, sizeof(preload) - len, "%s%s", len > 0 ? ":" : "", path);
+    return 0;
+}
+
+
+/**
+ * Opens the signalfd that wakes the tracer up, once for the syscall trace and the triage
+ * @return 0 on success, -1 on error
+ */
+static int open_child_signals(void) {
+    if (child_signals != -1) {
+        return 0;
+    }
+
+    // SIGCHLD is only received through the signalfd, the children unblock it before execv()
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) == -1) {
+        perror("sigprocmask");
+        return -1;
+    }
+    child_signals = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (child_signals == -1) {
+        perror("signalfd");
+        return -1;
+    }
+    return 0;
+}
+
+
+int executor_enable_trace(void) {
+    if (!systrace_supported()) {
+        fprintf(stderr, "The system calls cannot be traced on this architecture\n");
+        return -1;
+    }
+    if (open_child_signals() == -1) {
+        return -1;
+    }
+    trace_enabled = true;
+    return 0;
+}
+
+
+int executor_enable_triage(void) {
+    if (!triage_supported()) {
+        fprintf(stderr, "The crashes cannot be triaged on this architecture\n");
+        return -1;
+    }
+    if (open_child_signals() == -1) {
+        return -1;
+    }
+    triage_enabled = true;
+    return 0;
+}
+
+
+/**
+ * Handles the stops of the traced child: a traced call, or a signal to deliver.
+ * An exit is only looked at (WNOWAIT), it is reaped by executor_run().
+ * @param pid the child
+ * @param fatal where to store the first fatal signal delivered to the child
+ * @return false once the child has exited
+ */
+static bool handle_stops(pid_t pid, int* fatal) {
+    for (;;) {
+        siginfo_t info;
+        info.si_pid = 0;
+        if (waitid(P_PID, pid, &info, WEXITED | WSTOPPED | WNOHANG | WNOWAIT) == -1) {
+            return false;
+        }
+        if (info.si_pid == 0) {
+            // Still running
+            return true;
+        }
+        if (info.si_code == CLD_EXITED || info.si_code == CLD_KILLED || info.si_code == CLD_DUMPED) {
+            return false;
+        }
+
+        // A stopped child cannot exit: this only takes the stop
+        int status;
+        if (waitpid(pid, &status, WNOHANG) <= 0) {
+            return true;
+        }
+        int sig = 0;
+        if (status >> 8 == (SIGTRAP | (PTRACE_EVENT_SECCOMP << 8))) {
+            systrace_record(pid);
+        } else if (status >> 16 == 0) {
+            // Signal delivery: the extractor gets its signals (SIGSEGV for its crash handler, SIGXFSZ...)
+            sig = WSTOPSIG(status);
+            if (triage_is_fatal(sig) && *fatal == 0) {
+                *fatal = sig;
+            }
+            if (triage_enabled && triage_is_fatal(sig)) {
+                // Before the handler runs: the registers are still those of the fault
+                triage_capture(pid, sig);
+            }
+        }
+        ptrace(PTRACE_CONT, pid, NULL, (void*) (long) sig);
+    }
+}
+
+
+void executor_enable_counter(void) {
+    counter_enabled = true;
+}
+
+
+enum executor_counter executor_counter(void) {
+    return counter_kind;
+}
+
+
+/**
+ * Opens the counter on a child that has not called execv() yet, it starts counting at execv().
+ * The first call finds out which counter is available.
+ * @return the counter, -1 if none can be opened
+ */
+static int open_counter(pid_t pid) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    if (!counter_probed) {
+        // Hardware instructions if possible, the software task clock otherwise
+        counter_probed = true;
+        for (counter_kind = COUNTER_INSTRUCTIONS; counter_kind <= COUNTER_TASK_CLOCK; counter_kind++) {
+            int fd = open_counter(pid);
+            if (fd != -1) {
+                return fd;
+            }
+        }
+        perror("perf_event_open");
+        counter_kind = COUNTER_NONE;
+        return -1;
+    }
+
+    if (counter_kind == COUNTER_INSTRUCTIONS) {
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    } else if (counter_kind == COUNTER_TASK_CLOCK) {
+        attr.type = PERF_TYPE_SOFTWARE;
+        attr.config = PERF_COUNT_SW_TASK_CLOCK;
+    } else {
+        return -1;
+    }
+    return (int) syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+
+/**
+ * Reads the bytes written by a process that exited but was not reaped yet
+ * @return the wchar counter of /proc/<pid>/io, 0 if it cannot be read
+ */
+static uint64_t read_bytes_written(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/io", (int) pid);
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return 0;
+    }
+
+    char line[128];
+    uint64_t written = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (sscanf(line, "wchar: %" SCNu64, &written) == 1) {
+            break;
+        }
+    }
+    fclose(file);
+    return written;
+}
+
+
+static double elapsed_ms(const struct timespec* start, const struct timespec* end) {
+    return (end->tv_sec - start->tv_sec) * 1000.0 + (end->tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+
+static double timeval_ms(const struct timeval* tv) {
+    return tv->tv_sec * 1000.0 + tv->tv_usec / 1000.0;
+}
+
+
+/**
+ * Finds the fatal signal and the limit of an execution, once its status and costs are known. A limit is only found
+ * from its signal or from the costs: an error message alone is printed by any call that fails, and a crash is a
+ * crash whatever the extractor printed before.
+ * @param execution the execution
+ * @param error_limit the limit of the first error found in the messages of the extractor, to describe the limit
+ * @param error the error
+ * @param own_peak whether the peak RSS is that of this execution alone, not of a server that ran others before
+ */
+static void classify(struct execution* execution, enum executor_limit error_limit, int error, bool own_peak) {
+    // The crash handler of the extractor only catches SIGSEGV
+    if (WIFSIGNALED(execution->status)) {
+        execution->signal = WTERMSIG(execution->status);
+    } else if (execution->crashed && execution->signal == 0) {
+        execution->signal = SIGSEGV;
+    }
+
+    // Killed by the signal of a limit (SIGKILL after SIGXCPU when it is ignored)
+    if (WIFSIGNALED(execution->status)) {
+        int sig = WTERMSIG(execution->status);
+        for (int l = LIMIT_NONE + 1; l < LIMIT_COUNT; l++) {
+            if (limit_values[l] > 0 && limits[l].signal != 0 && sig == limits[l].signal) {
+                execution->limit = l;
+            }
+        }
+        if (sig == SIGKILL && limit_values[LIMIT_CPU] > 0 &&
+            execution->user_time + execution->sys_time >= limit_values[LIMIT_CPU] * 1000.0) {
+            execution->limit = LIMIT_CPU;
+        }
+    }
+    // A write that crosses the limit is cut short without a signal, the extractor may stop there silently
+    if (execution->limit == LIMIT_NONE && limit_values[LIMIT_FSIZE] > 0 &&
+        execution->bytes_written >= limit_values[LIMIT_FSIZE]) {
+        execution->limit = LIMIT_FSIZE;
+    }
+    // An allocation refused near the limit of the address space. The open files cannot be counted once the extractor
+    // has exited: EMFILE is never taken for a limit hit.
+    if (execution->limit == LIMIT_NONE && own_peak && limit_values[LIMIT_AS] > 0 &&
+        execution->max_rss * 1024.0 * 100 >= (double) limit_values[LIMIT_AS] * AS_PEAK_PERCENT) {
+        execution->limit = LIMIT_AS;
+    }
+    if (execution->limit != LIMIT_NONE) {
+        execution->crashed = false;
+        // An injected error is not the one of the limit
+        if (error_limit == execution->limit && !execution->injected) {
+            execution->limit_error = error;
+        }
+    }
+}
+
+
+/**
+ * Runs the extractor in a new process
+ * @param archive_path path of the archive, absolute if the extractor runs in another directory
+ */
+static int fork_run(const char* extractor, const char* directory, const char* archive_path, bool injected,
+                    struct execution* execution) {
+    memset(execution, 0, sizeof(*execution));
+    execution->injected = injected;
+
+    // Standard output and error of the extractor, and a pipe closed by a successful execv() or carrying its errno
+    int output[2];
+    int errors[2];
+    int exec_error[2];
+    if (pipe2(output, O_CLOEXEC) == -1) {
+        perror("pipe");
+        return -1;
+    }
+    if (pipe2(errors, O_CLOEXEC) == -1) {
+        perror("pipe");
+        close(output[0]);
+        close(output[1]);
+        return -1;
+    }
+    if (pipe2(exec_error, O_CLOEXEC) == -1) {
+        perror("pipe");
+        close(output[0]);
+        close(output[1]);
+        close(errors[0]);
+        close(errors[1]);
+        return -1;
+    }
+
+    // With a counter or a tracer, the child waits for them to be set up before calling execv()
+    int start_barrier[2] = {-1, -1};
+    if ((counter_enabled || trace_enabled || triage_enabled) && pipe2(start_barrier, O_CLOEXEC) == -1) {
+        perror("pipe");
+        start_barrier[0] = start_barrier[1] = -1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        close(output[0]);
+        close(output[1]);
+        close(errors[0]);
+        close(errors[1]);
+        close(exec_error[0]);
+        close(exec_error[1]);
+        if (start_barrier[0] != -1) {
+            close(start_barrier[0]);
+            close(start_barrier[1]);
+        }
+        return -1;
+    }
+
+    if (pid == 0) {
+        dup2(output[1], STDOUT_FILENO);
+        dup2(errors[1], STDERR_FILENO);
+        executor_apply_limits();
+        if (triage_enabled) {
+            // The report replaces the core file
+            struct rlimit no_core = {0, 0};
+            setrlimit(RLIMIT_CORE, &no_core);
+        }
+        if (start_barrier[0] != -1) {
+            // 'T' for the seccomp filter of the syscall trace, anything else runs it without
+            char go = 0;
+            close(start_barrier[1]);
+            if (read(start_barrier[0], &go, 1) == 1 && go == 'T' && systrace_install_filter() == -1) {
+                perror("seccomp");
+            }
+        }
+        if (child_signals != -1) {
+            sigset_t mask;
+            sigemptyset(&mask);
+            sigaddset(&mask, SIGCHLD);
+            sigprocmask(SIG_UNBLOCK, &mask, NULL);
+        }
+        if (preload[0] != '\0') {
+            setenv("LD_PRELOAD", preload, 1);
+        }
+        if (directory == NULL || chdir(directory) == 0) {
+            char* argv[] = {(char*) extractor, (char*) archive_path, NULL};
+            execv(extractor, argv);
+        }
+        int err = errno;
+        if (write(exec_error[1], &err, sizeof(err)) == -1) {
+            // Nothing else can be done in the child
+        }
+        _exit(127);
+    }
+
+    close(output[1]);
+    close(errors[1]);
+    close(exec_error[1]);
+
+    int counter = -1;
+    bool tracing = false;
+    bool traced = false;
+    if (start_barrier[0] != -1) {
+        if (counter_enabled) {
+            counter = open_counter(pid);
+        }
+        if (trace_enabled || triage_enabled) {
+            systrace_start();
+            triage_start();
+            tracing = ptrace(PTRACE_SEIZE, pid, NULL, (void*) (PTRACE_O_TRACESECCOMP | PTRACE_O_EXITKILL)) == 0;
+            if (!tracing) {
+                perror("ptrace");
+            }
+        }
+        traced = tracing && trace_enabled;
+        // The seccomp filter only for the syscall trace, the triage only needs the signals
+        char go = traced ? 'T' : 'G';
+        if (write(start_barrier[1], &go, 1) == -1) {
+            // The child runs anyway when the pipe is closed
+        }
+        close(start_barrier[0]);
+        close(start_barrier[1]);
+    }
+
+    // Same check as before: the first line, up to the length of the message. Then both outputs are drained,
+    // so that the extractor never blocks on a full pipe, and its errors are copied to stderr.
+    char buf[sizeof(CRASH_MESSAGE)];
+    size_t got = 0;
+    bool first_line = false;
+    // The errors are searched in the end of the previous read and the new one: a message can be split
+    char window[MAX_ERROR_MESSAGE + 4096];
+    size_t kept = 0;
+    enum executor_limit error_limit = LIMIT_NONE;
+    int error = 0;
+
+    // The tracer also wakes up when the child stops, until it exits
+    struct pollfd fds[3] = {{output[0], POLLIN, 0}, {errors[0], POLLIN, 0}, {tracing ? child_signals : -1, POLLIN, 0}};
+    int open_fds = 2;
+    while (open_fds > 0 || tracing) {
+        if (poll(fds, 3, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            break;
+        }
+
+        if (fds[0].revents != 0) {
+            char drain[4096];
+            ssize_t n = first_line ? read(output[0], drain, sizeof(drain))
+                                   : read(output[0], buf + got, sizeof(buf) - 1 - got);
+            if (n <= 0) {
+                fds[0].fd = -1;
+                open_fds--;
+            } else if (!first_line) {
+                got += n;
+                first_line = got == sizeof(buf) - 1 || memchr(buf, '\n', got) != NULL;
+            }
+        }
+
+        if (fds[1].revents != 0) {
+            ssize_t n = read(errors[0], window + kept, sizeof(window) - kept);
+            if (n <= 0) {
+                fds[1].fd = -1;
+                open_fds--;
+            } else {
+                scan_errors(window, &kept, n, &error_limit, &error);
+            }
+        }
+
+        if (fds[2].revents != 0) {
+            struct signalfd_siginfo signal_info;
+            while (read(child_signals, &signal_info, sizeof(signal_info)) > 0) {
+            }
+            tracing = handle_stops(pid, &execution->signal);
+            if (!tracing) {
+                fds[2].fd = -1;
+            }
+        }
+    }
+    execution->crashed = got == sizeof(buf) - 1 && memcmp(buf, CRASH_MESSAGE, got) == 0;
+    close(output[0]);
+    close(errors[0]);
+
+    int err = 0;
+    bool exec_failed = read(exec_error[0], &err, sizeof(err)) == sizeof(err);
+    close(exec_error[0]);
+
+    // Wait without reaping first: /proc/<pid>/io disappears with the process
+    siginfo_t info;
+    if (waitid(P_PID, pid, &info, WEXITED | WNOWAIT) == 0) {
+        execution->bytes_written = read_bytes_written(pid);
+    }
+    if (counter != -1) {
+        if (read(counter, &execution->counter, sizeof(execution->counter)) != sizeof(execution->counter)) {
+            execution->counter = 0;
+        }
+        close(counter);
+    }
+
+    struct rusage usage;
+    if (wait4(pid, &execution->status, 0, &usage) == -1) {
+        perror("wait4");
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (exec_failed) {
+        fprintf(stderr, "%s: %s\n", extractor, strerror(err));
+        return -1;
+    }
+
+    execution->wall_time = elapsed_ms(&start, &end);
+    execution->user_time = timeval_ms(&usage.ru_utime);
+    execution->sys_time = timeval_ms(&usage.ru_stime);
+    execution->max_rss = usage.ru_maxrss;
+    execution->minor_faults = usage.ru_minflt;
+    execution->major_faults = usage.ru_majflt;
+    classify(execution, error_limit, error, true);
+
+    if (traced) {
+        execution->new_behaviours = systrace_finish(&execution->trace_hash);
+    }
+    return 0;
+}
+
+
+
+int executor_enable_persistent(const char* library) {
+    // The extractor runs in another directory: an absolute path
+    if (realpath(library, persistent_library) == NULL) {
+        perror(library);
+        return -1;
+    }
+    persistent_enabled = true;
+    return 0;
+}
+
+
+/**
+ * Forgets the persistent server, once it has exited or been reaped
+ */
+static void close_server(void) {
+    close(server.socket);
+    close(server.output);
+    close(server.errors);
+    server.pid = -1;
+}
+
+
+/**
+ * Stops the persistent server, or only forgets it in a worker forked after it was started
+ */
+static void stop_server(void) {
+    if (server.pid == -1) {
+        return;
+    }
+    if (server.owner == getpid()) {
+        kill(server.pid, SIGKILL);
+        waitpid(server.pid, NULL, 0);
+    }
+    close_server();
+}
+
+
+/**
+ * Starts the extractor with the persistent harness, and waits for it to be ready
+ * @return 0 on success, -1 if the harness does not answer (static extractor, library not found...)
+ */
+static int start_server(const char* extractor) {
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) == -1) {
+        perror("socketpair");
+        return -1;
+    }
+    // The outputs of each archive are read back from the start, then truncated
+    int output = memfd_create("output", MFD_CLOEXEC);
+    int errors = memfd_create("errors", MFD_CLOEXEC);
+    if (output == -1 || errors == -1) {
+        perror("memfd_create");
+        close(sockets[0]);
+        close(sockets[1]);
+        if (output != -1) {
+            close(output);
+        }
+        if (errors != -1) {
+            close(errors);
+        }
+        return -1;
+    }
+
+    // The harness first: it sees the allocations before the guard-page allocator
+    char libraries[sizeof(preload) + PATH_MAX + 1];
+    const char* others = preload[0] != '\0' ? preload : getenv("LD_PRELOAD");
+    snprintf(libraries, sizeof(libraries), "%s%s%s", persistent_library,
+             others != NULL && others[0] != '\0' ? ":" : "", others != NULL ? others : "");
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        close(sockets[0]);
+        close(sockets[1]);
+        close(output);
+        close(errors);
+        return -1;
+    }
+    if (pid == 0) {
+        dup2(output, STDOUT_FILENO);
+        dup2(errors, STDERR_FILENO);
+        apply_limits(false);
+        // dup() clears close-on-exec
+        char fd[16];
+        snprintf(fd, sizeof(fd), "%d", dup(sockets[1]));
+        setenv("PERSISTENT_FD", fd, 1);
+        setenv("LD_PRELOAD", libraries, 1);
+        char* argv[] = {(char*) extractor, NULL};
+        execv(extractor, argv);
+        _exit(127);
+    }
+    close(sockets[1]);
+
+    server.pid = pid;
+    server.owner = getpid();
+    snprintf(server.extractor, sizeof(server.extractor), "%s", extractor);
+    server.socket = sockets[0];
+    server.output = output;
+    server.errors = errors;
+    server.user_time = server.sys_time = 0;
+
+    // Without the harness, the extractor prints its usage and exits
+    struct pollfd fds = {server.socket, POLLIN, 0};
+    char ready = 0;
+    if (poll(&fds, 1, PERSISTENT_START_TIMEOUT) != 1 || read(server.socket, &ready, 1) != 1 || ready != 'P') {
+        fprintf(stderr, "The persistent harness did not start in %s\n", extractor);
+        stop_server();
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * @return whether a signal is one of those sent to stop the campaign (SIGINT, SIGTERM), to the server too
+ */
+static bool stop_signal(int sig) {
+    return sig == SIGINT || sig == SIGTERM;
+}
+
+
+/**
+ * Runs the extractor on an archive in the persistent server, started if needed
+ * @param directory where the extractor runs, absolute
+ * @param archive_path path of the archive, absolute
+ * @return 0 if the extractor ran, -1 if the server could not be started or reached
+ */
+static int persistent_run(const char* extractor, const char* directory, const char* archive_path, bool injected,
+                          struct execution* execution) {
+    memset(execution, 0, sizeof(*execution));
+    execution->injected = injected;
+    if (server.pid != -1 && (server.owner != getpid() || strcmp(server.extractor, extractor) != 0)) {
+        stop_server();
+    }
+    if (server.pid == -1 && start_server(extractor) == -1) {
+        return -1;
+    }
+
+    if (ftruncate(server.output, 0) == -1 || ftruncate(server.errors, 0) == -1 ||
+        lseek(server.output, 0, SEEK_SET) == -1 || lseek(server.errors, 0, SEEK_SET) == -1) {
+        perror("ftruncate");
+        stop_server();
+        return -1;
+    }
+
+    char request[PATH_MAX * 4];
+    int len = snprintf(request, sizeof(request), "%s\n%s\n", directory, archive_path);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (len >= (int) sizeof(request) || send(server.socket, request, len, MSG_NOSIGNAL) != len) {
+        perror("send");
+        stop_server();
+        return -1;
+    }
+
+    // The CPU limit becomes a timeout: SIGKILL one second after it, as RLIMIT_CPU would
+    int timeout = limit_values[LIMIT_CPU] > 0 ? (int) (limit_values[LIMIT_CPU] + 1) * 1000 : -1;
+    struct pollfd fds = {server.socket, POLLIN, 0};
+    int ready;
+    while ((ready = poll(&fds, 1, timeout)) == -1 && errno == EINTR) {
+    }
+    struct persistent_status status = {0};
+    bool answered = ready == 1 && recv(server.socket, &status, sizeof(status), MSG_WAITALL) == sizeof(status);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    execution->wall_time = elapsed_ms(&start, &end);
+
+    if (answered) {
+        execution->status = (status.exit_code & 0xff) << 8;
+        execution->signal = status.crash_signal;
+        execution->user_time = status.user_us / 1000.0;
+        execution->sys_time = status.sys_us / 1000.0;
+        execution->max_rss = status.max_rss;
+        execution->minor_faults = status.minor_faults;
+        execution->major_faults = status.major_faults;
+        execution->bytes_written = status.bytes_written;
+        server.user_time = status.total_user_us / 1000.0;
+        server.sys_time = status.total_sys_us / 1000.0;
+        if (status.crash_signal != 0) {
+            // The harness exits after a crash, its heap cannot be trusted
+            waitpid(server.pid, NULL, 0);
+            server.pid = -1;
+        }
+    } else {
+        // Killed by the archive, or at the CPU limit
+        if (ready == 0) {
+            kill(server.pid, SIGKILL);
+        }
+        struct rusage usage;
+        if (wait4(server.pid, &execution->status, 0, &usage) == -1) {
+            perror("wait4");
+            stop_server();
+            return -1;
+        }
+        server.pid = -1;
+        // Killed by the signal that stops the campaign: what it used is not the cost of the archive, and it ran
+        // into no limit
+        if (WIFSIGNALED(execution->status) && stop_signal(WTERMSIG(execution->status))) {
+            execution->signal = WTERMSIG(execution->status);
+            close_server();
+            return 0;
+        }
+        execution->user_time = timeval_ms(&usage.ru_utime) - server.user_time;
+        execution->sys_time = timeval_ms(&usage.ru_stime) - server.sys_time;
+        execution->max_rss = usage.ru_maxrss;
+    }
+
+    // Same checks as with a process per archive, on what the extractor left in the outputs
+    char buf[sizeof(CRASH_MESSAGE)];
+    ssize_t got = pread(server.output, buf, sizeof(buf) - 1, 0);
+    execution->crashed = got == sizeof(buf) - 1 && memcmp(buf, CRASH_MESSAGE, got) == 0;
+    char window[MAX_ERROR_MESSAGE + 4096];
+    size_t kept = 0;
+    enum executor_limit error_limit = LIMIT_NONE;
+    int error = 0;
+    off_t offset = 0;
+    ssize_t n;
+    while ((n = pread(server.errors, window + kept, sizeof(window) - kept, offset)) > 0) {
+        offset += n;
+        scan_errors(window, &kept, n, &error_limit, &error);
+    }
+    // The peak RSS of the server covers all the archives it ran
+    classify(execution, error_limit, error, false);
+    if (ready == 0 && limit_values[LIMIT_CPU] > 0) {
+        execution->limit = LIMIT_CPU;
+        execution->crashed = false;
+    }
+
+    if (server.pid == -1) {
+        close_server();
+    } else if (status.leaks != 0) {
+        fprintf(stderr, "The persistent harness cannot put the extractor back in its initial state (leaks %#x), "
+                "back to a process per archive\n", status.leaks);
+        persistent_enabled = false;
+        stop_server();
+    }
+    persistent_runs++;
+    return 0;
+}
+
+
+void executor_plain(void) {
+    // The server belongs to the process that started it
+    stop_server();
+    persistent_enabled = false;
+    counter_enabled = false;
+    trace_enabled = false;
+    triage_enabled = false;
+}
+
+
+int executor_run(const char* extractor, const char* directory, const char* archive, bool injected,
+                 struct execution* execution) {
+    // The counter and the tracer follow one process per archive
+    bool persistent = persistent_enabled && !counter_enabled && !trace_enabled && !triage_enabled;
+
+    // The extractor runs elsewhere: give it an absolute path
+    char archive_path[PATH_MAX * 2];
+    char cwd[PATH_MAX];
+    if ((directory != NULL || persistent) && getcwd(cwd, sizeof(cwd)) == NULL) {
+        perror("getcwd");
+        return -1;
+    }
+    if ((directory != NULL || persistent) && archive[0] != '/') {
+        snprintf(archive_path, sizeof(archive_path), "%s/%s", cwd, archive);
+    } else {
+        snprintf(archive_path, sizeof(archive_path), "%s", archive);
+    }
+    if (!persistent) {
+        return fork_run(extractor, directory, archive_path, injected, execution);
+    }
+
+    // The server outlives the changes of directory of the fuzzer
+    char directory_path[PATH_MAX * 2];
+    if (directory != NULL && directory[0] == '/') {
+        snprintf(directory_path, sizeof(directory_path), "%s", directory);
+    } else {
+        snprintf(directory_path, sizeof(directory_path), "%s%s%s", cwd, directory != NULL ? "/" : "",
+                 directory != NULL ? directory : "");
+    }
+    // A new process for this archive, the server is started again for the next one
+    if (persistent_run(extractor, directory_path, archive_path, injected, execution) == -1) {
+        if (++persistent_failures == PERSISTENT_START_ATTEMPTS) {
+            fprintf(stderr, "Persistent mode not available, back to a process per archive\n");
+            persistent_enabled = false;
+        }
+        return fork_run(extractor, directory, archive_path, injected, execution);
+    }
+    persistent_failures = 0;
+
+    // The first archives, then one in PERSISTENT_CHECK_INTERVAL, run again in a new process from the same empty
+    // directory: another outcome means that some state of the extractor survives between the archives
+    if (persistent_enabled && directory != NULL && !stop_signal(execution->signal) &&
+        (persistent_runs <= PERSISTENT_FIRST_CHECKS || persistent_runs % PERSISTENT_CHECK_INTERVAL == 0)) {
+        struct execution forked;
+        if (scratch_clean(directory) == 0 && fork_run(extractor, directory, archive_path, injected, &forked) == 0 &&
+            (forked.crashed != execution->crashed || forked.limit != execution->limit ||
+             forked.status != execution->status)) {
+            fprintf(stderr, "%s gives another outcome in a new process, back to a process per archive\n", archive);
+            persistent_enabled = false;
+            stop_server();
+            *execution = forked;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+#ifndef FUZZER_EXECUTOR_H
+#define FUZZER_EXECUTOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Runs the extractor on one archive, without a shell: fork(), execv(), and wait4() to get what the execution
+ * cost. The extractor runs with resource limits (setrlimit() in the child before execv()), a limit hit is found from
+ * the signal of the limit or from what the execution cost.
+ * The crash message is read from the standard output of the extractor, its errors are copied to stderr
+ * and describe the limit it ran into, if any.
+ */
+
+// Resource limits applied to the extractor, see executor_parse_limit()
+enum executor_limit {
+    LIMIT_NONE,
+    // Address space (RLIMIT_AS), in bytes: hitting it makes allocations fail with ENOMEM, or EFAULT later if unchecked.
+    // Taken as hit when the peak RSS comes near it.
+    LIMIT_AS,
+    // Size of the files created (RLIMIT_FSIZE), in bytes: SIGXFSZ, or EFBIG when the signal is ignored
+    LIMIT_FSIZE,
+    // Number of open files (RLIMIT_NOFILE): EMFILE. Applied, but never reported: nothing is left to count after the
+    // extractor exits, and EMFILE in its messages may come from anything else.
+    LIMIT_NOFILE,
+    // CPU time (RLIMIT_CPU), in seconds: SIGXCPU, then SIGKILL one second later
+    LIMIT_CPU,
+    LIMIT_COUNT
+};
+
+// What an execution of the extractor did and cost
+struct execution {
+    // The extractor printed its crash message
+    bool crashed;
+    // Status returned by wait4()
+    int status;
+    // Elapsed, user and system time, in milliseconds
+    double wall_time;
+    double user_time;
+    double sys_time;
+    // Peak resident set size, in kilobytes
+    long max_rss;
+    long minor_faults;
+    long major_faults;
+    // Bytes passed to write() and similar calls (wchar of /proc/<pid>/io), 0 if unknown
+    uint64_t bytes_written;
+    // Value of the performance counter, when enabled (see executor_enable_counter())
+    uint64_t counter;
+    // Fatal signal: the one that killed the extractor, or the one its crash handler caught (SIGSEGV, or the signal
+    // delivered when the extractor is traced), 0 if none
+    int signal;
+    // The limit the extractor ran into, if any: not a crash, even if it printed the crash message
+    enum executor_limit limit;
+    // The error of the limit in the messages of the extractor, to describe it: 0 if it was a signal, a short write or
+    // the peak RSS alone, or if the errors were injected
+    int limit_error;
+    // The calls of the extractor failed as told by a fault schedule (see faults.h)
+    bool injected;
+    // With syscall tracing (see executor_enable_trace()): number of new entries in the map of the behaviours,
+    // and hash of the sequence of traced calls
+    unsigned int new_behaviours;
+    uint64_t trace_hash;
+};
+
+// The performance counter read around each execution
+enum executor_counter {
+    // Not enabled, or perf_event_open() is not available
+    COUNTER_NONE,
+    // Instructions retired in user space
+    COUNTER_INSTRUCTIONS,
+    // Software fallback when there is no hardware counter (e.g. in a VM): CPU time in nanoseconds
+    COUNTER_TASK_CLOCK
+};
+
+/**
+ * Parses a limit of the form "resource=value" (e.g. "fsize=1048576") and sets it, 0 removes the limit.
+ * The resources are as and fsize (bytes), nofile, and cpu (seconds).
+ * By default: as=1073741824 fsize=67108864 nofile=256 cpu=10, so that no archive can fill the disk or the memory
+ * of the host.
+ * @param arg the string to parse
+ * @return 0 on success, -1 if the resource is unknown or the value invalid
+ */
+int executor_parse_limit(const char* arg);
+
+/**
+ * Describes the limit an execution ran into, e.g. "fsize=67108864 (SIGXFSZ)"
+ * @param execution the execution
+ * @param buf where to write
+ * @param len size of buf
+ */
+void executor_describe_limit(const struct execution* execution, char* buf, size_t len);
+
+/**
+ * Applies the limits to the current process, in a child before execv()
+ */
+void executor_apply_limits(void);
+
+/**
+ * Preloads a library in the extractor (LD_PRELOAD), e.g. the guard-page allocator. Can be called several times.
+ * @param library path of the shared library
+ * @return 0 on success, -1 if the library cannot be found or the list is too long
+ */
+int executor_add_preload(const char* library);
+
+/**
+ * Runs the archives in a persistent server instead of a process per archive: the extractor started once with the
+ * harness preloaded (make libpersistent.so), which calls its main() in a loop and puts its state back in between,
+ * see src/preload/persistent.c. The first archives and one in 64 are checked in a new process. The server is started
+ * again after an archive kills it or when it does not start, with a new process for that archive. The executor goes
+ * back to a process per archive when the harness does not start 3 times in a row, reports a state it cannot put
+ * back, or when a check gives another outcome, and uses one anyway with the counter, the syscall trace and the
+ * triage.
+ * @param library path of the harness
+ * @return 0 on success, -1 if the library cannot be found
+ */
+int executor_enable_persistent(const char* library);
+
+/**
+ * Traces the system calls of every execution, see systrace.h. SIGCHLD is blocked from then on.
+ * @return 0 on success, -1 if tracing is not available
+ */
+int executor_enable_trace(void);
+
+/**
+ * Stops the extractor before the delivery of its fatal signals to write a crash report, see triage.h.
+ * SIGCHLD is blocked from then on.
+ * @return 0 on success, -1 if the extractor cannot be traced
+ */
+int executor_enable_triage(void);
+
+/**
+ * Counts the instructions of every execution with perf_event_open(), or its CPU time in nanoseconds with the
+ * software task clock when the hardware counter is not available.
+ * The counter is opened on the child before execv() and only counts the extractor, its children included.
+ */
+void executor_enable_counter(void);
+
+/**
+ * @return the counter in use, COUNTER_NONE until the first execution
+ */
+enum executor_counter executor_counter(void);
+
+/**
+ * Goes back to a process per archive without the persistent server, the syscall trace, the triage or the counter,
+ * in a process forked from a worker that runs archives apart from the campaign (see confirm.h). The limits and the
+ * preloaded libraries are kept.
+ */
+void executor_plain(void);
+
+/**
+ * Runs the extractor on an archive and waits for it
+ * @param extractor path of the extractor
+ * @param directory where the extractor runs, NULL for the current directory
+ * @param archive path of the archive, relative to the current directory
+ * @param injected whether a fault schedule is set (FAULT_SCHEDULE_VARIABLE): the errors the extractor prints are
+ *                 the injected ones, they never describe a limit
+ * @param execution where to store the outcome
+ * @return 0 if the extractor ran (crashed or not), -1 if it could not be launched
+ */
+int executor_run(const char* extractor, const char* directory, const char* archive, bool injected,
+                 struct execution* execution);
+
+#endif
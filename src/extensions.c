@@ -0,0 +1,535 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "extensions.h"
+#include "numeric.h"
+
+
+// Data of the regular file that follows the extension members
+static const char member_data[] = "extension member data\n";
+
+/*
+ * GNU long names ('L') and long link names ('K')
+ */
+
+static const size_t long_lengths[] = {0, 1, 99, 100, 101, 155, 256, 257, 511, 512, 513, 1023, 1024, 4095};
+#define LONG_LENGTH_COUNT (sizeof(long_lengths) / sizeof(long_lengths[0]))
+
+// How the size field of an extension member lies about its payload
+enum size_mutation {
+    SIZE_EXACT,
+    SIZE_WITHOUT_NUL,
+    SIZE_SHORT,
+    SIZE_LONG,
+    SIZE_ZERO,
+    SIZE_OCTAL_MAX,
+    SIZE_BASE256_MAX,
+    SIZE_NOT_OCTAL,
+    SIZE_MUTATION_COUNT
+};
+
+static const char* size_mutation_names[SIZE_MUTATION_COUNT] = {
+    [SIZE_EXACT] = "exact size",
+    [SIZE_WITHOUT_NUL] = "size without the null character",
+    [SIZE_SHORT] = "size - 1",
+    [SIZE_LONG] = "size + 1",
+    [SIZE_ZERO] = "size 0",
+    [SIZE_OCTAL_MAX] = "size 77777777777",
+    [SIZE_BASE256_MAX] = "size 2^63-1 in base-256",
+    [SIZE_NOT_OCTAL] = "size not octal",
+};
+
+// What comes after the long name
+enum follower {
+    FOLLOW_MEMBER,
+    FOLLOW_NOTHING,
+    FOLLOW_SECOND_LONG,
+    FOLLOWER_COUNT
+};
+
+static const char* follower_names[FOLLOWER_COUNT] = {
+    [FOLLOW_MEMBER] = "then a member",
+    [FOLLOW_NOTHING] = "then the end of the archive",
+    [FOLLOW_SECOND_LONG] = "twice",
+};
+
+#define LONG_CASES (LONG_LENGTH_COUNT * SIZE_MUTATION_COUNT * FOLLOWER_COUNT)
+
+/*
+ * pax extended headers ('x' and 'g')
+ */
+
+static const char* keywords[] = {
+    "path", "linkpath", "size", "uid", "gid", "mtime", "atime", "uname", "gname",
+    "hdrcharset", "comment", "GNU.sparse.map", "SCHILY.xattr.user.fuzz", "", "unknown.keyword",
+};
+#define KEYWORD_COUNT (sizeof(keywords) / sizeof(keywords[0]))
+
+// Values with their length, they may contain null characters. A NULL value is LONG_VALUE_LENGTH 'a'.
+#define LONG_VALUE_LENGTH 1000
+static const struct {
+    const char* bytes;
+    size_t len;
+    const char* description;
+} pax_values[] = {
+    {"file.txt", 8, "file.txt"},
+    {"", 0, "empty"},
+    {"-1", 2, "-1"},
+    {"18446744073709551616", 20, "2^64"},
+    {"1.000000000001", 14, "1.000000000001"},
+    {NULL, LONG_VALUE_LENGTH, "1000 characters"},
+    {"a\0b", 3, "a\\0b"},
+};
+#define PAX_VALUE_COUNT (sizeof(pax_values) / sizeof(pax_values[0]))
+
+// How the record, or the size of the header holding it, lies about its length
+enum record_mutation {
+    RECORD_EXACT,
+    RECORD_SHORT,
+    RECORD_LONG,
+    RECORD_ZERO,
+    RECORD_NO_LENGTH,
+    RECORD_NOT_DIGIT,
+    RECORD_HUGE,
+    RECORD_LEADING_ZEROS,
+    RECORD_NEGATIVE,
+    RECORD_PAST_END,
+    RECORD_NO_NEWLINE,
+    RECORD_NO_EQUALS,
+    HEADER_SIZE_SHORT,
+    HEADER_SIZE_LONG,
+    HEADER_SIZE_ZERO,
+    HEADER_SIZE_HUGE,
+    RECORD_MUTATION_COUNT
+};
+
+static const char* record_mutation_names[RECORD_MUTATION_COUNT] = {
+    [RECORD_EXACT] = "exact record",
+    [RECORD_SHORT] = "record length - 1",
+    [RECORD_LONG] = "record length + 1",
+    [RECORD_ZERO] = "record length 0",
+    [RECORD_NO_LENGTH] = "record without length",
+    [RECORD_NOT_DIGIT] = "record length not a number",
+    [RECORD_HUGE] = "record length 10^20-1",
+    [RECORD_LEADING_ZEROS] = "record length with leading zeros",
+    [RECORD_NEGATIVE] = "negative record length",
+    [RECORD_PAST_END] = "record length past the end of the header",
+    [RECORD_NO_NEWLINE] = "record without new line",
+    [RECORD_NO_EQUALS] = "record without '='",
+    [HEADER_SIZE_SHORT] = "header size - 1",
+    [HEADER_SIZE_LONG] = "header size + 1",
+    [HEADER_SIZE_ZERO] = "header size 0",
+    [HEADER_SIZE_HUGE] = "header size 77777777777",
+};
+
+#define PAX_CASES (KEYWORD_COUNT * PAX_VALUE_COUNT * RECORD_MUTATION_COUNT)
+
+/*
+ * Old GNU sparse files ('S')
+ */
+
+// Where the sparse fields are in the GNU header, relative to the prefix field (offset 345)
+#define SPARSE_MAP_OFFSET (386 - 345)
+#define SPARSE_IS_EXTENDED_OFFSET (482 - 345)
+#define SPARSE_REAL_SIZE_OFFSET (483 - 345)
+#define SPARSE_HEADER_ENTRIES 4
+#define SPARSE_BLOCK_ENTRIES 21
+#define SPARSE_MAX_ENTRIES (SPARSE_HEADER_ENTRIES + EXTENSION_SPARSE_BLOCKS * SPARSE_BLOCK_ENTRIES)
+
+// Data actually stored for a sparse member, whatever the map says
+#define SPARSE_MAX_DATA 1024
+
+struct sparse_entry {
+    uint64_t offset;
+    uint64_t numbytes;
+};
+
+static const struct {
+    const char* description;
+    int count;
+    struct sparse_entry entries[6];
+} sparse_maps[] = {
+    {"empty map", 0, {{0, 0}}},
+    {"one full block", 1, {{0, 512}}},
+    {"two bytes far apart", 2, {{0, 1}, {1024, 1}}},
+    {"decreasing offsets", 2, {{512, 512}, {0, 512}}},
+    {"overlapping entries", 2, {{0, 512}, {256, 512}}},
+    {"huge offset", 1, {{077777777777ULL, 1}}},
+    {"huge numbytes", 1, {{0, 077777777777ULL}}},
+    {"offset + numbytes overflowing", 1, {{077777777770ULL, 1000}}},
+    {"zero-length entry", 1, {{0, 0}}},
+    {"four entries", 4, {{0, 10}, {512, 10}, {1024, 10}, {1536, 10}}},
+    {"six entries", 6, {{0, 10}, {512, 10}, {1024, 10}, {1536, 10}, {2048, 10}, {2560, 10}}},
+    {"25 entries", -1, {{0, 0}}},
+};
+#define SPARSE_MAP_COUNT (sizeof(sparse_maps) / sizeof(sparse_maps[0]))
+
+enum real_size {
+    REAL_SIZE_EXACT,
+    REAL_SIZE_ZERO,
+    REAL_SIZE_SHORT,
+    REAL_SIZE_HUGE,
+    REAL_SIZE_COUNT
+};
+
+static const char* real_size_names[REAL_SIZE_COUNT] = {
+    [REAL_SIZE_EXACT] = "exact real size",
+    [REAL_SIZE_ZERO] = "real size 0",
+    [REAL_SIZE_SHORT] = "real size - 1",
+    [REAL_SIZE_HUGE] = "real size 77777777777",
+};
+
+enum extended {
+    EXTENDED_CORRECT,
+    EXTENDED_MISSING,
+    EXTENDED_ENDLESS,
+    EXTENDED_COUNT
+};
+
+static const char* extended_names[EXTENDED_COUNT] = {
+    [EXTENDED_CORRECT] = "correct extension flags",
+    [EXTENDED_MISSING] = "extension block missing",
+    [EXTENDED_ENDLESS] = "every block extended",
+};
+
+#define SPARSE_CASES (SPARSE_MAP_COUNT * REAL_SIZE_COUNT * EXTENDED_COUNT)
+
+
+unsigned int extension_case_count(void) {
+    return 2 * LONG_CASES + 2 * PAX_CASES + SPARSE_CASES;
+}
+
+
+/**
+ * Fills a header of the suite with a correct checksum
+ */
+static void fill_header(struct tar_t* header, const char* name, char typeflag, size_t size, const char* linkname) {
+    char type[2] = {typeflag, '\0'};
+    char size_field[12];
+    snprintf(size_field, sizeof(size_field), "%011o", (unsigned int) size);
+    generate_tar_header(header, name, "0000664", "0001750", "0001750", size_field, "14413537165", type,
+                        linkname, "ustar", "00", "michal", "michal");
+    calculate_checksum(header);
+}
+
+
+/**
+ * Replaces the size field of a header according to a mutation, the checksum is updated
+ * @param size the size of the payload, null character included
+ */
+static void mutate_size(struct tar_t* header, size_t size, enum size_mutation mutation) {
+    struct numeric_value value = {false, size};
+
+    switch (mutation) {
+        case SIZE_EXACT:
+            break;
+        case SIZE_WITHOUT_NUL:
+            value.magnitude = size - 1;
+            break;
+        case SIZE_SHORT:
+            value.magnitude = size > 1 ? size - 2 : 0;
+            break;
+        case SIZE_LONG:
+            value.magnitude = size + 1;
+            break;
+        case SIZE_ZERO:
+            value.magnitude = 0;
+            break;
+        case SIZE_OCTAL_MAX:
+            value.magnitude = 077777777777ULL;
+            break;
+        case SIZE_BASE256_MAX:
+            value.magnitude = INT64_MAX;
+            numeric_encode(header->size, sizeof(header->size), value, BASE256);
+            calculate_checksum(header);
+            return;
+        case SIZE_NOT_OCTAL:
+            memcpy(header->size, "0000000009z", sizeof(header->size));
+            calculate_checksum(header);
+            return;
+        default:
+            break;
+    }
+    numeric_encode(header->size, sizeof(header->size), value, OCTAL_NUL);
+    calculate_checksum(header);
+}
+
+
+static void build_long(struct extension_case* ext, char typeflag, unsigned int index) {
+    size_t length = long_lengths[index / (SIZE_MUTATION_COUNT * FOLLOWER_COUNT)];
+    enum size_mutation mutation = (index / FOLLOWER_COUNT) % SIZE_MUTATION_COUNT;
+    enum follower follower = index % FOLLOWER_COUNT;
+
+    // "dir/dir/.../dir/x": long names need directories, the last character is never a separator
+    for (size_t i = 0; i < length; i++) {
+        ext->payload[i] = "dir/"[i % 4];
+    }
+    if (length > 0) {
+        ext->payload[length - 1] = 'x';
+    }
+    ext->payload[length] = '\0';
+
+    int count = follower == FOLLOW_SECOND_LONG ? 2 : 1;
+    for (int i = 0; i < count; i++) {
+        fill_header(&ext->headers[i], "././@LongLink", typeflag, length + 1, "");
+        mutate_size(&ext->headers[i], length + 1, mutation);
+        archive_add_member(&ext->archive, &ext->headers[i], ext->payload, length + 1, true);
+    }
+
+    if (follower != FOLLOW_NOTHING) {
+        // The member the long name applies to: a file for 'L', a symbolic link for 'K'
+        struct tar_t* member = &ext->headers[count];
+        if (typeflag == 'L') {
+            fill_header(member, "file.txt", '0', sizeof(member_data) - 1, "");
+            archive_add_member(&ext->archive, member, member_data, sizeof(member_data) - 1, true);
+        } else {
+            fill_header(member, "link", '2', 0, "file.txt");
+            archive_add_member(&ext->archive, member, NULL, 0, true);
+        }
+    }
+}
+
+
+/**
+ * @return the number of decimal digits of a value
+ */
+static size_t decimal_digits(size_t value) {
+    size_t digits = 1;
+    while (value >= 10) {
+        value /= 10;
+        digits++;
+    }
+    return digits;
+}
+
+
+/**
+ * Writes a pax record "<length> <keyword>=<value>\n" in the payload, mutated
+ * @return the length of the record
+ */
+static size_t write_record(char* buf, const char* keyword, const char* value, size_t value_len,
+                           enum record_mutation mutation) {
+    // " keyword=value\n" and the length, which counts its own digits
+    size_t body = 1 + strlen(keyword) + 1 + value_len + 1;
+    size_t length = body + decimal_digits(body);
+    if (decimal_digits(length) != decimal_digits(body)) {
+        length++;
+    }
+
+    char prefix[32];
+    switch (mutation) {
+        case RECORD_SHORT:
+            snprintf(prefix, sizeof(prefix), "%zu", length - 1);
+            break;
+        case RECORD_LONG:
+            snprintf(prefix, sizeof(prefix), "%zu", length + 1);
+            break;
+        case RECORD_ZERO:
+            snprintf(prefix, sizeof(prefix), "0");
+            break;
+        case RECORD_NO_LENGTH:
+            prefix[0] = '\0';
+            break;
+        case RECORD_NOT_DIGIT:
+            snprintf(prefix, sizeof(prefix), "x");
+            break;
+        case RECORD_HUGE:
+            snprintf(prefix, sizeof(prefix), "99999999999999999999");
+            break;
+        case RECORD_LEADING_ZEROS:
+            snprintf(prefix, sizeof(prefix), "000%zu", length + 3);
+            break;
+        case RECORD_NEGATIVE:
+            snprintf(prefix, sizeof(prefix), "-%zu", length);
+            break;
+        case RECORD_PAST_END:
+            snprintf(prefix, sizeof(prefix), "%zu", length + 1000);
+            break;
+        default:
+            snprintf(prefix, sizeof(prefix), "%zu", length);
+            break;
+    }
+
+    size_t used = 0;
+    if (mutation == RECORD_NO_LENGTH) {
+        used += sprintf(buf, "%s", keyword);
+    } else {
+        used += sprintf(buf, "%s %s", prefix, keyword);
+    }
+    buf[used++] = mutation == RECORD_NO_EQUALS ? ' ' : '=';
+    if (value != NULL) {
+        memcpy(buf + used, value, value_len);
+    } else {
+        memset(buf + used, 'a', value_len);
+    }
+    used += value_len;
+    buf[used++] = mutation == RECORD_NO_NEWLINE ? 'X' : '\n';
+    return used;
+}
+
+
+static void build_pax(struct extension_case* ext, char typeflag, unsigned int index) {
+    const char* keyword = keywords[index / (PAX_VALUE_COUNT * RECORD_MUTATION_COUNT)];
+    unsigned int value = (index / RECORD_MUTATION_COUNT) % PAX_VALUE_COUNT;
+    enum record_mutation mutation = index % RECORD_MUTATION_COUNT;
+
+    size_t length = write_record(ext->payload, keyword, pax_values[value].bytes, pax_values[value].len, mutation);
+
+    struct tar_t* header = &ext->headers[0];
+    fill_header(header, typeflag == 'g' ? "pax_global_header" : "PaxHeaders/file.txt", typeflag, length, "");
+    switch (mutation) {
+        case HEADER_SIZE_SHORT:
+            mutate_size(header, length + 1, SIZE_SHORT);
+            break;
+        case HEADER_SIZE_LONG:
+            mutate_size(header, length, SIZE_LONG);
+            break;
+        case HEADER_SIZE_ZERO:
+            mutate_size(header, length, SIZE_ZERO);
+            break;
+        case HEADER_SIZE_HUGE:
+            mutate_size(header, length, SIZE_OCTAL_MAX);
+            break;
+        default:
+            break;
+    }
+    archive_add_member(&ext->archive, header, ext->payload, length, true);
+
+    // The member the records apply to
+    fill_header(&ext->headers[1], "file.txt", '0', sizeof(member_data) - 1, "");
+    archive_add_member(&ext->archive, &ext->headers[1], member_data, sizeof(member_data) - 1, true);
+}
+
+
+/**
+ * Writes a 12-byte octal number of the sparse map
+ */
+static void write_sparse_number(unsigned char* field, uint64_t value) {
+    struct numeric_value number = {false, value};
+    numeric_encode((char*) field, 12, number, OCTAL_NUL);
+}
+
+
+static void build_sparse(struct extension_case* ext, unsigned int index) {
+    unsigned int map = index / (REAL_SIZE_COUNT * EXTENDED_COUNT);
+    enum real_size real_size = (index / EXTENDED_COUNT) % REAL_SIZE_COUNT;
+    enum extended extended = index % EXTENDED_COUNT;
+
+    struct sparse_entry entries[SPARSE_MAX_ENTRIES];
+    int count = sparse_maps[map].count;
+    if (count == -1) {
+        // A full header and a full extension block
+        count = SPARSE_HEADER_ENTRIES + SPARSE_BLOCK_ENTRIES;
+        for (int i = 0; i < count; i++) {
+            entries[i].offset = (uint64_t) i * TAR_BLOCK_SIZE;
+            entries[i].numbytes = 1;
+        }
+    } else {
+        memcpy(entries, sparse_maps[map].entries, sizeof(entries[0]) * count);
+    }
+
+    // The stored data is the sum of the entries, bounded
+    uint64_t stored = 0;
+    uint64_t end = 0;
+    for (int i = 0; i < count; i++) {
+        stored += entries[i].numbytes;
+        if (entries[i].offset + entries[i].numbytes > end) {
+            end = entries[i].offset + entries[i].numbytes;
+        }
+    }
+    size_t data_len = stored < SPARSE_MAX_DATA ? stored : SPARSE_MAX_DATA;
+
+    struct tar_t* header = &ext->headers[0];
+    fill_header(header, "sparse.txt", 'S', data_len, "");
+    unsigned char* gnu = (unsigned char*) header->prefix;
+    memset(gnu, 0, sizeof(header->prefix));
+
+    int blocks = count > SPARSE_HEADER_ENTRIES ? 1 + (count - SPARSE_HEADER_ENTRIES - 1) / SPARSE_BLOCK_ENTRIES : 0;
+    memset(ext->sparse, 0, sizeof(ext->sparse));
+    for (int i = 0; i < count; i++) {
+        unsigned char* entry;
+        if (i < SPARSE_HEADER_ENTRIES) {
+            entry = gnu + SPARSE_MAP_OFFSET + i * 24;
+        } else {
+            int block = (i - SPARSE_HEADER_ENTRIES) / SPARSE_BLOCK_ENTRIES;
+            entry = ext->sparse[block] + ((i - SPARSE_HEADER_ENTRIES) % SPARSE_BLOCK_ENTRIES) * 24;
+        }
+        write_sparse_number(entry, entries[i].offset);
+        write_sparse_number(entry + 12, entries[i].numbytes);
+    }
+
+    // The header and each block say if another extension block follows
+    gnu[SPARSE_IS_EXTENDED_OFFSET] = blocks > 0 || extended != EXTENDED_CORRECT;
+    for (int i = 0; i < blocks; i++) {
+        ext->sparse[i][504] = i + 1 < blocks || extended == EXTENDED_ENDLESS;
+    }
+    if (extended == EXTENDED_MISSING) {
+        blocks = 0;
+    }
+
+    uint64_t real = end;
+    if (real_size == REAL_SIZE_ZERO) {
+        real = 0;
+    } else if (real_size == REAL_SIZE_SHORT) {
+        real = end > 0 ? end - 1 : 0;
+    } else if (real_size == REAL_SIZE_HUGE) {
+        real = 077777777777ULL;
+    }
+    write_sparse_number(gnu + SPARSE_REAL_SIZE_OFFSET, real);
+    calculate_checksum(header);
+
+    archive_add_raw(&ext->archive, header, sizeof(struct tar_t));
+    for (int i = 0; i < blocks; i++) {
+        archive_add_raw(&ext->archive, ext->sparse[i], TAR_BLOCK_SIZE);
+    }
+    memset(ext->payload, 's', data_len);
+    archive_add_raw(&ext->archive, ext->payload, data_len);
+    if (data_len % TAR_BLOCK_SIZE) {
+        archive_add_zeros(&ext->archive, TAR_BLOCK_SIZE - data_len % TAR_BLOCK_SIZE);
+    }
+}
+
+
+void extension_build_case(unsigned int index, struct extension_case* ext) {
+    archive_init(&ext->archive);
+
+    if (index < LONG_CASES) {
+        build_long(ext, 'L', index);
+    } else if ((index -= LONG_CASES) < LONG_CASES) {
+        build_long(ext, 'K', index);
+    } else if ((index -= LONG_CASES) < PAX_CASES) {
+        build_pax(ext, 'x', index);
+    } else if ((index -= PAX_CASES) < PAX_CASES) {
+        build_pax(ext, 'g', index);
+    } else {
+        build_sparse(ext, index - PAX_CASES);
+    }
+    archive_end(&ext->archive, 2);
+}
+
+
+void extension_describe_case(unsigned int index, char* buf, size_t len) {
+    if (index < 2 * LONG_CASES) {
+        char typeflag = index < LONG_CASES ? 'L' : 'K';
+        index %= LONG_CASES;
+        snprintf(buf, len, "GNU %c of %zu characters, %s, %s", typeflag,
+                 long_lengths[index / (SIZE_MUTATION_COUNT * FOLLOWER_COUNT)],
+                 size_mutation_names[(index / FOLLOWER_COUNT) % SIZE_MUTATION_COUNT],
+                 follower_names[index % FOLLOWER_COUNT]);
+    } else if ((index -= 2 * LONG_CASES) < 2 * PAX_CASES) {
+        char typeflag = index < PAX_CASES ? 'x' : 'g';
+        index %= PAX_CASES;
+        snprintf(buf, len, "pax %c %s=%s, %s", typeflag,
+                 keywords[index / (PAX_VALUE_COUNT * RECORD_MUTATION_COUNT)],
+                 pax_values[(index / RECORD_MUTATION_COUNT) % PAX_VALUE_COUNT].description,
+                 record_mutation_names[index % RECORD_MUTATION_COUNT]);
+    } else {
+        index -= 2 * PAX_CASES;
+        snprintf(buf, len, "GNU sparse with %s, %s, %s",
+                 sparse_maps[index / (REAL_SIZE_COUNT * EXTENDED_COUNT)].description,
+                 real_size_names[(index / EXTENDED_COUNT) % REAL_SIZE_COUNT],
+                 extended_names[index % EXTENDED_COUNT]);
+    }
+}
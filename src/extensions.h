@@ -0,0 +1,52 @@
+#ifndef FUZZER_EXTENSIONS_H
+#define FUZZER_EXTENSIONS_H
+
+#include <stddef.h>
+
+#include "tar.h"
+#include "archive.h"
+
+/*
+ * Generators for the members that struct tar_t does not model: GNU long names and long link names
+ * (typeflags 'L' and 'K'), pax extended headers (local 'x' and global 'g') and old GNU sparse files ('S').
+ * They are all length-prefixed, a test case mutates one length: the size field of the extension member,
+ * the length of a pax record, the offsets and sizes of the sparse map, the extension blocks that follow.
+ * Every length stays under a few kilobytes, except the declared ones, so each archive is cheap to extract.
+ * The magic is always "ustar\0": the extractor rejects the GNU magic before looking at the typeflag.
+ */
+
+// Largest payload of an extension member (a long name, the pax records)
+#define EXTENSION_PAYLOAD_MAX 4608
+
+// Extension blocks of a sparse member
+#define EXTENSION_SPARSE_BLOCKS 2
+
+// An archive of the suite, the buffers have to live as long as the archive that points at them
+struct extension_case {
+    struct tar_t headers[4];
+    char payload[EXTENSION_PAYLOAD_MAX];
+    unsigned char sparse[EXTENSION_SPARSE_BLOCKS][TAR_BLOCK_SIZE];
+    struct archive archive;
+};
+
+/**
+ * @return the number of test cases of the generators
+ */
+unsigned int extension_case_count(void);
+
+/**
+ * Builds the archive of a test case
+ * @param index the test case, from 0 to extension_case_count() - 1
+ * @param ext where to build the archive
+ */
+void extension_build_case(unsigned int index, struct extension_case* ext);
+
+/**
+ * Writes a short description of a test case (e.g. "pax x path=\"\", record length - 1")
+ * @param index the test case
+ * @param buf where to write the description
+ * @param len size of buf
+ */
+void extension_describe_case(unsigned int index, char* buf, size_t len);
+
+#endif
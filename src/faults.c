@@ -0,0 +1,366 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include "faults.h"
+#include "fsgraph.h"
+#include "campaign.h"
+
+
+// The functions wrapped by the injector, with the errnos their callers are most likely to mishandle
+static const struct {
+    const char* name;
+    int errors[FAULT_MAX_ERRORS];
+} functions[FAULT_FUNCTION_COUNT] = {
+    {"open", {ENOENT, EACCES, EMFILE}},
+    {"read", {EIO, EINTR, 0}},
+    {"write", {ENOSPC, EIO, EINTR}},
+    {"mmap", {ENOMEM, 0, 0}},
+    {"malloc", {ENOMEM, 0, 0}},
+    {"calloc", {ENOMEM, 0, 0}},
+    {"mkdir", {EEXIST, EACCES, ENOSPC}},
+    {"symlink", {EEXIST, EACCES, ENOSPC}},
+    {"link", {EEXIST, EPERM, EXDEV}},
+    {"mknod", {EPERM, EEXIST, 0}},
+    {"mkfifo", {EEXIST, EACCES, 0}},
+    {"lstat", {ENOENT, EACCES, ELOOP}},
+};
+
+static const char* library = NULL;
+
+// Calls of each function per hand-written graph, and which graphs were counted
+static unsigned long (*known_counts)[FAULT_FUNCTION_COUNT] = NULL;
+static bool* counted = NULL;
+
+// A fault of a schedule with several faults
+struct fault {
+    unsigned int function;
+    unsigned int call;
+    int error;
+};
+
+
+/**
+ * Allocates the counts of the graphs, on first use
+ * @return 0 on success, -1 on error
+ */
+static int allocate_counts(void) {
+    if (known_counts != NULL) {
+        return 0;
+    }
+    known_counts = calloc(fsgraph_shape_count(), sizeof(*known_counts));
+    counted = calloc(fsgraph_shape_count(), sizeof(*counted));
+    if (known_counts == NULL || counted == NULL) {
+        perror("calloc");
+        free(known_counts);
+        free(counted);
+        known_counts = NULL;
+        counted = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * Writes the counts to FAULT_COUNTS_FILE, replacing it atomically
+ */
+static void save_counts(FILE* checkpoint) {
+    unsigned int shapes = 0;
+    FILE* file = fopen(FAULT_COUNTS_FILE ".tmp", "w");
+    if (file == NULL) {
+        perror(FAULT_COUNTS_FILE ".tmp");
+    } else {
+        for (unsigned int shape = 0; known_counts != NULL && shape < fsgraph_shape_count(); shape++) {
+            if (!counted[shape]) {
+                continue;
+            }
+            fprintf(file, "%u", shape);
+            for (unsigned int f = 0; f < FAULT_FUNCTION_COUNT; f++) {
+                fprintf(file, "\t%lu", known_counts[shape][f]);
+            }
+            fputc('\n', file);
+            shapes++;
+        }
+        if (fflush(file) == EOF || fsync(fileno(file)) == -1) {
+            perror(FAULT_COUNTS_FILE ".tmp");
+        }
+        fclose(file);
+        if (rename(FAULT_COUNTS_FILE ".tmp", FAULT_COUNTS_FILE) == -1) {
+            perror(FAULT_COUNTS_FILE);
+        }
+    }
+    fprintf(checkpoint, "%s %u", FAULT_COUNTS_FILE, shapes);
+}
+
+
+static int load_counts(__attribute__((unused)) const char* value) {
+    FILE* file = fopen(FAULT_COUNTS_FILE, "r");
+    if (file == NULL) {
+        perror(FAULT_COUNTS_FILE);
+        return -1;
+    }
+    if (allocate_counts() == -1) {
+        fclose(file);
+        return -1;
+    }
+    char line[512];
+    int rv = 0;
+    while (rv == 0 && fgets(line, sizeof(line), file) != NULL) {
+        char* cursor = line;
+        char* end;
+        unsigned long shape = strtoul(cursor, &end, 10);
+        if (end == cursor || shape >= fsgraph_shape_count()) {
+            rv = -1;
+            break;
+        }
+        for (unsigned int f = 0; rv == 0 && f < FAULT_FUNCTION_COUNT; f++) {
+            cursor = end;
+            known_counts[shape][f] = strtoul(cursor, &end, 10);
+            rv = end == cursor ? -1 : 0;
+        }
+        counted[shape] = rv == 0;
+    }
+    fclose(file);
+    return rv;
+}
+
+
+void fault_enable(const char* path) {
+    library = path;
+    campaign_add_checkpoint_hook("fault-counts", save_counts, load_counts);
+}
+
+
+const char* fault_library(void) {
+    return library;
+}
+
+
+unsigned int fault_case_count(void) {
+    return fault_mutation_start() + FAULT_MUTATION_CASES;
+}
+
+
+unsigned int fault_mutation_start(void) {
+    return fsgraph_shape_count() * FAULT_FUNCTION_COUNT * FAULT_MAX_CALLS * FAULT_MAX_ERRORS;
+}
+
+
+int fault_known_counts(unsigned int shape, unsigned long counts[FAULT_FUNCTION_COUNT]) {
+    if (known_counts == NULL || shape >= fsgraph_shape_count() || !counted[shape]) {
+        return -1;
+    }
+    memcpy(counts, known_counts[shape], sizeof(known_counts[shape]));
+    return 0;
+}
+
+
+void fault_keep_counts(unsigned int shape, const unsigned long counts[FAULT_FUNCTION_COUNT]) {
+    if (shape >= fsgraph_shape_count() || allocate_counts() == -1) {
+        return;
+    }
+    memcpy(known_counts[shape], counts, sizeof(known_counts[shape]));
+    counted[shape] = true;
+}
+
+
+/**
+ * @return the number of errnos of a function
+ */
+static unsigned int error_count(unsigned int function) {
+    unsigned int n = 0;
+    while (n < FAULT_MAX_ERRORS && functions[function].errors[n] != 0) {
+        n++;
+    }
+    return n;
+}
+
+
+/**
+ * @return the calls of a function a fault can target
+ */
+static unsigned int call_count(const unsigned long counts[FAULT_FUNCTION_COUNT], unsigned int function) {
+    return counts[function] < FAULT_MAX_CALLS ? (unsigned int) counts[function] : FAULT_MAX_CALLS;
+}
+
+
+/**
+ * Adds a fault on a counted call, unless that call already fails
+ * @return true if it was added
+ */
+static bool add_fault(struct prng* prng, const unsigned long counts[FAULT_FUNCTION_COUNT], unsigned int total,
+                      struct fault* faults, unsigned int* fault_count) {
+    // A call picked among all of them: the frequent functions get more faults
+    unsigned int pick = (unsigned int) prng_below(prng, total);
+    unsigned int function = 0;
+    while (pick >= call_count(counts, function)) {
+        pick -= call_count(counts, function);
+        function++;
+    }
+    for (unsigned int i = 0; i < *fault_count; i++) {
+        if (faults[i].function == function && faults[i].call == pick + 1) {
+            return false;
+        }
+    }
+    faults[*fault_count].function = function;
+    faults[*fault_count].call = pick + 1;
+    faults[*fault_count].error = functions[function].errors[prng_below(prng, error_count(function))];
+    (*fault_count)++;
+    return true;
+}
+
+
+int fault_mutate_schedule(unsigned int index, struct prng* prng, unsigned int* shape, char* buf, size_t len) {
+    *shape = (index - fault_mutation_start()) % fsgraph_shape_count();
+    unsigned long counts[FAULT_FUNCTION_COUNT];
+    if (fault_known_counts(*shape, counts) == -1) {
+        return -1;
+    }
+    unsigned int total = 0;
+    for (unsigned int f = 0; f < FAULT_FUNCTION_COUNT; f++) {
+        total += call_count(counts, f);
+    }
+    if (total < 2) {
+        return -1;
+    }
+
+    struct fault faults[FAULT_MAX_SCHEDULE];
+    unsigned int fault_count = 0;
+    add_fault(prng, counts, total, faults, &fault_count);
+    unsigned int mutations = 1 + (unsigned int) prng_below(prng, 3);
+    for (unsigned int m = 0; m < mutations || fault_count < 2; m++) {
+        unsigned int which = (unsigned int) prng_below(prng, fault_count);
+        switch (prng_below(prng, 3)) {
+            case 0:
+                if (fault_count < FAULT_MAX_SCHEDULE) {
+                    add_fault(prng, counts, total, faults, &fault_count);
+                }
+                break;
+            case 1:
+                if (fault_count > 1) {
+                    faults[which] = faults[--fault_count];
+                }
+                break;
+            default: {
+                // A few calls earlier or later: the same error path, another state of the extractor
+                int call = (int) faults[which].call + (int) prng_below(prng, 7) - 3;
+                int last = (int) call_count(counts, faults[which].function);
+                faults[which].call = call < 1 ? 1 : call > last ? (unsigned int) last : (unsigned int) call;
+                break;
+            }
+        }
+    }
+
+    size_t used = 0;
+    buf[0] = '\0';
+    for (unsigned int i = 0; i < fault_count && used < len; i++) {
+        used += snprintf(buf + used, len - used, "%s%s:%u:%d", i > 0 ? "," : "", functions[faults[i].function].name,
+                         faults[i].call, faults[i].error);
+    }
+    return used < len ? 0 : -1;
+}
+
+
+void fault_decode(unsigned int index, unsigned int* shape, unsigned int* function, unsigned int* call, int* error) {
+    *error = functions[(index / (FAULT_MAX_ERRORS * FAULT_MAX_CALLS)) % FAULT_FUNCTION_COUNT]
+             .errors[index % FAULT_MAX_ERRORS];
+    index /= FAULT_MAX_ERRORS;
+    *call = index % FAULT_MAX_CALLS + 1;
+    index /= FAULT_MAX_CALLS;
+    *function = index % FAULT_FUNCTION_COUNT;
+    *shape = index / FAULT_FUNCTION_COUNT;
+}
+
+
+unsigned int fault_encode(unsigned int shape, unsigned int function, unsigned int call, unsigned int error) {
+    return ((shape * FAULT_FUNCTION_COUNT + function) * FAULT_MAX_CALLS + call - 1) * FAULT_MAX_ERRORS + error;
+}
+
+
+void fault_schedule(unsigned int index, char* buf, size_t len) {
+    unsigned int shape, function, call;
+    int error;
+    fault_decode(index, &shape, &function, &call, &error);
+    snprintf(buf, len, "%s:%u:%d", functions[function].name, call, error);
+}
+
+
+void fault_describe(unsigned int index, char* buf, size_t len) {
+    unsigned int shape, function, call;
+    int error;
+    fault_decode(index, &shape, &function, &call, &error);
+    char graph[64];
+    fsgraph_describe_case(shape, graph, sizeof(graph));
+    const char* error_name = strerrorname_np(error);
+    snprintf(buf, len, "call %u of %s() fails with %s, %s", call, functions[function].name,
+             error_name != NULL ? error_name : "?", graph);
+}
+
+
+/**
+ * Builds the path of the schedule of an archive, its name without ".tar"
+ */
+static void schedule_path(const char* archive, char* path, size_t len) {
+    size_t name_len = strlen(archive);
+    if (name_len >= 4 && strcmp(archive + name_len - 4, ".tar") == 0) {
+        name_len -= 4;
+    }
+    snprintf(path, len, "%.*s%s", (int) name_len, archive, FAULT_SCHEDULE_EXTENSION);
+}
+
+
+int fault_save_schedule(const char* archive, const char* schedule) {
+    char path[PATH_MAX];
+    schedule_path(archive, path, sizeof(path));
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+    fprintf(file, "%s\n", schedule);
+    if (fclose(file) == EOF) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+
+int fault_load_schedule(const char* archive, char* buf, size_t len) {
+    char path[PATH_MAX];
+    schedule_path(archive, path, sizeof(path));
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+    int rv = fgets(buf, len, file) != NULL ? 0 : -1;
+    fclose(file);
+    buf[strcspn(buf, "\n")] = '\0';
+    return rv == 0 && buf[0] != '\0' ? 0 : -1;
+}
+
+
+int fault_read_counts(const char* path, unsigned long counts[FAULT_FUNCTION_COUNT]) {
+    memset(counts, 0, FAULT_FUNCTION_COUNT * sizeof(counts[0]));
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+    char name[32];
+    unsigned long count;
+    while (fscanf(file, "%31s %lu", name, &count) == 2) {
+        for (unsigned int f = 0; f < FAULT_FUNCTION_COUNT; f++) {
+            if (strcmp(name, functions[f].name) == 0) {
+                counts[f] = count;
+            }
+        }
+    }
+    fclose(file);
+    return 0;
+}
@@ -0,0 +1,156 @@
+#ifndef FUZZER_FAULTS_H
+#define FUZZER_FAULTS_H
+
+#include <stddef.h>
+
+#include "prng.h"
+
+/*
+ * Fault schedules of the fault injection suite: the error paths of the extractor only run when a call fails.
+ * The injector (src/preload/faultinject.c, preloaded in the extractor) fails the N-th call of a function with an
+ * errno, as told by the FAULTINJECT variable, and writes how many times each function was called to the file
+ * named by FAULTINJECT_COUNTS.
+ *
+ * The suite starts from the hand-written archives of the filesystem graphs: each one is extracted once to count the
+ * calls, then every call up to FAULT_MAX_CALLS of every function fails in turn, with each errno of the function.
+ * The schedule is part of the test case: index = ((shape * FAULT_FUNCTION_COUNT + function) * FAULT_MAX_CALLS
+ * + call - 1) * FAULT_MAX_ERRORS + error, so a test case is replayed from its index alone.
+ * The FAULT_MUTATION_CASES test cases after them fail several calls at once: a fault drawn among the counted calls,
+ * mutated by adding, dropping or moving faults (see fault_mutate_schedule()), from the index and the counts alone.
+ *
+ * The counts of each graph are taken once per worker and saved with the checkpoints in FAULT_COUNTS_FILE, so that
+ * neither a slice of the scheduler nor --resume counts them again.
+ */
+
+// Variables read by the injector
+#define FAULT_SCHEDULE_VARIABLE "FAULTINJECT"
+#define FAULT_COUNTS_VARIABLE "FAULTINJECT_COUNTS"
+
+// Functions that can fail, calls enumerated for each of them, and errnos for each of them
+#define FAULT_FUNCTION_COUNT 12
+#define FAULT_MAX_CALLS 64
+#define FAULT_MAX_ERRORS 3
+
+// Schedules with several faults, after the single ones, and their number of faults at most
+#define FAULT_MUTATION_CASES 4096
+#define FAULT_MAX_SCHEDULE 4
+
+// Length of the schedule of a test case, e.g. "symlink:12:17,malloc:3:12"
+#define FAULT_SCHEDULE_SIZE 80
+
+// Calls counted for each graph, in the working directory
+#define FAULT_COUNTS_FILE "fault_counts.tsv"
+
+// Kept next to an archive that only crashes with its schedule: "<name>.fault" for "<name>.tar"
+#define FAULT_SCHEDULE_EXTENSION ".fault"
+
+/**
+ * Enables the fault injection suite, its counts are saved in the checkpoint.
+ * Has to be called before campaign_open().
+ * @param library path of the injector (libfaultinject.so), preloaded in the extractor
+ */
+void fault_enable(const char* library);
+
+/**
+ * @return the path of the injector, NULL if the suite is not enabled
+ */
+const char* fault_library(void);
+
+/**
+ * @return the number of test cases of the suite, most of the single faults are skipped (calls that do not happen)
+ */
+unsigned int fault_case_count(void);
+
+/**
+ * @return the index of the first test case with several faults
+ */
+unsigned int fault_mutation_start(void);
+
+/**
+ * Looks up the calls of a hand-written graph, counted before by this worker or before a resume
+ * @param shape the graph
+ * @param counts where to store the number of calls of each function
+ * @return 0 if they are known, -1 if the graph has to be counted
+ */
+int fault_known_counts(unsigned int shape, unsigned long counts[FAULT_FUNCTION_COUNT]);
+
+/**
+ * Keeps the calls counted for a hand-written graph
+ * @param shape the graph
+ * @param counts the number of calls of each function
+ */
+void fault_keep_counts(unsigned int shape, const unsigned long counts[FAULT_FUNCTION_COUNT]);
+
+/**
+ * Builds the schedule of a test case with several faults: one fault on a call counted for its graph, then 1 to 3
+ * mutations, each one adding a fault, dropping one or moving one to a call nearby, and at least 2 faults
+ * @param index the test case, from fault_mutation_start()
+ * @param prng generator seeded for the test case
+ * @param shape where to store the hand-written graph it extracts
+ * @param buf where to write the schedule
+ * @param len size of buf
+ * @return 0 on success, -1 if the calls of the graph are not known or too few to fail
+ */
+int fault_mutate_schedule(unsigned int index, struct prng* prng, unsigned int* shape, char* buf, size_t len);
+
+/**
+ * Decodes a test case
+ * @param index the test case
+ * @param shape where to store the hand-written graph it extracts (see fsgraph_build_case())
+ * @param function where to store the function that fails
+ * @param call where to store which call fails, from 1
+ * @param error where to store the errno, 0 if the function has fewer errnos than FAULT_MAX_ERRORS
+ */
+void fault_decode(unsigned int index, unsigned int* shape, unsigned int* function, unsigned int* call, int* error);
+
+/**
+ * @param shape a hand-written graph
+ * @param function the function that fails
+ * @param call which call fails, from 1
+ * @param error index of the errno in the errnos of the function
+ * @return the index of the test case
+ */
+unsigned int fault_encode(unsigned int shape, unsigned int function, unsigned int call, unsigned int error);
+
+/**
+ * Writes the schedule of a test case, the value of FAULT_SCHEDULE_VARIABLE
+ * @param index the test case
+ * @param buf where to write
+ * @param len size of buf
+ */
+void fault_schedule(unsigned int index, char* buf, size_t len);
+
+/**
+ * Writes a description of a test case, e.g. "call 3 of open() fails with ENOENT"
+ * @param index the test case
+ * @param buf where to write
+ * @param len size of buf
+ */
+void fault_describe(unsigned int index, char* buf, size_t len);
+
+/**
+ * Writes a schedule next to an archive, on one line
+ * @param archive path of the archive
+ * @param schedule the value of FAULT_SCHEDULE_VARIABLE
+ * @return 0 on success, -1 on error
+ */
+int fault_save_schedule(const char* archive, const char* schedule);
+
+/**
+ * Reads the schedule kept next to an archive by fault_save_schedule()
+ * @param archive path of the archive
+ * @param buf where to store the schedule
+ * @param len size of buf
+ * @return 0 on success, -1 if the archive has no schedule
+ */
+int fault_load_schedule(const char* archive, char* buf, size_t len);
+
+/**
+ * Reads the counts written by the injector
+ * @param path the file named by FAULT_COUNTS_VARIABLE
+ * @param counts where to store the number of calls of each function
+ * @return 0 on success, -1 if the file cannot be read (e.g. the extractor did not exit normally)
+ */
+int fault_read_counts(const char* path, unsigned long counts[FAULT_FUNCTION_COUNT]);
+
+#endif
@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "fsgraph.h"
+#include "numeric.h"
+#include "scratch.h"
+
+
+// Number of random graphs after the hand-written shapes
+#define RANDOM_GRAPHS 2048
+
+// Device numbers that do not name any real device (majors above 4095 are rejected by mknod)
+static const struct {
+    struct numeric_value value;
+    enum numeric_encoding encoding;
+} device_numbers[] = {
+    {{false, 0}, OCTAL_NUL},
+    {{false, 4096}, OCTAL_NUL},
+    {{false, (1ULL << 21) - 1}, OCTAL_NUL},
+    {{false, (1ULL << 24) - 1}, OCTAL_FULL},
+    {{false, (1ULL << 56) - 1}, BASE256},
+    {{true, 1}, BASE256},
+};
+#define DEVICE_NUMBER_COUNT (sizeof(device_numbers) / sizeof(device_numbers[0]))
+
+// Content of the regular files
+static const char data[] = "fsgraph member data, the same for every file\n";
+
+// A member of a hand-written shape
+struct member {
+    char typeflag;
+    const char* name;
+    const char* linkname;
+    const char* prefix;
+    const char* mode;
+    // Index in device_numbers, for the devices
+    int device;
+    // Fill the name and the prefix entirely, without terminator
+    bool full;
+};
+
+struct shape {
+    const char* description;
+    int count;
+    struct member members[FSGRAPH_MAX_MEMBERS];
+};
+
+#define FILE_(name) {'0', name, NULL, NULL, NULL, 0, false}
+#define DIR_(name) {'5', name, NULL, NULL, NULL, 0, false}
+#define SYMLINK(name, target) {'2', name, target, NULL, NULL, 0, false}
+#define HARDLINK(name, target) {'1', name, target, NULL, NULL, 0, false}
+
+static const struct shape shapes[] = {
+    {"symlink before its target", 2, {SYMLINK("link", "file.txt"), FILE_("file.txt")}},
+    {"write through a symlink to a later directory", 3,
+        {SYMLINK("link", "dir"), DIR_("dir/"), FILE_("link/file.txt")}},
+    {"hard link to a missing file", 1, {HARDLINK("hard", "missing.txt")}},
+    {"hard link before its target", 2, {HARDLINK("hard", "file.txt"), FILE_("file.txt")}},
+    {"file replacing a directory", 3, {DIR_("dir/"), FILE_("dir/file.txt"), FILE_("dir")}},
+    {"directory replacing a file", 3, {FILE_("dir"), DIR_("dir/"), FILE_("dir/file.txt")}},
+    {"directory replacing a symlink", 3, {SYMLINK("dir", "file.txt"), DIR_("dir/"), FILE_("dir/file.txt")}},
+    {"file replacing a symlink", 3, {SYMLINK("link", "file.txt"), FILE_("link"), FILE_("file.txt")}},
+    {"self-referencing symlink", 2, {SYMLINK("loop", "loop"), FILE_("loop/file.txt")}},
+    {"symlink cycle", 3, {SYMLINK("a", "b"), SYMLINK("b", "a"), FILE_("a/file.txt")}},
+    {"hard link to a directory", 2, {DIR_("dir/"), HARDLINK("hard", "dir")}},
+    {"hard link to itself", 1, {HARDLINK("hard", "hard")}},
+    {"hard link to a symlink, then written", 3,
+        {SYMLINK("link", "file.txt"), HARDLINK("hard", "link"), FILE_("hard")}},
+    {"hard link through a symlink", 4,
+        {SYMLINK("link", "dir"), DIR_("dir/"), FILE_("dir/file.txt"), HARDLINK("hard", "link/file.txt")}},
+    {"dangling absolute symlink", 1, {SYMLINK("link", "/nonexistent-fuzz/file.txt")}},
+    {"absolute names", 3,
+        {DIR_("/proc/self/cwd/dir/"), FILE_("/proc/self/cwd/dir/file.txt"), SYMLINK("/proc/self/cwd/link", "dir")}},
+    {"file in missing parent directories", 1, {FILE_("a/b/c/d/e/f/file.txt")}},
+    {"dot entries", 5, {DIR_("."), DIR_("./"), DIR_(""), FILE_("./file.txt"), DIR_("dir/./../dir/")}},
+    {"traversal in the name", 2, {FILE_("../escape.txt"), FILE_("dir/../../escape2.txt")}},
+    {"traversal in the prefix", 2,
+        {{'0', "escape.txt", NULL, "../", NULL, 0, false}, {'0', "../escape2.txt", NULL, "..", NULL, 0, false}}},
+    {"symlink out of the root, then written through", 2, {SYMLINK("up", "../.."), FILE_("up/escape.txt")}},
+    {"full name and prefix without terminator", 1, {{'0', "", NULL, NULL, NULL, 0, true}}},
+    {"directory without permissions, then written into", 3,
+        {{'5', "dir/", NULL, NULL, "0000000", 0, false}, FILE_("dir/file.txt"), DIR_("dir/")}},
+    {"devices and FIFOs", 5,
+        {{'3', "chr", NULL, NULL, NULL, 0, false}, {'4', "blk", NULL, NULL, NULL, 2, false},
+         {'3', "chr256", NULL, NULL, NULL, 4, false}, {'6', "fifo", NULL, NULL, NULL, 0, false},
+         HARDLINK("hard", "fifo")}},
+    {"devices with the same name", 3,
+        {{'3', "dev", NULL, NULL, NULL, 1, false}, {'4', "dev", NULL, NULL, NULL, 3, false},
+         {'6', "dev", NULL, NULL, NULL, 0, false}}},
+};
+#define SHAPE_COUNT (sizeof(shapes) / sizeof(shapes[0]))
+
+// Path components shared by the members of the random graphs
+static const char* components[] = {"a", "b", "dir", "file.txt", "link", "sub", ".", "..", ""};
+#define COMPONENT_COUNT (sizeof(components) / sizeof(components[0]))
+
+// Number of ".." components allowed in an archive: it cannot climb higher than the sandbox
+#define MAX_TRAVERSAL (FSGRAPH_SANDBOX_DEPTH - 2)
+
+// Absolute paths that lead back to the working directory of the extractor
+#define SELF_ROOT "/proc/self/cwd/"
+
+
+unsigned int fsgraph_case_count(void) {
+    return SHAPE_COUNT + RANDOM_GRAPHS;
+}
+
+
+unsigned int fsgraph_shape_count(void) {
+    return SHAPE_COUNT;
+}
+
+
+/**
+ * Fills a header for a member of a graph, with a correct checksum
+ */
+static void fill_header(struct tar_t* header, char typeflag, const char* name, const char* linkname,
+                        const char* prefix, const char* mode, int device, size_t data_len) {
+    char type[2] = {typeflag, '\0'};
+    char size[12];
+    snprintf(size, sizeof(size), "%011o", (unsigned int) data_len);
+
+    if (mode == NULL) {
+        mode = typeflag == '5' ? "0000775" : "0000664";
+    }
+    generate_tar_header(header, name, mode, "0001750", "0001750", size, "14413537165", type,
+                        linkname != NULL ? linkname : "", "ustar", "00", "michal", "michal");
+    if (prefix != NULL) {
+        strncpy(header->prefix, prefix, sizeof(header->prefix));
+    }
+    if (typeflag == '3' || typeflag == '4') {
+        numeric_encode(header->devmajor, sizeof(header->devmajor),
+                       device_numbers[device].value, device_numbers[device].encoding);
+        int minor = (device + 3) % DEVICE_NUMBER_COUNT;
+        numeric_encode(header->devminor, sizeof(header->devminor),
+                       device_numbers[minor].value, device_numbers[minor].encoding);
+    }
+    calculate_checksum(header);
+}
+
+
+/**
+ * Adds a member to the archive of a graph, regular files get some data
+ */
+static void add_member(struct fsgraph* graph, char typeflag, const char* name, const char* linkname,
+                       const char* prefix, const char* mode, int device, size_t data_len) {
+    struct tar_t* header = &graph->headers[graph->count++];
+    if (typeflag != '0') {
+        data_len = 0;
+    }
+    fill_header(header, typeflag, name, linkname, prefix, mode, device, data_len);
+    archive_add_member(&graph->archive, header, data, data_len, true);
+}
+
+
+static void build_shape(const struct shape* shape, struct fsgraph* graph) {
+    for (int i = 0; i < shape->count; i++) {
+        const struct member* member = &shape->members[i];
+        add_member(graph, member->typeflag, member->name, member->linkname, member->prefix, member->mode,
+                   member->device, 12);
+
+        if (member->full) {
+            // "dir/dir/.../dir/" in the prefix and the name, no terminator anywhere
+            struct tar_t* header = &graph->headers[graph->count - 1];
+            for (size_t j = 0; j < sizeof(header->prefix); j++) {
+                header->prefix[j] = "dir/"[j % 4];
+            }
+            for (size_t j = 0; j < sizeof(header->name); j++) {
+                header->name[j] = "dir/"[j % 4];
+            }
+            header->name[sizeof(header->name) - 1] = 'x';
+            calculate_checksum(header);
+        }
+    }
+}
+
+
+/**
+ * @return the number of ".." components of a path
+ */
+static int count_traversal(const char* path) {
+    int count = 0;
+    for (const char* p = path; (p = strstr(p, "..")) != NULL; p += 2) {
+        if ((p == path || p[-1] == '/') && (p[2] == '/' || p[2] == '\0')) {
+            count++;
+        }
+    }
+    return count;
+}
+
+
+/**
+ * Writes a random path of 1 to 3 shared components, sometimes absolute.
+ * ".." is only used while the traversal budget lasts.
+ */
+static void random_path(struct prng* prng, char* buf, size_t len, int* traversal) {
+    size_t used = 0;
+    buf[0] = '\0';
+
+    if (prng_below(prng, 20) == 0) {
+        used += snprintf(buf, len, "%s", SELF_ROOT);
+    }
+
+    int count = 1 + (int) prng_below(prng, 3);
+    for (int i = 0; i < count; i++) {
+        const char* component = components[prng_below(prng, COMPONENT_COUNT)];
+        if (strcmp(component, "..") == 0) {
+            if (*traversal == 0) {
+                component = ".";
+            } else {
+                (*traversal)--;
+            }
+        }
+        used += snprintf(buf + used, len - used, "%s%s", i ? "/" : "", component);
+        if (used >= len) {
+            return;
+        }
+    }
+}
+
+
+static void build_random(struct prng* prng, struct fsgraph* graph) {
+    int traversal = MAX_TRAVERSAL;
+    int count = 2 + (int) prng_below(prng, FSGRAPH_MAX_MEMBERS - 1);
+
+    // Names of the members that links may point at (never a FIFO or a device)
+    char names[FSGRAPH_MAX_MEMBERS][64];
+    int name_count = 0;
+
+    for (int i = 0; i < count; i++) {
+        char name[64];
+        char linkname[64];
+        char prefix[64];
+        const char* link = NULL;
+        const char* pre = NULL;
+        const char* mode = NULL;
+        int device = 0;
+        size_t data_len = prng_below(prng, sizeof(data));
+
+        unsigned int roll = (unsigned int) prng_below(prng, 100);
+        char typeflag = roll < 30 ? '0' : roll < 50 ? '5' : roll < 70 ? '2' : roll < 85 ? '1'
+                      : roll < 90 ? '3' : roll < 95 ? '4' : '6';
+
+        if (typeflag == '3' || typeflag == '4' || typeflag == '6') {
+            // Names that no other member can reach
+            snprintf(name, sizeof(name), "node%d", i);
+            device = (int) prng_below(prng, DEVICE_NUMBER_COUNT);
+        } else {
+            random_path(prng, name, sizeof(name), &traversal);
+            if (typeflag == '5' && prng_below(prng, 2)) {
+                strncat(name, "/", sizeof(name) - strlen(name) - 1);
+            }
+        }
+
+        if (typeflag == '1' || typeflag == '2') {
+            // Point at another member half of the time, at a random path otherwise
+            const char* target = name_count > 0 && prng_below(prng, 2) ? names[prng_below(prng, name_count)] : NULL;
+            if (target != NULL && count_traversal(target) <= traversal) {
+                snprintf(linkname, sizeof(linkname), "%s", target);
+                traversal -= count_traversal(target);
+            } else {
+                random_path(prng, linkname, sizeof(linkname), &traversal);
+            }
+            link = linkname;
+        }
+
+        if (prng_below(prng, 10) == 0 && typeflag != '3' && typeflag != '4' && typeflag != '6') {
+            random_path(prng, prefix, sizeof(prefix), &traversal);
+            pre = prefix;
+        }
+        if (prng_below(prng, 10) == 0) {
+            static const char* modes[] = {"0000000", "0007777", "0000100", "0000200"};
+            mode = modes[prng_below(prng, 4)];
+        }
+
+        add_member(graph, typeflag, name, link, pre, mode, device, data_len);
+        if (typeflag != '3' && typeflag != '4' && typeflag != '6') {
+            snprintf(names[name_count++], sizeof(names[0]), "%s", name);
+        }
+    }
+}
+
+
+void fsgraph_build_case(unsigned int index, struct prng* prng, struct fsgraph* graph) {
+    graph->count = 0;
+    archive_init(&graph->archive);
+
+    if (index < SHAPE_COUNT) {
+        build_shape(&shapes[index], graph);
+    } else {
+        build_random(prng, graph);
+    }
+    archive_end(&graph->archive, 2);
+}
+
+
+void fsgraph_describe_case(unsigned int index, char* buf, size_t len) {
+    if (index < SHAPE_COUNT) {
+        snprintf(buf, len, "%s", shapes[index].description);
+    } else {
+        snprintf(buf, len, "random graph %u", index - (unsigned int) SHAPE_COUNT);
+    }
+}
+
+
+int fsgraph_reset_sandbox(void) {
+    if (scratch_clean(FSGRAPH_SANDBOX) == -1) {
+        return -1;
+    }
+    return scratch_mkdirs(FSGRAPH_ROOT);
+}
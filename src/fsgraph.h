@@ -0,0 +1,70 @@
+#ifndef FUZZER_FSGRAPH_H
+#define FUZZER_FSGRAPH_H
+
+#include <stddef.h>
+
+#include "tar.h"
+#include "archive.h"
+#include "prng.h"
+
+/*
+ * Generator of archives whose members form a graph of filesystem objects:
+ * directories, symbolic and hard links, FIFOs and device nodes, pointing at each other
+ * (links before their target, cycles, objects replacing each other, traversal through "..", the prefix or symlinks).
+ * The first test cases are hand-written shapes, the others are random graphs built from a small pool of path
+ * components shared by all the members, so the archives stay a few blocks long.
+ *
+ * The archives are extracted in a sandbox nested FSGRAPH_SANDBOX_DEPTH directories deep, and the generator never
+ * puts more ".." components in an archive than that: whatever the extractor does with the links, it cannot write
+ * outside of the sandbox. Absolute paths go through /proc/self/cwd, i.e. back to the sandbox,
+ * and nothing is ever written through a FIFO or a device node (they would block or reach real hardware).
+ */
+
+// Maximum number of members of a graph
+#define FSGRAPH_MAX_MEMBERS 8
+
+// Directory emptied before each extraction, and the nested directory the extractor runs in
+#define FSGRAPH_SANDBOX "graph"
+#define FSGRAPH_SANDBOX_DEPTH 8
+#define FSGRAPH_ROOT FSGRAPH_SANDBOX "/d1/d2/d3/d4/d5/d6/d7/root"
+
+// An archive of the suite, the headers have to live as long as the archive that points at them
+struct fsgraph {
+    struct tar_t headers[FSGRAPH_MAX_MEMBERS];
+    int count;
+    struct archive archive;
+};
+
+/**
+ * @return the number of test cases of the generator
+ */
+unsigned int fsgraph_case_count(void);
+
+/**
+ * @return the number of hand-written test cases, they come first
+ */
+unsigned int fsgraph_shape_count(void);
+
+/**
+ * Builds the archive of a test case
+ * @param index the test case, from 0 to fsgraph_case_count() - 1
+ * @param prng generator seeded for this test case, only used by the random graphs
+ * @param graph where to build the archive
+ */
+void fsgraph_build_case(unsigned int index, struct prng* prng, struct fsgraph* graph);
+
+/**
+ * Writes a short description of a test case (e.g. "symlink cycle")
+ * @param index the test case
+ * @param buf where to write the description
+ * @param len size of buf
+ */
+void fsgraph_describe_case(unsigned int index, char* buf, size_t len);
+
+/**
+ * Removes everything extracted in the sandbox, even what escaped the root, and creates the root again
+ * @return 0 on success, -1 on error
+ */
+int fsgraph_reset_sandbox(void);
+
+#endif
@@ -3,136 +3,211 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "campaign.h"
+#include "tar.h"
+#include "prng.h"
+#include "replay.h"
+#include "numeric.h"
+#include "archive.h"
+#include "fsgraph.h"
+#include "extensions.h"
+#include "mutate.h"
+#include "executor.h"
+#include "resource.h"
+#include "scratch.h"
+#include "complexity.h"
+#include "systrace.h"
+#include "behaviour.h"
+#include "differential.h"
+#include "faults.h"
+#include "triage.h"
+#include "store.h"
+#include "regression.h"
+#include "scheduler.h"
+#include "corpus.h"
+#include "sweep.h"
+#include "dedup.h"
+#include "confirm.h"
+
+// Seed of the campaign when none is given: runs are reproducible by default
+#define DEFAULT_SEED 0x7461722d66757a7aULL
+
+// Where the archives of the extension suite are extracted
+#define EXTENSION_DIRECTORY "extension"
+
+// Where extract() runs the extractor when the extracted trees are fingerprinted or compared
+#define EXTRACT_DIRECTORY "extract"
+
+// Executions of the complexity mode when --complexity-execs is not given
+#define DEFAULT_COMPLEXITY_EXECUTIONS 5000
+
+// Where the archives of the truncation suite are extracted
+#define TRUNCATION_DIRECTORY "truncation"
+
+// Where the archives of the header sweep are extracted
+#define HEADER_DIRECTORY "header"
+
+// Returned by extract() when the archive was not run again, see dedup.h
+#define EXTRACT_ALREADY_RUN 2
 
 
-// Header structure
-struct tar_t
-{                              /* byte offset */
-    char name[100];               /*   0 */
-    char mode[8];                 /* 100 */
-    char uid[8];                  /* 108 */
-    char gid[8];                  /* 116 */
-    char size[12];                /* 124 */
-    char mtime[12];               /* 136 */
-    char chksum[8];               /* 148 */
-    char typeflag[1];             /* 156 */
-    char linkname[100];           /* 157 */
-    char magic[6];                /* 257 */
-    char version[2];              /* 263 */
-    char uname[32];               /* 265 */
-    char gname[32];               /* 297 */
-    char devmajor[8];             /* 329 */
-    char devminor[8];             /* 337 */
-    char prefix[155];             /* 345 */
-    char padding[12];             /* 500 */
-};
-
 /**
- * Computes the checksum for a tar header and encode it on the header
- * @param entry: The tar header
- * @return the value of the checksum
+ * Calls the external extractor from another directory, so that whatever it creates stays there.
+ * The archives that cost too much (CPU time, memory, writes...) are kept as resource bugs,
+ * and those that run into a resource limit of the extractor are kept apart, they are not crashes.
+ * With syscall feedback or fingerprints, the archives that made the extractor behave in a new way are added
+ * to the corpus. In differential mode, the reference extracts the archive at the same time, and a tree that differs
+ * is a semantic bug. The fingerprint covers the first component of the directory, so that a nested sandbox includes
+ * what escaped through "..", and that component is emptied here, by the walk that computes the fingerprint.
+ * An archive already run by the shard in the same directory, with the same faults, and without a finding, is not
+ * run again.
+ * With --confirm, the directory as a crash left it is copied before it is cleaned, to run the crash again.
+ * @param extractor the extractor that will be used
+ * @param directory where the extractor runs, relative to the current directory, NULL for the current directory
+ * @param filename name of the tar archive, in the current directory
+ * @param injected whether the fault suite set a schedule (FAULT_SCHEDULE_VARIABLE), see executor_run()
+ * @return the same as extract()
  */
-unsigned int calculate_checksum(struct tar_t* entry) {
-    // use spaces for the checksum bytes while calculating the checksum
-    memset(entry->chksum, ' ', 8);
+int extract_in_directory(char* extractor, const char* directory, const char* filename, bool injected) {
+    // "graph/d1/.../root": the tree is "graph", the reference runs in "d1/.../root" of its own directory
+    char tree[PATH_MAX];
+    const char* nesting = NULL;
+    if (directory != NULL) {
+        snprintf(tree, sizeof(tree), "%s", directory);
+        char* slash = strchr(tree, '/');
+        if (slash != NULL) {
+            *slash = '\0';
+            nesting = directory + (slash - tree) + 1;
+        }
+    }
 
-    // sum of entire metadata
-    unsigned int check = 0;
-    unsigned char* raw = (unsigned char*) entry;
-    for(int i = 0; i < 512; i++){
-        check += raw[i];
+    // What was taken for the crash of another execution is not this one's
+    if (confirm_enabled()) {
+        confirm_forget();
     }
 
-    // Checksum is terminated by a null character and a space character (0x00 0x20)
-    snprintf(entry->chksum, sizeof(entry->chksum), "%06o0", check);
+    // It was run to its end without a finding
+    struct dedup_key key;
+    if (dedup_enabled()) {
+        const char* schedule = getenv(FAULT_SCHEDULE_VARIABLE);
+        char context[PATH_MAX + FAULT_SCHEDULE_SIZE];
+        snprintf(context, sizeof(context), "%s:%s", directory != NULL ? directory : ".", schedule != NULL ? schedule : "");
+        if (dedup_seen(filename, context, &key)) {
+            return EXTRACT_ALREADY_RUN;
+        }
+    }
 
-    entry->chksum[6] = '\0';
-    entry->chksum[7] = ' ';
-    return check;
-}
+    bool compared = differential_enabled() && directory != NULL && differential_start(nesting, filename) == 0;
+    struct execution execution;
+    if (executor_run(extractor, directory, filename, injected, &execution) == -1) {
+        uint64_t ignored;
+        int status;
+        if (compared) {
+            differential_finish(&ignored, &status);
+        }
+        return -1;
+    }
+    if (execution.crashed && confirm_enabled()) {
+        confirm_capture(directory);
+    }
 
+    uint64_t case_id = campaign_case_id();
+    bool finding = execution.crashed;
+    // Cut short by the signal that stops the campaign: neither its costs nor its limits are those of the archive,
+    // and --resume runs it again
+    bool interrupted = campaign_stop_requested() || execution.signal == SIGINT || execution.signal == SIGTERM;
 
-/**
- * Generates a tar header given the inputed values
- * @param header
- * @param name
- * @param mode
- * @param uid
- * @param gid
- * @param size
- * @param mtime
- * @param typeflag
- * @param linkname
- * @param magic
- * @param version
- * @param uname
- * @param gname
- */
-void generate_tar_header(struct tar_t *header, const char *name, const char *mode, const char *uid, const char *gid, const char *size,
-                         const char *mtime, const char *typeflag, const char *linkname, const char *magic, const char *version,
-                         const char *uname, const char *gname) {
-    // Copy the input parameters into the tar header fields
-    strncpy(header->name, name, sizeof(header->name));
-    strncpy(header->mode, mode, sizeof(header->mode));
-    strncpy(header->uid, uid, sizeof(header->uid));
-    strncpy(header->gid, gid, sizeof(header->gid));
-    strncpy(header->size, size, sizeof(header->size));
-    strncpy(header->mtime, mtime, sizeof(header->mtime));
-    strncpy(header->typeflag, typeflag, sizeof(header->typeflag));
-    strncpy(header->linkname, linkname, sizeof(header->linkname));
-    strncpy(header->magic, magic, sizeof(header->magic));
-    strncpy(header->version, version, sizeof(header->version));
-    strncpy(header->uname, uname, sizeof(header->uname));
-    strncpy(header->gname, gname, sizeof(header->gname));
-    strncpy(header->devmajor, "0000000", sizeof(header->devmajor));
-    strncpy(header->devminor, "0000000", sizeof(header->devminor));
-    strncpy(header->prefix, "", sizeof(header->prefix));
-    strncpy(header->padding, "", sizeof(header->padding));
-}
-
-/**
- * Creates a .tar archive
- * @param filename name of the archive to be created
- * @param header header data to be added in the tar archive
- */
-void write_tar_file(const char* filename, struct tar_t* header) {
-    // Open file for writing in binary mode
-    FILE* file = fopen(filename, "wb");
+    uint64_t fingerprint = 0;
+    if ((behaviour_enabled() || compared) && directory != NULL && scratch_clean_fingerprint(tree, &fingerprint) == -1) {
+        perror(tree);
+    }
 
-    // Write the header to the file
-    fwrite(header, sizeof(struct tar_t), 1, file);
+    // Another tree than the reference, without a crash or a limit to explain it, once per pair of trees
+    uint64_t reference_fingerprint;
+    int reference_status;
+    if (compared && differential_finish(&reference_fingerprint, &reference_status) == 0 && !execution.crashed &&
+        execution.limit == LIMIT_NONE && fingerprint != reference_fingerprint &&
+        differential_new_mismatch(fingerprint, reference_fingerprint)) {
+        char detail[128];
+        char semantic_name[64];
+        snprintf(detail, sizeof(detail), "tree %016llx, reference tree %016llx, reference exit status %d",
+                 (unsigned long long) fingerprint, (unsigned long long) reference_fingerprint,
+                 WIFEXITED(reference_status) ? WEXITSTATUS(reference_status) : 128 + WTERMSIG(reference_status));
+        snprintf(semantic_name, sizeof(semantic_name), "semantic_%s_%u.tar", suite_name(case_id >> 32),
+                 (unsigned int) case_id);
+        finding = true;
+        printf("        > Semantic bug: the extracted tree differs from the reference (%s)\n", detail);
+        store_add(filename, STORE_SEMANTIC, &execution);
+        if (scratch_copy_file(filename, semantic_name) == 0) {
+            campaign_record_finding("semantic", semantic_name, detail);
+        }
+    }
 
-    // Close the file
-    fclose(file);
-}
+    uint64_t behaviour = execution.trace_hash;
+    bool new_class = false;
+    if (behaviour_enabled() && directory != NULL) {
+        behaviour = behaviour_class(execution.crashed, execution.status, fingerprint, execution.trace_hash);
+        new_class = behaviour_record(behaviour);
+    }
+    if (execution.new_behaviours > 0) {
+        printf("        > New syscall behaviour: %u new entries\n", execution.new_behaviours);
+    }
+    if (new_class) {
+        printf("        > New behaviour class: %lu so far\n", behaviour_count());
+    }
 
-/**
- * Creates a .tar archive of a file with data and padding
- * @param filename name of the archive to be created
- * @param header header data to be added in the tar archive
- * @param data data that has to be added
- * @param data_len data size used to calculate the padding
- */
-void write_tar_file_with_data(const char* filename, struct tar_t* header, const char* data, int data_len) {
-    // Open file for writing in binary mode
-    FILE* file = fopen(filename, "wb");
+    // Appended to the packed corpus with its behaviour: an archive is kept once per behaviour and worker
+    if (execution.new_behaviours > 0 || new_class) {
+        scheduler_note_discovery();
+        corpus_add(filename, case_id, behaviour,
+                   (execution.new_behaviours > 0 ? CORPUS_SYSCALLS : 0) | (new_class ? CORPUS_CLASS : 0));
+    }
 
-    // Write the header to the file
-    fwrite(header, sizeof(struct tar_t), 1, file);
+    // Stopped by a limit before it could harm the host: keep a copy of the archive, the caller reuses the file
+    if (execution.limit != LIMIT_NONE && !interrupted) {
+        char limit[64];
+        char limit_name[64];
+        executor_describe_limit(&execution, limit, sizeof(limit));
+        snprintf(limit_name, sizeof(limit_name), "limit_%s_%u.tar", suite_name(case_id >> 32), (unsigned int) case_id);
+        printf("        > Limit hit: %s\n", limit);
+        store_add(filename, execution.limit == LIMIT_CPU ? STORE_HANG : STORE_LIMIT, &execution);
+        if (scratch_copy_file(filename, limit_name) == 0) {
+            campaign_record_finding("limit", limit_name, limit);
+        }
+        return 0;
+    }
 
-    // Write the data to the file
-    fwrite(data, sizeof(char), data_len, file);
+    // Denial of service by archive is a bug too: keep a copy of the archive, the caller reuses the file
+    char reason[256];
+    if (!interrupted && resource_check(&execution, reason, sizeof(reason))) {
+        char costs[128];
+        char resource_name[64];
+        resource_describe(&execution, costs, sizeof(costs));
+        snprintf(resource_name, sizeof(resource_name), "resource_%s_%u.tar",
+                 suite_name(case_id >> 32), (unsigned int) case_id);
+        finding = true;
+        printf("        > Resource bug: %s (%s)\n", reason, costs);
+        store_add(filename, STORE_RESOURCE, &execution);
+        if (scratch_copy_file(filename, resource_name) == 0) {
+            campaign_record_finding("resource", resource_name, reason);
+        }
+    }
 
-    // Pad the data with null bytes (it has to be a 512-byte block)
-    int padding_len = 512 - (data_len % 512);
-    if (padding_len != 512) {
-        char padding[padding_len];
-        memset(padding, 0, padding_len);
-        fwrite(padding, sizeof(char), padding_len, file);
+    if (execution.crashed) {
+        store_add(filename, STORE_CRASH, &execution);
     }
 
-    // Close the file
-    fclose(file);
+    if (dedup_enabled() && !finding && !interrupted) {
+        dedup_add(&key);
+    }
+    return execution.crashed ? 1 : 0;
 }
 
 
@@ -142,40 +217,12 @@ void write_tar_file_with_data(const char* filename, struct tar_t* header, const
  * @param filename name of the tar archive to be extracted
  * @return -1 if the executable cannot be launched,
  *          0 if it is launched but does not crash,
- *          1 if it is launched and it crashed.
+ *          1 if it is launched and it crashed,
+ *          EXTRACT_ALREADY_RUN if the same archive was already run without a finding, it is not run again.
  */
 int extract(char* extractor, char * filename) {
-    int rv = 0;
-    char cmd[51];
-    strncpy(cmd, extractor, 25);
-    cmd[26] = '\0';
-    strncat(cmd, filename, 25);
-    char buf[33];
-    FILE *fp;
-
-    if ((fp = popen(cmd, "r")) == NULL) {
-        printf("Error opening pipe!\n");
-        return -1;
-    }
-
-    if(fgets(buf, 33, fp) == NULL) {
-        //printf("No output\n");
-        goto finally;
-    }
-    if(strncmp(buf, "*** The program has crashed ***\n", 33)) {
-        //printf("Not the crash message\n");
-        goto finally;
-    } else {
-        //printf("Crash message\n");
-        rv = 1;
-        goto finally;
-    }
-    finally:
-    if(pclose(fp) == -1) {
-        printf("Command not found\n");
-        rv = -1;
-    }
-    return rv;
+    bool elsewhere = behaviour_enabled() || differential_enabled();
+    return extract_in_directory(extractor, elsewhere ? EXTRACT_DIRECTORY : NULL, filename, false);
 }
 
 
@@ -209,6 +256,11 @@ int test_filename_field(char* extractor) {
                 continue;
             }
 
+            // Only run the test cases assigned to this shard, and not those of a pruned position
+            if (behaviour_pruned(SUITE_NAME, i) || !campaign_claim(SUITE_NAME, i * 256 + j)) {
+                continue;
+            }
+
             filename[i] = (char) j;
 
             // Generate a header with other fields that are correct, only manipulate the filename field
@@ -221,9 +273,10 @@ int test_filename_field(char* extractor) {
             write_tar_file("test_filename.tar", &header);
 
 
-            if (extract(extractor, " test_filename.tar") == 1 ) {
+            if (extract(extractor, "test_filename.tar") == 1 ) {
                 // The extractor has crashed
                 rename("test_filename.tar", "success_filename.tar");
+                campaign_record_crash("success_filename.tar");
                 // Delete the extracted file
                 remove(filename);
                 // return 1 to stop the execution as one crash is enough
@@ -266,6 +319,11 @@ int test_mode_field(char* extractor) {
     for (i = 0; i < 7; i++) {
         for (j = 0x00; j <= 0xFF; j++) {
 
+            // Only run the test cases assigned to this shard, and not those of a pruned position
+            if (behaviour_pruned(SUITE_MODE, i) || !campaign_claim(SUITE_MODE, i * 256 + j)) {
+                continue;
+            }
+
             mode[i] = (char) j;
 
             // Generate a header with other fields that are correct, only manipulate the mode field
@@ -278,9 +336,10 @@ int test_mode_field(char* extractor) {
             write_tar_file("test_mode.tar", &header);
 
 
-            if (extract(extractor, " test_mode.tar") == 1 ) {
+            if (extract(extractor, "test_mode.tar") == 1 ) {
                 // The extractor has crashed
                 rename("test_mode.tar", "success_mode.tar");
+                campaign_record_crash("success_mode.tar");
                 // Delete the extracted file
                 remove("file.txt");
                 // return 1 to stop the execution as one crash is enough
@@ -323,6 +382,11 @@ int test_uid_field(char* extractor) {
     for (i = 0; i < 7; i++) {
         for (j = 0x00; j <= 0xFF; j++) {
 
+            // Only run the test cases assigned to this shard, and not those of a pruned position
+            if (behaviour_pruned(SUITE_UID, i) || !campaign_claim(SUITE_UID, i * 256 + j)) {
+                continue;
+            }
+
             uid[i] = (char) j;
 
             // Generate a header with other fields that are correct, only manipulate the mode field
@@ -335,9 +399,10 @@ int test_uid_field(char* extractor) {
             write_tar_file("test_uid.tar", &header);
 
 
-            if (extract(extractor, " test_uid.tar") == 1 ) {
+            if (extract(extractor, "test_uid.tar") == 1 ) {
                 // The extractor has crashed
                 rename("test_uid.tar", "success_uid.tar");
+                campaign_record_crash("success_uid.tar");
                 // Delete the extracted file
                 remove("file.txt");
                 // return 1 to stop the execution as one crash is enough
@@ -380,6 +445,11 @@ int test_gid_field(char* extractor) {
     for (i = 0; i < 7; i++) {
         for (j = 0x00; j <= 0xFF; j++) {
 
+            // Only run the test cases assigned to this shard, and not those of a pruned position
+            if (behaviour_pruned(SUITE_GID, i) || !campaign_claim(SUITE_GID, i * 256 + j)) {
+                continue;
+            }
+
             gid[i] = (char) j;
 
             // Generate a header with other fields that are correct, only manipulate the mode field
@@ -392,9 +462,10 @@ int test_gid_field(char* extractor) {
             write_tar_file("test_gid.tar", &header);
 
 
-            if (extract(extractor, " test_gid.tar") == 1 ) {
+            if (extract(extractor, "test_gid.tar") == 1 ) {
                 // The extractor has crashed
                 rename("test_gid.tar", "success_gid.tar");
+                campaign_record_crash("success_gid.tar");
                 // Delete the extracted file
                 remove("file.txt");
                 // return 1 to stop the execution as one crash is enough
@@ -437,6 +508,11 @@ int test_size_field(char* extractor) {
     for (i = 0; i < 11; i++) {
         for (j = 0x00; j <= 0xFF; j++) {
 
+            // Only run the test cases assigned to this shard, and not those of a pruned position
+            if (behaviour_pruned(SUITE_SIZE, i) || !campaign_claim(SUITE_SIZE, i * 256 + j)) {
+                continue;
+            }
+
             size[i] = (char) j;
 
             // Generate a header with other fields that are correct, only manipulate the mode field
@@ -449,9 +525,10 @@ int test_size_field(char* extractor) {
             write_tar_file("test_size.tar", &header);
 
 
-            if (extract(extractor, " test_size.tar") == 1 ) {
+            if (extract(extractor, "test_size.tar") == 1 ) {
                 // The extractor has crashed
                 rename("test_size.tar", "success_size.tar");
+                campaign_record_crash("success_size.tar");
                 // Delete the extracted file
                 remove("file.txt");
                 // return 1 to stop the execution as one crash is enough
@@ -493,6 +570,11 @@ int test_mtime_field(char* extractor) {
     for (i = 0; i < 11; i++) {
         for (j = 0x00; j <= 0xFF; j++) {
 
+            // Only run the test cases assigned to this shard, and not those of a pruned position
+            if (behaviour_pruned(SUITE_MTIME, i) || !campaign_claim(SUITE_MTIME, i * 256 + j)) {
+                continue;
+            }
+
             mtime[i] = (char) j;
 
             // Generate a header with other fields that are correct, only manipulate the mode field
@@ -505,9 +587,10 @@ int test_mtime_field(char* extractor) {
             write_tar_file("test_mtime.tar", &header);
 
 
-            if (extract(extractor, " test_mtime.tar") == 1 ) {
+            if (extract(extractor, "test_mtime.tar") == 1 ) {
                 // The extractor has crashed
                 rename("test_mtime.tar", "success_mtime.tar");
+                campaign_record_crash("success_mtime.tar");
                 // Delete the extracted file
                 remove("file.txt");
                 // return 1 to stop the execution as one crash is enough
@@ -550,6 +633,11 @@ int test_typeflag_field(char* extractor) {
 
     for (j = 0x00; j <= 0xFF; j++) {
 
+        // Only run the test cases assigned to this shard, and not those of a pruned position
+        if (behaviour_pruned(SUITE_TYPEFLAG, 0) || !campaign_claim(SUITE_TYPEFLAG, j)) {
+            continue;
+        }
+
         typeflag[0] = (char) j;
 
         // Generate a header with other fields that are correct, only manipulate the mode field
@@ -562,9 +650,10 @@ int test_typeflag_field(char* extractor) {
         write_tar_file("test_typeflag.tar", &header);
 
 
-        if (extract(extractor, " test_typeflag.tar") == 1 ) {
+        if (extract(extractor, "test_typeflag.tar") == 1 ) {
             // The extractor has crashed
             rename("test_typeflag.tar", "success_typeflag.tar");
+            campaign_record_crash("success_typeflag.tar");
             // Delete the extracted file
             remove("file.txt");
             // return 1 to stop the execution as one crash is enough
@@ -606,6 +695,11 @@ int test_linkname_field(char* extractor) {
     for (i = 0; i < 99; i++) {
         for (j = 0x00; j <= 0xFF; j++) {
 
+            // Only run the test cases assigned to this shard, and not those of a pruned position
+            if (behaviour_pruned(SUITE_LINKNAME, i) || !campaign_claim(SUITE_LINKNAME, i * 256 + j)) {
+                continue;
+            }
+
             linkname[i] = (char) j;
 
             // Generate a header with other fields that are correct, only manipulate the mode field
@@ -618,9 +712,10 @@ int test_linkname_field(char* extractor) {
             write_tar_file("test_linkname.tar", &header);
 
 
-            if (extract(extractor, " test_linkname.tar") == 1 ) {
+            if (extract(extractor, "test_linkname.tar") == 1 ) {
                 // The extractor has crashed
                 rename("test_linkname.tar", "success_linkname.tar");
+                campaign_record_crash("success_linkname.tar");
                 // Delete the extracted file
                 remove("file.txt");
                 // return 1 to stop the execution as one crash is enough
@@ -663,6 +758,11 @@ int test_magic_field(char* extractor) {
     for (i = 0; i < 5; i++) {
         for (j = 0x00; j <= 0xFF; j++) {
 
+            // Only run the test cases assigned to this shard, and not those of a pruned position
+            if (behaviour_pruned(SUITE_MAGIC, i) || !campaign_claim(SUITE_MAGIC, i * 256 + j)) {
+                continue;
+            }
+
             magic[i] = (char) j;
 
             // Generate a header with other fields that are correct, only manipulate the magic field
@@ -675,9 +775,10 @@ int test_magic_field(char* extractor) {
             write_tar_file("test_magic.tar", &header);
 
 
-            if (extract(extractor, " test_magic.tar") == 1 ) {
+            if (extract(extractor, "test_magic.tar") == 1 ) {
                 // The extractor has crashed
                 rename("test_magic.tar", "success_magic.tar");
+                campaign_record_crash("success_magic.tar");
                 // Delete the extracted file
                 remove("file.txt");
                 // return 1 to stop the execution as one crash is enough
@@ -720,6 +821,11 @@ int test_version_field(char* extractor) {
     for (i = 0; i < 2; i++) {
         for (j = 0x00; j <= 0xFF; j++) {
 
+            // Only run the test cases assigned to this shard, and not those of a pruned position
+            if (behaviour_pruned(SUITE_VERSION, i) || !campaign_claim(SUITE_VERSION, i * 256 + j)) {
+                continue;
+            }
+
             version[i] = (char) j;
 
             // Generate a header with other fields that are correct, only manipulate the version field
@@ -732,9 +838,10 @@ int test_version_field(char* extractor) {
             write_tar_file("test_version.tar", &header);
 
 
-            if (extract(extractor, " test_version.tar") == 1 ) {
+            if (extract(extractor, "test_version.tar") == 1 ) {
                 // The extractor has crashed
                 rename("test_version.tar", "success_version.tar");
+                campaign_record_crash("success_version.tar");
                 // Delete the extracted file
                 remove("file.txt");
                 // return 1 to stop the execution as one crash is enough
@@ -777,6 +884,11 @@ int test_uname_field(char* extractor) {
     for (i = 0; i < 31; i++) {
         for (j = 0x00; j <= 0xFF; j++) {
 
+            // Only run the test cases assigned to this shard, and not those of a pruned position
+            if (behaviour_pruned(SUITE_UNAME, i) || !campaign_claim(SUITE_UNAME, i * 256 + j)) {
+                continue;
+            }
+
             uname[i] = (char) j;
 
             // Generate a header with other fields that are correct, only manipulate the uname field
@@ -789,9 +901,10 @@ int test_uname_field(char* extractor) {
             write_tar_file("test_uname.tar", &header);
 
 
-            if (extract(extractor, " test_uname.tar") == 1 ) {
+            if (extract(extractor, "test_uname.tar") == 1 ) {
                 // The extractor has crashed
                 rename("test_uname.tar", "success_uname.tar");
+                campaign_record_crash("success_uname.tar");
                 // Delete the extracted file
                 remove("file.txt");
                 // return 1 to stop the execution as one crash is enough
@@ -834,6 +947,11 @@ int test_gname_field(char* extractor) {
     for (i = 0; i < 31; i++) {
         for (j = 0x00; j <= 0xFF; j++) {
 
+            // Only run the test cases assigned to this shard, and not those of a pruned position
+            if (behaviour_pruned(SUITE_GNAME, i) || !campaign_claim(SUITE_GNAME, i * 256 + j)) {
+                continue;
+            }
+
             gname[i] = (char) j;
 
             // Generate a header with other fields that are correct, only manipulate the gname field
@@ -846,9 +964,10 @@ int test_gname_field(char* extractor) {
             write_tar_file("test_gname.tar", &header);
 
 
-            if (extract(extractor, " test_gname.tar") == 1 ) {
+            if (extract(extractor, "test_gname.tar") == 1 ) {
                 // The extractor has crashed
                 rename("test_gname.tar", "success_gname.tar");
+                campaign_record_crash("success_gname.tar");
                 // Delete the extracted file
                 remove("file.txt");
                 // return 1 to stop the execution as one crash is enough
@@ -892,6 +1011,11 @@ int test_checksum_field(char* extractor) {
     for (i = 0; i < 6; i++) {
         for (j = 0x00; j <= 0xFF; j++) {
 
+            // Only run the test cases assigned to this shard, and not those of a pruned position
+            if (behaviour_pruned(SUITE_CHKSUM, i) || !campaign_claim(SUITE_CHKSUM, i * 256 + j)) {
+                continue;
+            }
+
             checksum_str[i] = (char) j;
 
             // Generate a header with other fields that are correct, only manipulate the checksum field
@@ -908,9 +1032,10 @@ int test_checksum_field(char* extractor) {
             write_tar_file("test_checksum.tar", &header);
 
 
-            if (extract(extractor, " test_checksum.tar") == 1 ) {
+            if (extract(extractor, "test_checksum.tar") == 1 ) {
                 // The extractor has crashed
                 rename("test_checksum.tar", "success_checksum.tar");
+                campaign_record_crash("success_checksum.tar");
                 // Delete the extracted file
                 remove("file.txt");
                 // return 1 to stop the execution as one crash is enough
@@ -929,6 +1054,82 @@ int test_checksum_field(char* extractor) {
 }
 
 
+/**
+ * Tests every byte of the header, all 512 offsets, with the 256 values (one offset by one, not all combinations),
+ * with the checksum computed again or left as in the golden header (see sweep.h).
+ * Unlike the field sweeps, the sweep goes on after a crash: the values that crash at each offset are the result.
+ * File with data
+ * Single file in archive
+ * @param extractor the extractor that will be used
+ * @return the number of test cases that made it crash
+ */
+int test_header_offsets(char* extractor) {
+    printf("Testing every byte of the header with all characters, chksum, devmajor, devminor, prefix and padding included.\n"
+           "        > File with data.\n"
+           "        > Single file in archive.\n");
+
+    static const char data[] = "The content of file.txt, fifty bytes long.........";
+    struct tar_t header;
+    int crashes = 0;
+
+    for (unsigned int i = 0; i < SWEEP_CASE_COUNT; i++) {
+        // Only run the test cases assigned to this shard, and not those of a pruned offset
+        if (sweep_skipped(i) || behaviour_pruned(SUITE_HEADER, i / 256) || !campaign_claim(SUITE_HEADER, i)) {
+            continue;
+        }
+
+        sweep_build_case(i, &header);
+        write_tar_file_with_data("test_header.tar", &header, data, sizeof(data) - 1);
+
+        if (scratch_clean(HEADER_DIRECTORY) == -1 || scratch_mkdirs(HEADER_DIRECTORY) == -1) {
+            perror(HEADER_DIRECTORY);
+            break;
+        }
+
+        int rv = extract_in_directory(extractor, HEADER_DIRECTORY, "test_header.tar", false);
+        bool crashed = rv == 1;
+        // Counted in the table when it was run
+        if (rv != EXTRACT_ALREADY_RUN) {
+            sweep_record(i, crashed);
+        }
+        if (crashed) {
+            // The extractor has crashed, keep the archive and go on with the next value
+            char success_name[40];
+            snprintf(success_name, sizeof(success_name), "success_header_%u.tar", i);
+            printf("        > Crash with 0x%02x at offset %u (%s)\n", i % 256, i / 256 % TAR_BLOCK_SIZE,
+                   sweep_field_name(i / 256 % TAR_BLOCK_SIZE));
+            rename("test_header.tar", success_name);
+            campaign_record_crash(success_name);
+            crashes++;
+        }
+    }
+
+    // Delete the extracted files
+    scratch_clean(HEADER_DIRECTORY);
+    rmdir(HEADER_DIRECTORY);
+    remove("test_header.tar");
+    return crashes;
+}
+
+
+void test_header(char* extractor) {
+
+    // 1. Test every offset of the header with every value
+    int crashes;
+    if (!scheduler_step(test_header_offsets, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+        return;
+    }
+    if (crashes) {
+        printf("\033[1;32m~~~~~It has crashed ! %d bytes of the header caused a crash.~~~~~\033[0m\n", crashes);
+    } else {
+        printf("\033[1;31m~~~~~No issues found with the bytes of the header.~~~~~\033[0m\n");
+    }
+    sweep_summary();
+    printf("\n");
+}
+
+
 /**
  * Tests all fields in the header to see if they accept the whole range of characters from 0x00 to 0xFF
  * On files without data
@@ -936,92 +1137,120 @@ int test_checksum_field(char* extractor) {
  * @param extractor the extractor that will be used
  */
 void test_fields_for_all_characters(char* extractor) {
+    int crashes;
+
     // 1. Test the file name field
-    if (test_filename_field(extractor)) {
+    if (!scheduler_step(test_filename_field, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
         printf("\033[1;32m~~~~~It has crashed ! Some non-ascii characters in the file name field caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with the file name field.~~~~~\033[0m\n\n");
     }
 
     // 2. Test the mode field
-    if (test_mode_field(extractor)) {
+    if (!scheduler_step(test_mode_field, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
         printf("\033[1;32m~~~~~It has crashed ! Some characters in the mode field caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with the mode field.~~~~~\033[0m\n\n");
     }
 
     // 3. Test the uid field
-    if (test_uid_field(extractor)) {
+    if (!scheduler_step(test_uid_field, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
         printf("\033[1;32m~~~~~It has crashed ! Some characters in the uid field caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with the uid field.~~~~~\033[0m\n\n");
     }
 
     // 4. Test the gid field
-    if (test_gid_field(extractor)) {
+    if (!scheduler_step(test_gid_field, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
         printf("\033[1;32m~~~~~It has crashed ! Some characters in the gid field caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with the gid field.~~~~~\033[0m\n\n");
     }
 
     // 5. Test the size field
-    if (test_size_field(extractor)) {
+    if (!scheduler_step(test_size_field, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
         printf("\033[1;32m~~~~~It has crashed ! Some characters in the size field caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with the size field.~~~~~\033[0m\n\n");
     }
 
     // 6. Test the mtime field
-    if (test_mtime_field(extractor)) {
+    if (!scheduler_step(test_mtime_field, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
         printf("\033[1;32m~~~~~It has crashed ! Some characters in the mtime field caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with the mtime field.~~~~~\033[0m\n\n");
     }
 
     // 7. Test the typeflag field
-    if (test_typeflag_field(extractor)) {
+    if (!scheduler_step(test_typeflag_field, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
         printf("\033[1;32m~~~~~It has crashed ! Some characters in the typeflag field caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with the typeflag field.~~~~~\033[0m\n\n");
     }
 
     // 8. Test the linkname field
-    if (test_linkname_field(extractor)) {
+    if (!scheduler_step(test_linkname_field, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
         printf("\033[1;32m~~~~~It has crashed ! Some characters in the linkname field caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with the linkname field.~~~~~\033[0m\n\n");
     }
 
     // 9. Test the magic field
-    if (test_magic_field(extractor)) {
+    if (!scheduler_step(test_magic_field, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
         printf("\033[1;32m~~~~~It has crashed ! Some characters in the magic field caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with the magic field.~~~~~\033[0m\n\n");
     }
 
     // 10. Test the version field
-    if (test_version_field(extractor)) {
+    if (!scheduler_step(test_version_field, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
         printf("\033[1;32m~~~~~It has crashed ! Some characters in the version field caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with the version field.~~~~~\033[0m\n\n");
     }
 
     // 11. Test the uname field
-    if (test_uname_field(extractor)) {
+    if (!scheduler_step(test_uname_field, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
         printf("\033[1;32m~~~~~It has crashed ! Some characters in the uname field caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with the uname field.~~~~~\033[0m\n\n");
     }
 
     // 12. Test the gname field
-    if (test_gname_field(extractor)) {
+    if (!scheduler_step(test_gname_field, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
         printf("\033[1;32m~~~~~It has crashed ! Some characters in the gname field caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with the gname field.~~~~~\033[0m\n\n");
     }
 
     // 13. Test the checksum field
-    if (test_checksum_field(extractor)) {
+    if (!scheduler_step(test_checksum_field, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
         printf("\033[1;32m~~~~~It has crashed ! Some characters in the checksum field caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with the checksum field.~~~~~\033[0m\n\n");
@@ -1055,9 +1284,10 @@ int test_wrong_checksum_value(char* extractor) {
 
     write_tar_file("test_wrong_checksum.tar", &header);
 
-    if (extract(extractor, " test_wrong_checksum.tar") == 1 ) {
+    if (extract(extractor, "test_wrong_checksum.tar") == 1 ) {
         // The extractor has crashed
         rename("test_wrong_checksum.tar", "success_wrong_checksum.tar");
+        campaign_record_crash("success_wrong_checksum.tar");
         // Delete the extracted file
         remove("file.txt");
         // return 1 to stop the execution as one crash is enough
@@ -1099,9 +1329,10 @@ int test_wrong_checksum_value_non_octal(char* extractor) {
 
     write_tar_file("test_wrong_checksum2.tar", &header);
 
-    if (extract(extractor, " test_wrong_checksum2.tar") == 1 ) {
+    if (extract(extractor, "test_wrong_checksum2.tar") == 1 ) {
         // The extractor has crashed
         rename("test_wrong_checksum2.tar", "success_wrong_checksum2.tar");
+        campaign_record_crash("success_wrong_checksum2.tar");
         // Delete the extracted file
         remove("file.txt");
         // return 1 to stop the execution as one crash is enough
@@ -1141,9 +1372,10 @@ int test_wrong_checksum_ending(char* extractor) {
 
     write_tar_file("test_wrong_checksum3.tar", &header);
 
-    if (extract(extractor, " test_wrong_checksum3.tar") == 1 ) {
+    if (extract(extractor, "test_wrong_checksum3.tar") == 1 ) {
         // The extractor has crashed
         rename("test_wrong_checksum3.tar", "success_wrong_checksum3.tar");
+        campaign_record_crash("success_wrong_checksum3.tar");
         // Delete the extracted file
         remove("file.txt");
         // return 1 to stop the execution as one crash is enough
@@ -1167,7 +1399,9 @@ int test_wrong_checksum_ending(char* extractor) {
 void test_checksum(char* extractor) {
 
     // 1. Test if a header with an incorrect (but octal) checksum value will make it crash
-    if (test_wrong_checksum_value(extractor)) {
+    if (!campaign_claim(SUITE_CHECKSUM, 0)) {
+        // Assigned to another shard
+    } else if (test_wrong_checksum_value(extractor)) {
         printf("\033[1;32m~~~~~It has crashed ! An incorrect (octal) checksum value has caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with an incorrect (octal) checksum value.~~~~~\033[0m\n\n");
@@ -1175,14 +1409,18 @@ void test_checksum(char* extractor) {
     }
 
     // 2. Test if a header with an incorrect (but non-octal) checksum value will make it crash
-    if (test_wrong_checksum_value_non_octal(extractor)) {
+    if (!campaign_claim(SUITE_CHECKSUM, 1)) {
+        // Assigned to another shard
+    } else if (test_wrong_checksum_value_non_octal(extractor)) {
         printf("\033[1;32m~~~~~It has crashed ! An incorrect (non-octal) checksum value has caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with an incorrect (non-octal) checksum value.~~~~~\033[0m\n\n");
     }
 
     // 3. Test if a header with an incorrect (octal) checksum value, not ended with '0x00 0x20' will make it crash
-    if (test_wrong_checksum_ending(extractor)) {
+    if (!campaign_claim(SUITE_CHECKSUM, 2)) {
+        // Assigned to another shard
+    } else if (test_wrong_checksum_ending(extractor)) {
         printf("\033[1;32m~~~~~It has crashed ! An incorrect (octal) checksum value not ended with '0x00 0x20' has caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with an incorrect (octal) checksum value not ended with '0x00 0x20'.~~~~~\033[0m\n\n");
@@ -1205,9 +1443,10 @@ int test_only_null_characters(char* extractor) {
 
     write_tar_file("test_all_null.tar", &header);
 
-    if (extract(extractor, " test_all_null.tar") == 1 ) {
+    if (extract(extractor, "test_all_null.tar") == 1 ) {
         // The extractor has crashed
         rename("test_all_null.tar", "success_all_null.tar");
+        campaign_record_crash("success_all_null.tar");
         // Delete the extracted file
         remove("");
         // return 1 to stop the execution as one crash is enough
@@ -1238,9 +1477,10 @@ int test_only_null_characters_with_data(char* extractor) {
 
     write_tar_file_with_data("test_all_null2.tar", &header, "aaaaaaaaaaaaaaaaaaaa", 20);
 
-    if (extract(extractor, " test_all_null2.tar") == 1 ) {
+    if (extract(extractor, "test_all_null2.tar") == 1 ) {
         // The extractor has crashed
         rename("test_all_null2.tar", "success_all_null2.tar");
+        campaign_record_crash("success_all_null2.tar");
         // Delete the extracted file
         remove("");
         // return 1 to stop the execution as one crash is enough
@@ -1258,14 +1498,18 @@ int test_only_null_characters_with_data(char* extractor) {
 void test_null_characters(char* extractor) {
 
     // 1. Test il all fields in the header with null characters will make it crash (without data)
-    if (test_only_null_characters(extractor)) {
+    if (!campaign_claim(SUITE_NULL, 0)) {
+        // Assigned to another shard
+    } else if (test_only_null_characters(extractor)) {
         printf("\033[1;32m~~~~~It has crashed ! A header full of empty fields has caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with a fully empty header.~~~~~\033[0m\n\n");
     }
 
     // 2. Test il all fields in the header with null characters will make it crash (without data)
-    if (test_only_null_characters_with_data(extractor)) {
+    if (!campaign_claim(SUITE_NULL, 1)) {
+        // Assigned to another shard
+    } else if (test_only_null_characters_with_data(extractor)) {
         printf("\033[1;32m~~~~~It has crashed ! A header (with data) full of empty fields has caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with a fully empty header (with data).~~~~~\033[0m\n\n");
@@ -1293,6 +1537,22 @@ int test_filesize(char* extractor, bool too_big, bool too_small, bool with_data,
 
     calculate_checksum(&header);
 
+    // Second member with a correct size, after the one with the wrong size
+    struct tar_t second_header;
+    generate_tar_header(&second_header, "file2.txt", "0000664", "0001750", "0001750", with_data ? "00000000024" : "00000000000",
+                        "14413537165", "0", "", "ustar", "00", "michal", "michal");
+    calculate_checksum(&second_header);
+
+    const char* data = "aaaaaaaaaaaaaaaaaaaa";
+    int data_len = with_data ? 20 : 0;
+
+    struct archive archive;
+    archive_init(&archive);
+    archive_add_member(&archive, &header, data, data_len, true);
+    if (multiple_files) {
+        archive_add_member(&archive, &second_header, data, data_len, true);
+    }
+
     char* archive_name;
 
     // File with data
@@ -1318,8 +1578,6 @@ int test_filesize(char* extractor, bool too_big, bool too_small, bool with_data,
                 archive_name = "test_size_small1.tar";
             }
         }
-        write_tar_file_with_data(archive_name, &header, "aaaaaaaaaaaaaaaaaaaa", 20);
-
     } else {
         // File without data
         printf(           "        > File without data.\n");
@@ -1342,33 +1600,15 @@ int test_filesize(char* extractor, bool too_big, bool too_small, bool with_data,
                 archive_name = "test_size_small2.tar";
             }
         }
-        write_tar_file(archive_name, &header);
     }
+    archive_write(&archive, archive_name);
 
-    char* space_name = malloc(strlen(archive_name) + 2);
-    strcpy(space_name, " ");
-    strcat(space_name, archive_name);
-
-
-    if (extract(extractor, space_name) == 1 ) {
+    if (extract(extractor, archive_name) == 1 ) {
         // The extractor has crashed
-        if (strcmp(archive_name, "test_size_big1.tar") == 0) {
-            rename("test_size_big1.tar", "success_size_big1.tar");
-        } else if (strcmp(archive_name, "test_size_small1.tar") == 0) {
-            rename("test_size_small1.tar", "success_size_small1.tar");
-        } else if (strcmp(archive_name, "test_size_big2.tar") == 0) {
-            rename("test_size_big2.tar", "success_size_big2.tar");
-        } else if (strcmp(archive_name, "test_size_small2.tar") == 0) {
-            rename("test_size_small2.tar", "success_size_small2.tar");
-        } else if (strcmp(archive_name, "test_size_big3.tar") == 0) {
-            rename("test_size_big3.tar", "success_size_big3.tar");
-        } else if (strcmp(archive_name, "test_size_small3.tar") == 0) {
-            rename("test_size_small3.tar", "success_size_small3.tar");
-        } else if (strcmp(archive_name, "test_size_big4.tar") == 0) {
-            rename("test_size_big4.tar", "success_size_big4.tar");
-        } else if (strcmp(archive_name, "test_size_small4.tar") == 0) {
-            rename("test_size_small4.tar", "success_size_small4.tar");
-        }
+        char success_name[32];
+        snprintf(success_name, sizeof(success_name), "success_%s", archive_name + strlen("test_"));
+        rename(archive_name, success_name);
+        campaign_record_crash(success_name);
 
         
         // Delete the extracted file(s)
@@ -1376,7 +1616,6 @@ int test_filesize(char* extractor, bool too_big, bool too_small, bool with_data,
         if (multiple_files) {
             remove ("file2.txt");
         }
-        free(space_name);
         return 1;
     } else {
         // Delete the extracted file(s)
@@ -1386,86 +1625,162 @@ int test_filesize(char* extractor, bool too_big, bool too_small, bool with_data,
         }
     }
 
-    if (strcmp(archive_name, "test_size_big1.tar") == 0) {
-        remove("test_size_big1.tar");
-    } else if (strcmp(archive_name, "test_size_big2.tar") == 0) {
-        remove("test_size_big2.tar");
-    } else if (strcmp(archive_name, "test_size_big3.tar") == 0) {
-        remove("test_size_big3.tar");
-    } else if (strcmp(archive_name, "test_size_big4.tar") == 0) {
-        remove("test_size_big4.tar");
-    } else if (strcmp(archive_name, "test_size_small1.tar") == 0) {
-        remove("test_size_small1.tar");
-    } else if (strcmp(archive_name, "test_size_small2.tar") == 0) {
-        remove("test_size_small2.tar");
-    } else if (strcmp(archive_name, "test_size_small3.tar") == 0) {
-        remove("test_size_small3.tar");
-    } else if (strcmp(archive_name, "test_size_small4.tar") == 0) {
-        remove("test_size_small4.tar");
-    }
+    remove(archive_name);
 
-    free(space_name);
     return 0;
 }
 
 
+/**
+ * Tests archives made of several correct members, with data sizes around the block size
+ * and with 0, 1 or 2 end-of-archive blocks
+ * Files with data
+ * Multiple files in archive
+ * @param extractor the extractor that will be used
+ * @return the number of test cases that made it crash
+ */
+int test_multiple_members(char* extractor) {
+    printf("Testing archives with several members.\n"
+           "        > Files with data (0, 1, 511, 512 and 513 bytes).\n"
+           "        > Multiple files in archive (2, 3 and 8).\n");
+
+    static const int member_counts[] = {2, 3, 8};
+    static const int data_sizes[] = {0, 1, 511, 512, 513};
+    static char data[513];
+    memset(data, 'a', sizeof(data));
+
+    struct tar_t headers[8];
+    char names[8][24];
+    int crashes = 0;
+    unsigned int index = 0;
+
+    for (int m = 0; m < 3; m++) {
+        for (int d = 0; d < 5; d++) {
+            for (int end_blocks = 0; end_blocks <= 2; end_blocks++, index++) {
+                if (!campaign_claim(SUITE_MEMBERS, index)) {
+                    continue;
+                }
+
+                char size[12];
+                snprintf(size, sizeof(size), "%011o", data_sizes[d]);
+
+                struct archive archive;
+                archive_init(&archive);
+                for (int i = 0; i < member_counts[m]; i++) {
+                    snprintf(names[i], sizeof(names[i]), "file%d.txt", i + 1);
+                    generate_tar_header(&headers[i], names[i], "0000664", "0001750", "0001750", size,
+                                        "14413537165", "0", "", "ustar", "00", "michal", "michal");
+                    calculate_checksum(&headers[i]);
+                    archive_add_member(&archive, &headers[i], data, data_sizes[d], true);
+                }
+                archive_end(&archive, end_blocks);
+                archive_write(&archive, "test_members.tar");
+
+                if (extract(extractor, "test_members.tar") == 1 ) {
+                    // The extractor has crashed, keep the archive and go on with the other shapes
+                    char success_name[32];
+                    snprintf(success_name, sizeof(success_name), "success_members_%u.tar", index);
+                    rename("test_members.tar", success_name);
+                    campaign_record_crash(success_name);
+                    crashes++;
+                }
+
+                // Delete the extracted files
+                for (int i = 0; i < member_counts[m]; i++) {
+                    remove(names[i]);
+                }
+            }
+        }
+    }
+
+    remove("test_members.tar");
+    return crashes;
+}
+
+
 void test_wrong_filesize(char* extractor) {
 
     // 1. Test filesize value too big, without data, single file in archive
-    if (test_filesize(extractor, true, false, false, false)) {
+    if (!campaign_claim(SUITE_FILESIZE, 0)) {
+        // Assigned to another shard
+    } else if (test_filesize(extractor, true, false, false, false)) {
         printf("\033[1;32m~~~~~It has crashed ! A too big filesize value caused a crash (no data, single file).~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with filesize value.~~~~~\033[0m\n\n");
     }
 
     // 2. Test filesize value too small, without data, single file in archive
-    if (test_filesize(extractor, false, true, false, false)) {
+    if (!campaign_claim(SUITE_FILESIZE, 1)) {
+        // Assigned to another shard
+    } else if (test_filesize(extractor, false, true, false, false)) {
         printf("\033[1;32m~~~~~It has crashed ! A too small filesize value caused a crash (no data, single file).~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with filesize value.~~~~~\033[0m\n\n");
     }
 
     // 3. Test filesize value too big, with data, single file in archive
-    if (test_filesize(extractor, true, false, true, false)) {
+    if (!campaign_claim(SUITE_FILESIZE, 2)) {
+        // Assigned to another shard
+    } else if (test_filesize(extractor, true, false, true, false)) {
         printf("\033[1;32m~~~~~It has crashed ! A too big filesize value caused a crash (with data, single file).~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with filesize value.~~~~~\033[0m\n\n");
     }
 
     // 4. Test filesize value too big, with data, single file in archive
-    if (test_filesize(extractor, false, true, true, false)) {
+    if (!campaign_claim(SUITE_FILESIZE, 3)) {
+        // Assigned to another shard
+    } else if (test_filesize(extractor, false, true, true, false)) {
         printf("\033[1;32m~~~~~It has crashed ! A too small filesize value caused a crash (with data, single file).~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with filesize value.~~~~~\033[0m\n\n");
     }
 
     // 5. Test filesize value too big, without data, multiple files in archive
-    if (test_filesize(extractor, true, false, false, true)) {
+    if (!campaign_claim(SUITE_FILESIZE, 4)) {
+        // Assigned to another shard
+    } else if (test_filesize(extractor, true, false, false, true)) {
         printf("\033[1;32m~~~~~It has crashed ! A too big filesize value caused a crash (no data, multiple files).~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with filesize value.~~~~~\033[0m\n\n");
     }
 
     // 6. Test filesize value too small, without data, multiple files in archive
-    if (test_filesize(extractor, false, true, false, true)) {
+    if (!campaign_claim(SUITE_FILESIZE, 5)) {
+        // Assigned to another shard
+    } else if (test_filesize(extractor, false, true, false, true)) {
         printf("\033[1;32m~~~~~It has crashed ! A too small filesize value caused a crash (no data, multiple files).~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with filesize value.~~~~~\033[0m\n\n");
     }
 
     // 7. Test filesize value too big, with data, multiple files in archive
-    if (test_filesize(extractor, true, false, true, true)) {
+    if (!campaign_claim(SUITE_FILESIZE, 6)) {
+        // Assigned to another shard
+    } else if (test_filesize(extractor, true, false, true, true)) {
         printf("\033[1;32m~~~~~It has crashed ! A too big filesize value caused a crash (with data, multiple files).~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with filesize value.~~~~~\033[0m\n\n");
     }
 
     // 8. Test filesize value too big, with data, multiple files in archive
-    if (test_filesize(extractor, false, true, true, true)) {
+    if (!campaign_claim(SUITE_FILESIZE, 7)) {
+        // Assigned to another shard
+    } else if (test_filesize(extractor, false, true, true, true)) {
         printf("\033[1;32m~~~~~It has crashed ! A too small filesize value caused a crash (with data, multiple files).~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with filesize value.~~~~~\033[0m\n\n");
     }
+
+    // 9. Test correct archives with several members, around the block size
+    int crashes;
+    if (!scheduler_step(test_multiple_members, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
+        printf("\033[1;32m~~~~~It has crashed ! %d archives with several members caused a crash.~~~~~\033[0m\n\n", crashes);
+    } else {
+        printf("\033[1;31m~~~~~No issues found with several members.~~~~~\033[0m\n\n");
+    }
 }
 
 int test_value_uid(char* extractor, char* uid_value) {
@@ -1483,9 +1798,10 @@ struct tar_t header;
         
         write_tar_file("test_uid_value.tar", &header);
 
-        if (extract(extractor, " test_uid_value.tar") == 1 ) {
+        if (extract(extractor, "test_uid_value.tar") == 1 ) {
             // The extractor has crashed
             rename("test_uid_value.tar", "success_uid_value.tar");
+            campaign_record_crash("success_uid_value.tar");
             // Delete the extracted file
             remove("file.txt");
             return 1;
@@ -1513,9 +1829,10 @@ int test_value_gid(char* extractor, char* gid_value) {
 
     write_tar_file("test_gid_value.tar", &header);
 
-    if (extract(extractor, " test_gid_value.tar") == 1 ) {
+    if (extract(extractor, "test_gid_value.tar") == 1 ) {
         // The extractor has crashed
         rename("test_gid_value.tar", "success_gid_value.tar");
+        campaign_record_crash("success_gid_value.tar");
         // Delete the extracted file
         remove("file.txt");
         return 1;
@@ -1542,9 +1859,10 @@ int test_value_mtime(char* extractor, char* mtime_value) {
 
     write_tar_file("test_mtime_value.tar", &header);
 
-    if (extract(extractor, " test_mtime_value.tar") == 1 ) {
+    if (extract(extractor, "test_mtime_value.tar") == 1 ) {
         // The extractor has crashed
         rename("test_mtime_value.tar", "success_mtime_value.tar");
+        campaign_record_crash("success_mtime_value.tar");
         // Delete the extracted file
         remove("file.txt");
         return 1;
@@ -1557,74 +1875,1166 @@ int test_value_mtime(char* extractor, char* mtime_value) {
 }
 
 
+/**
+ * Tests every numeric field with boundary values (0, max, max+1, negative, off_t and time_t limits),
+ * encoded in octal with and without terminator and in GNU base-256. The checksum is always correct.
+ * File without data
+ * Single file in archive
+ * @param extractor the extractor that will be used
+ * @return the number of test cases that made it crash
+ */
+int test_octal_boundaries(char* extractor) {
+    printf("Testing the numeric fields with boundary values in octal and base-256 encodings.\n"
+           "        > File without data.\n"
+           "        > Single file in archive.\n");
+
+    struct tar_t header;
+    int crashes = 0;
+
+    for (unsigned int i = campaign_progress(SUITE_OCTAL); i < numeric_case_count(); i++) {
+        // Some values do not fit in some fields with some encodings
+        if (numeric_build_case(i, &header) == -1 || !campaign_claim(SUITE_OCTAL, i)) {
+            continue;
+        }
+
+        write_tar_file("test_octal.tar", &header);
+
+        if (extract(extractor, "test_octal.tar") == 1 ) {
+            // The extractor has crashed, keep the archive and look for other values
+            char description[64];
+            char success_name[32];
+            numeric_describe_case(i, description, sizeof(description));
+            snprintf(success_name, sizeof(success_name), "success_octal_%u.tar", i);
+            printf("        > Crash with %s\n", description);
+            rename("test_octal.tar", success_name);
+            campaign_record_crash(success_name);
+            crashes++;
+        }
+        // Delete the extracted file
+        remove("file.txt");
+    }
+
+    remove("test_octal.tar");
+    return crashes;
+}
+
+
 void test_numerical_fields(char* extractor) {
 
     // 1. Test too big value for uid
-    if (test_value_uid(extractor, "7777777")) {
+    if (!campaign_claim(SUITE_NUMERIC, 0)) {
+        // Assigned to another shard
+    } else if (test_value_uid(extractor, "7777777")) {
         printf("\033[1;32m~~~~~It has crashed ! A too big uid value caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with a too big uid value.~~~~~\033[0m\n\n");
     }
 
     // 2. Test too big value for gid
-    if (test_value_uid(extractor, "7777777")) {
-        printf("\033[1;32m~~~~~It has crashed ! A too big uid value caused a crash.~~~~~\033[0m\n\n");
+    if (!campaign_claim(SUITE_NUMERIC, 1)) {
+        // Assigned to another shard
+    } else if (test_value_gid(extractor, "7777777")) {
+        printf("\033[1;32m~~~~~It has crashed ! A too big gid value caused a crash.~~~~~\033[0m\n\n");
     } else {
-        printf("\033[1;31m~~~~~No issues found with a too big uid value.~~~~~\033[0m\n\n");
+        printf("\033[1;31m~~~~~No issues found with a too big gid value.~~~~~\033[0m\n\n");
     }
     
     // 3. Test too big value for mtime
-    if (test_value_mtime(extractor, "77777777777")) {
+    if (!campaign_claim(SUITE_NUMERIC, 2)) {
+        // Assigned to another shard
+    } else if (test_value_mtime(extractor, "77777777777")) {
         printf("\033[1;32m~~~~~It has crashed ! A too big mtime value caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with a too big mtime value.~~~~~\033[0m\n\n");
     }
     
     // 4. Test negative value for uid
-    if (test_value_gid(extractor, "1777400")) {
-        printf("\033[1;32m~~~~~It has crashed ! A negative gid value caused a crash.~~~~~\033[0m\n\n");
+    if (!campaign_claim(SUITE_NUMERIC, 3)) {
+        // Assigned to another shard
+    } else if (test_value_uid(extractor, "1777400")) {
+        printf("\033[1;32m~~~~~It has crashed ! A negative uid value caused a crash.~~~~~\033[0m\n\n");
     } else {
-        printf("\033[1;31m~~~~~No issues found with a negative gid value.~~~~~\033[0m\n\n");
+        printf("\033[1;31m~~~~~No issues found with a negative uid value.~~~~~\033[0m\n\n");
     }
 
     // 5. Test negative value for gid
-    if (test_value_gid(extractor, "1777400")) {
+    if (!campaign_claim(SUITE_NUMERIC, 4)) {
+        // Assigned to another shard
+    } else if (test_value_gid(extractor, "1777400")) {
         printf("\033[1;32m~~~~~It has crashed ! A negative gid value caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with a negative gid value.~~~~~\033[0m\n\n");
     }
     
     // 6. Test negative value for mtime
-    if (test_value_mtime(extractor, "11111777400")) {
+    if (!campaign_claim(SUITE_NUMERIC, 5)) {
+        // Assigned to another shard
+    } else if (test_value_mtime(extractor, "11111777400")) {
         printf("\033[1;32m~~~~~It has crashed ! A negative mtime value caused a crash.~~~~~\033[0m\n\n");
     } else {
         printf("\033[1;31m~~~~~No issues found with a negative mtime value.~~~~~\033[0m\n\n");
     }
+
+    // 7. Test the boundary values of every numeric field, in octal and base-256
+    int crashes;
+    if (!scheduler_step(test_octal_boundaries, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
+        printf("\033[1;32m~~~~~It has crashed ! %d boundary values of numeric fields caused a crash.~~~~~\033[0m\n\n", crashes);
+    } else {
+        printf("\033[1;31m~~~~~No issues found with the boundary values of numeric fields.~~~~~\033[0m\n\n");
+    }
 }
 
 
-int main(__attribute__((unused)) int argc, char* argv[]) {
+/**
+ * Tests archives whose members are a graph of filesystem objects: directories, symbolic and hard links,
+ * FIFOs and devices pointing at each other, traversal through "..", the prefix and symlinks.
+ * Each archive is extracted in a nested sandbox that is emptied before the next one.
+ * Files with data
+ * Multiple files in archive
+ * @param extractor the extractor that will be used
+ * @return the number of test cases that made it crash
+ */
+int test_filesystem_graph(char* extractor) {
+    printf("Testing archives with links, directories, FIFOs and devices pointing at each other.\n"
+           "        > Files with data.\n"
+           "        > Multiple files in archive (1 to %d).\n", FSGRAPH_MAX_MEMBERS);
 
-    // Test all fields in the header to see if they accept the whole range of characters from 0x00 to 0xFF (one file, no data)
-    test_fields_for_all_characters(argv[1]);
+    static struct fsgraph graph;
+    int crashes = 0;
 
-    // Test different possibilities of crashes that could be caused by the checksum field
-    test_checksum(argv[1]);
+    for (unsigned int i = 0; i < fsgraph_case_count(); i++) {
+        if (!campaign_claim(SUITE_GRAPH, i)) {
+            continue;
+        }
 
-    // Test all fields if they can work when composed of only null characters
-    test_null_characters(argv[1]);
+        struct prng prng;
+        prng_seed_case(&prng, campaign_case_id());
+        fsgraph_build_case(i, &prng, &graph);
+        archive_write(&graph.archive, "test_graph.tar");
+
+        if (fsgraph_reset_sandbox() == -1) {
+            perror(FSGRAPH_SANDBOX);
+            break;
+        }
+
+        if (extract_in_directory(extractor, FSGRAPH_ROOT, "test_graph.tar", false) == 1) {
+            // The extractor has crashed, keep the archive and look for other graphs
+            char description[64];
+            char success_name[32];
+            fsgraph_describe_case(i, description, sizeof(description));
+            snprintf(success_name, sizeof(success_name), "success_graph_%u.tar", i);
+            printf("        > Crash with %s\n", description);
+            rename("test_graph.tar", success_name);
+            campaign_record_crash(success_name);
+            crashes++;
+        }
+    }
+
+    // Delete the extracted files, wherever they went
+    scratch_clean(FSGRAPH_SANDBOX);
+    rmdir(FSGRAPH_SANDBOX);
+    remove("test_graph.tar");
+    return crashes;
+}
+
+
+void test_filesystem_objects(char* extractor) {
+
+    // 1. Test graphs of links, directories, FIFOs and devices
+    int crashes;
+    if (!scheduler_step(test_filesystem_graph, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
+        printf("\033[1;32m~~~~~It has crashed ! %d graphs of filesystem objects caused a crash.~~~~~\033[0m\n\n", crashes);
+    } else {
+        printf("\033[1;31m~~~~~No issues found with graphs of filesystem objects.~~~~~\033[0m\n\n");
+    }
+}
+
+
+/**
+ * Tests the GNU long names and long link names, the pax extended headers and the GNU sparse files,
+ * with mutated sizes, record lengths and sparse maps. Each archive is extracted in its own directory.
+ * Files with data
+ * Multiple files in archive
+ * @param extractor the extractor that will be used
+ * @return the number of test cases that made it crash
+ */
+int test_extension_headers(char* extractor) {
+    printf("Testing GNU long names, pax extended headers and sparse files with wrong lengths.\n"
+           "        > Files with data.\n"
+           "        > Multiple files in archive.\n");
+
+    static struct extension_case ext;
+    int crashes = 0;
+
+    for (unsigned int i = 0; i < extension_case_count(); i++) {
+        if (!campaign_claim(SUITE_EXTENSION, i)) {
+            continue;
+        }
+
+        extension_build_case(i, &ext);
+        archive_write(&ext.archive, "test_extension.tar");
+
+        // Long names create directories, start from an empty one
+        if (scratch_clean(EXTENSION_DIRECTORY) == -1 || scratch_mkdirs(EXTENSION_DIRECTORY) == -1) {
+            perror(EXTENSION_DIRECTORY);
+            break;
+        }
+
+        if (extract_in_directory(extractor, EXTENSION_DIRECTORY, "test_extension.tar", false) == 1) {
+            // The extractor has crashed, keep the archive and look for other lengths
+            char description[128];
+            char success_name[40];
+            extension_describe_case(i, description, sizeof(description));
+            snprintf(success_name, sizeof(success_name), "success_extension_%u.tar", i);
+            printf("        > Crash with %s\n", description);
+            rename("test_extension.tar", success_name);
+            campaign_record_crash(success_name);
+            crashes++;
+        }
+    }
+
+    // Delete the extracted files
+    scratch_clean(EXTENSION_DIRECTORY);
+    rmdir(EXTENSION_DIRECTORY);
+    remove("test_extension.tar");
+    return crashes;
+}
+
+
+void test_extensions(char* extractor) {
+
+    // 1. Test GNU long names, pax extended headers and sparse files
+    int crashes;
+    if (!scheduler_step(test_extension_headers, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
+        printf("\033[1;32m~~~~~It has crashed ! %d GNU or pax extension headers caused a crash.~~~~~\033[0m\n\n", crashes);
+    } else {
+        printf("\033[1;31m~~~~~No issues found with GNU and pax extension headers.~~~~~\033[0m\n\n");
+    }
+}
+
+
+/**
+ * Tests archives cut or extended at offsets chosen mostly on block boundaries: data without padding,
+ * members misaligned with their size, end-of-archive blocks dropped, duplicated or in the middle, partial headers
+ * Files with data
+ * Single and multiple files in archive
+ * @param extractor the extractor that will be used
+ * @return the number of test cases that made it crash
+ */
+int test_truncated_archives(char* extractor) {
+    printf("Testing archives cut, extended, without padding or with misplaced end blocks.\n"
+           "        > Files with data.\n"
+           "        > Single and multiple files in archive.\n");
+
+    static struct mutation_case mutation;
+    int crashes = 0;
+
+    for (unsigned int i = 0; i < mutate_case_count(); i++) {
+        if (!campaign_claim(SUITE_TRUNCATION, i)) {
+            continue;
+        }
+
+        struct prng prng;
+        prng_seed_case(&prng, campaign_case_id());
+        mutate_build_case(i, &prng, &mutation);
+        archive_write(&mutation.archive, "test_truncation.tar");
 
+        if (scratch_clean(TRUNCATION_DIRECTORY) == -1 || scratch_mkdirs(TRUNCATION_DIRECTORY) == -1) {
+            perror(TRUNCATION_DIRECTORY);
+            break;
+        }
+
+        if (extract_in_directory(extractor, TRUNCATION_DIRECTORY, "test_truncation.tar", false) == 1) {
+            // The extractor has crashed, keep the archive and look for other mutations
+            char success_name[40];
+            snprintf(success_name, sizeof(success_name), "success_truncation_%u.tar", i);
+            printf("        > Crash with %s\n", mutation.description);
+            rename("test_truncation.tar", success_name);
+            campaign_record_crash(success_name);
+            crashes++;
+        }
+    }
+
+    // Delete the extracted files
+    scratch_clean(TRUNCATION_DIRECTORY);
+    rmdir(TRUNCATION_DIRECTORY);
+    remove("test_truncation.tar");
+    return crashes;
+}
+
+
+void test_padding(char* extractor) {
+
+    // 1. Test data without padding, cut or extended archives, misplaced end blocks
+    int crashes;
+    if (!scheduler_step(test_truncated_archives, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
+        printf("\033[1;32m~~~~~It has crashed ! %d cut or misaligned archives caused a crash.~~~~~\033[0m\n\n", crashes);
+    } else {
+        printf("\033[1;31m~~~~~No issues found with cut or misaligned archives.~~~~~\033[0m\n\n");
+    }
+}
+
+
+// Test cases of the corpus suite, more with a time budget
+static unsigned int corpus_cases = CORPUS_CASES;
+
+
+/**
+ * Tests mutations of archives of the packed corpus, picked at random and read in place from its mapping: header
+ * fields overwritten with the checksum fixed or not, blocks of other archives inserted, ranges inserted or removed,
+ * cuts. The corpus is mapped as it is when the strategy starts (or a slice of it), with the archives found so far
+ * by every worker, those of its own mutations included.
+ * Files with and without data
+ * Single and multiple files in archive
+ * @param extractor the extractor that will be used
+ * @return the number of test cases that made it crash
+ */
+int test_corpus_archives(char* extractor) {
+    printf("Testing mutations of the archives of the corpus.\n"
+           "        > Header fields, blocks of other archives, inserted and removed ranges, cuts.\n"
+           "        > Archives with a new behaviour found so far by every worker.\n");
+
+    static struct mutation_case mutation;
+    struct corpus corpus = {0};
+    bool mapped = false;
+    int crashes = 0;
+
+    for (unsigned int i = 0; i < corpus_cases; i++) {
+        if (!campaign_claim(SUITE_CORPUS, i)) {
+            continue;
+        }
+        // Mapped by the first test case claimed, a slice that claims none does not map it
+        if (!mapped) {
+            if (corpus_map(&corpus, corpus_path()) == -1) {
+                return crashes;
+            }
+            mapped = true;
+        }
+        if (corpus.count == 0) {
+            break;
+        }
+
+        struct prng prng;
+        prng_seed_case(&prng, campaign_case_id());
+        corpus_build_case(&corpus, &prng, &mutation);
+        archive_write(&mutation.archive, "test_corpus.tar");
+
+        // The corpus has the graphs of filesystem objects: the same sandbox, for what goes through ".."
+        if (fsgraph_reset_sandbox() == -1) {
+            perror(FSGRAPH_SANDBOX);
+            break;
+        }
+
+        if (extract_in_directory(extractor, FSGRAPH_ROOT, "test_corpus.tar", false) == 1) {
+            // The extractor has crashed, keep the archive and look for other mutations
+            char success_name[40];
+            snprintf(success_name, sizeof(success_name), "success_corpus_%u.tar", i);
+            printf("        > Crash with %s\n", mutation.description);
+            rename("test_corpus.tar", success_name);
+            campaign_record_crash(success_name);
+            crashes++;
+        }
+    }
+
+    // Delete the extracted files, wherever they went
+    if (mapped) {
+        corpus_unmap(&corpus);
+    }
+    scratch_clean(FSGRAPH_SANDBOX);
+    rmdir(FSGRAPH_SANDBOX);
+    remove("test_corpus.tar");
+    return crashes;
+}
+
+
+void test_corpus(char* extractor) {
+
+    // 1. Test mutations of the archives that showed a new behaviour
+    int crashes;
+    if (!scheduler_step(test_corpus_archives, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
+        printf("\033[1;32m~~~~~It has crashed ! %d mutations of the corpus caused a crash.~~~~~\033[0m\n\n", crashes);
+    } else {
+        printf("\033[1;31m~~~~~No issues found with mutations of the corpus.~~~~~\033[0m\n\n");
+    }
+}
+
+
+/**
+ * Counts the calls of the extractor on a hand-written graph, or takes the counts of an earlier slice or run
+ * @param graph the graph, built
+ * @param counts_path where the injector writes the counts, absolute
+ * @return 0 on success, -1 if they cannot be counted
+ */
+static int count_fault_calls(char* extractor, unsigned int shape, const struct fsgraph* graph, const char* counts_path,
+                             unsigned long counts[FAULT_FUNCTION_COUNT]) {
+    if (fault_known_counts(shape, counts) == 0) {
+        return 0;
+    }
+    // Without any fault: not a test case
+    struct execution execution;
+    setenv(FAULT_COUNTS_VARIABLE, counts_path, 1);
+    int counted = archive_write_unrecorded(&graph->archive, "test_fault.tar") == 0 && fsgraph_reset_sandbox() == 0 &&
+                  executor_run(extractor, FSGRAPH_ROOT, "test_fault.tar", false, &execution) == 0 &&
+                  fault_read_counts(counts_path, counts) == 0;
+    unsetenv(FAULT_COUNTS_VARIABLE);
+    remove(counts_path);
+    if (!counted) {
+        return -1;
+    }
+    fault_keep_counts(shape, counts);
+    return 0;
+}
+
+
+/**
+ * Extracts a graph with a fault schedule, the claimed test case
+ * @param description what fails, for the crash message
+ * @return true if the extractor crashed
+ */
+static bool run_fault_case(char* extractor, const struct fsgraph* graph, unsigned int index, const char* schedule,
+                           const char* description) {
+    archive_write(&graph->archive, "test_fault.tar");
+    if (fsgraph_reset_sandbox() == -1) {
+        perror(FSGRAPH_SANDBOX);
+        return false;
+    }
+
+    setenv(FAULT_SCHEDULE_VARIABLE, schedule, 1);
+    // The errors the extractor prints are those of the schedule, not of a limit
+    bool crashed = extract_in_directory(extractor, FSGRAPH_ROOT, "test_fault.tar", true) == 1;
+    unsetenv(FAULT_SCHEDULE_VARIABLE);
+    if (crashed) {
+        // The archive is not enough to reproduce it: keep the schedule next to it
+        char success_name[40];
+        snprintf(success_name, sizeof(success_name), "success_fault_%u.tar", index);
+        printf("        > Crash when %s (%s=%s)\n", description, FAULT_SCHEDULE_VARIABLE, schedule);
+        rename("test_fault.tar", success_name);
+        fault_save_schedule(success_name, schedule);
+        campaign_record_crash(success_name);
+    }
+    return crashed;
+}
+
+
+/**
+ * Makes the calls of the extractor fail one by one (open(), read(), malloc(), mkdir(), symlink()...) while it extracts
+ * the hand-written graphs of filesystem objects, then several at once, see faults.h. Each graph is extracted once
+ * first, to count the calls, and its counts are kept for the next slices and --resume.
+ * Files with data
+ * Multiple files in archive
+ * @param extractor the extractor that will be used
+ * @return the number of test cases that made it crash
+ */
+int test_fault_injection(char* extractor) {
+    printf("Testing the error paths: each call of open(), read(), malloc(), mkdir(), symlink()... fails in turn,\n"
+           "then several of them at once.\n"
+           "        > Files with data.\n"
+           "        > Multiple files in archive (1 to %d).\n", FSGRAPH_MAX_MEMBERS);
+
+    // The extractor runs in the sandbox: an absolute path
+    char counts_path[PATH_MAX];
+    if (getcwd(counts_path, sizeof(counts_path) - sizeof("/fault_counts")) == NULL) {
+        perror("getcwd");
+        return 0;
+    }
+    strcat(counts_path, "/fault_counts");
+
+    static struct fsgraph graph;
+    int crashes = 0;
+
+    for (unsigned int shape = 0; shape < fsgraph_shape_count(); shape++) {
+        // Finished in an earlier slice or run: the graph is not built again, the mutations only need its counts
+        unsigned long counts[FAULT_FUNCTION_COUNT];
+        if (fault_encode(shape + 1, 0, 1, 0) <= campaign_progress(SUITE_FAULT) &&
+            fault_known_counts(shape, counts) == 0) {
+            continue;
+        }
+
+        // The hand-written graphs do not use the generator
+        struct prng prng;
+        prng_seed_case(&prng, shape);
+        fsgraph_build_case(shape, &prng, &graph);
+
+        if (count_fault_calls(extractor, shape, &graph, counts_path, counts) == -1) {
+            continue;
+        }
+
+        for (unsigned int function = 0; function < FAULT_FUNCTION_COUNT; function++) {
+            for (unsigned int call = 1; call <= counts[function] && call <= FAULT_MAX_CALLS; call++) {
+                for (unsigned int error = 0; error < FAULT_MAX_ERRORS; error++) {
+                    unsigned int index = fault_encode(shape, function, call, error);
+                    unsigned int decoded_shape, decoded_function, decoded_call;
+                    int errno_value;
+                    fault_decode(index, &decoded_shape, &decoded_function, &decoded_call, &errno_value);
+                    // Fewer errnos for this function
+                    if (errno_value == 0 || !campaign_claim(SUITE_FAULT, index)) {
+                        continue;
+                    }
+
+                    char schedule[FAULT_SCHEDULE_SIZE];
+                    char description[160];
+                    fault_schedule(index, schedule, sizeof(schedule));
+                    fault_describe(index, description, sizeof(description));
+                    crashes += run_fault_case(extractor, &graph, index, schedule, description);
+                }
+            }
+        }
+    }
+
+    // Several faults at once, the error paths that only run after another one
+    for (unsigned int index = fault_mutation_start(); index < fault_case_count(); index++) {
+        if (!campaign_claim(SUITE_FAULT, index)) {
+            continue;
+        }
+        struct prng prng;
+        prng_seed_case(&prng, campaign_case_id());
+        unsigned int shape;
+        char schedule[FAULT_SCHEDULE_SIZE];
+        if (fault_mutate_schedule(index, &prng, &shape, schedule, sizeof(schedule)) == -1) {
+            continue;
+        }
+        struct prng graph_prng;
+        prng_seed_case(&graph_prng, shape);
+        fsgraph_build_case(shape, &graph_prng, &graph);
+
+        char description[160];
+        char graph_description[64];
+        fsgraph_describe_case(shape, graph_description, sizeof(graph_description));
+        snprintf(description, sizeof(description), "these calls fail together, %s", graph_description);
+        crashes += run_fault_case(extractor, &graph, index, schedule, description);
+    }
+
+    // Delete the extracted files, wherever they went
+    scratch_clean(FSGRAPH_SANDBOX);
+    rmdir(FSGRAPH_SANDBOX);
+    remove("test_fault.tar");
+    return crashes;
+}
+
+
+void test_error_paths(char* extractor) {
+
+    // 1. Test every call of the functions that can fail, with the errnos they can fail with
+    int crashes;
+    if (!scheduler_step(test_fault_injection, extractor, &crashes)) {
+        // Finished in an earlier slice, or goes on in the next one
+    } else if (crashes) {
+        printf("\033[1;32m~~~~~It has crashed ! %d injected faults caused a crash.~~~~~\033[0m\n\n", crashes);
+    } else {
+        printf("\033[1;31m~~~~~No issues found with injected faults.~~~~~\033[0m\n\n");
+    }
+}
+
+
+// The strategies of the campaign, in the order they run without the scheduler
+static const struct {
+    const char* name;
+    void (*run)(char* extractor);
+} strategies[] = {
+    // Test all fields in the header to see if they accept the whole range of characters from 0x00 to 0xFF (one file, no data)
+    {"sweeps", test_fields_for_all_characters},
+    // Test every byte of the header with all characters (with --header-sweep)
+    {"header", test_header},
+    // Test different possibilities of crashes that could be caused by the checksum field
+    {"checksum", test_checksum},
+    // Test all fields if they can work when composed of only null characters
+    {"null", test_null_characters},
     // Test conducted on filesize (with and without data)
-    test_wrong_filesize(argv[1]);
+    {"filesize", test_wrong_filesize},
+    // Test too high values and boundary values for numerical fields
+    {"numeric", test_numerical_fields},
+    // Test links, directories, FIFOs and devices, and paths leaving the extraction directory
+    {"objects", test_filesystem_objects},
+    // Test the GNU and pax extensions, made of length-prefixed fields
+    {"extensions", test_extensions},
+    // Test data without padding (e.g. header + non-padded data + header + data), cut archives and end blocks
+    {"padding", test_padding},
+    // Mutate the archives with a new behaviour, from the packed corpus (with --syscall-feedback or --fingerprint)
+    {"corpus", test_corpus},
+    // Test the error paths of the extractor, with the calls to libc failing one by one (with --fault-injection)
+    {"faults", test_error_paths},
+};
+#define STRATEGY_COUNT (sizeof(strategies) / sizeof(strategies[0]))
+
+
+/**
+ * @return whether a strategy can run: the faults need the fault injector, the corpus mutations a corpus, and the
+ *         header sweep has to be asked for
+ */
+static bool strategy_enabled(size_t s) {
+    if (strategies[s].run == test_error_paths) {
+        return fault_library() != NULL;
+    }
+    if (strategies[s].run == test_corpus) {
+        return corpus_path() != NULL;
+    }
+    if (strategies[s].run == test_header) {
+        return sweep_enabled();
+    }
+    return true;
+}
+
+
+/**
+ * Runs every test suite for one shard of the campaign
+ * @param extractor the extractor that will be used
+ * @param out_dir the shared output directory, or NULL to work in the current directory
+ * @param shard_index index of the shard handled by this process
+ * @param shard_count total number of shards
+ * @param worker_index index of this process among the local workers of the shard
+ * @param worker_count number of local workers, their output goes to a log file in their working directory
+ * @param resume continue from the checkpoint of the working directory
+ * @param checkpoint_interval seconds between two checkpoints
+ * @param seed seed of the campaign
+ * @param replay_log record every executed archive in the replay log of the working directory
+ * @param syscall_feedback trace the system calls of the extractor and keep the archives with a new behaviour
+ * @param budget seconds given to the adaptive scheduler (0 for no limit), negative to run the strategies in order
+ * @return 0 on success, 1 if the campaign could not be started
+ */
+int run_campaign(char* extractor, const char* out_dir, unsigned int shard_index, unsigned int shard_count,
+                 unsigned int worker_index, unsigned int worker_count, bool resume, unsigned int checkpoint_interval,
+                 uint64_t seed, bool replay_log, bool syscall_feedback, double budget) {
+    // The random test cases are derived from the seed of the campaign
+    prng_setup(seed);
+    if (replay_log) {
+        replay_enable();
+    }
+    resource_enable();
+    if (syscall_feedback) {
+        if (executor_enable_trace() == -1) {
+            return 1;
+        }
+        systrace_enable();
+    }
 
-    // Test too high values for numerical fields
-    test_numerical_fields(argv[1]);
+    // The state of the scheduler is restored with the checkpoint
+    if (budget >= 0) {
+        scheduler_enable();
+    }
+    if (campaign_open(out_dir, shard_index, shard_count, worker_index, worker_count, resume, checkpoint_interval) == -1) {
+        return 1;
+    }
+    if (replay_open(resume) == -1) {
+        return 1;
+    }
+    // One store for the whole output directory, next to the working directories of the shards
+    if (store_open(out_dir != NULL ? "../" STORE_DIRECTORY : STORE_DIRECTORY, (shard_index << 16) | worker_index) == -1) {
+        return 1;
+    }
+    // The same for the corpus, when something can be added to it
+    corpus_cases = budget > 0 ? CORPUS_BUDGET_CASES : CORPUS_CASES;
+    if ((syscall_feedback || behaviour_enabled()) &&
+        corpus_open(out_dir != NULL ? "../" CORPUS_DIRECTORY : CORPUS_DIRECTORY, (shard_index << 16) | worker_index) == -1) {
+        return 1;
+    }
 
-    // TODO : test if data can be non-padded
+    // Several workers share the terminal, keep their output apart
+    if (worker_count > 1 && freopen("fuzzer.log", resume ? "a" : "w", stdout) == NULL) {
+        perror("fuzzer.log");
+        return 1;
+    }
 
-    // TODO : check if a header + non-padded data + header + data will work
+    // The crashes are confirmed apart, while the campaign goes on
+    if (confirm_start(extractor) == -1) {
+        return 1;
+    }
+
+    // The fingerprints need the extracted trees apart from the files of the campaign
+    bool elsewhere = behaviour_enabled() || differential_enabled();
+    if (elsewhere && (scratch_clean(EXTRACT_DIRECTORY) == -1 || scratch_mkdirs(EXTRACT_DIRECTORY) == -1)) {
+        perror(EXTRACT_DIRECTORY);
+        return 1;
+    }
+
+    bool finished = true;
+    if (budget < 0) {
+        for (size_t s = 0; s < STRATEGY_COUNT; s++) {
+            if (strategy_enabled(s)) {
+                strategies[s].run(extractor);
+            }
+        }
+    } else {
+        for (size_t s = 0; s < STRATEGY_COUNT; s++) {
+            if (strategy_enabled(s)) {
+                scheduler_add(strategies[s].name, strategies[s].run);
+            }
+        }
+        if (scheduler_run(extractor, budget) > 0) {
+            printf("Budget spent, the campaign can be continued with --resume.\n");
+            finished = false;
+        }
+    }
 
     // TODO : test all fields if they can end without the null character
 
+    confirm_finish();
+
+    if (behaviour_enabled()) {
+        printf("%lu behaviour classes\n", behaviour_count());
+    }
+    if (dedup_enabled()) {
+        printf("%lu executions skipped, the same archive had already been run (%lu archives in the filter)\n",
+               dedup_skipped(), dedup_count());
+    }
+    if (elsewhere) {
+        scratch_clean(EXTRACT_DIRECTORY);
+        rmdir(EXTRACT_DIRECTORY);
+    }
+    if (differential_enabled()) {
+        scratch_clean(DIFFERENTIAL_DIRECTORY);
+        rmdir(DIFFERENTIAL_DIRECTORY);
+    }
+
+    campaign_close(finished);
+    replay_close();
+    store_close();
+    corpus_close();
+    dedup_close();
     return 0;
-}
\ No newline at end of file
+}
+
+
+void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [options] <extractor>\n"
+                    "       %s --regression DIR [--repeats N] [--jobs J] <extractor>...\n"
+                    "  --shard i/N   only run the i-th of N deterministic slices of every suite\n"
+                    "  --jobs J      split the shard between J local worker processes\n"
+                    "  --out DIR     shared output directory (default: fuzz-out when sharding)\n"
+                    "  --merge DIR   merge the results of all the shards written in DIR\n"
+                    "  --resume      continue from the checkpoint left by an interrupted run\n"
+                    "  --checkpoint-interval S\n"
+                    "                seconds between two checkpoints (default: 60, 0 to only write one at the end)\n"
+                    "  --seed N      seed of the campaign, the random streams of all processes derive from it\n"
+                    "  --replay-log  record every executed archive in DIR/shard-*/replay.log (a few bytes each)\n"
+                    "  --regenerate LOG [--case SUITE:INDEX]\n"
+                    "                list the records of a replay log, or write again the archives of a test case\n"
+                    "  --query STORE [--case SUITE:INDEX]\n"
+                    "                list the findings of a results store (DIR/store), and count the distinct archives\n"
+                    "  --corpus DIR  list the archives of a packed corpus (DIR/corpus), where they are in corpus.pack\n"
+                    "  --regression DIR\n"
+                    "                replay the crashes of DIR (e.g. DIR/store) on each extractor, on all the cores, and\n"
+                    "                print which ones still crash, are fixed, are flaky or behave in a new way\n"
+                    "  --repeats N   executions of each reproducer on each extractor with --regression (default: 1)\n"
+                    "  --threshold METRIC=VALUE\n"
+                    "                flag the executions above a cost as resource bugs, 0 to disable: cpu and wall (ms),\n"
+                    "                rss (KB), faults, written (bytes) (default: cpu=2000 wall=10000 rss=524288\n"
+                    "                written=67108864)\n"
+                    "  --outlier-sigma K\n"
+                    "                also flag the executions K standard deviations above the mean (default: 8, 0 to disable)\n"
+                    "  --limit RESOURCE=VALUE\n"
+                    "                limit what one execution of the extractor can use, 0 to remove the limit: as and fsize\n"
+                    "                (bytes), nofile, cpu (seconds) (default: as=1073741824 fsize=67108864 nofile=256 cpu=10)\n"
+                    "  --dedup       skip the archives the shard already ran in the same way without a finding, with a\n"
+                    "                filter in DIR/executed-i-of-N.bloom (executed.bloom without --out)\n"
+                    "  --dedup-capacity N\n"
+                    "                with --dedup, executions of a shard the filter is sized for, 16 bits each\n"
+                    "                (default: 16777216, 32 MB)\n"
+                    "  --header-sweep PASSES\n"
+                    "                also set every byte of the header to every value, all 512 offsets, with the checksum\n"
+                    "                computed again (fixed), left as it was (raw) or both, the table of the values that\n"
+                    "                crash at each offset goes to header_sweep.tsv\n"
+                    "  --syscall-feedback\n"
+                    "                trace the filesystem and memory calls of the extractor (seccomp), and keep the archives\n"
+                    "                with a new sequence of calls in DIR/corpus, and mutate them (x86_64 only)\n"
+                    "  --fingerprint fingerprint what the extractor leaves on disk, and keep the archives with a new\n"
+                    "                behaviour (output, exit status, extracted tree, syscalls when traced) in DIR/corpus\n"
+                    "  --prune-sweeps N\n"
+                    "                with --fingerprint, skip the rest of a position of a field sweep after N characters\n"
+                    "                in a row without a new behaviour (default: 0, never)\n"
+                    "  --differential COMMAND\n"
+                    "                also extract every archive with a reference (e.g. \"tar --no-same-owner -xf\", the\n"
+                    "                archive is appended), and keep the archives giving another tree as semantic bugs\n"
+                    "  --guard-malloc LIBRARY\n"
+                    "                preload the guard-page allocator in the extractor (make libguardmalloc.so), so that\n"
+                    "                heap overflows, use after free and double free crash it at once\n"
+                    "  --fault-injection LIBRARY\n"
+                    "                preload the fault injector in the extractor (make libfaultinject.so), and run the\n"
+                    "                fault suite: each call of open(), read(), malloc(), mkdir()... fails in turn\n"
+                    "  --confirm N   run each crash again N times in an empty directory, apart from the campaign, and label it\n"
+                    "                deterministic, flaky or environment (only crashes in the directory it was found in,\n"
+                    "                whose minimal state is kept as <archive>.state), in DIR/shard-*/confirm.tsv\n"
+                    "  --triage      stop the extractor at its fatal signal, and write the signal, fault address,\n"
+                    "                registers and backtrace next to every crash archive (<archive>.crash, x86_64 only)\n"
+                    "  --persistent LIBRARY\n"
+                    "                start the extractor once with the persistent harness (make libpersistent.so), which\n"
+                    "                runs its main() in a loop and resets its state between the archives, instead of a\n"
+                    "                process per archive (back to that if some state leaks)\n"
+                    "  --budget S    give the strategies slices of the campaign by how many crashes and new behaviours\n"
+                    "                they find (multi-armed bandit), and stop after S seconds (0: when all are done)\n"
+                    "  --slice N     test cases of a slice of --budget (default: 256, or 5 seconds)\n"
+                    "  --complexity METRIC\n"
+                    "                instead of the suites, look for the archives that cost the extractor the most:\n"
+                    "                cpu (ms), instructions (task clock in ns without a hardware counter) or rss (KB)\n"
+                    "  --complexity-execs N\n"
+                    "                number of executions of the complexity mode (default: 5000)\n",
+            program, program);
+}
+
+
+int main(int argc, char* argv[]) {
+    static const struct option long_options[] = {
+        {"shard", required_argument, NULL, 's'},
+        {"jobs", required_argument, NULL, 'j'},
+        {"out", required_argument, NULL, 'o'},
+        {"merge", required_argument, NULL, 'm'},
+        {"resume", no_argument, NULL, 'r'},
+        {"checkpoint-interval", required_argument, NULL, 'c'},
+        {"seed", required_argument, NULL, 'S'},
+        {"replay-log", no_argument, NULL, 'l'},
+        {"regenerate", required_argument, NULL, 'g'},
+        {"case", required_argument, NULL, 'C'},
+        {"query", required_argument, NULL, 'q'},
+        {"corpus", required_argument, NULL, 'K'},
+        {"dedup", no_argument, NULL, 'U'},
+        {"dedup-capacity", required_argument, NULL, 'd'},
+        {"header-sweep", required_argument, NULL, 'H'},
+        {"regression", required_argument, NULL, 'R'},
+        {"repeats", required_argument, NULL, 'n'},
+        {"budget", required_argument, NULL, 'b'},
+        {"slice", required_argument, NULL, 'k'},
+        {"threshold", required_argument, NULL, 'T'},
+        {"outlier-sigma", required_argument, NULL, 'O'},
+        {"limit", required_argument, NULL, 'L'},
+        {"syscall-feedback", no_argument, NULL, 'F'},
+        {"fingerprint", no_argument, NULL, 'f'},
+        {"prune-sweeps", required_argument, NULL, 'P'},
+        {"differential", required_argument, NULL, 'D'},
+        {"guard-malloc", required_argument, NULL, 'G'},
+        {"fault-injection", required_argument, NULL, 'I'},
+        {"confirm", required_argument, NULL, 'y'},
+        {"triage", no_argument, NULL, 't'},
+        {"persistent", required_argument, NULL, 'p'},
+        {"complexity", required_argument, NULL, 'x'},
+        {"complexity-execs", required_argument, NULL, 'X'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    unsigned int shard_index = 0;
+    unsigned int shard_count = 1;
+    unsigned int jobs = 1;
+    const char* out_dir = NULL;
+    bool resume = false;
+    unsigned int checkpoint_interval = 60;
+    uint64_t seed = DEFAULT_SEED;
+    bool replay_log = false;
+    bool syscall_feedback = false;
+    const char* regenerate = NULL;
+    const char* query = NULL;
+    const char* corpus = NULL;
+    const char* regression = NULL;
+    unsigned int repeats = 1;
+    bool jobs_given = false;
+    double budget = -1;
+    const char* case_spec = NULL;
+    int complexity_metric = -1;
+    unsigned long complexity_executions = DEFAULT_COMPLEXITY_EXECUTIONS;
+    const char* guard_malloc = NULL;
+    const char* persistent = NULL;
+    bool dedup = false;
+    unsigned long dedup_capacity = DEDUP_DEFAULT_CAPACITY;
+    bool triage = false;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "s:j:o:m:rc:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                if (campaign_parse_shard(optarg, &shard_index, &shard_count) == -1) {
+                    fprintf(stderr, "Invalid shard '%s', expected i/N with 0 <= i < N\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'j':
+                jobs = (unsigned int) strtoul(optarg, NULL, 10);
+                if (jobs == 0) {
+                    fprintf(stderr, "Invalid number of jobs '%s'\n", optarg);
+                    return 1;
+                }
+                jobs_given = true;
+                break;
+            case 'o':
+                out_dir = optarg;
+                break;
+            case 'm': {
+                int rv = campaign_merge(optarg);
+                if (rv != -1 && sweep_merge(optarg) == -1) {
+                    rv = 1;
+                }
+                return rv == 0 ? 0 : 1;
+            }
+            case 'r':
+                resume = true;
+                break;
+            case 'c':
+                checkpoint_interval = (unsigned int) strtoul(optarg, NULL, 10);
+                break;
+            case 'S':
+                seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'l':
+                replay_log = true;
+                break;
+            case 'g':
+                regenerate = optarg;
+                break;
+            case 'C':
+                case_spec = optarg;
+                break;
+            case 'q':
+                query = optarg;
+                break;
+            case 'K':
+                corpus = optarg;
+                break;
+            case 'U':
+                dedup = true;
+                break;
+            case 'd':
+                dedup_capacity = strtoul(optarg, NULL, 10);
+                if (dedup_capacity == 0) {
+                    fprintf(stderr, "Invalid capacity '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'H': {
+                unsigned int passes = sweep_parse_passes(optarg);
+                if (passes == 0) {
+                    fprintf(stderr, "Invalid header sweep '%s', expected fixed, raw or both\n", optarg);
+                    return 1;
+                }
+                sweep_enable(passes);
+                break;
+            }
+            case 'R':
+                regression = optarg;
+                break;
+            case 'b':
+                budget = strtod(optarg, NULL);
+                if (budget < 0) {
+                    fprintf(stderr, "Invalid budget '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'k':
+                scheduler_set_slice(strtoul(optarg, NULL, 10));
+                break;
+            case 'n':
+                repeats = (unsigned int) strtoul(optarg, NULL, 10);
+                if (repeats == 0) {
+                    fprintf(stderr, "Invalid number of repeats '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'T':
+                if (resource_parse_threshold(optarg) == -1) {
+                    fprintf(stderr, "Invalid threshold '%s', expected METRIC=VALUE\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'O':
+                resource_set_outlier_sigma(strtod(optarg, NULL));
+                break;
+            case 'L':
+                if (executor_parse_limit(optarg) == -1) {
+                    fprintf(stderr, "Invalid limit '%s', expected RESOURCE=VALUE\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'F':
+                syscall_feedback = true;
+                break;
+            case 'f':
+                behaviour_enable();
+                break;
+            case 'P':
+                behaviour_set_prune((unsigned int) strtoul(optarg, NULL, 10));
+                break;
+            case 'D':
+                if (differential_enable(optarg) == -1) {
+                    fprintf(stderr, "Invalid reference command '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'G':
+                guard_malloc = optarg;
+                break;
+            case 'I':
+                fault_enable(optarg);
+                break;
+            case 'y': {
+                char* end;
+                unsigned long confirm_runs = strtoul(optarg, &end, 10);
+                if (*end != '\0' || confirm_runs == 0 || confirm_runs > CONFIRM_MAX_RUNS) {
+                    fprintf(stderr, "Invalid number of runs '%s', expected 1 to %d\n", optarg, CONFIRM_MAX_RUNS);
+                    return 1;
+                }
+                confirm_enable((unsigned int) confirm_runs);
+                break;
+            }
+            case 't':
+                triage = true;
+                break;
+            case 'p':
+                persistent = optarg;
+                break;
+            case 'x':
+                complexity_metric = complexity_parse_metric(optarg);
+                if (complexity_metric == -1) {
+                    fprintf(stderr, "Invalid metric '%s', expected cpu, instructions or rss\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'X':
+                complexity_executions = strtoul(optarg, NULL, 10);
+                break;
+            case 'h':
+                usage(argv[0]);
+                return 0;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    // SUITE:INDEX, as printed in the results files and by the listings
+    uint64_t case_id = UINT64_MAX;
+    if (case_spec != NULL) {
+        char name[32];
+        unsigned int index;
+        int suite;
+        if (sscanf(case_spec, "%31[^:]:%u", name, &index) != 2 || (suite = suite_from_name(name)) == -1) {
+            fprintf(stderr, "Invalid test case '%s', expected SUITE:INDEX\n", case_spec);
+            return 1;
+        }
+        case_id = ((uint64_t) suite << 32) | index;
+    }
+
+    if (query != NULL) {
+        return store_query(query, case_id) >= 0 ? 0 : 1;
+    }
+    if (corpus != NULL) {
+        return corpus_list(corpus) >= 0 ? 0 : 1;
+    }
+
+    if (regenerate != NULL) {
+        if (case_spec == NULL) {
+            return replay_list(regenerate) == 0 ? 0 : 1;
+        }
+        return replay_regenerate(regenerate, case_id) > 0 ? 0 : 1;
+    }
+
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // The injector comes first: its malloc() goes to the one of the guard-page allocator. The reproducers of
+    // --regression run with them too
+    if ((fault_library() != NULL && executor_add_preload(fault_library()) == -1) ||
+        (guard_malloc != NULL && executor_add_preload(guard_malloc) == -1)) {
+        return 1;
+    }
+
+    if (regression != NULL) {
+        // Every extractor given, all the cores unless --jobs says otherwise
+        char** extractors = calloc(argc - optind, sizeof(*extractors));
+        if (extractors == NULL) {
+            perror("calloc");
+            return 1;
+        }
+        for (int e = optind; e < argc; e++) {
+            extractors[e - optind] = realpath(argv[e], NULL);
+            if (extractors[e - optind] == NULL) {
+                perror(argv[e]);
+                return 1;
+            }
+        }
+        return regression_run(regression, extractors, argc - optind, repeats, jobs_given ? jobs : 0) == 0 ? 0 : 1;
+    }
+
+    // The faults are scheduled per process, through its environment
+    if (persistent != NULL && fault_library() != NULL) {
+        fprintf(stderr, "--persistent cannot be combined with --fault-injection\n");
+        return 1;
+    }
+    if (persistent != NULL && executor_enable_persistent(persistent) == -1) {
+        return 1;
+    }
+
+    // The shards work in their own directory, the extractor has to be found from there
+    char extractor[PATH_MAX];
+    if (realpath(argv[optind], extractor) == NULL) {
+        perror(argv[optind]);
+        return 1;
+    }
+    if (triage && (executor_enable_triage() == -1 || triage_enable(extractor) == -1)) {
+        return 1;
+    }
+
+    if (complexity_metric != -1) {
+        // Every execution depends on the previous ones: one process
+        if (shard_count > 1 || jobs > 1) {
+            fprintf(stderr, "--complexity cannot be sharded\n");
+            return 1;
+        }
+        return complexity_run(extractor, out_dir, complexity_metric, complexity_executions, seed) == 0 ? 0 : 1;
+    }
+
+    if ((shard_count > 1 || jobs > 1) && out_dir == NULL) {
+        out_dir = "fuzz-out";
+    }
+
+    // One filter per shard, mapped before its workers are forked so that they share it
+    if (dedup) {
+        char dedup_path[PATH_MAX];
+        if (out_dir != NULL && mkdir(out_dir, 0755) == -1 && errno != EEXIST) {
+            perror(out_dir);
+            return 1;
+        }
+        if (out_dir != NULL) {
+            snprintf(dedup_path, sizeof(dedup_path), "%s/executed-%u-of-%u.bloom", out_dir, shard_index, shard_count);
+        } else {
+            snprintf(dedup_path, sizeof(dedup_path), "executed.bloom");
+        }
+        if (dedup_open(dedup_path, dedup_capacity, resume) == -1) {
+            return 1;
+        }
+    }
+
+    if (jobs == 1) {
+        return run_campaign(extractor, out_dir, shard_index, shard_count, 0, 1, resume, checkpoint_interval,
+                            seed, replay_log, syscall_feedback, budget);
+    }
+
+    // Local workers split the slice of this shard between them, see campaign_claim()
+    for (unsigned int k = 0; k < jobs; k++) {
+        pid_t pid = fork();
+        if (pid == -1) {
+            perror("fork");
+            return 1;
+        }
+        if (pid == 0) {
+            exit(run_campaign(extractor, out_dir, shard_index, shard_count, k, jobs, resume, checkpoint_interval,
+                              seed, replay_log, syscall_feedback, budget));
+        }
+    }
+
+    int rv = 0;
+    int status;
+    while (wait(&status) > 0) {
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            rv = 1;
+        }
+    }
+    return rv;
+}
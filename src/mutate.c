@@ -0,0 +1,384 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "mutate.h"
+
+
+// Number of random test cases after the systematic ones
+#define RANDOM_MUTATIONS 4096
+
+// Number of correct archives the mutations start from, and their largest number of members
+#define SEED_COUNT 4
+#define SEED_MAX_MEMBERS 2
+
+// Sources of the inserted bytes
+static const char zeros[4 * TAR_BLOCK_SIZE];
+static char letters[2 * TAR_BLOCK_SIZE];
+static char data[1024];
+
+// Lengths of the inserted and removed ranges
+static const size_t range_lengths[] = {1, 12, 100, 511, 512, 513, 1024};
+#define RANGE_LENGTH_COUNT (sizeof(range_lengths) / sizeof(range_lengths[0]))
+
+// Most headers mutate_pick_header() picks from, those of an archive of 64 KB
+#define MAX_HEADERS 128
+
+// Numbers of end-of-archive blocks, the correct archives have 2
+static const int end_blocks[] = {0, 1, 3, 4};
+#define END_BLOCKS_COUNT (sizeof(end_blocks) / sizeof(end_blocks[0]))
+
+// A correct archive and where its members are
+struct seed {
+    const char* description;
+    struct tar_t headers[SEED_MAX_MEMBERS];
+    int member_count;
+    // Where the padding of each member starts, and its length
+    size_t padding_offsets[SEED_MAX_MEMBERS];
+    size_t padding_lengths[SEED_MAX_MEMBERS];
+    // Where the end-of-archive blocks start
+    size_t end_offset;
+    struct archive archive;
+};
+
+static struct seed seeds[SEED_COUNT];
+static bool seeds_ready = false;
+
+enum mutation {
+    MUTATION_TRUNCATE,
+    MUTATION_REMOVE_PADDING,
+    MUTATION_END_BLOCKS,
+    MUTATION_END_IN_THE_MIDDLE,
+    MUTATION_PARTIAL_HEADER,
+    MUTATION_INSERT,
+    MUTATION_REMOVE,
+    MUTATION_COUNT
+};
+
+// Share of the random mutations (in %), the cheap ones that find bugs come first
+static const unsigned int weights[MUTATION_COUNT] = {
+    [MUTATION_TRUNCATE] = 30,
+    [MUTATION_REMOVE_PADDING] = 15,
+    [MUTATION_END_BLOCKS] = 10,
+    [MUTATION_END_IN_THE_MIDDLE] = 5,
+    [MUTATION_PARTIAL_HEADER] = 15,
+    [MUTATION_INSERT] = 10,
+    [MUTATION_REMOVE] = 15,
+};
+
+// A systematic test case
+struct systematic {
+    unsigned char seed;
+    unsigned char mutation;
+    // Member, cut offset or number of end blocks, depending on the mutation
+    unsigned int param;
+};
+
+#define MAX_SYSTEMATIC 256
+static struct systematic systematic[MAX_SYSTEMATIC];
+static unsigned int systematic_count = 0;
+
+
+/**
+ * Adds a member to a seed, with data and padding
+ */
+static void add_seed_member(struct seed* seed, const char* name, const char* typeflag, size_t data_len) {
+    struct tar_t* header = &seed->headers[seed->member_count];
+    char size[12];
+    snprintf(size, sizeof(size), "%011o", (unsigned int) data_len);
+    generate_tar_header(header, name, typeflag[0] == '5' ? "0000775" : "0000664", "0001750", "0001750", size,
+                        "14413537165", typeflag, "", "ustar", "00", "michal", "michal");
+    calculate_checksum(header);
+
+    archive_add_member(&seed->archive, header, data, data_len, true);
+    seed->padding_offsets[seed->member_count] = seed->archive.length - (data_len % TAR_BLOCK_SIZE ?
+                                                TAR_BLOCK_SIZE - data_len % TAR_BLOCK_SIZE : 0);
+    seed->padding_lengths[seed->member_count] = seed->archive.length - seed->padding_offsets[seed->member_count];
+    seed->member_count++;
+}
+
+
+static void add_systematic(unsigned int seed, enum mutation mutation, unsigned int param) {
+    if (systematic_count < MAX_SYSTEMATIC) {
+        systematic[systematic_count++] = (struct systematic) {seed, mutation, param};
+    }
+}
+
+
+/**
+ * Builds the seed archives and the list of the systematic test cases, once
+ */
+static void init_seeds(void) {
+    if (seeds_ready) {
+        return;
+    }
+    memset(letters, 'A', sizeof(letters));
+    memset(data, 'a', sizeof(data));
+
+    static const char* descriptions[SEED_COUNT] = {
+        "one file of 50 bytes",
+        "two files of 20 bytes",
+        "files of 513 and 0 bytes",
+        "a directory and a file of 100 bytes",
+    };
+    for (int i = 0; i < SEED_COUNT; i++) {
+        struct seed* seed = &seeds[i];
+        seed->description = descriptions[i];
+        seed->member_count = 0;
+        archive_init(&seed->archive);
+        switch (i) {
+            case 0:
+                add_seed_member(seed, "file.txt", "0", 50);
+                break;
+            case 1:
+                add_seed_member(seed, "file1.txt", "0", 20);
+                add_seed_member(seed, "file2.txt", "0", 20);
+                break;
+            case 2:
+                add_seed_member(seed, "file1.txt", "0", 513);
+                add_seed_member(seed, "file2.txt", "0", 0);
+                break;
+            default:
+                add_seed_member(seed, "dir/", "5", 0);
+                add_seed_member(seed, "dir/file.txt", "0", 100);
+                break;
+        }
+        seed->end_offset = seed->archive.length;
+        archive_end(&seed->archive, 2);
+
+        // Every padding removed, one by one then all at once
+        for (int m = 0; m < seed->member_count; m++) {
+            if (seed->padding_lengths[m] > 0) {
+                add_systematic(i, MUTATION_REMOVE_PADDING, m);
+            }
+        }
+        add_systematic(i, MUTATION_REMOVE_PADDING, SEED_MAX_MEMBERS);
+
+        // Cut around every block boundary
+        for (size_t offset = TAR_BLOCK_SIZE; offset < seed->archive.length; offset += TAR_BLOCK_SIZE) {
+            add_systematic(i, MUTATION_TRUNCATE, offset - 1);
+            add_systematic(i, MUTATION_TRUNCATE, offset);
+            add_systematic(i, MUTATION_TRUNCATE, offset + 1);
+        }
+
+        // Every number of end blocks, and the end blocks after the first member
+        for (unsigned int b = 0; b < END_BLOCKS_COUNT; b++) {
+            add_systematic(i, MUTATION_END_BLOCKS, b);
+        }
+        add_systematic(i, MUTATION_END_IN_THE_MIDDLE, 0);
+    }
+    seeds_ready = true;
+}
+
+
+unsigned int mutate_case_count(void) {
+    init_seeds();
+    return systematic_count + RANDOM_MUTATIONS;
+}
+
+
+size_t mutate_pick_offset(struct prng* prng, size_t length) {
+    unsigned int roll = (unsigned int) prng_below(prng, 4);
+    size_t blocks = length / TAR_BLOCK_SIZE;
+    size_t offset;
+
+    if (roll < 2) {
+        // A block boundary, or one byte around it
+        static const int jitter[] = {-1, 0, 0, 1};
+        offset = prng_below(prng, blocks + 1) * TAR_BLOCK_SIZE;
+        int delta = jitter[prng_below(prng, 4)];
+        if (delta < 0 && offset > 0) {
+            offset--;
+        } else if (delta > 0) {
+            offset++;
+        }
+    } else if (roll == 2) {
+        // A field boundary in one of the blocks
+        size_t block = prng_below(prng, blocks + 1);
+        offset = block * TAR_BLOCK_SIZE + tar_fields[prng_below(prng, TAR_FIELD_COUNT)].offset;
+    } else {
+        offset = prng_below(prng, length + 1);
+    }
+    return offset < length ? offset : length;
+}
+
+
+void mutate_describe(struct mutation_case* mutation, const char* format, ...) {
+    size_t used = strlen(mutation->description);
+    if (used < sizeof(mutation->description)) {
+        va_list args;
+        va_start(args, format);
+        vsnprintf(mutation->description + used, sizeof(mutation->description) - used, format, args);
+        va_end(args);
+    }
+}
+
+
+size_t mutate_pick_header(struct prng* prng, const struct archive* archive) {
+    size_t blocks = archive->length / TAR_BLOCK_SIZE;
+    size_t headers[MAX_HEADERS];
+    size_t count = 0;
+    for (size_t b = 0; b < blocks && count < MAX_HEADERS; b++) {
+        char magic[5];
+        if (archive_gather(archive, b * TAR_BLOCK_SIZE + 257, magic, 5) == 5 && memcmp(magic, "ustar", 5) == 0) {
+            headers[count++] = b;
+        }
+    }
+    if (count > 0) {
+        return headers[prng_below(prng, count)] * TAR_BLOCK_SIZE;
+    }
+    return prng_below(prng, blocks + 1) * TAR_BLOCK_SIZE;
+}
+
+
+size_t mutate_pick_length(struct prng* prng) {
+    return range_lengths[prng_below(prng, RANGE_LENGTH_COUNT)];
+}
+
+
+void mutate_generic(struct prng* prng, struct mutation_case* mutation, enum mutate_generic kind, size_t offset,
+                    size_t len) {
+    // The other mutators may not have built the seeds
+    if (letters[0] == 0) {
+        memset(letters, 'A', sizeof(letters));
+    }
+
+    struct archive* archive = &mutation->archive;
+    switch (kind) {
+        case MUTATE_INSERT:
+            archive_splice(archive, offset, 0, prng_below(prng, 2) ? zeros : letters, len);
+            mutate_describe(mutation, ", %zu bytes inserted at %zu", len, offset);
+            break;
+        case MUTATE_REMOVE:
+            archive_splice(archive, offset, len, NULL, 0);
+            mutate_describe(mutation, ", %zu bytes removed at %zu", len, offset);
+            break;
+        default:
+            archive_truncate(archive, offset);
+            mutate_describe(mutation, ", cut at %zu", offset);
+            break;
+    }
+}
+
+
+/**
+ * Removes the padding of a member of the seed, or of all of them when member is SEED_MAX_MEMBERS.
+ * The offsets are those of the seed: the removal starts from the last member.
+ */
+static void remove_padding(struct mutation_case* mutation, const struct seed* seed, unsigned int member) {
+    for (int m = seed->member_count - 1; m >= 0; m--) {
+        if (member == SEED_MAX_MEMBERS || member == (unsigned int) m) {
+            archive_splice(&mutation->archive, seed->padding_offsets[m], seed->padding_lengths[m], NULL, 0);
+        }
+    }
+    if (member == SEED_MAX_MEMBERS) {
+        mutate_describe(mutation, ", no padding");
+    } else {
+        mutate_describe(mutation, ", no padding after member %u", member + 1);
+    }
+}
+
+
+/**
+ * Replaces the end-of-archive blocks of the seed (they are its last 2 blocks)
+ */
+static void set_end_blocks(struct mutation_case* mutation, unsigned int which) {
+    size_t end = mutation->archive.length - 2 * TAR_BLOCK_SIZE;
+    archive_splice(&mutation->archive, end, 2 * TAR_BLOCK_SIZE, zeros, end_blocks[which] * TAR_BLOCK_SIZE);
+    mutate_describe(mutation, ", %d end blocks", end_blocks[which]);
+}
+
+
+/**
+ * Applies a random mutation.
+ * The offsets of the members are those of the seed, a stacked mutation may hit something else.
+ */
+static void mutate_randomly(struct prng* prng, struct mutation_case* mutation, const struct seed* seed) {
+    unsigned int roll = (unsigned int) prng_below(prng, 100);
+    enum mutation kind = 0;
+    while (kind < MUTATION_COUNT - 1 && roll >= weights[kind]) {
+        roll -= weights[kind];
+        kind++;
+    }
+
+    struct archive* archive = &mutation->archive;
+    size_t offset = mutate_pick_offset(prng, archive->length);
+    size_t len = mutate_pick_length(prng);
+
+    switch (kind) {
+        case MUTATION_TRUNCATE:
+            mutate_generic(prng, mutation, MUTATE_TRUNCATE, offset, len);
+            break;
+        case MUTATION_REMOVE_PADDING:
+            remove_padding(mutation, seed, (unsigned int) prng_below(prng, seed->member_count + 1));
+            break;
+        case MUTATION_END_BLOCKS:
+            set_end_blocks(mutation, (unsigned int) prng_below(prng, END_BLOCKS_COUNT));
+            break;
+        case MUTATION_END_IN_THE_MIDDLE:
+            archive_splice(archive, seed->padding_offsets[0] + seed->padding_lengths[0], 0, zeros, 2 * TAR_BLOCK_SIZE);
+            mutate_describe(mutation, ", end blocks after member 1");
+            break;
+        case MUTATION_PARTIAL_HEADER: {
+            // The beginning of a header, up to a field boundary or anywhere, often where the next header should be
+            size_t cut = prng_below(prng, 2) ? tar_fields[1 + prng_below(prng, TAR_FIELD_COUNT - 1)].offset
+                                             : 1 + prng_below(prng, TAR_BLOCK_SIZE - 1);
+            if (prng_below(prng, 2)) {
+                offset = seed->end_offset;
+            }
+            const struct tar_t* header = &seed->headers[prng_below(prng, seed->member_count)];
+            archive_splice(archive, offset, 0, header, cut);
+            mutate_describe(mutation, ", %zu bytes of a header at %zu", cut, offset);
+            break;
+        }
+        case MUTATION_INSERT:
+            mutate_generic(prng, mutation, MUTATE_INSERT, offset, len);
+            break;
+        default:
+            mutate_generic(prng, mutation, MUTATE_REMOVE, offset, len);
+            break;
+    }
+}
+
+
+void mutate_build_case(unsigned int index, struct prng* prng, struct mutation_case* mutation) {
+    init_seeds();
+
+    const struct seed* seed;
+    if (index < systematic_count) {
+        seed = &seeds[systematic[index].seed];
+    } else {
+        seed = &seeds[prng_below(prng, SEED_COUNT)];
+    }
+    mutation->archive = seed->archive;
+    snprintf(mutation->description, sizeof(mutation->description), "%s", seed->description);
+
+    if (index < systematic_count) {
+        unsigned int param = systematic[index].param;
+        switch (systematic[index].mutation) {
+            case MUTATION_REMOVE_PADDING:
+                remove_padding(mutation, seed, param);
+                break;
+            case MUTATION_TRUNCATE:
+                archive_truncate(&mutation->archive, param);
+                mutate_describe(mutation, ", cut at %u", param);
+                break;
+            case MUTATION_END_BLOCKS:
+                set_end_blocks(mutation, param);
+                break;
+            default:
+                archive_splice(&mutation->archive, seed->padding_offsets[0] + seed->padding_lengths[0], 0,
+                               zeros, 2 * TAR_BLOCK_SIZE);
+                mutate_describe(mutation, ", end blocks after member 1");
+                break;
+        }
+        return;
+    }
+
+    // Mostly one mutation, sometimes two or three stacked
+    int count = prng_below(prng, 4) ? 1 : 2 + (int) prng_below(prng, 2);
+    for (int i = 0; i < count; i++) {
+        mutate_randomly(prng, mutation, seed);
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef FUZZER_MUTATE_H
+#define FUZZER_MUTATE_H
+
+#include <stddef.h>
+
+#include "archive.h"
+#include "prng.h"
+
+/*
+ * Truncation and padding mutator.
+ * Starts from a few correct archives (one or two members, data around the block size, a directory) and cuts
+ * or extends them: truncation, data left without padding, bytes inserted or removed so that the members
+ * no longer start where their size says, end-of-archive blocks dropped, duplicated or put in the middle,
+ * and partial headers.
+ * The first test cases are the systematic ones (every padding removed, cuts around every block boundary,
+ * every number of end blocks), the others are random and pick their offsets mostly on block boundaries,
+ * then on the field boundaries of a header, and rarely anywhere.
+ */
+
+// Size of the description of a test case
+#define MUTATE_DESCRIPTION_SIZE 128
+
+// A mutated archive, its parts point at the seed archives and at static buffers
+struct mutation_case {
+    struct archive archive;
+    char description[MUTATE_DESCRIPTION_SIZE];
+};
+
+// The mutations that do not depend on what the archive holds, stacked by the other mutators too
+enum mutate_generic {
+    MUTATE_INSERT,
+    MUTATE_REMOVE,
+    MUTATE_TRUNCATE,
+    MUTATE_GENERIC_COUNT
+};
+
+/**
+ * @return the number of test cases of the mutator
+ */
+unsigned int mutate_case_count(void);
+
+/**
+ * Builds the archive of a test case, and its description
+ * @param index the test case, from 0 to mutate_case_count() - 1
+ * @param prng generator seeded for this test case, only used by the random mutations
+ * @param mutation where to build the archive
+ */
+void mutate_build_case(unsigned int index, struct prng* prng, struct mutation_case* mutation);
+
+/**
+ * Picks an offset in an archive: a block boundary (give or take a byte) half of the time,
+ * the boundary of a header field a quarter of the time, any offset otherwise
+ * @param prng the generator
+ * @param length length of the archive
+ * @return an offset from 0 to length
+ */
+size_t mutate_pick_offset(struct prng* prng, size_t length);
+
+/**
+ * Picks a header of an archive: a block with the ustar magic at its place, any block if there is none
+ * @param prng the generator
+ * @param archive the archive
+ * @return the offset of the block
+ */
+size_t mutate_pick_header(struct prng* prng, const struct archive* archive);
+
+/**
+ * Picks the length of an inserted or removed range: around the block size, a field, a byte
+ * @param prng the generator
+ * @return a length from 1 to 2 blocks
+ */
+size_t mutate_pick_length(struct prng* prng);
+
+/**
+ * Applies a generic mutation: null bytes or letters inserted, a range removed, or a cut, and appends it to the
+ * description
+ * @param prng the generator, for what is inserted
+ * @param mutation the archive to mutate
+ * @param kind the mutation
+ * @param offset where, e.g. from mutate_pick_offset()
+ * @param len length of the range, from mutate_pick_length(), unused by a cut
+ */
+void mutate_generic(struct prng* prng, struct mutation_case* mutation, enum mutate_generic kind, size_t offset,
+                    size_t len);
+
+/**
+ * Appends a step to the description of a test case
+ * @param mutation the test case
+ * @param format format of the step, e.g. ", cut at %zu"
+ */
+void mutate_describe(struct mutation_case* mutation, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+#endif
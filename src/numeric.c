@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "numeric.h"
+
+
+// The boundaries worth trying in any numeric field
+static const struct numeric_value values[] = {
+    {false, 0},
+    {false, 1},
+    {false, 511},                           // around a block
+    {false, 512},
+    {false, 513},
+    {false, 07777},                         // all the mode bits
+    {false, 010000},
+    {false, (1ULL << 21) - 1},              // 7 octal digits: max of an 8-byte field with terminator
+    {false, 1ULL << 21},
+    {false, (1ULL << 24) - 1},              // 8 octal digits: max of an 8-byte field without terminator
+    {false, 1ULL << 24},
+    {false, (1ULL << 31) - 1},              // int, 32-bit time_t
+    {false, 1ULL << 31},
+    {false, (1ULL << 32) - 1},              // unsigned int, uid_t, gid_t
+    {false, 1ULL << 32},
+    {false, (1ULL << 33) - 1},              // 11 octal digits: max of a 12-byte field with terminator
+    {false, 1ULL << 33},
+    {false, (1ULL << 36) - 1},              // 12 octal digits: max of a 12-byte field without terminator
+    {false, 1ULL << 36},
+    {false, (1ULL << 56) - 1},              // max of an 8-byte base-256 field
+    {false, (1ULL << 63) - 512},            // off_t: rounding up to a block overflows
+    {false, (1ULL << 63) - 1},              // max of off_t and 64-bit time_t
+    {false, 1ULL << 63},
+    {false, UINT64_MAX},
+    {true, 1},
+    {true, 2},
+    {true, 512},
+    {true, 1ULL << 31},                     // min of 32-bit time_t
+    {true, (1ULL << 31) + 1},
+    {true, 1ULL << 63},                     // min of off_t and 64-bit time_t
+};
+#define VALUE_COUNT (sizeof(values) / sizeof(values[0]))
+
+static const char* field_names[NUMERIC_FIELD_COUNT] = {
+    [NUMERIC_MODE] = "mode",
+    [NUMERIC_UID] = "uid",
+    [NUMERIC_GID] = "gid",
+    [NUMERIC_SIZE] = "size",
+    [NUMERIC_MTIME] = "mtime",
+    [NUMERIC_DEVMAJOR] = "devmajor",
+    [NUMERIC_DEVMINOR] = "devminor",
+};
+
+static const char* encoding_names[NUMERIC_ENCODING_COUNT] = {
+    [OCTAL_NUL] = "octal",
+    [OCTAL_SPACE] = "octal-space",
+    [OCTAL_FULL] = "octal-full",
+    [OCTAL_SHORT] = "octal-short",
+    [OCTAL_LEADING_SPACES] = "octal-leading-spaces",
+    [BASE256] = "base256",
+};
+
+
+unsigned int numeric_case_count(void) {
+    return NUMERIC_FIELD_COUNT * VALUE_COUNT * NUMERIC_ENCODING_COUNT;
+}
+
+
+/**
+ * @return the number of octal digits of a value (at least 1)
+ */
+static size_t octal_digits(uint64_t value) {
+    size_t digits = 1;
+    while (value >>= 3) {
+        digits++;
+    }
+    return digits;
+}
+
+
+/**
+ * Writes the value in octal, right-aligned on exactly "digits" characters
+ */
+static void write_octal(char* out, size_t digits, uint64_t value) {
+    for (size_t i = digits; i > 0; i--) {
+        out[i - 1] = (char) ('0' + (value & 7));
+        value >>= 3;
+    }
+}
+
+
+int numeric_encode(char* field, size_t width, struct numeric_value value, enum numeric_encoding encoding) {
+    size_t digits = octal_digits(value.magnitude);
+
+    // Only base-256 has negative values
+    if (value.negative && (encoding != BASE256 || value.magnitude == 0)) {
+        return -1;
+    }
+
+    memset(field, 0, width);
+    switch (encoding) {
+        case OCTAL_NUL:
+        case OCTAL_SPACE:
+            if (digits > width - 1) {
+                return -1;
+            }
+            write_octal(field, width - 1, value.magnitude);
+            field[width - 1] = encoding == OCTAL_NUL ? '\0' : ' ';
+            return 0;
+
+        case OCTAL_FULL:
+            if (digits > width) {
+                return -1;
+            }
+            write_octal(field, width, value.magnitude);
+            return 0;
+
+        case OCTAL_SHORT:
+            if (digits > width - 1) {
+                return -1;
+            }
+            write_octal(field, digits, value.magnitude);
+            return 0;
+
+        case OCTAL_LEADING_SPACES:
+            if (digits > width - 1) {
+                return -1;
+            }
+            memset(field, ' ', width - 1 - digits);
+            write_octal(field + width - 1 - digits, digits, value.magnitude);
+            return 0;
+
+        case BASE256:
+            if (!value.negative) {
+                // 0x80 marker then the value on width-1 bytes
+                if (width - 1 < 8 && value.magnitude >> (8 * (width - 1))) {
+                    return -1;
+                }
+                field[0] = (char) 0x80;
+                uint64_t v = value.magnitude;
+                for (size_t i = width - 1; i > 0 && v; i--) {
+                    field[i] = (char) (v & 0xff);
+                    v >>= 8;
+                }
+                return 0;
+            }
+
+            // Two's complement on the whole field, computed on the unsigned magnitude. The first byte has to be the
+            // 0xff marker: at least -2^(8*(width-1)) (INT64_MIN does not fit in 8 bytes), at least -2^63 above
+            if (value.magnitude > (width <= 8 ? 1ULL << (8 * (width - 1)) : 1ULL << 63)) {
+                return -1;
+            }
+            uint64_t v = ~value.magnitude + 1;
+            for (size_t i = width; i > 0; i--) {
+                field[i - 1] = (char) (v & 0xff);
+                v = (v >> 8) | 0xff00000000000000ULL;
+            }
+            return 0;
+
+        default:
+            return -1;
+    }
+}
+
+
+/**
+ * Finds a numeric field in a header
+ * @param header the header
+ * @param field the field
+ * @param width where to store the size of the field
+ * @return the start of the field
+ */
+static char* field_of(struct tar_t* header, enum numeric_field field, size_t* width) {
+    switch (field) {
+        case NUMERIC_MODE:
+            *width = sizeof(header->mode);
+            return header->mode;
+        case NUMERIC_UID:
+            *width = sizeof(header->uid);
+            return header->uid;
+        case NUMERIC_GID:
+            *width = sizeof(header->gid);
+            return header->gid;
+        case NUMERIC_SIZE:
+            *width = sizeof(header->size);
+            return header->size;
+        case NUMERIC_MTIME:
+            *width = sizeof(header->mtime);
+            return header->mtime;
+        case NUMERIC_DEVMAJOR:
+            *width = sizeof(header->devmajor);
+            return header->devmajor;
+        default:
+            *width = sizeof(header->devminor);
+            return header->devminor;
+    }
+}
+
+
+int numeric_build_case(unsigned int index, struct tar_t* header) {
+    enum numeric_encoding encoding = index % NUMERIC_ENCODING_COUNT;
+    unsigned int value = (index / NUMERIC_ENCODING_COUNT) % VALUE_COUNT;
+    enum numeric_field field = index / NUMERIC_ENCODING_COUNT / VALUE_COUNT;
+
+    generate_golden_tar_header(header);
+
+    size_t width;
+    char* start = field_of(header, field, &width);
+    if (numeric_encode(start, width, values[value], encoding) == -1) {
+        return -1;
+    }
+
+    // The extractor must not stop at the checksum
+    calculate_checksum(header);
+    return 0;
+}
+
+
+void numeric_describe_case(unsigned int index, char* buf, size_t len) {
+    enum numeric_encoding encoding = index % NUMERIC_ENCODING_COUNT;
+    unsigned int value = (index / NUMERIC_ENCODING_COUNT) % VALUE_COUNT;
+    enum numeric_field field = index / NUMERIC_ENCODING_COUNT / VALUE_COUNT;
+
+    snprintf(buf, len, "%s=%s%" PRIu64 " (%s)", field_names[field],
+             values[value].negative ? "-" : "", values[value].magnitude, encoding_names[encoding]);
+}
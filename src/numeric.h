@@ -0,0 +1,80 @@
+#ifndef FUZZER_NUMERIC_H
+#define FUZZER_NUMERIC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tar.h"
+
+/*
+ * Structure-aware mutator for the numeric fields of the header.
+ * A test case is a field, a boundary value and a way to encode it: octal with the usual terminators,
+ * octal filling the whole field, or the GNU base-256 extension (high bit of the first byte set).
+ */
+
+enum numeric_field {
+    NUMERIC_MODE,
+    NUMERIC_UID,
+    NUMERIC_GID,
+    NUMERIC_SIZE,
+    NUMERIC_MTIME,
+    NUMERIC_DEVMAJOR,
+    NUMERIC_DEVMINOR,
+    NUMERIC_FIELD_COUNT
+};
+
+enum numeric_encoding {
+    // width-1 octal digits and a null character, the usual encoding
+    OCTAL_NUL,
+    // width-1 octal digits and a space
+    OCTAL_SPACE,
+    // width octal digits, no terminator
+    OCTAL_FULL,
+    // as few digits as possible, the rest of the field is null
+    OCTAL_SHORT,
+    // right-aligned digits after leading spaces, null terminated (old tar style)
+    OCTAL_LEADING_SPACES,
+    // GNU base-256: big-endian two's complement, first byte 0x80 for positive values, 0xff for negative ones
+    BASE256,
+    NUMERIC_ENCODING_COUNT
+};
+
+// A value to encode: the magnitude may need all 64 bits
+struct numeric_value {
+    bool negative;
+    uint64_t magnitude;
+};
+
+/**
+ * @return the number of test cases of the mutator (some of them cannot be encoded, see numeric_build_case())
+ */
+unsigned int numeric_case_count(void);
+
+/**
+ * Encodes a value in a numeric field
+ * @param field the field to overwrite
+ * @param width size of the field
+ * @param value the value
+ * @param encoding how to encode it
+ * @return 0 on success, -1 if the value cannot be represented with this encoding and width
+ */
+int numeric_encode(char* field, size_t width, struct numeric_value value, enum numeric_encoding encoding);
+
+/**
+ * Builds the header of a test case: the golden header with one numeric field replaced, checksum fixed
+ * @param index index of the test case, < numeric_case_count()
+ * @param header the header to fill
+ * @return 0 on success, -1 if the value of the test case cannot be encoded in its field
+ */
+int numeric_build_case(unsigned int index, struct tar_t* header);
+
+/**
+ * Describes a test case, e.g. "uid=-1 (base256)"
+ * @param index index of the test case
+ * @param buf where to write the description
+ * @param len size of buf
+ */
+void numeric_describe_case(unsigned int index, char* buf, size_t len);
+
+#endif
@@ -0,0 +1,361 @@
+/*
+ * Fault injector, preloaded in the extractor (LD_PRELOAD) to run its error paths: the calls to open(), read(),
+ * mmap(), malloc(), mkdir(), symlink()... always succeed on a healthy host.
+ *
+ * FAULTINJECT holds the schedule, a list of faults "function:N:errno" separated by commas: the N-th call (from 1)
+ * of the function fails with the errno (a number), e.g. "open:2:2,malloc:5:12". Without it, every call goes through.
+ * FAULTINJECT_COUNTS is the path of a file where the number of calls of each function is written at exit,
+ * as lines "function count", so that the fuzzer knows which calls a schedule can target.
+ *
+ * The calls are counted whether or not they fail, and the other calls go to the next definition (libc, or another
+ * preloaded library such as the guard-page allocator when this one comes first in LD_PRELOAD).
+ * The writes to the standard output and error are neither counted nor failed: the crash message of the extractor
+ * goes there, and the fuzzer could no longer see the crash.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+
+// The functions that can fail, in the order of the counts file
+enum function {
+    F_OPEN,
+    F_READ,
+    F_WRITE,
+    F_MMAP,
+    F_MALLOC,
+    F_CALLOC,
+    F_MKDIR,
+    F_SYMLINK,
+    F_LINK,
+    F_MKNOD,
+    F_MKFIFO,
+    F_LSTAT,
+    F_COUNT
+};
+
+static const char* names[F_COUNT] = {
+    [F_OPEN] = "open",
+    [F_READ] = "read",
+    [F_WRITE] = "write",
+    [F_MMAP] = "mmap",
+    [F_MALLOC] = "malloc",
+    [F_CALLOC] = "calloc",
+    [F_MKDIR] = "mkdir",
+    [F_SYMLINK] = "symlink",
+    [F_LINK] = "link",
+    [F_MKNOD] = "mknod",
+    [F_MKFIFO] = "mkfifo",
+    [F_LSTAT] = "lstat",
+};
+
+#define MAX_FAULTS 16
+
+static struct {
+    enum function function;
+    unsigned long call;
+    int error;
+} faults[MAX_FAULTS];
+static int fault_count = 0;
+
+static unsigned long calls[F_COUNT];
+static int ready = 0;
+
+static int (*next_open)(const char*, int, ...);
+static ssize_t (*next_read)(int, void*, size_t);
+static ssize_t (*next_write)(int, const void*, size_t);
+static void* (*next_mmap)(void*, size_t, int, int, int, off_t);
+static void* (*next_malloc)(size_t);
+static void* (*next_calloc)(size_t, size_t);
+static void* (*next_realloc)(void*, size_t);
+static void (*next_free)(void*);
+static int (*next_mkdir)(const char*, mode_t);
+static int (*next_symlink)(const char*, const char*);
+static int (*next_link)(const char*, const char*);
+static int (*next_mknod)(const char*, mode_t, dev_t);
+static int (*next_mkfifo)(const char*, mode_t);
+static int (*next_lstat)(const char*, struct stat*);
+
+// dlsym() allocates with calloc(): those allocations come from here, and are never freed
+static char bootstrap[4096];
+static size_t bootstrap_used = 0;
+static int resolving = 0;
+
+
+static void* bootstrap_alloc(size_t size) {
+    size = (size + 15) & ~(size_t) 15;
+    if (bootstrap_used + size > sizeof(bootstrap)) {
+        return NULL;
+    }
+    void* pointer = bootstrap + bootstrap_used;
+    bootstrap_used += size;
+    return pointer;
+}
+
+
+static int from_bootstrap(const void* pointer) {
+    return (const char*) pointer >= bootstrap && (const char*) pointer < bootstrap + sizeof(bootstrap);
+}
+
+
+static void parse_schedule(void) {
+    const char* schedule = getenv("FAULTINJECT");
+    while (schedule != NULL && *schedule != '\0' && fault_count < MAX_FAULTS) {
+        const char* colon = strchr(schedule, ':');
+        if (colon == NULL) {
+            return;
+        }
+        for (int f = 0; f < F_COUNT; f++) {
+            if ((size_t) (colon - schedule) == strlen(names[f]) && strncmp(schedule, names[f], colon - schedule) == 0) {
+                char* end;
+                faults[fault_count].function = f;
+                faults[fault_count].call = strtoul(colon + 1, &end, 10);
+                faults[fault_count].error = *end == ':' ? (int) strtol(end + 1, &end, 10) : EIO;
+                fault_count++;
+                break;
+            }
+        }
+        schedule = strchr(schedule, ',');
+        if (schedule != NULL) {
+            schedule++;
+        }
+    }
+}
+
+
+static void setup(void) {
+    resolving = 1;
+    next_open = dlsym(RTLD_NEXT, "open");
+    next_read = dlsym(RTLD_NEXT, "read");
+    next_write = dlsym(RTLD_NEXT, "write");
+    next_mmap = dlsym(RTLD_NEXT, "mmap");
+    next_malloc = dlsym(RTLD_NEXT, "malloc");
+    next_calloc = dlsym(RTLD_NEXT, "calloc");
+    next_realloc = dlsym(RTLD_NEXT, "realloc");
+    next_free = dlsym(RTLD_NEXT, "free");
+    next_mkdir = dlsym(RTLD_NEXT, "mkdir");
+    next_symlink = dlsym(RTLD_NEXT, "symlink");
+    next_link = dlsym(RTLD_NEXT, "link");
+    next_mknod = dlsym(RTLD_NEXT, "mknod");
+    next_mkfifo = dlsym(RTLD_NEXT, "mkfifo");
+    next_lstat = dlsym(RTLD_NEXT, "lstat");
+    resolving = 0;
+    parse_schedule();
+    ready = 1;
+}
+
+
+/**
+ * Counts a call and tells if it has to fail
+ * @return the errno of the failure, 0 if the call goes through
+ */
+static int inject(enum function function) {
+    if (!ready) {
+        setup();
+    }
+    unsigned long call = ++calls[function];
+    for (int i = 0; i < fault_count; i++) {
+        if (faults[i].function == function && faults[i].call == call) {
+            return faults[i].error;
+        }
+    }
+    return 0;
+}
+
+
+__attribute__((destructor)) static void write_counts(void) {
+    const char* path = getenv("FAULTINJECT_COUNTS");
+    if (path == NULL) {
+        return;
+    }
+    // Not through stdio: the extractor may be exiting from its crash handler
+    int fd = next_open != NULL ? next_open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) : -1;
+    if (fd == -1) {
+        return;
+    }
+    for (int f = 0; f < F_COUNT; f++) {
+        char line[64];
+        int len = snprintf(line, sizeof(line), "%s %lu\n", names[f], calls[f]);
+        if (next_write(fd, line, len) != len) {
+            break;
+        }
+    }
+    close(fd);
+}
+
+
+int open(const char* path, int flags, ...) {
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+    int error = inject(F_OPEN);
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return next_open(path, flags, mode);
+}
+
+
+ssize_t read(int fd, void* buf, size_t count) {
+    int error = inject(F_READ);
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return next_read(fd, buf, count);
+}
+
+
+ssize_t write(int fd, const void* buf, size_t count) {
+    if (fd == STDOUT_FILENO || fd == STDERR_FILENO) {
+        if (!ready) {
+            setup();
+        }
+        return next_write(fd, buf, count);
+    }
+    int error = inject(F_WRITE);
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return next_write(fd, buf, count);
+}
+
+
+void* mmap(void* address, size_t length, int prot, int flags, int fd, off_t offset) {
+    int error = inject(F_MMAP);
+    if (error != 0) {
+        errno = error;
+        return MAP_FAILED;
+    }
+    return next_mmap(address, length, prot, flags, fd, offset);
+}
+
+
+void* malloc(size_t size) {
+    if (resolving) {
+        return bootstrap_alloc(size);
+    }
+    int error = inject(F_MALLOC);
+    if (error != 0) {
+        errno = error;
+        return NULL;
+    }
+    return next_malloc(size);
+}
+
+
+void* calloc(size_t count, size_t size) {
+    if (resolving) {
+        // Static memory is zero
+        return size != 0 && count > sizeof(bootstrap) / size ? NULL : bootstrap_alloc(count * size);
+    }
+    int error = inject(F_CALLOC);
+    if (error != 0) {
+        errno = error;
+        return NULL;
+    }
+    return next_calloc(count, size);
+}
+
+
+void* realloc(void* pointer, size_t size) {
+    if (!ready) {
+        setup();
+    }
+    if (from_bootstrap(pointer)) {
+        // Only dlsym() allocates from there: copy out, whatever the size was
+        void* moved = next_malloc(size);
+        if (moved != NULL) {
+            size_t available = bootstrap + sizeof(bootstrap) - (char*) pointer;
+            memcpy(moved, pointer, available < size ? available : size);
+        }
+        return moved;
+    }
+    return next_realloc(pointer, size);
+}
+
+
+void free(void* pointer) {
+    if (pointer == NULL || from_bootstrap(pointer)) {
+        return;
+    }
+    if (!ready) {
+        setup();
+    }
+    next_free(pointer);
+}
+
+
+int mkdir(const char* path, mode_t mode) {
+    int error = inject(F_MKDIR);
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return next_mkdir(path, mode);
+}
+
+
+int symlink(const char* target, const char* path) {
+    int error = inject(F_SYMLINK);
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return next_symlink(target, path);
+}
+
+
+int link(const char* target, const char* path) {
+    int error = inject(F_LINK);
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return next_link(target, path);
+}
+
+
+int mknod(const char* path, mode_t mode, dev_t device) {
+    int error = inject(F_MKNOD);
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return next_mknod(path, mode, device);
+}
+
+
+int mkfifo(const char* path, mode_t mode) {
+    int error = inject(F_MKFIFO);
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return next_mkfifo(path, mode);
+}
+
+
+int lstat(const char* path, struct stat* st) {
+    int error = inject(F_LSTAT);
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return next_lstat(path, st);
+}
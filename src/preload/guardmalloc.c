@@ -0,0 +1,468 @@
+/*
+ * Guard-page allocator, preloaded in the extractor (LD_PRELOAD) to turn silent heap corruption into crashes.
+ *
+ * Every allocation ends right before a guard page (PROT_NONE): an overflow of the heap faults at once, instead of
+ * corrupting a neighbour that may never be used again before exit. The bytes between the end of the allocation and
+ * the guard page (alignment) are filled with a pattern checked by free(). Freed allocations are made inaccessible and
+ * kept in a quarantine before their pages are reused, so that a use after free faults too.
+ *
+ * The slots come from pools reserved with one mmap() each: the size of an allocation is rounded up to a power of two
+ * pages (its class), and a slot of a class is that many pages plus the guard page. Allocating only changes the
+ * protection of the pages of the slot, and the pages before the allocation stay inaccessible (an underflow faults
+ * once it leaves the first page of the allocation).
+ *
+ * The errors found by free() (double free, invalid pointer, overwritten pattern) are reported on stderr and raise
+ * SIGSEGV: the extractor only catches SIGSEGV, its handler prints the crash message that the fuzzer looks for.
+ *
+ * GUARDMALLOC_QUARANTINE sets the number of freed allocations kept in the quarantine (default: 4096).
+ */
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+
+// Alignment of malloc()
+#define ALIGNMENT 16
+
+// Largest class: 2^MAX_CLASS pages (64 MiB with 4 KiB pages), the larger allocations fail with ENOMEM
+#define MAX_CLASS 14
+
+// Size of a pool, or more to hold a few slots of the large classes
+#define POOL_SIZE (32 * 1024 * 1024)
+#define MIN_POOL_SLOTS 4
+#define MAX_POOLS 1024
+
+// Byte written between the end of an allocation and the guard page
+#define PATTERN 0xa5
+
+#define DEFAULT_QUARANTINE 4096
+#define MAX_QUARANTINE 65536
+
+enum slot_state {
+    SLOT_UNUSED,
+    SLOT_ALLOCATED,
+    SLOT_QUARANTINED,
+    SLOT_FREE
+};
+
+// A slot of a pool, or none
+struct slot_ref {
+    int32_t pool;
+    int32_t slot;
+};
+
+// A slot, described outside of the pages handed to the extractor so that an overflow cannot corrupt it
+struct slot {
+    size_t size;
+    char* pointer;
+    enum slot_state state;
+    // Next free slot of the class
+    struct slot_ref next_free;
+};
+
+struct pool {
+    char* base;
+    size_t slot_size;
+    size_t slot_count;
+    size_t used;
+    struct slot* slots;
+    unsigned int class;
+};
+
+static struct pool pools[MAX_POOLS];
+static unsigned int pool_count = 0;
+
+// Free slots of each class
+static struct slot_ref free_lists[MAX_CLASS + 1];
+
+// Freed slots waiting to be reused, oldest first
+static struct slot_ref quarantine[MAX_QUARANTINE];
+static unsigned int quarantine_capacity = 0;
+static unsigned int quarantine_head = 0;
+static unsigned int quarantine_length = 0;
+
+static size_t page_size = 0;
+static volatile char lock = 0;
+
+
+static void acquire(void) {
+    while (__atomic_test_and_set(&lock, __ATOMIC_ACQUIRE)) {
+    }
+}
+
+
+static void release(void) {
+    __atomic_clear(&lock, __ATOMIC_RELEASE);
+}
+
+
+static void setup(void) {
+    page_size = (size_t) sysconf(_SC_PAGESIZE);
+    for (unsigned int c = 0; c <= MAX_CLASS; c++) {
+        free_lists[c].pool = -1;
+    }
+    quarantine_capacity = DEFAULT_QUARANTINE;
+    const char* value = getenv("GUARDMALLOC_QUARANTINE");
+    if (value != NULL) {
+        unsigned long n = strtoul(value, NULL, 10);
+        quarantine_capacity = n < MAX_QUARANTINE ? n : MAX_QUARANTINE;
+    }
+}
+
+
+/**
+ * Reports a heap error and crashes the way the extractor reports its crashes, without allocating
+ */
+static void report(const char* error, const void* pointer) {
+    static const char digits[] = "0123456789abcdef";
+    char address[19] = "0x";
+    for (int i = 0; i < 16; i++) {
+        address[2 + i] = digits[((uintptr_t) pointer >> (60 - 4 * i)) & 15];
+    }
+    address[18] = '\n';
+    if (write(STDERR_FILENO, "guardmalloc: ", 13) == -1 || write(STDERR_FILENO, error, strlen(error)) == -1 ||
+        write(STDERR_FILENO, " ", 1) == -1 || write(STDERR_FILENO, address, sizeof(address)) == -1) {
+        // Crashing anyway
+    }
+    release();
+    raise(SIGSEGV);
+    abort();
+}
+
+
+/**
+ * @return the class of an allocation: the power of two of its number of pages, -1 if it is too large
+ */
+static int class_of(size_t size) {
+    size_t pages = (size + page_size - 1) / page_size;
+    int class = 0;
+    while (((size_t) 1 << class) < pages) {
+        if (++class > MAX_CLASS) {
+            return -1;
+        }
+    }
+    return class;
+}
+
+
+/**
+ * Reserves a new pool for a class, inaccessible until its slots are used
+ * @return the index of the pool, -1 on error
+ */
+static int new_pool(unsigned int class) {
+    if (pool_count == MAX_POOLS) {
+        return -1;
+    }
+    size_t slot_size = (((size_t) 1 << class) + 1) * page_size;
+    size_t slot_count = POOL_SIZE / slot_size;
+    if (slot_count < MIN_POOL_SLOTS) {
+        slot_count = MIN_POOL_SLOTS;
+    }
+
+    // The descriptions of the slots come first, in pages that stay accessible
+    size_t header = (slot_count * sizeof(struct slot) + page_size - 1) / page_size * page_size;
+    size_t length = header + slot_count * slot_size;
+    char* region = mmap(NULL, length, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (region == MAP_FAILED) {
+        return -1;
+    }
+    if (mprotect(region, header, PROT_READ | PROT_WRITE) == -1) {
+        munmap(region, length);
+        return -1;
+    }
+
+    struct pool* pool = &pools[pool_count];
+    pool->slots = (struct slot*) region;
+    pool->base = region + header;
+    pool->slot_size = slot_size;
+    pool->slot_count = slot_count;
+    pool->used = 0;
+    pool->class = class;
+    return (int) pool_count++;
+}
+
+
+/**
+ * @return the slot of a pointer, with a pool of -1 if the pointer is not in a pool
+ */
+static struct slot_ref find_slot(const void* pointer) {
+    struct slot_ref ref = {-1, -1};
+    for (unsigned int p = 0; p < pool_count; p++) {
+        const char* base = pools[p].base;
+        if ((const char*) pointer >= base && (const char*) pointer < base + pools[p].slot_count * pools[p].slot_size) {
+            ref.pool = (int32_t) p;
+            ref.slot = (int32_t) (((const char*) pointer - base) / pools[p].slot_size);
+            break;
+        }
+    }
+    return ref;
+}
+
+
+static struct slot* slot_of(struct slot_ref ref) {
+    return &pools[ref.pool].slots[ref.slot];
+}
+
+
+/**
+ * @return the address of the guard page of a slot
+ */
+static char* guard_of(struct slot_ref ref) {
+    const struct pool* pool = &pools[ref.pool];
+    return pool->base + ((size_t) ref.slot + 1) * pool->slot_size - page_size;
+}
+
+
+static void push_free(struct slot_ref ref) {
+    unsigned int class = pools[ref.pool].class;
+    struct slot* slot = slot_of(ref);
+    slot->state = SLOT_FREE;
+    slot->next_free = free_lists[class];
+    free_lists[class] = ref;
+}
+
+
+/**
+ * Takes a slot of a class: a free one, else a new one
+ * @return the slot, with a pool of -1 on error
+ */
+static struct slot_ref take_slot(unsigned int class) {
+    struct slot_ref ref = free_lists[class];
+    if (ref.pool != -1) {
+        free_lists[class] = slot_of(ref)->next_free;
+        return ref;
+    }
+
+    // The last pool of the class has room, or a new one
+    for (int p = (int) pool_count - 1; p >= 0; p--) {
+        if (pools[p].class == class) {
+            if (pools[p].used < pools[p].slot_count) {
+                ref.pool = p;
+                ref.slot = (int32_t) pools[p].used++;
+                return ref;
+            }
+            break;
+        }
+    }
+    ref.pool = new_pool(class);
+    if (ref.pool != -1) {
+        ref.slot = (int32_t) pools[ref.pool].used++;
+    }
+    return ref;
+}
+
+
+/**
+ * Moves a freed slot to the quarantine, and the oldest slot of a full quarantine to the free list of its class
+ */
+static void retire(struct slot_ref ref) {
+    slot_of(ref)->state = SLOT_QUARANTINED;
+    if (quarantine_capacity > 0) {
+        if (quarantine_length < quarantine_capacity) {
+            quarantine[(quarantine_head + quarantine_length) % quarantine_capacity] = ref;
+            quarantine_length++;
+            return;
+        }
+        // Full: the new one takes the place of the oldest one
+        struct slot_ref oldest = quarantine[quarantine_head];
+        quarantine[quarantine_head] = ref;
+        quarantine_head = (quarantine_head + 1) % quarantine_capacity;
+        ref = oldest;
+    }
+
+    // The pages go back to the system, they are zero when reused
+    const struct pool* pool = &pools[ref.pool];
+    madvise(pool->base + (size_t) ref.slot * pool->slot_size, pool->slot_size - page_size, MADV_DONTNEED);
+    push_free(ref);
+}
+
+
+/**
+ * Allocates against a guard page
+ * @param size size of the allocation
+ * @param alignment power of two, at most a page
+ * @return the allocation, NULL with errno set on error
+ */
+static void* allocate(size_t size, size_t alignment) {
+    acquire();
+    if (page_size == 0) {
+        setup();
+    }
+    if (size == 0) {
+        size = 1;
+    }
+    int class = alignment <= page_size && size <= ((size_t) page_size << MAX_CLASS) ? class_of(size) : -1;
+    struct slot_ref ref = {-1, -1};
+    if (class != -1) {
+        ref = take_slot((unsigned int) class);
+    }
+    if (ref.pool == -1) {
+        release();
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    // Only the pages of the allocation become accessible, the rest of the slot catches the underflows
+    char* guard = guard_of(ref);
+    char* pointer = (char*) ((uintptr_t) (guard - size) & ~(uintptr_t) (alignment - 1));
+    char* first_page = (char*) ((uintptr_t) pointer & ~(uintptr_t) (page_size - 1));
+    if (mprotect(first_page, guard - first_page, PROT_READ | PROT_WRITE) == -1) {
+        // Out of mappings (vm.max_map_count)
+        push_free(ref);
+        release();
+        errno = ENOMEM;
+        return NULL;
+    }
+    memset(pointer + size, PATTERN, guard - pointer - size);
+
+    struct slot* slot = slot_of(ref);
+    slot->size = size;
+    slot->pointer = pointer;
+    slot->state = SLOT_ALLOCATED;
+    release();
+    return pointer;
+}
+
+
+/**
+ * @return the slot of an allocation, after checking that it is one
+ */
+static struct slot_ref checked_slot(void* pointer) {
+    struct slot_ref ref = find_slot(pointer);
+    if (ref.pool == -1) {
+        report("free of a pointer that was not allocated", pointer);
+    }
+    struct slot* slot = slot_of(ref);
+    if (slot->state == SLOT_QUARANTINED || slot->state == SLOT_FREE) {
+        report("double free", pointer);
+    }
+    if (slot->state != SLOT_ALLOCATED || slot->pointer != pointer) {
+        report("free of a pointer inside an allocation", pointer);
+    }
+    return ref;
+}
+
+
+void free(void* pointer) {
+    if (pointer == NULL) {
+        return;
+    }
+    acquire();
+    struct slot_ref ref = checked_slot(pointer);
+    struct slot* slot = slot_of(ref);
+
+    // An overflow shorter than the alignment did not reach the guard page
+    char* guard = guard_of(ref);
+    for (const char* c = slot->pointer + slot->size; c < guard; c++) {
+        if (*(const unsigned char*) c != PATTERN) {
+            report("heap overflow detected on free of", pointer);
+        }
+    }
+
+    mprotect(pools[ref.pool].base + (size_t) ref.slot * pools[ref.pool].slot_size,
+             pools[ref.pool].slot_size - page_size, PROT_NONE);
+    retire(ref);
+    release();
+}
+
+
+void* malloc(size_t size) {
+    return allocate(size, ALIGNMENT);
+}
+
+
+void* calloc(size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    // The pages of a slot are new, or were given back to the system when leaving the quarantine: zero
+    return allocate(count * size, ALIGNMENT);
+}
+
+
+void* realloc(void* pointer, size_t size) {
+    if (pointer == NULL) {
+        return malloc(size);
+    }
+    if (size == 0) {
+        free(pointer);
+        return NULL;
+    }
+
+    acquire();
+    size_t old_size = slot_of(checked_slot(pointer))->size;
+    release();
+
+    // Always moved: a pointer kept on the old allocation faults
+    void* moved = malloc(size);
+    if (moved != NULL) {
+        memcpy(moved, pointer, old_size < size ? old_size : size);
+        free(pointer);
+    }
+    return moved;
+}
+
+
+void* reallocarray(void* pointer, size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return realloc(pointer, count * size);
+}
+
+
+int posix_memalign(void** result, size_t alignment, size_t size) {
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    void* pointer = allocate(size, alignment);
+    if (pointer == NULL) {
+        return ENOMEM;
+    }
+    *result = pointer;
+    return 0;
+}
+
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return allocate(size, alignment < ALIGNMENT ? ALIGNMENT : alignment);
+}
+
+
+void* memalign(size_t alignment, size_t size) {
+    return aligned_alloc(alignment, size);
+}
+
+
+void* valloc(size_t size) {
+    return allocate(size, (size_t) sysconf(_SC_PAGESIZE));
+}
+
+
+void* pvalloc(size_t size) {
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    return allocate((size + page - 1) / page * page, page);
+}
+
+
+size_t malloc_usable_size(void* pointer) {
+    if (pointer == NULL) {
+        return 0;
+    }
+    acquire();
+    size_t size = slot_of(checked_slot(pointer))->size;
+    release();
+    return size;
+}
@@ -0,0 +1,724 @@
+/*
+ * Persistent harness, preloaded in the extractor (LD_PRELOAD) to run its main() once per archive in the same process,
+ * instead of a fork() and an execv() per archive.
+ *
+ * With PERSISTENT_FD (a connected socket) in the environment, the harness takes the place of main() (through
+ * __libc_start_main()), says it is ready with a byte 'P', then reads requests from the socket, two lines each:
+ * the directory to extract in (empty for the current one) and the archive. For each one it calls the real main()
+ * with the archive as its argument, catches exit() with a longjmp, and answers with a struct persistent_status.
+ * Without it, the extractor runs as usual.
+ *
+ * Between two iterations, the harness puts back what the extractor may have changed:
+ *  - its global variables (the writable segments of the executable, the RELRO part excluded), as they were before
+ *    the first iteration
+ *  - the heap: the blocks allocated by the code of the extractor (not by libc for its own caches) are freed, and
+ *    the memory an earlier iteration used is cleared when the extractor allocates it, as new memory would be
+ *  - the mappings it created with mmap(), the file descriptors it opened, the current directory, the umask,
+ *    the signal mask and the handlers of the fatal signals
+ * What cannot be put back is reported as leaks in the status (too many blocks or mappings to track, a heap growing
+ * anyway), and the fuzzer then falls back to a fork() per execution. After a crash the heap cannot be trusted:
+ * the harness reports it and exits, the fuzzer starts a new one.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <link.h>
+#include <malloc.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+
+// Sent after each iteration, same layout as in the executor of the fuzzer
+struct persistent_status {
+    // Argument of exit(), or value returned by main()
+    int32_t exit_code;
+    // Fatal signal caught by the handler of the extractor, 0 if none
+    int32_t crash_signal;
+    // Bit set of what could not be put back, see enum leak
+    uint32_t leaks;
+    uint32_t reserved;
+    // CPU time of the iteration in microseconds, peak resident set size during the iteration in kilobytes
+    int64_t user_us;
+    int64_t sys_us;
+    int64_t max_rss;
+    int64_t minor_faults;
+    int64_t major_faults;
+    // Bytes passed to write() and similar calls during the iteration
+    uint64_t bytes_written;
+    // CPU time of the process so far, once its state is put back: an archive that kills it cost the rest
+    int64_t total_user_us;
+    int64_t total_sys_us;
+};
+
+enum leak {
+    LEAK_BLOCKS = 1,
+    LEAK_MAPPINGS = 2,
+    LEAK_HEAP = 4,
+    // The working directory could not be put back
+    LEAK_CWD = 8,
+};
+
+// Blocks tracked per iteration, a power of two
+#define TRACKED_SLOTS (1 << 18)
+// Mappings tracked per iteration
+#define TRACKED_MAPPINGS 256
+// Growth of the heap in use, after the cleanup, above which libc keeps something of every iteration
+#define HEAP_GROWTH_LIMIT (16 * 1024 * 1024)
+// File descriptors open before the first iteration (the others are closed after each one), looked for up to MAX_FD
+#define MAX_BASELINE_FDS 64
+#define MAX_FD 4096
+
+typedef int (*main_function)(int, char**, char**);
+
+static int (*next_libc_start_main)(main_function, int, char**, void (*)(void), void (*)(void), void (*)(void), void*);
+static void* (*next_malloc)(size_t);
+static void* (*next_calloc)(size_t, size_t);
+static void* (*next_realloc)(void*, size_t);
+static void (*next_free)(void*);
+static int (*next_posix_memalign)(void**, size_t, size_t);
+static void* (*next_mmap)(void*, size_t, int, int, int, off_t);
+static int (*next_munmap)(void*, size_t);
+static void (*next_exit)(int) __attribute__((noreturn));
+static int (*next_sigaction)(int, const struct sigaction*, struct sigaction*);
+
+// dlsym() allocates with calloc(): those allocations come from here, and are never freed
+static char bootstrap[4096];
+static size_t bootstrap_used = 0;
+static int resolving = 0;
+static int ready = 0;
+
+static main_function real_main;
+
+// Code of the executable: the allocations made from there are those of the extractor
+static uintptr_t code_start = 0;
+static uintptr_t code_end = 0;
+
+// Writable segments of the executable and their content before the first iteration
+#define MAX_SEGMENTS 4
+static struct {
+    char* address;
+    size_t length;
+    char* saved;
+} segments[MAX_SEGMENTS];
+static int segment_count = 0;
+
+// Set of blocks: open addressing on the pointer, an entry is only valid for the iteration that wrote it
+struct block_set {
+    struct {
+        void* pointer;
+        uint32_t iteration;
+    } *slots;
+    // Slots written during the iteration, to find the blocks left without walking the whole table
+    uint32_t* written;
+    size_t written_count;
+};
+
+// Blocks allocated by the extractor and not freed yet, blocks freed during the iteration
+static struct block_set allocated;
+static struct block_set freed;
+static uint32_t iteration = 0;
+
+static struct {
+    void* address;
+    size_t length;
+} mappings[TRACKED_MAPPINGS];
+static int mapping_count = 0;
+
+static uint32_t leaks = 0;
+static volatile int in_iteration = 0;
+static volatile sig_atomic_t crash_signal = 0;
+static sigjmp_buf iteration_jump;
+
+// Handlers of the fatal signals installed by the extractor, called from the one of the harness
+static void (*fatal_handlers[NSIG])(int);
+
+
+static void* bootstrap_alloc(size_t size) {
+    size = (size + 15) & ~(size_t) 15;
+    if (bootstrap_used + size > sizeof(bootstrap)) {
+        return NULL;
+    }
+    void* pointer = bootstrap + bootstrap_used;
+    bootstrap_used += size;
+    return pointer;
+}
+
+
+static int from_bootstrap(const void* pointer) {
+    return (const char*) pointer >= bootstrap && (const char*) pointer < bootstrap + sizeof(bootstrap);
+}
+
+
+static void setup(void) {
+    resolving = 1;
+    next_libc_start_main = dlsym(RTLD_NEXT, "__libc_start_main");
+    next_malloc = dlsym(RTLD_NEXT, "malloc");
+    next_calloc = dlsym(RTLD_NEXT, "calloc");
+    next_realloc = dlsym(RTLD_NEXT, "realloc");
+    next_free = dlsym(RTLD_NEXT, "free");
+    next_posix_memalign = dlsym(RTLD_NEXT, "posix_memalign");
+    next_mmap = dlsym(RTLD_NEXT, "mmap");
+    next_munmap = dlsym(RTLD_NEXT, "munmap");
+    next_exit = dlsym(RTLD_NEXT, "exit");
+    next_sigaction = dlsym(RTLD_NEXT, "sigaction");
+    resolving = 0;
+    ready = 1;
+}
+
+
+static int is_fatal(int sig) {
+    return sig == SIGSEGV || sig == SIGBUS || sig == SIGFPE || sig == SIGILL || sig == SIGABRT;
+}
+
+
+static int from_extractor(const void* caller) {
+    return (uintptr_t) caller >= code_start && (uintptr_t) caller < code_end;
+}
+
+
+static size_t slot_of(const void* pointer) {
+    return (size_t) (((uintptr_t) pointer * 0x9e3779b97f4a7c15ULL) >> 46) & (TRACKED_SLOTS - 1);
+}
+
+
+static int set_create(struct block_set* set) {
+    set->slots = next_mmap(NULL, TRACKED_SLOTS * sizeof(*set->slots), PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    set->written = next_mmap(NULL, TRACKED_SLOTS / 2 * sizeof(*set->written), PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    set->written_count = 0;
+    return set->slots == MAP_FAILED || set->written == MAP_FAILED ? -1 : 0;
+}
+
+
+/**
+ * @return 0 on success, -1 if the set is full
+ */
+static int set_add(struct block_set* set, void* pointer) {
+    if (pointer == NULL || set->slots == NULL) {
+        return 0;
+    }
+    // At most half full, so that the probes stay short
+    if (set->written_count >= TRACKED_SLOTS / 2) {
+        return -1;
+    }
+    for (size_t s = slot_of(pointer);; s = (s + 1) & (TRACKED_SLOTS - 1)) {
+        if (set->slots[s].iteration != iteration || set->slots[s].pointer == NULL) {
+            if (set->slots[s].iteration != iteration) {
+                set->written[set->written_count++] = (uint32_t) s;
+            }
+            set->slots[s].pointer = pointer;
+            set->slots[s].iteration = iteration;
+            return 0;
+        }
+    }
+}
+
+
+/**
+ * @param remove also removes the block from the set
+ * @return 1 if the block is in the set, 0 otherwise
+ */
+static int set_find(struct block_set* set, void* pointer, int remove) {
+    if (pointer == NULL || set->slots == NULL) {
+        return 0;
+    }
+    for (size_t s = slot_of(pointer); set->slots[s].iteration == iteration; s = (s + 1) & (TRACKED_SLOTS - 1)) {
+        if (set->slots[s].pointer == pointer) {
+            if (remove) {
+                // Keeps the slot of this iteration: the probes go on past it
+                set->slots[s].pointer = NULL;
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * Tracks a new block of the extractor. In a new process, a block that was not freed before by the same execution
+ * comes from memory never used, full of zeros: so does the block, when an earlier iteration left data in it.
+ */
+static void track(void* pointer) {
+    if (pointer == NULL) {
+        return;
+    }
+    // Blocks mapped on their own (IS_MMAPPED in the size of the chunk of glibc) are new mappings
+    size_t chunk_size = ((size_t*) pointer)[-1];
+    if (!(chunk_size & 2) && !set_find(&freed, pointer, 0)) {
+        memset(pointer, 0, malloc_usable_size(pointer));
+    }
+    if (set_add(&allocated, pointer) == -1) {
+        leaks |= LEAK_BLOCKS;
+    }
+}
+
+
+void* malloc(size_t size) {
+    if (resolving) {
+        return bootstrap_alloc(size);
+    }
+    if (!ready) {
+        setup();
+    }
+    void* pointer = next_malloc(size);
+    if (in_iteration && from_extractor(__builtin_return_address(0))) {
+        track(pointer);
+    }
+    return pointer;
+}
+
+
+void* calloc(size_t count, size_t size) {
+    if (resolving) {
+        // Static memory is zero
+        return size != 0 && count > sizeof(bootstrap) / size ? NULL : bootstrap_alloc(count * size);
+    }
+    if (!ready) {
+        setup();
+    }
+    void* pointer = next_calloc(count, size);
+    if (in_iteration && from_extractor(__builtin_return_address(0)) && set_add(&allocated, pointer) == -1) {
+        leaks |= LEAK_BLOCKS;
+    }
+    return pointer;
+}
+
+
+void* realloc(void* pointer, size_t size) {
+    if (!ready) {
+        setup();
+    }
+    if (from_bootstrap(pointer)) {
+        // Only dlsym() allocates from there: copy out, whatever the size was
+        void* moved = next_malloc(size);
+        if (moved != NULL) {
+            size_t available = bootstrap + sizeof(bootstrap) - (char*) pointer;
+            memcpy(moved, pointer, available < size ? available : size);
+        }
+        return moved;
+    }
+    int tracked = in_iteration && set_find(&allocated, pointer, 1);
+    void* moved = next_realloc(pointer, size);
+    if (in_iteration && (tracked || from_extractor(__builtin_return_address(0)))) {
+        // On failure, the block is still there
+        if (set_add(&allocated, moved == NULL && size != 0 ? pointer : moved) == -1) {
+            leaks |= LEAK_BLOCKS;
+        }
+    }
+    return moved;
+}
+
+
+int posix_memalign(void** pointer, size_t alignment, size_t size) {
+    if (!ready) {
+        setup();
+    }
+    int rv = next_posix_memalign(pointer, alignment, size);
+    if (rv == 0 && in_iteration && from_extractor(__builtin_return_address(0))) {
+        track(*pointer);
+    }
+    return rv;
+}
+
+
+void free(void* pointer) {
+    if (pointer == NULL || from_bootstrap(pointer)) {
+        return;
+    }
+    if (!ready) {
+        setup();
+    }
+    if (in_iteration) {
+        set_find(&allocated, pointer, 1);
+        // When the set is full, the blocks freed later are cleared if allocated again: no worse than a new process
+        set_add(&freed, pointer);
+    }
+    next_free(pointer);
+}
+
+
+void* mmap(void* address, size_t length, int prot, int flags, int fd, off_t offset) {
+    if (!ready) {
+        setup();
+    }
+    void* mapping = next_mmap(address, length, prot, flags, fd, offset);
+    if (mapping != MAP_FAILED && in_iteration) {
+        if (mapping_count == TRACKED_MAPPINGS) {
+            leaks |= LEAK_MAPPINGS;
+        } else {
+            mappings[mapping_count].address = mapping;
+            mappings[mapping_count].length = length;
+            mapping_count++;
+        }
+    }
+    return mapping;
+}
+
+
+int munmap(void* address, size_t length) {
+    if (!ready) {
+        setup();
+    }
+    // Forget every tracked mapping it touches: the part left, if any, is not unmapped again later
+    for (int m = 0; m < mapping_count; m++) {
+        char* start = mappings[m].address;
+        if (start < (char*) address + length && (char*) address < start + mappings[m].length) {
+            mappings[m--] = mappings[--mapping_count];
+        }
+    }
+    return next_munmap(address, length);
+}
+
+
+void exit(int code) {
+    if (!ready) {
+        setup();
+    }
+    if (in_iteration) {
+        // Back in the loop of the harness, the value cannot be 0
+        siglongjmp(iteration_jump, (code & 0xff) + 1);
+    }
+    next_exit(code);
+}
+
+
+static void fatal_trampoline(int sig) {
+    crash_signal = sig;
+    void (*handler)(int) = fatal_handlers[sig];
+    if (handler != NULL && handler != SIG_DFL && handler != SIG_IGN) {
+        handler(sig);
+    }
+    // The handler returned: the extractor dies of the signal, as it would have without the harness
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+
+int sigaction(int sig, const struct sigaction* action, struct sigaction* old) {
+    if (!ready) {
+        setup();
+    }
+    if (sig <= 0 || sig >= NSIG || !is_fatal(sig) || action == NULL || (action->sa_flags & SA_SIGINFO) ||
+        action->sa_handler == SIG_DFL || action->sa_handler == SIG_IGN) {
+        if (sig > 0 && sig < NSIG && action != NULL) {
+            fatal_handlers[sig] = NULL;
+        }
+        return next_sigaction(sig, action, old);
+    }
+    // The handler of a fatal signal goes through the harness, to know that the extractor crashed
+    struct sigaction wrapped = *action;
+    wrapped.sa_handler = fatal_trampoline;
+    void (*previous)(int) = fatal_handlers[sig];
+    int rv = next_sigaction(sig, &wrapped, old);
+    if (rv == 0) {
+        fatal_handlers[sig] = action->sa_handler;
+        if (old != NULL && old->sa_handler == fatal_trampoline) {
+            old->sa_handler = previous;
+        }
+    }
+    return rv;
+}
+
+
+/**
+ * signal() with the System V semantics, which the extractor uses: the handler is reset when the signal comes
+ */
+static void (*install(int sig, void (*handler)(int), int flags))(int) {
+    struct sigaction action;
+    struct sigaction old;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handler;
+    action.sa_flags = flags;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(sig, &action, &old) == -1) {
+        return SIG_ERR;
+    }
+    return old.sa_handler;
+}
+
+
+void (*__sysv_signal(int sig, void (*handler)(int)))(int) {
+    return install(sig, handler, SA_RESETHAND | SA_NODEFER);
+}
+
+
+void (*sysv_signal(int sig, void (*handler)(int)))(int) {
+    return install(sig, handler, SA_RESETHAND | SA_NODEFER);
+}
+
+
+void (*signal(int sig, void (*handler)(int)))(int) {
+    return install(sig, handler, SA_RESTART);
+}
+
+
+void (*bsd_signal(int sig, void (*handler)(int)))(int) {
+    return install(sig, handler, SA_RESTART);
+}
+
+
+/**
+ * Finds the code and the writable segments of the executable, the first object
+ */
+static int find_executable(struct dl_phdr_info* info, __attribute__((unused)) size_t size,
+                           __attribute__((unused)) void* data) {
+    uintptr_t relro_start = 0;
+    uintptr_t relro_end = 0;
+    for (int p = 0; p < info->dlpi_phnum; p++) {
+        const ElfW(Phdr)* phdr = &info->dlpi_phdr[p];
+        if (phdr->p_type == PT_GNU_RELRO) {
+            relro_start = info->dlpi_addr + phdr->p_vaddr;
+            relro_end = relro_start + phdr->p_memsz;
+        }
+    }
+    for (int p = 0; p < info->dlpi_phnum; p++) {
+        const ElfW(Phdr)* phdr = &info->dlpi_phdr[p];
+        if (phdr->p_type != PT_LOAD) {
+            continue;
+        }
+        uintptr_t start = info->dlpi_addr + phdr->p_vaddr;
+        uintptr_t end = start + phdr->p_memsz;
+        if (phdr->p_flags & PF_X) {
+            code_start = code_start == 0 || start < code_start ? start : code_start;
+            code_end = end > code_end ? end : code_end;
+        }
+        if ((phdr->p_flags & PF_W) && segment_count < MAX_SEGMENTS) {
+            // The RELRO part is read-only by now
+            if (relro_start <= start && start < relro_end) {
+                start = relro_end;
+            }
+            if (start < end) {
+                segments[segment_count].address = (char*) start;
+                segments[segment_count].length = end - start;
+                segment_count++;
+            }
+        }
+    }
+    // Only the first object, the executable
+    return 1;
+}
+
+
+static int64_t timeval_us(const struct timeval* tv) {
+    return (int64_t) tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
+
+static uint64_t read_bytes_written(void) {
+    int fd = open("/proc/self/io", O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return 0;
+    }
+    char buf[512];
+    ssize_t got = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (got <= 0) {
+        return 0;
+    }
+    buf[got] = '\0';
+    const char* wchar = strstr(buf, "wchar: ");
+    return wchar != NULL ? strtoull(wchar + 7, NULL, 10) : 0;
+}
+
+
+/**
+ * Reads a line of the control descriptor, without stdio: the extractor owns it
+ * @return 0 on success, -1 at the end of the requests
+ */
+static int read_line(int fd, char* line, size_t size) {
+    size_t len = 0;
+    for (;;) {
+        char c;
+        ssize_t got = read(fd, &c, 1);
+        if (got == -1 && errno == EINTR) {
+            continue;
+        }
+        if (got != 1) {
+            return -1;
+        }
+        if (c == '\n') {
+            line[len] = '\0';
+            return 0;
+        }
+        if (len + 1 < size) {
+            line[len++] = c;
+        }
+    }
+}
+
+
+/**
+ * Resets the peak resident set size of the process, so that the one of getrusage() is the peak of the iteration
+ * @return 1 if it was reset, 0 if the peak is still the one of the whole process
+ */
+static int reset_peak_rss(void) {
+    int fd = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return 0;
+    }
+    int reset = write(fd, "5", 1) == 1;
+    close(fd);
+    return reset;
+}
+
+
+static int harness_main(int argc, char** argv, char** envp) {
+    int control = atoi(getenv("PERSISTENT_FD"));
+
+    dl_iterate_phdr(find_executable, NULL);
+    for (int s = 0; s < segment_count; s++) {
+        segments[s].saved = next_malloc(segments[s].length);
+        if (segments[s].saved == NULL) {
+            return real_main(argc, argv, envp);
+        }
+        memcpy(segments[s].saved, segments[s].address, segments[s].length);
+    }
+    if (set_create(&allocated) == -1 || set_create(&freed) == -1) {
+        return real_main(argc, argv, envp);
+    }
+
+    // What the iterations have to leave as it is, this descriptor included
+    int cwd = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    struct rlimit files;
+    int max_fd = getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur != RLIM_INFINITY &&
+                 files.rlim_cur < MAX_FD ? (int) files.rlim_cur : MAX_FD;
+    unsigned int baseline_fds[MAX_BASELINE_FDS];
+    int baseline_count = 0;
+    for (int fd = 3; fd < max_fd && baseline_count < MAX_BASELINE_FDS; fd++) {
+        if (fcntl(fd, F_GETFD) != -1) {
+            baseline_fds[baseline_count++] = fd;
+        }
+    }
+    mode_t mask = umask(022);
+    umask(mask);
+    sigset_t signal_mask;
+    sigprocmask(SIG_SETMASK, NULL, &signal_mask);
+    size_t heap_baseline = 0;
+
+    if (write(control, "P", 1) != 1) {
+        return 1;
+    }
+
+    char directory[4096];
+    char archive[4096];
+    while (cwd != -1 && read_line(control, directory, sizeof(directory)) == 0 &&
+           read_line(control, archive, sizeof(archive)) == 0) {
+        struct persistent_status status;
+        memset(&status, 0, sizeof(status));
+
+        for (int s = 0; s < segment_count; s++) {
+            memcpy(segments[s].address, segments[s].saved, segments[s].length);
+        }
+        if (directory[0] != '\0' && chdir(directory) == -1) {
+            status.exit_code = 127;
+        }
+
+        struct rusage before;
+        struct rusage after;
+        int peak_reset = reset_peak_rss();
+        getrusage(RUSAGE_SELF, &before);
+        uint64_t written_before = read_bytes_written();
+
+        iteration++;
+        allocated.written_count = 0;
+        freed.written_count = 0;
+        mapping_count = 0;
+        crash_signal = 0;
+        if (status.exit_code == 0) {
+            char* arguments[] = {argv[0], archive, NULL};
+            in_iteration = 1;
+            int jumped = sigsetjmp(iteration_jump, 1);
+            if (jumped == 0) {
+                status.exit_code = real_main(2, arguments, envp);
+            } else {
+                status.exit_code = jumped - 1;
+            }
+            in_iteration = 0;
+        }
+        fflush(NULL);
+        clearerr(stdout);
+        clearerr(stderr);
+
+        getrusage(RUSAGE_SELF, &after);
+        status.crash_signal = crash_signal;
+        status.user_us = timeval_us(&after.ru_utime) - timeval_us(&before.ru_utime);
+        status.sys_us = timeval_us(&after.ru_stime) - timeval_us(&before.ru_stime);
+        // Without the reset, what the iteration added to the peak of the process
+        status.max_rss = peak_reset ? after.ru_maxrss : after.ru_maxrss - before.ru_maxrss;
+        status.minor_faults = after.ru_minflt - before.ru_minflt;
+        status.major_faults = after.ru_majflt - before.ru_majflt;
+        status.bytes_written = read_bytes_written() - written_before;
+
+        // Put back what the extractor changed
+        // Every gap between the descriptors of the baseline, in a few calls
+        unsigned int low = 3;
+        for (int b = 0; b < baseline_count; b++) {
+            if (baseline_fds[b] > low) {
+                close_range(low, baseline_fds[b] - 1, 0);
+            }
+            low = baseline_fds[b] + 1;
+        }
+        close_range(low, ~0U, 0);
+        for (int m = 0; m < mapping_count; m++) {
+            next_munmap(mappings[m].address, mappings[m].length);
+        }
+        for (size_t w = 0; w < allocated.written_count; w++) {
+            if (allocated.slots[allocated.written[w]].pointer != NULL) {
+                next_free(allocated.slots[allocated.written[w]].pointer);
+                allocated.slots[allocated.written[w]].pointer = NULL;
+            }
+        }
+        if (fchdir(cwd) == -1) {
+            leaks |= LEAK_CWD;
+        }
+        umask(mask);
+        sigprocmask(SIG_SETMASK, &signal_mask, NULL);
+        for (int sig = 1; sig < NSIG; sig++) {
+            if (fatal_handlers[sig] != NULL) {
+                signal(sig, SIG_DFL);
+            }
+        }
+
+        // What libc keeps of each iteration, the first one sets its caches up
+        struct mallinfo2 heap = mallinfo2();
+        if (iteration == 1) {
+            heap_baseline = heap.uordblks;
+        } else if (heap.uordblks > heap_baseline + HEAP_GROWTH_LIMIT) {
+            leaks |= LEAK_HEAP;
+        }
+        status.leaks = leaks;
+
+        struct rusage total;
+        getrusage(RUSAGE_SELF, &total);
+        status.total_user_us = timeval_us(&total.ru_utime);
+        status.total_sys_us = timeval_us(&total.ru_stime);
+
+        if (write(control, &status, sizeof(status)) != sizeof(status) || status.crash_signal != 0) {
+            // After a crash, the heap may be corrupted: a new process for the next archive
+            break;
+        }
+    }
+    _exit(0);
+}
+
+
+int __libc_start_main(main_function main, int argc, char** argv, void (*init)(void), void (*fini)(void),
+                      void (*rtld_fini)(void), void* stack_end) {
+    if (!ready) {
+        setup();
+    }
+    real_main = main;
+    return next_libc_start_main(getenv("PERSISTENT_FD") != NULL ? harness_main : main, argc, argv, init, fini,
+                                rtld_fini, stack_end);
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "prng.h"
+#include "campaign.h"
+
+
+// Seed of the campaign, the generators of the test cases are derived from it
+static uint64_t campaign_seed;
+
+
+/**
+ * The finalizer of splitmix64
+ */
+static inline uint64_t finalize(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+
+static uint64_t splitmix64(uint64_t* x) {
+    return finalize(*x += 0x9E3779B97F4A7C15ULL);
+}
+
+
+static inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+
+void prng_seed(struct prng* prng, uint64_t seed) {
+    for (int i = 0; i < 4; i++) {
+        prng->s[i] = splitmix64(&seed);
+    }
+}
+
+
+uint64_t prng_next(struct prng* prng) {
+    uint64_t* s = prng->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+
+    return result;
+}
+
+
+uint64_t prng_below(struct prng* prng, uint64_t bound) {
+    // Reject the values of the incomplete last interval to avoid the modulo bias
+    uint64_t threshold = -bound % bound;
+    uint64_t r;
+    do {
+        r = prng_next(prng);
+    } while (r < threshold);
+    return r % bound;
+}
+
+
+uint64_t prng_derive(uint64_t seed, uint64_t value) {
+    uint64_t x = seed ^ splitmix64(&value);
+    return splitmix64(&x);
+}
+
+
+uint64_t prng_mix(uint64_t hash, uint64_t value) {
+    return finalize(hash ^ (value + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2)));
+}
+
+
+uint64_t prng_hash64(const void* content, size_t len, uint64_t seed) {
+    const uint8_t* bytes = content;
+    uint64_t hash = seed;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash = prng_mix(hash, word);
+    }
+    uint64_t last = 0;
+    memcpy(&last, bytes + i, len - i);
+    return prng_mix(hash, last ^ ((uint64_t) len << 56));
+}
+
+
+void prng_hash(const void* content, size_t len, uint64_t hash[2]) {
+    const uint8_t* bytes = content;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash[0] = prng_mix(hash[0], word);
+        hash[1] = prng_mix(hash[1], word ^ hash[0]);
+    }
+    uint64_t last = 0;
+    memcpy(&last, bytes + i, len - i);
+    hash[0] = prng_mix(hash[0], last ^ ((uint64_t) len << 56));
+    hash[1] = prng_mix(hash[1], last ^ hash[0] ^ len);
+}
+
+
+static void save_seed(FILE* file) {
+    fprintf(file, "%016" PRIx64, campaign_seed);
+}
+
+
+static int load_seed(const char* value) {
+    uint64_t seed;
+    if (sscanf(value, "%" SCNx64, &seed) != 1) {
+        return -1;
+    }
+    // Resuming with another seed would silently mix two campaigns
+    if (seed != campaign_seed) {
+        fprintf(stderr, "The checkpoint was written with the seed %" PRIu64 "\n", seed);
+        return -1;
+    }
+    return 0;
+}
+
+
+void prng_setup(uint64_t seed) {
+    campaign_seed = seed;
+    campaign_add_checkpoint_hook("seed", save_seed, load_seed);
+}
+
+
+void prng_seed_case(struct prng* prng, uint64_t case_id) {
+    prng_seed(prng, prng_derive(campaign_seed, case_id));
+}
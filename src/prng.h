@@ -0,0 +1,86 @@
+#ifndef FUZZER_PRNG_H
+#define FUZZER_PRNG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * State of a xoshiro256** generator.
+ * Fast and good enough for fuzzing, not for anything related to security.
+ */
+struct prng {
+    uint64_t s[4];
+};
+
+/**
+ * Seeds a generator, the state is expanded from the seed with splitmix64 so any seed (even 0) is fine
+ * @param prng the generator
+ * @param seed the seed
+ */
+void prng_seed(struct prng* prng, uint64_t seed);
+
+/**
+ * @param prng the generator
+ * @return the next 64 random bits
+ */
+uint64_t prng_next(struct prng* prng);
+
+/**
+ * @param prng the generator
+ * @param bound the upper bound, must be > 0
+ * @return a uniformly distributed number in [0, bound)
+ */
+uint64_t prng_below(struct prng* prng, uint64_t bound);
+
+/**
+ * Mixes several values in one seed, e.g. the campaign seed and the identifier of a worker or a test case
+ * @param seed the base seed
+ * @param value the value to mix in
+ * @return the derived seed
+ */
+uint64_t prng_derive(uint64_t seed, uint64_t value);
+
+/**
+ * Mixes a value into a hash (the finalizer of splitmix64 on the combination), the hashes of the fuzzer are all built
+ * with it: content, fingerprints of the extracted trees, behaviour classes
+ * @param hash the hash so far
+ * @param value the value to mix in
+ * @return the new hash
+ */
+uint64_t prng_mix(uint64_t hash, uint64_t value);
+
+/**
+ * Hashes some content on 64 bits, word by word with prng_mix(), the length with the last word
+ * @param content the content
+ * @param len its length
+ * @param seed the starting hash, e.g. the hash of what comes before
+ * @return the hash
+ */
+uint64_t prng_hash64(const void* content, size_t len, uint64_t seed);
+
+/**
+ * Hashes some content on 128 bits: two 64-bit lanes fed with every word, the second one with the first one too.
+ * The first lane is prng_hash64() of its seed.
+ * @param content the content
+ * @param len its length
+ * @param hash the seeds of the two lanes, replaced by the hash
+ */
+void prng_hash(const void* content, size_t len, uint64_t hash[2]);
+
+/**
+ * Sets the seed of the campaign the generators of the test cases are derived from.
+ * Registers it in the checkpoint, so that a resumed run with another seed is refused: has to be called before
+ * campaign_open().
+ * @param campaign_seed the seed shared by all the processes of the campaign
+ */
+void prng_setup(uint64_t campaign_seed);
+
+/**
+ * Seeds a generator that only depends on the campaign seed and the test case,
+ * so that a randomized test case generates the same archive whatever the shard running it
+ * @param prng the generator to seed
+ * @param case_id identifier of the test case (see campaign_case_id())
+ */
+void prng_seed_case(struct prng* prng, uint64_t case_id);
+
+#endif
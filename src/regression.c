@@ -0,0 +1,285 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "regression.h"
+#include "executor.h"
+#include "faults.h"
+#include "scratch.h"
+#include "store.h"
+
+
+// What the repeats of a reproducer on an extractor did, counted by all the workers
+struct cell {
+    unsigned int crashes;
+    unsigned int limits;
+    unsigned int signals;
+    unsigned int failures;
+};
+
+enum label {
+    LABEL_CRASH,
+    LABEL_FLAKY,
+    LABEL_FIXED,
+    LABEL_NEW,
+    // The extractor could not be run
+    LABEL_ERROR,
+    LABEL_COUNT
+};
+
+static const char* label_names[LABEL_COUNT] = {
+    [LABEL_CRASH] = "crash",
+    [LABEL_FLAKY] = "flaky",
+    [LABEL_FIXED] = "fixed",
+    [LABEL_NEW] = "new",
+    [LABEL_ERROR] = "error",
+};
+
+// Reproducers found, absolute paths
+static char** paths = NULL;
+static size_t path_count = 0;
+static size_t path_capacity = 0;
+// Fault schedule of each reproducer, kept next to it, NULL if it has none
+static char** schedules = NULL;
+
+
+static int add_reproducer(const char* path, __attribute__((unused)) const struct stat* st, int type,
+                          __attribute__((unused)) struct FTW* ftw) {
+    size_t len = strlen(path);
+    if (type != FTW_F || len < 4 || strcmp(path + len - 4, ".tar") != 0) {
+        return 0;
+    }
+    // Only the crashes: the objects of a store with a crash record, the archives kept by the suites for a crash.
+    // The limits, resource and semantic bugs do not crash, each one would be taken for a fixed crash.
+    int object = store_object_crashed(path);
+    const char* slash = strrchr(path, '/');
+    const char* name = slash != NULL ? slash + 1 : path;
+    if (object == 0 ||
+        (object == -1 && strncmp(name, REGRESSION_CRASH_PREFIX, strlen(REGRESSION_CRASH_PREFIX)) != 0 &&
+         strncmp(name, REGRESSION_SUCCESS_PREFIX, strlen(REGRESSION_SUCCESS_PREFIX)) != 0)) {
+        return 0;
+    }
+    if (path_count == path_capacity) {
+        size_t capacity = path_capacity == 0 ? 1024 : path_capacity * 2;
+        char** grown = realloc(paths, capacity * sizeof(*paths));
+        if (grown == NULL) {
+            return -1;
+        }
+        paths = grown;
+        path_capacity = capacity;
+    }
+    paths[path_count] = realpath(path, NULL);
+    if (paths[path_count] == NULL) {
+        return -1;
+    }
+    path_count++;
+    return 0;
+}
+
+
+static int compare_paths(const void* a, const void* b) {
+    return strcmp(*(char* const*) a, *(char* const*) b);
+}
+
+
+/**
+ * Runs the share of a worker: the executions whose number modulo the number of workers is its index
+ */
+static void run_worker(unsigned int worker, unsigned int jobs, char** extractors, int extractor_count,
+                       unsigned int repeats, struct cell* cells) {
+    char directory[64];
+    snprintf(directory, sizeof(directory), REGRESSION_DIRECTORY "-%u", worker);
+    if (scratch_mkdirs(directory) == -1 || scratch_clean(directory) == -1) {
+        perror(directory);
+        return;
+    }
+
+    size_t total = path_count * extractor_count * repeats;
+    for (size_t item = worker; item < total; item += jobs) {
+        size_t pair = item / repeats;
+        struct cell* cell = &cells[pair];
+        struct execution execution;
+        const char* schedule = schedules[pair / extractor_count];
+        if (schedule != NULL) {
+            setenv(FAULT_SCHEDULE_VARIABLE, schedule, 1);
+        }
+        int rv = executor_run(extractors[pair % extractor_count], directory, paths[pair / extractor_count],
+                              schedule != NULL, &execution);
+        unsetenv(FAULT_SCHEDULE_VARIABLE);
+        if (rv == -1) {
+            __atomic_fetch_add(&cell->failures, 1, __ATOMIC_RELAXED);
+        } else if (execution.crashed) {
+            __atomic_fetch_add(&cell->crashes, 1, __ATOMIC_RELAXED);
+        } else if (execution.limit != LIMIT_NONE) {
+            __atomic_fetch_add(&cell->limits, 1, __ATOMIC_RELAXED);
+        } else if (WIFSIGNALED(execution.status)) {
+            __atomic_fetch_add(&cell->signals, 1, __ATOMIC_RELAXED);
+        }
+        scratch_clean(directory);
+    }
+    rmdir(directory);
+}
+
+
+static enum label cell_label(const struct cell* cell, unsigned int repeats) {
+    if (cell->failures > 0) {
+        return LABEL_ERROR;
+    } else if (cell->crashes == repeats) {
+        return LABEL_CRASH;
+    } else if (cell->crashes > 0) {
+        return LABEL_FLAKY;
+    } else if (cell->limits > 0 || cell->signals > 0) {
+        return LABEL_NEW;
+    }
+    return LABEL_FIXED;
+}
+
+
+int regression_run(const char* reproducers, char** extractors, int extractor_count, unsigned int repeats,
+                   unsigned int jobs) {
+    if (nftw(reproducers, add_reproducer, 16, FTW_PHYS) == -1) {
+        perror(reproducers);
+        return -1;
+    }
+    if (path_count == 0) {
+        fprintf(stderr, "No reproducer (.tar) in %s\n", reproducers);
+        return -1;
+    }
+    qsort(paths, path_count, sizeof(*paths), compare_paths);
+
+    // The crashes of the fault suite only happen with their schedule
+    schedules = calloc(path_count, sizeof(*schedules));
+    if (schedules == NULL) {
+        perror("calloc");
+        return -1;
+    }
+    size_t scheduled = 0;
+    for (size_t p = 0; p < path_count; p++) {
+        char schedule[FAULT_SCHEDULE_SIZE];
+        if (fault_load_schedule(paths[p], schedule, sizeof(schedule)) == 0) {
+            schedules[p] = strdup(schedule);
+            scheduled++;
+        }
+    }
+    if (scheduled > 0 && fault_library() == NULL) {
+        fprintf(stderr, "%zu reproducers have a fault schedule, they need --fault-injection to crash\n", scheduled);
+    }
+
+    if (jobs == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = online > 0 ? (unsigned int) online : 1;
+    }
+    if (repeats == 0) {
+        repeats = 1;
+    }
+
+    // Shared with the workers, which only add to it
+    size_t cells_size = path_count * extractor_count * sizeof(struct cell);
+    struct cell* cells = mmap(NULL, cells_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (cells == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+
+    // The messages of thousands of executions would drown the matrix
+    int log = open(REGRESSION_LOG, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (log == -1) {
+        perror(REGRESSION_LOG);
+        munmap(cells, cells_size);
+        return -1;
+    }
+
+    fprintf(stderr, "Replaying %zu reproducers on %d extractors, %u times each, with %u workers\n",
+            path_count, extractor_count, repeats, jobs);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int rv = 0;
+    for (unsigned int k = 0; k < jobs; k++) {
+        pid_t pid = fork();
+        if (pid == -1) {
+            perror("fork");
+            rv = -1;
+            break;
+        }
+        if (pid == 0) {
+            dup2(log, STDERR_FILENO);
+            run_worker(k, jobs, extractors, extractor_count, repeats, cells);
+            exit(0);
+        }
+    }
+    int status;
+    while (wait(&status) > 0) {
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            rv = -1;
+        }
+    }
+    close(log);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // The matrix: one column per extractor
+    printf("reproducer");
+    for (int e = 0; e < extractor_count; e++) {
+        printf("\t%s", extractors[e]);
+    }
+    printf("\n");
+
+    size_t counts[extractor_count][LABEL_COUNT];
+    size_t changed[extractor_count];
+    memset(counts, 0, sizeof(counts));
+    memset(changed, 0, sizeof(changed));
+    for (size_t p = 0; p < path_count; p++) {
+        printf("%s", paths[p]);
+        enum label first = LABEL_ERROR;
+        for (int e = 0; e < extractor_count; e++) {
+            const struct cell* cell = &cells[p * extractor_count + e];
+            enum label label = cell_label(cell, repeats);
+            counts[e][label]++;
+            if (e == 0) {
+                first = label;
+            } else if (label != first) {
+                changed[e]++;
+            }
+            if (label == LABEL_FLAKY) {
+                printf("\t%s %u/%u", label_names[label], cell->crashes, repeats);
+            } else {
+                printf("\t%s", label_names[label]);
+            }
+        }
+        printf("\n");
+        free(paths[p]);
+        free(schedules[p]);
+    }
+    fflush(stdout);
+
+    for (int e = 0; e < extractor_count; e++) {
+        fprintf(stderr, "%s: %zu still crashing, %zu flaky, %zu fixed, %zu new behaviours", extractors[e],
+                counts[e][LABEL_CRASH], counts[e][LABEL_FLAKY], counts[e][LABEL_FIXED], counts[e][LABEL_NEW]);
+        if (counts[e][LABEL_ERROR] > 0) {
+            fprintf(stderr, ", %zu not run", counts[e][LABEL_ERROR]);
+        }
+        if (e > 0) {
+            fprintf(stderr, " (%zu changed since %s)", changed[e], extractors[0]);
+        }
+        fprintf(stderr, "\n");
+    }
+    fprintf(stderr, "%zu executions in %.1f s\n", path_count * extractor_count * repeats,
+            (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+    free(paths);
+    free(schedules);
+    paths = NULL;
+    schedules = NULL;
+    path_count = path_capacity = 0;
+    munmap(cells, cells_size);
+    return rv;
+}
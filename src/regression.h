@@ -0,0 +1,43 @@
+#ifndef FUZZER_REGRESSION_H
+#define FUZZER_REGRESSION_H
+
+/*
+ * Regression replay: instead of running the campaign again on a new build of the extractor, the crash reproducers
+ * kept so far are run against one or more extractors, each one several times, split between worker processes. They
+ * are found in a directory: the objects of a results store with a crash record (crash, or deterministic once
+ * confirmed), and elsewhere (an output directory, any directory) the archives named like the crashes of the suites,
+ * "success_*.tar" or "crash_*.tar". The limits, resource and semantic bugs are left out, they never crashed.
+ * Each pair of a reproducer and an extractor is labelled over its repeats:
+ *  - crash: crashed every time, still a bug
+ *  - flaky: crashed some of the times only
+ *  - fixed: exited without crashing every time
+ *  - new: another behaviour, a resource limit or a signal that the crash handler did not catch
+ * A reproducer with a fault schedule next to it ("<name>.fault", see faults.h) runs with that schedule, the injector
+ * being preloaded by --fault-injection.
+ * The matrix goes to stdout as TSV, one line per reproducer and a column per extractor, and the number of each
+ * label per extractor to stderr, with the number of labels that changed since the first extractor.
+ */
+
+// Names of the crash reproducers outside of a store
+#define REGRESSION_SUCCESS_PREFIX "success_"
+#define REGRESSION_CRASH_PREFIX "crash_"
+
+// Where the workers extract the reproducers, "<directory>-<worker>" in the current directory
+#define REGRESSION_DIRECTORY "regression"
+
+// Where the workers copy the messages of the extractors
+#define REGRESSION_LOG "regression.log"
+
+/**
+ * Replays the crash reproducers against the extractors
+ * @param reproducers directory searched (recursively) for the crash reproducers
+ * @param extractors paths of the extractors, the first one being the reference of the changes
+ * @param extractor_count number of extractors
+ * @param repeats number of executions of each reproducer on each extractor
+ * @param jobs number of worker processes, 0 for one per online CPU
+ * @return 0 on success, -1 on error
+ */
+int regression_run(const char* reproducers, char** extractors, int extractor_count, unsigned int repeats,
+                   unsigned int jobs);
+
+#endif
@@ -0,0 +1,344 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include "replay.h"
+#include "campaign.h"
+#include "tar.h"
+
+
+#define REPLAY_FILE "replay.log"
+#define REPLAY_MAGIC "FZRL\x01"
+#define REPLAY_MAGIC_SIZE 5
+
+// Two operations closer than this are merged, the bytes in between cost less than a new operation
+#define MERGE_GAP 3
+
+static bool enabled = false;
+static FILE* log_file = NULL;
+// Size of the log at the last checkpoint, -1 if not resuming from one
+static long checkpoint_offset = -1;
+
+// The previous archive of the log, every archive is recorded as the changes from it
+static unsigned char* reference = NULL;
+static size_t reference_length = 0;
+static size_t reference_capacity = 0;
+
+// Operations of the record being encoded: start and size of the ranges that differ from the reference
+struct op {
+    size_t start;
+    size_t size;
+};
+static struct op* ops = NULL;
+static size_t ops_capacity = 0;
+
+static int read_record(FILE* file, uint64_t* case_id, uint64_t* op_count);
+
+
+/**
+ * Resizes the reference archive, the new bytes are null bytes
+ */
+static void resize_reference(size_t length) {
+    if (length > reference_capacity) {
+        reference_capacity = length > 2 * reference_capacity ? length : 2 * reference_capacity;
+        reference = realloc(reference, reference_capacity);
+    }
+    if (length > reference_length) {
+        memset(reference + reference_length, 0, length - reference_length);
+    }
+    reference_length = length;
+}
+
+
+/**
+ * The first record of a log is compared to the golden header
+ */
+static void reset_reference(void) {
+    struct tar_t header;
+    generate_golden_tar_header(&header);
+    reference_length = 0;
+    resize_reference(sizeof(header));
+    memcpy(reference, &header, sizeof(header));
+}
+
+
+static void save_offset(FILE* file) {
+    long offset = 0;
+    if (log_file != NULL && fflush(log_file) == 0) {
+        offset = ftell(log_file);
+    }
+    fprintf(file, "%ld", offset);
+}
+
+
+static int load_offset(const char* value) {
+    char* end;
+    checkpoint_offset = strtol(value, &end, 10);
+    return end == value ? -1 : 0;
+}
+
+
+void replay_enable(void) {
+    enabled = true;
+    campaign_add_checkpoint_hook("replay", save_offset, load_offset);
+}
+
+
+int replay_open(bool resume) {
+    if (!enabled) {
+        return 0;
+    }
+
+    reset_reference();
+
+    log_file = fopen(REPLAY_FILE, resume ? "r+b" : "w+b");
+    if (log_file == NULL) {
+        perror(REPLAY_FILE);
+        return -1;
+    }
+
+    if (resume && checkpoint_offset >= REPLAY_MAGIC_SIZE) {
+        // Drop what was recorded after the checkpoint, these test cases run again
+        if (ftruncate(fileno(log_file), checkpoint_offset) == -1) {
+            perror(REPLAY_FILE);
+            return -1;
+        }
+
+        // The next record is compared to the last one kept
+        fseek(log_file, REPLAY_MAGIC_SIZE, SEEK_SET);
+        uint64_t case_id, op_count;
+        while (ftell(log_file) < checkpoint_offset && read_record(log_file, &case_id, &op_count) == 0) {
+        }
+        fseek(log_file, 0, SEEK_END);
+    } else {
+        if (ftruncate(fileno(log_file), 0) == -1) {
+            perror(REPLAY_FILE);
+            return -1;
+        }
+        fwrite(REPLAY_MAGIC, 1, REPLAY_MAGIC_SIZE, log_file);
+    }
+    return 0;
+}
+
+
+static void write_varint(uint64_t value) {
+    while (value >= 0x80) {
+        fputc((int) (value | 0x80) & 0xff, log_file);
+        value >>= 7;
+    }
+    fputc((int) value, log_file);
+}
+
+
+/**
+ * Writes a range of the archive to the log (null bytes after the parts) and copies it to the reference
+ */
+static void write_range(const struct iovec* iov, int iovcnt, size_t start, size_t size, unsigned char* copy) {
+    int i = 0;
+    while (i < iovcnt && start >= iov[i].iov_len) {
+        start -= iov[i].iov_len;
+        i++;
+    }
+    while (size > 0) {
+        if (i == iovcnt) {
+            fputc(0, log_file);
+            *copy++ = 0;
+            size--;
+            continue;
+        }
+        size_t chunk = iov[i].iov_len - start;
+        if (chunk > size) {
+            chunk = size;
+        }
+        fwrite((const char*) iov[i].iov_base + start, 1, chunk, log_file);
+        memcpy(copy, (const char*) iov[i].iov_base + start, chunk);
+        copy += chunk;
+        size -= chunk;
+        start = 0;
+        i++;
+    }
+}
+
+
+void replay_record(const struct iovec* iov, int iovcnt, size_t length) {
+    if (log_file == NULL) {
+        return;
+    }
+
+    size_t op_count = 0;
+    size_t offset = 0;
+
+    for (int i = 0; i <= iovcnt; i++) {
+        // The padding after the last part is made of null bytes
+        const unsigned char* base = i < iovcnt ? iov[i].iov_base : NULL;
+        size_t len = i < iovcnt ? iov[i].iov_len : (length > offset ? length - offset : 0);
+
+        for (size_t k = 0; k < len; k++, offset++) {
+            unsigned char byte = base ? base[k] : 0;
+            unsigned char expected = offset < reference_length ? reference[offset] : 0;
+            if (byte == expected) {
+                continue;
+            }
+
+            // Extend the last operation if it is close enough, otherwise start a new one
+            if (op_count > 0 && offset - (ops[op_count - 1].start + ops[op_count - 1].size) < MERGE_GAP) {
+                ops[op_count - 1].size = offset + 1 - ops[op_count - 1].start;
+                continue;
+            }
+            if (op_count == ops_capacity) {
+                ops_capacity = ops_capacity ? ops_capacity * 2 : 64;
+                ops = realloc(ops, ops_capacity * sizeof(struct op));
+            }
+            ops[op_count].start = offset;
+            ops[op_count].size = 1;
+            op_count++;
+        }
+    }
+
+    write_varint(campaign_case_id());
+    write_varint(offset);
+    write_varint(op_count);
+
+    resize_reference(offset);
+    size_t previous_end = 0;
+    for (size_t op = 0; op < op_count; op++) {
+        write_varint(ops[op].start - previous_end);
+        write_varint(ops[op].size);
+        write_range(iov, iovcnt, ops[op].start, ops[op].size, reference + ops[op].start);
+        previous_end = ops[op].start + ops[op].size;
+    }
+}
+
+
+void replay_close(void) {
+    if (log_file != NULL) {
+        fclose(log_file);
+        log_file = NULL;
+    }
+    free(ops);
+    ops = NULL;
+    ops_capacity = 0;
+    free(reference);
+    reference = NULL;
+    reference_length = 0;
+    reference_capacity = 0;
+}
+
+
+static int read_varint(FILE* file, uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(file);
+        if (c == EOF) {
+            return -1;
+        }
+        *value |= (uint64_t) (c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * Reads the next record of a replay log and applies it to the reference archive
+ * @param file the replay log
+ * @param case_id where to store the test case identifier
+ * @param op_count where to store the number of operations
+ * @return 0 on success, -1 at the end of the log or if it is corrupted
+ */
+static int read_record(FILE* file, uint64_t* case_id, uint64_t* op_count) {
+    uint64_t length;
+    if (read_varint(file, case_id) == -1 || read_varint(file, &length) == -1 || read_varint(file, op_count) == -1) {
+        return -1;
+    }
+    resize_reference(length);
+
+    uint64_t position = 0;
+    for (uint64_t op = 0; op < *op_count; op++) {
+        uint64_t gap, size;
+        if (read_varint(file, &gap) == -1 || read_varint(file, &size) == -1) {
+            return -1;
+        }
+        position += gap;
+        if (position + size > length || fread(reference + position, 1, size, file) != size) {
+            return -1;
+        }
+        position += size;
+    }
+    return 0;
+}
+
+
+static FILE* open_log(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        return NULL;
+    }
+
+    char magic[REPLAY_MAGIC_SIZE];
+    if (fread(magic, 1, REPLAY_MAGIC_SIZE, file) != REPLAY_MAGIC_SIZE || memcmp(magic, REPLAY_MAGIC, REPLAY_MAGIC_SIZE)) {
+        fprintf(stderr, "%s is not a replay log\n", path);
+        fclose(file);
+        return NULL;
+    }
+
+    reset_reference();
+    return file;
+}
+
+
+int replay_list(const char* path) {
+    FILE* file = open_log(path);
+    if (file == NULL) {
+        return -1;
+    }
+
+    uint64_t case_id, op_count;
+    unsigned long records = 0;
+    while (read_record(file, &case_id, &op_count) == 0) {
+        printf("%s\t%" PRIu64 "\tlength=%zu ops=%" PRIu64 "\n",
+               suite_name(case_id >> 32), case_id & 0xffffffff, reference_length, op_count);
+        records++;
+    }
+    printf("%lu records, %ld bytes\n", records, ftell(file));
+
+    fclose(file);
+    return 0;
+}
+
+
+int replay_regenerate(const char* path, uint64_t wanted) {
+    FILE* file = open_log(path);
+    if (file == NULL) {
+        return -1;
+    }
+
+    uint64_t case_id, op_count;
+    int written = 0;
+    while (read_record(file, &case_id, &op_count) == 0) {
+        if (case_id != wanted) {
+            continue;
+        }
+
+        char name[128];
+        snprintf(name, sizeof(name), "replay-%s-%" PRIu64 "-%d.tar",
+                 suite_name(case_id >> 32), case_id & 0xffffffff, written);
+        FILE* out = fopen(name, "wb");
+        if (out == NULL) {
+            perror(name);
+            break;
+        }
+        fwrite(reference, 1, reference_length, out);
+        fclose(out);
+        printf("%s\n", name);
+        written++;
+    }
+
+    fclose(file);
+    return written;
+}
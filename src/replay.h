@@ -0,0 +1,63 @@
+#ifndef FUZZER_REPLAY_H
+#define FUZZER_REPLAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+/*
+ * Replay log: one compact record per executed archive, enough to write the archive again bit for bit.
+ * A record is the test case identifier followed by the mutation operations that turn the archive of the
+ * previous record (the golden header of generate_golden_tar_header() for the first one) into the archive:
+ *
+ *     varint case_id, varint length, varint op_count, op_count * (varint gap, varint size, size bytes)
+ *
+ * The previous archive is cut or extended with null bytes to "length", then each operation overwrites
+ * "size" bytes, "gap" bytes after the end of the previous operation.
+ * A test case of the field sweeps takes about ten bytes, an archive is regenerated by reading the log from its start.
+ */
+
+/**
+ * Enables the replay log, its position is saved in the checkpoint.
+ * Has to be called before campaign_open().
+ */
+void replay_enable(void);
+
+/**
+ * Opens the replay log "replay.log" of the working directory, if it was enabled.
+ * When resuming, the records written after the checkpoint are dropped, they are executed again.
+ * @param resume whether the campaign continues from a checkpoint
+ * @return 0 on success, -1 on error
+ */
+int replay_open(bool resume);
+
+/**
+ * Records the archive of the current test case, if the log is open
+ * @param iov the parts of the archive
+ * @param iovcnt number of parts
+ * @param length length of the archive, the bytes after the parts are null bytes (padding)
+ */
+void replay_record(const struct iovec* iov, int iovcnt, size_t length);
+
+/**
+ * Flushes and closes the replay log
+ */
+void replay_close(void);
+
+/**
+ * Lists the records of a replay log
+ * @param path the replay log
+ * @return 0 on success, -1 on error
+ */
+int replay_list(const char* path);
+
+/**
+ * Writes again the archives of a test case recorded in a replay log, as "replay-<suite>-<index>-<n>.tar"
+ * @param path the replay log
+ * @param case_id identifier of the test case (see campaign_case_id())
+ * @return the number of archives written, -1 on error
+ */
+int replay_regenerate(const char* path, uint64_t case_id);
+
+#endif
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "resource.h"
+#include "campaign.h"
+
+
+// Number of executions before the outlier detection starts
+#define MIN_SAMPLES 100
+
+static const struct {
+    const char* name;
+    const char* unit;
+    // Default threshold, 0 if none
+    double threshold;
+    // An outlier also has to be this much above the mean: a 1 ms execution among 0 ms ones is noise
+    double min_excess;
+} metrics[RESOURCE_METRIC_COUNT] = {
+    [RESOURCE_CPU] = {"cpu", "ms", 2000, 50},
+    [RESOURCE_WALL] = {"wall", "ms", 10000, 200},
+    [RESOURCE_RSS] = {"rss", "KB", 512 * 1024, 16 * 1024},
+    [RESOURCE_FAULTS] = {"faults", "", 0, 4096},
+    [RESOURCE_WRITTEN] = {"written", "B", 64 * 1024 * 1024, 1024 * 1024},
+};
+
+static double thresholds[RESOURCE_METRIC_COUNT];
+static bool thresholds_set = false;
+static double outlier_sigma = 8;
+
+// Running mean and variance of each metric (Welford)
+static struct {
+    unsigned long count;
+    double mean;
+    double m2;
+} stats[RESOURCE_METRIC_COUNT];
+
+
+static void init_thresholds(void) {
+    if (!thresholds_set) {
+        for (int m = 0; m < RESOURCE_METRIC_COUNT; m++) {
+            thresholds[m] = metrics[m].threshold;
+        }
+        thresholds_set = true;
+    }
+}
+
+
+int resource_parse_threshold(const char* arg) {
+    init_thresholds();
+
+    const char* equal = strchr(arg, '=');
+    if (equal == NULL) {
+        return -1;
+    }
+    char* end;
+    double value = strtod(equal + 1, &end);
+    if (end == equal + 1 || *end != '\0' || value < 0) {
+        return -1;
+    }
+
+    for (int m = 0; m < RESOURCE_METRIC_COUNT; m++) {
+        if (strlen(metrics[m].name) == (size_t) (equal - arg) && strncmp(metrics[m].name, arg, equal - arg) == 0) {
+            thresholds[m] = value;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+
+void resource_set_outlier_sigma(double sigma) {
+    outlier_sigma = sigma;
+}
+
+
+static void save_stats(FILE* file) {
+    for (int m = 0; m < RESOURCE_METRIC_COUNT; m++) {
+        fprintf(file, "%s%lu %.17g %.17g", m ? " " : "", stats[m].count, stats[m].mean, stats[m].m2);
+    }
+}
+
+
+static int load_stats(const char* value) {
+    for (int m = 0; m < RESOURCE_METRIC_COUNT; m++) {
+        int used;
+        if (sscanf(value, "%lu %lg %lg%n", &stats[m].count, &stats[m].mean, &stats[m].m2, &used) != 3) {
+            return -1;
+        }
+        value += used;
+    }
+    return 0;
+}
+
+
+void resource_enable(void) {
+    campaign_add_checkpoint_hook("resource", save_stats, load_stats);
+}
+
+
+static void metric_values(const struct execution* execution, double values[RESOURCE_METRIC_COUNT]) {
+    values[RESOURCE_CPU] = execution->user_time + execution->sys_time;
+    values[RESOURCE_WALL] = execution->wall_time;
+    values[RESOURCE_RSS] = (double) execution->max_rss;
+    values[RESOURCE_FAULTS] = (double) (execution->minor_faults + execution->major_faults);
+    values[RESOURCE_WRITTEN] = (double) execution->bytes_written;
+}
+
+
+bool resource_check(const struct execution* execution, char* reason, size_t len) {
+    init_thresholds();
+
+    double values[RESOURCE_METRIC_COUNT];
+    metric_values(execution, values);
+
+    bool flagged = false;
+    size_t used = 0;
+    reason[0] = '\0';
+
+    for (int m = 0; m < RESOURCE_METRIC_COUNT && used < len; m++) {
+        double stddev = stats[m].count > 1 ? sqrt(stats[m].m2 / (stats[m].count - 1)) : 0;
+
+        if (thresholds[m] > 0 && values[m] > thresholds[m]) {
+            used += snprintf(reason + used, len - used, "%s%s=%.0f%s>%.0f", flagged ? " " : "",
+                             metrics[m].name, values[m], metrics[m].unit, thresholds[m]);
+            flagged = true;
+        } else if (outlier_sigma > 0 && stats[m].count >= MIN_SAMPLES &&
+                   values[m] > stats[m].mean + outlier_sigma * stddev &&
+                   values[m] > stats[m].mean + metrics[m].min_excess) {
+            used += snprintf(reason + used, len - used, "%s%s=%.0f%s outlier (mean %.1f, stddev %.1f)",
+                             flagged ? " " : "", metrics[m].name, values[m], metrics[m].unit,
+                             stats[m].mean, stddev);
+            flagged = true;
+        }
+    }
+
+    // The flagged executions would hide the next ones
+    if (!flagged) {
+        for (int m = 0; m < RESOURCE_METRIC_COUNT; m++) {
+            stats[m].count++;
+            double delta = values[m] - stats[m].mean;
+            stats[m].mean += delta / stats[m].count;
+            stats[m].m2 += delta * (values[m] - stats[m].mean);
+        }
+    }
+    return flagged;
+}
+
+
+void resource_describe(const struct execution* execution, char* buf, size_t len) {
+    double values[RESOURCE_METRIC_COUNT];
+    metric_values(execution, values);
+
+    size_t used = 0;
+    for (int m = 0; m < RESOURCE_METRIC_COUNT && used < len; m++) {
+        used += snprintf(buf + used, len - used, "%s%s=%.*f%s", m ? " " : "", metrics[m].name,
+                         m <= RESOURCE_WALL ? 1 : 0, values[m], metrics[m].unit);
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef FUZZER_RESOURCE_H
+#define FUZZER_RESOURCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "executor.h"
+
+/*
+ * Detection of resource bugs: archives that make the extractor spend too much CPU time, memory,
+ * page faults or disk writes. An execution is flagged when a metric is above its threshold,
+ * or when it is an outlier: more than N standard deviations above the mean of the previous executions.
+ */
+
+enum resource_metric {
+    // User + system time, in milliseconds
+    RESOURCE_CPU,
+    // Elapsed time, in milliseconds
+    RESOURCE_WALL,
+    // Peak resident set size, in kilobytes
+    RESOURCE_RSS,
+    // Minor + major page faults
+    RESOURCE_FAULTS,
+    // Bytes written
+    RESOURCE_WRITTEN,
+    RESOURCE_METRIC_COUNT
+};
+
+/**
+ * Parses a threshold of the form "metric=value" (e.g. "rss=262144") and sets it, 0 disables the threshold
+ * @param arg the string to parse
+ * @return 0 on success, -1 if the metric is unknown or the value invalid
+ */
+int resource_parse_threshold(const char* arg);
+
+/**
+ * Sets how many standard deviations above the mean make an outlier, 0 disables the outlier detection
+ * @param sigma the number of standard deviations
+ */
+void resource_set_outlier_sigma(double sigma);
+
+/**
+ * Saves the statistics of the executions in the checkpoint, has to be called before campaign_open()
+ */
+void resource_enable(void);
+
+/**
+ * Checks the cost of an execution and adds it to the statistics if it is not flagged
+ * @param execution the execution
+ * @param reason where to write why the execution is flagged
+ * @param len size of reason
+ * @return true if the execution is a resource bug
+ */
+bool resource_check(const struct execution* execution, char* reason, size_t len);
+
+/**
+ * Writes the costs of an execution, e.g. "cpu=1.2ms wall=3.4ms rss=1024KB faults=80 written=12B"
+ * @param execution the execution
+ * @param buf where to write
+ * @param len size of buf
+ */
+void resource_describe(const struct execution* execution, char* buf, size_t len);
+
+#endif
@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "scheduler.h"
+#include "campaign.h"
+
+
+// A strategy and what its slices gave so far
+struct strategy {
+    const char* name;
+    void (*run)(char* extractor);
+    bool finished;
+    // Steps run to their end, skipped by the next slices
+    unsigned int steps_done;
+    // What the step not finished yet returned in the earlier slices, e.g. crashes
+    int partial;
+    unsigned long slices;
+    unsigned long executions;
+    unsigned long discoveries;
+    // Sum of the rewards of the slices
+    double rewards;
+};
+
+static struct strategy strategies[SCHEDULER_MAX_STRATEGIES];
+static int strategy_count = 0;
+static unsigned long slice_executions = SCHEDULER_SLICE_EXECUTIONS;
+static unsigned long discoveries = 0;
+
+// Strategy of the current slice, -1 outside of the scheduler, and the steps it started in the slice
+static int current = -1;
+static unsigned int steps;
+
+// Strategies read from the checkpoint, before they are added again, by name
+#define MAX_NAME 32
+static struct {
+    char name[MAX_NAME];
+    struct strategy state;
+} saved[SCHEDULER_MAX_STRATEGIES];
+static int saved_count = 0;
+
+
+static void save_strategies(FILE* file) {
+    for (int s = 0; s < strategy_count; s++) {
+        const struct strategy* strategy = &strategies[s];
+        fprintf(file, "%s%s %d %u %d %lu %lu %lu %.17g", s ? " " : "", strategy->name, strategy->finished,
+                strategy->steps_done, strategy->partial, strategy->slices, strategy->executions,
+                strategy->discoveries, strategy->rewards);
+    }
+}
+
+
+static int load_strategies(const char* value) {
+    saved_count = 0;
+    while (*value != '\0') {
+        if (saved_count == SCHEDULER_MAX_STRATEGIES) {
+            return -1;
+        }
+        struct strategy* state = &saved[saved_count].state;
+        int finished;
+        int used;
+        if (sscanf(value, " %31s %d %u %d %lu %lu %lu %lg%n", saved[saved_count].name, &finished, &state->steps_done,
+                   &state->partial, &state->slices, &state->executions, &state->discoveries, &state->rewards,
+                   &used) != 8) {
+            return -1;
+        }
+        state->finished = finished != 0;
+        saved_count++;
+        value += used;
+    }
+    return 0;
+}
+
+
+void scheduler_enable(void) {
+    campaign_add_checkpoint_hook("scheduler", save_strategies, load_strategies);
+}
+
+
+int scheduler_add(const char* name, void (*run)(char* extractor)) {
+    if (strategy_count == SCHEDULER_MAX_STRATEGIES) {
+        fprintf(stderr, "Too many strategies, '%s' ignored\n", name);
+        return -1;
+    }
+    strategies[strategy_count] = (struct strategy) {.name = name, .run = run};
+    for (int s = 0; s < saved_count; s++) {
+        if (strcmp(saved[s].name, name) == 0) {
+            strategies[strategy_count] = saved[s].state;
+            strategies[strategy_count].name = name;
+            strategies[strategy_count].run = run;
+        }
+    }
+    strategy_count++;
+    return 0;
+}
+
+
+void scheduler_set_slice(unsigned long executions) {
+    slice_executions = executions > 0 ? executions : 1;
+}
+
+
+void scheduler_note_discovery(void) {
+    discoveries++;
+}
+
+
+bool scheduler_step(int (*test)(char* extractor), char* extractor, int* result) {
+    if (current == -1) {
+        *result = test(extractor);
+        return true;
+    }
+    struct strategy* strategy = &strategies[current];
+    steps++;
+    if (steps <= strategy->steps_done || campaign_slice_spent()) {
+        return false;
+    }
+    *result = strategy->partial + test(extractor);
+    // A test case was refused: the step goes on in the next slice
+    if (campaign_slice_over()) {
+        strategy->partial = *result;
+        return false;
+    }
+    strategy->partial = 0;
+    strategy->steps_done = steps;
+    return true;
+}
+
+
+static double now_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+/**
+ * Picks the strategy of the next slice: those never tried first, in order, then the highest upper confidence bound
+ * @return its index, -1 if every strategy is finished
+ */
+static int select_strategy(unsigned long total_slices) {
+    int best = -1;
+    double best_score = 0;
+    for (int s = 0; s < strategy_count; s++) {
+        if (strategies[s].finished) {
+            continue;
+        }
+        if (strategies[s].slices == 0) {
+            return s;
+        }
+        double mean = strategies[s].rewards / strategies[s].slices;
+        double score = mean + SCHEDULER_EXPLORATION * sqrt(2 * log((double) total_slices) / strategies[s].slices);
+        if (best == -1 || score > best_score) {
+            best = s;
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+
+int scheduler_run(char* extractor, double budget) {
+    double start = now_seconds();
+    // The slices of the runs before a resume count for the confidence bounds
+    unsigned long total_slices = 0;
+    for (int s = 0; s < strategy_count; s++) {
+        total_slices += strategies[s].slices;
+    }
+    unsigned long resumed_slices = total_slices;
+
+    for (;;) {
+        double left = budget - (now_seconds() - start);
+        if (budget > 0 && left <= 0) {
+            break;
+        }
+        int s = select_strategy(total_slices);
+        if (s == -1) {
+            break;
+        }
+        struct strategy* strategy = &strategies[s];
+
+        unsigned long executed_before, crashes_before;
+        campaign_totals(&executed_before, &crashes_before);
+        unsigned long discoveries_before = discoveries;
+
+        double seconds = budget > 0 && left < SCHEDULER_SLICE_SECONDS ? left : SCHEDULER_SLICE_SECONDS;
+        campaign_start_slice(slice_executions, seconds);
+        current = s;
+        steps = 0;
+        strategy->run(extractor);
+        current = -1;
+        // Returned before the end of its slice: nothing left to run
+        strategy->finished = !campaign_end_slice();
+
+        unsigned long executed, crashes;
+        campaign_totals(&executed, &crashes);
+        unsigned long slice_executed = executed - executed_before;
+        unsigned long found = crashes - crashes_before + discoveries - discoveries_before;
+        double reward = slice_executed > 0 ? (double) found / slice_executed : 0;
+
+        strategy->slices++;
+        strategy->executions += slice_executed;
+        strategy->discoveries += found;
+        strategy->rewards += reward > 1 ? 1 : reward;
+        total_slices++;
+        printf("        > Scheduler: %s ran %lu test cases, %lu discoveries%s\n",
+               strategy->name, slice_executed, found, strategy->finished ? ", finished" : "");
+    }
+
+    int unfinished = 0;
+    printf("\033[1;32m~~~~~%lu slices in %.1f s, by strategy:~~~~~\033[0m\n", total_slices - resumed_slices,
+           now_seconds() - start);
+    for (int s = 0; s < strategy_count; s++) {
+        printf("        > %s: %lu slices, %lu test cases, %lu discoveries, %s\n",
+               strategies[s].name, strategies[s].slices, strategies[s].executions, strategies[s].discoveries,
+               strategies[s].finished ? "finished" : "unfinished");
+        unfinished += !strategies[s].finished;
+    }
+    return unfinished;
+}
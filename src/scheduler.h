@@ -0,0 +1,77 @@
+#ifndef FUZZER_SCHEDULER_H
+#define FUZZER_SCHEDULER_H
+
+#include <stdbool.h>
+
+/*
+ * Adaptive scheduler of the strategies of the campaign (field sweeps, checksum, null characters, file sizes,
+ * numeric fields...): instead of running each one to its end in a fixed order, the campaign is cut in slices of
+ * SCHEDULER_SLICE_EXECUTIONS test cases or SCHEDULER_SLICE_SECONDS seconds, and each slice goes to the strategy that
+ * looks the most productive, a multi-armed bandit (UCB1). The reward of a slice is the number of crashes and new
+ * behaviours (syscall feedback, fingerprints) per test case executed. A strategy that returns before the end of
+ * its slice is finished, the others go on from where they stopped (see campaign_start_slice()).
+ *
+ * A strategy is made of steps, a test followed by its report (the sweep of a field, the boundaries of the numeric
+ * fields...), run with scheduler_step(). The steps a strategy finished in an earlier slice are skipped, and a step
+ * cut by the end of its slice prints no report: it goes on in the next slice of the strategy, where the test cases
+ * it finished are not claimed again (see campaign_progress()).
+ *
+ * With a wall-clock budget, the campaign stops when it is spent, and --resume continues the unfinished strategies.
+ * What each strategy did (steps, slices, rewards) is saved with the checkpoints, so that the resumed run skips the
+ * same steps, adds up the same reports and picks the strategies with the same rewards. A run interrupted in the
+ * middle of a slice loses what that slice found, its test cases are not run again.
+ */
+
+// Size of a slice, whichever comes first
+#define SCHEDULER_SLICE_EXECUTIONS 256
+#define SCHEDULER_SLICE_SECONDS 5.0
+
+// Weight of the exploration: the rewards are rates of a few percent, the sqrt(2) of UCB1 would only explore
+#define SCHEDULER_EXPLORATION 0.1
+
+// Most strategies
+#define SCHEDULER_MAX_STRATEGIES 16
+
+/**
+ * Saves the state of the strategies with the checkpoints, has to be called before campaign_open()
+ */
+void scheduler_enable(void);
+
+/**
+ * Adds a strategy, the first ones are tried first, with its state of the checkpoint if there is one
+ * @param name name of the strategy, for the reports
+ * @param run runs the strategy, until its end or until campaign_claim() refuses the test cases
+ * @return 0 on success, -1 if there are too many strategies
+ */
+int scheduler_add(const char* name, void (*run)(char* extractor));
+
+/**
+ * Sets the number of test cases of a slice, SCHEDULER_SLICE_EXECUTIONS by default
+ * @param executions test cases per slice, at least 1
+ */
+void scheduler_set_slice(unsigned long executions);
+
+/**
+ * Counts a new behaviour found by the current slice, a crash is counted by the campaign
+ */
+void scheduler_note_discovery(void);
+
+/**
+ * Runs a step of the strategy of the current slice, or just runs it outside of the scheduler
+ * @param test the test of the step
+ * @param extractor the extractor
+ * @param result where to store what the test returned, added up over the slices of the step
+ * @return true if the step ran to its end and its report can be printed, false if it was finished in an earlier
+ * slice or is not finished yet
+ */
+bool scheduler_step(int (*test)(char* extractor), char* extractor, int* result);
+
+/**
+ * Runs the strategies slice by slice, then prints what each strategy cost and found
+ * @param extractor the extractor
+ * @param budget seconds of the run, 0 to run every strategy to its end
+ * @return the number of strategies left unfinished when the budget was spent
+ */
+int scheduler_run(char* extractor, double budget);
+
+#endif
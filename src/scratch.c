@@ -0,0 +1,337 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "scratch.h"
+#include "prng.h"
+
+
+// Bytes of each regular file that go into the fingerprint, the size covers the rest
+#define FINGERPRINT_CONTENT (64 * 1024)
+
+
+/**
+ * Hashes an entry of the extracted tree: its name and where it is, type, permissions, size,
+ * target of a symbolic link, and the beginning of the content of a regular file
+ */
+static uint64_t fingerprint_entry(int dir_fd, const char* name, uint64_t dir_hash, const struct stat* st) {
+    uint64_t hash = prng_hash64(name, strlen(name), dir_hash);
+    hash = prng_mix(hash, st->st_mode);
+    if (S_ISLNK(st->st_mode)) {
+        char target[PATH_MAX];
+        ssize_t len = readlinkat(dir_fd, name, target, sizeof(target));
+        if (len > 0) {
+            hash = prng_hash64(target, len, hash);
+        }
+    } else if (S_ISREG(st->st_mode)) {
+        hash = prng_mix(hash, st->st_size);
+        // The extractor may have created it without any permission, root reads it anyway
+        int fd = openat(dir_fd, name, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC);
+        if (fd != -1) {
+            static unsigned char content[FINGERPRINT_CONTENT];
+            ssize_t got = read(fd, content, sizeof(content));
+            if (got > 0) {
+                hash = prng_hash64(content, got, hash);
+            }
+            close(fd);
+        }
+    } else if (S_ISCHR(st->st_mode) || S_ISBLK(st->st_mode)) {
+        hash = prng_mix(hash, st->st_rdev);
+    }
+    return hash;
+}
+
+
+/**
+ * Removes the content of an open directory, the descriptor is closed
+ * @param dir_fd the directory
+ * @param dir_hash hash of the path of the directory
+ * @param fingerprint where to add the hashes of the entries, NULL not to compute them
+ * @return 0 on success, -1 if something could not be removed
+ */
+static int clean_fd(int dir_fd, uint64_t dir_hash, uint64_t* fingerprint) {
+    DIR* dir = fdopendir(dir_fd);
+    if (dir == NULL) {
+        close(dir_fd);
+        return -1;
+    }
+
+    int rv = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        struct stat st;
+        if (fstatat(dir_fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == -1) {
+            rv = -1;
+            continue;
+        }
+
+        // Summed: the fingerprint does not depend on the order of readdir()
+        uint64_t entry_hash = 0;
+        if (fingerprint != NULL) {
+            entry_hash = fingerprint_entry(dir_fd, entry->d_name, dir_hash, &st);
+            *fingerprint += entry_hash;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            // The extractor may have created it without any permission
+            if ((st.st_mode & S_IRWXU) != S_IRWXU) {
+                fchmodat(dir_fd, entry->d_name, S_IRWXU, 0);
+            }
+            int child = openat(dir_fd, entry->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+            if (child == -1 || clean_fd(child, entry_hash, fingerprint) == -1) {
+                rv = -1;
+            }
+            if (unlinkat(dir_fd, entry->d_name, AT_REMOVEDIR) == -1) {
+                rv = -1;
+            }
+        } else if (unlinkat(dir_fd, entry->d_name, 0) == -1) {
+            rv = -1;
+        }
+    }
+
+    closedir(dir);
+    return rv;
+}
+
+
+int scratch_clean(const char* dir) {
+    return scratch_clean_fingerprint(dir, NULL);
+}
+
+
+int scratch_clean_fingerprint(const char* dir, uint64_t* fingerprint) {
+    if (fingerprint != NULL) {
+        *fingerprint = 0;
+    }
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if (fd == -1) {
+        return errno == ENOENT ? 0 : -1;
+    }
+    return clean_fd(fd, 0, fingerprint);
+}
+
+
+int scratch_mkdirs(const char* path) {
+    char buf[PATH_MAX];
+    snprintf(buf, sizeof(buf), "%s", path);
+
+    for (char* p = buf + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            if (mkdir(buf, 0755) == -1 && errno != EEXIST) {
+                return -1;
+            }
+            *p = '/';
+        }
+    }
+    if (mkdir(buf, 0755) == -1 && errno != EEXIST) {
+        return -1;
+    }
+    return 0;
+}
+
+
+int scratch_copy_file(const char* from, const char* to) {
+    int in = open(from, O_RDONLY);
+    if (in == -1) {
+        return -1;
+    }
+    int out = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out == -1) {
+        close(in);
+        return -1;
+    }
+
+    char buf[8192];
+    ssize_t n;
+    int rv = 0;
+    while ((n = read(in, buf, sizeof(buf))) > 0) {
+        if (write(out, buf, n) != n) {
+            rv = -1;
+            break;
+        }
+    }
+    if (n == -1) {
+        rv = -1;
+    }
+    close(in);
+    close(out);
+    return rv;
+}
+
+
+int scratch_create_file(const char* path, const void* content, size_t len) {
+    // The private file is next to the other one, "<directory>/.<name>.<pid>"
+    char temporary[PATH_MAX + 32];
+    const char* slash = strrchr(path, '/');
+    if (slash != NULL) {
+        snprintf(temporary, sizeof(temporary), "%.*s/.%s.%d", (int) (slash - path), path, slash + 1, (int) getpid());
+    } else {
+        snprintf(temporary, sizeof(temporary), ".%s.%d", path, (int) getpid());
+    }
+
+    int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        perror(temporary);
+        return -1;
+    }
+    int rv = 0;
+    if (write(fd, content, len) != (ssize_t) len) {
+        perror(temporary);
+        rv = -1;
+    }
+    close(fd);
+    if (rv == 0 && link(temporary, path) == -1 && errno != EEXIST) {
+        perror(path);
+        rv = -1;
+    }
+    unlink(temporary);
+    return rv;
+}
+
+
+/**
+ * Copies the content of an open directory into another one, the descriptors are closed
+ * @param from_fd the directory to copy
+ * @param to_fd where to copy it
+ * @param skip entries not copied, NULL for all of them
+ * @return 0 on success, -1 if something could not be copied
+ */
+static int copy_fd(int from_fd, int to_fd, bool (*skip)(const char* name)) {
+    DIR* dir = fdopendir(from_fd);
+    if (dir == NULL) {
+        close(from_fd);
+        close(to_fd);
+        return -1;
+    }
+
+    int rv = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char* name = entry->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0 || (skip != NULL && skip(name))) {
+            continue;
+        }
+
+        struct stat st;
+        if (fstatat(from_fd, name, &st, AT_SYMLINK_NOFOLLOW) == -1) {
+            rv = -1;
+            continue;
+        }
+        mode_t mode = st.st_mode & 07777;
+
+        if (S_ISDIR(st.st_mode)) {
+            // Filled first, the permissions of the copy are set afterwards
+            if (mkdirat(to_fd, name, S_IRWXU) == -1 && errno != EEXIST) {
+                rv = -1;
+                continue;
+            }
+            int child_from = openat(from_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+            int child_to = openat(to_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+            if (child_from == -1 || child_to == -1) {
+                if (child_from != -1) {
+                    close(child_from);
+                }
+                if (child_to != -1) {
+                    close(child_to);
+                }
+                rv = -1;
+                continue;
+            }
+            if (copy_fd(child_from, child_to, NULL) == -1) {
+                rv = -1;
+            }
+            fchmodat(to_fd, name, mode, 0);
+        } else if (S_ISLNK(st.st_mode)) {
+            char target[PATH_MAX];
+            ssize_t len = readlinkat(from_fd, name, target, sizeof(target) - 1);
+            if (len == -1) {
+                rv = -1;
+                continue;
+            }
+            target[len] = '\0';
+            if (symlinkat(target, to_fd, name) == -1) {
+                rv = -1;
+            }
+        } else if (S_ISREG(st.st_mode)) {
+            int in = openat(from_fd, name, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC);
+            int out = openat(to_fd, name, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, S_IRUSR | S_IWUSR);
+            char buf[8192];
+            ssize_t n = 0;
+            while (in != -1 && out != -1 && (n = read(in, buf, sizeof(buf))) > 0) {
+                if (write(out, buf, n) != n) {
+                    n = -1;
+                    break;
+                }
+            }
+            if (in == -1 || out == -1 || n == -1 || fchmod(out, mode) == -1) {
+                rv = -1;
+            }
+            if (in != -1) {
+                close(in);
+            }
+            if (out != -1) {
+                close(out);
+            }
+        } else if (mknodat(to_fd, name, st.st_mode, st.st_rdev) == -1) {
+            // FIFOs, sockets and devices
+            rv = -1;
+        }
+    }
+
+    closedir(dir);
+    close(to_fd);
+    return rv;
+}
+
+
+int scratch_copy_tree(const char* from, const char* to, bool (*skip)(const char* name)) {
+    if (scratch_mkdirs(to) == -1) {
+        return -1;
+    }
+    int from_fd = open(from, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if (from_fd == -1) {
+        return -1;
+    }
+    int to_fd = open(to, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if (to_fd == -1) {
+        close(from_fd);
+        return -1;
+    }
+    return copy_fd(from_fd, to_fd, skip);
+}
+
+
+uint8_t* scratch_read_file(const char* path, size_t* len) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return NULL;
+    }
+    struct stat st;
+    uint8_t* content = NULL;
+    if (fstat(fd, &st) == 0 && (content = malloc(st.st_size > 0 ? st.st_size : 1)) != NULL) {
+        size_t got = 0;
+        ssize_t n = 1;
+        while (got < (size_t) st.st_size && (n = read(fd, content + got, st.st_size - got)) > 0) {
+            got += n;
+        }
+        if (n <= 0 && got < (size_t) st.st_size) {
+            free(content);
+            content = NULL;
+        }
+        *len = got;
+    }
+    close(fd);
+    return content;
+}
@@ -0,0 +1,69 @@
+#ifndef FUZZER_SCRATCH_H
+#define FUZZER_SCRATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Removes everything inside a directory, whatever the extractor created there:
+ * directories without permissions, symbolic links (never followed), FIFOs, device nodes...
+ * @param dir the directory to empty, it is kept
+ * @return 0 on success, -1 if something could not be removed
+ */
+int scratch_clean(const char* dir);
+
+/**
+ * Same as scratch_clean(), and computes a fingerprint of what the extractor left on the way, without another walk:
+ * the names and places, types, permissions, sizes, link targets and the first 64 KiB of each file.
+ * The fingerprint does not depend on the order of the entries, an empty directory gives 0.
+ * @param dir the directory to empty, it is kept
+ * @param fingerprint where to store the fingerprint
+ * @return 0 on success, -1 if something could not be removed
+ */
+int scratch_clean_fingerprint(const char* dir, uint64_t* fingerprint);
+
+/**
+ * Creates a directory and its missing parents
+ * @param path the directory
+ * @return 0 on success, -1 on error
+ */
+int scratch_mkdirs(const char* path);
+
+/**
+ * Copies a file
+ * @param from the file to copy
+ * @param to the copy, replaced if it exists
+ * @return 0 on success, -1 on error
+ */
+int scratch_copy_file(const char* from, const char* to);
+
+/**
+ * Creates a file shared between processes with its first bytes (a header the others append after), unless it
+ * exists: written to a private file first and then linked, so that the other processes never see it without them
+ * @param path the file
+ * @param content its first bytes
+ * @param len their length
+ * @return 0 on success or if the file exists, -1 on error
+ */
+int scratch_create_file(const char* path, const void* content, size_t len);
+
+/**
+ * Copies a tree: directories, regular files, symbolic links (never followed), FIFOs and device nodes, with their
+ * permissions. Hard links are copied as separate files.
+ * @param from the directory to copy
+ * @param to the copy, created if needed
+ * @param skip tells which entries of the top directory are not copied, NULL to copy them all
+ * @return 0 on success, -1 if something could not be copied
+ */
+int scratch_copy_tree(const char* from, const char* to, bool (*skip)(const char* name));
+
+/**
+ * Reads a whole file
+ * @param path the file
+ * @param len where to store its length
+ * @return the content, to be freed, NULL on error
+ */
+uint8_t* scratch_read_file(const char* path, size_t* len);
+
+#endif
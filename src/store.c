@@ -0,0 +1,446 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "store.h"
+#include "campaign.h"
+#include "faults.h"
+#include "prng.h"
+#include "scratch.h"
+
+
+#define INDEX_FILE "index"
+#define OBJECTS_DIRECTORY "objects"
+
+static const char* outcome_names[STORE_OUTCOME_COUNT] = {
+    [STORE_CRASH] = "crash",
+    [STORE_HANG] = "hang",
+    [STORE_LIMIT] = "limit",
+    [STORE_RESOURCE] = "resource",
+    [STORE_SEMANTIC] = "semantic",
+    [STORE_DETERMINISTIC] = "deterministic",
+    [STORE_FLAKY] = "flaky",
+    [STORE_ENVIRONMENT] = "environment",
+};
+
+// Absolute path of the open store, so that it does not depend on the current directory
+static char store_path[PATH_MAX];
+static int index_fd = -1;
+static uint32_t store_worker;
+
+// Objects of the store last looked up by store_object_crashed() with a crash record, sorted
+static char crash_store[PATH_MAX];
+static uint8_t (*crash_hashes)[16] = NULL;
+static size_t crash_count = 0;
+
+
+const char* store_outcome_name(enum store_outcome outcome) {
+    return outcome < STORE_OUTCOME_COUNT ? outcome_names[outcome] : "unknown";
+}
+
+
+/**
+ * Hashes some content on 128 bits: two 64-bit lanes with their own seed, both fed with every word, then with the
+ * fault schedule it was run with, if any
+ */
+static void hash_content(const uint8_t* content, size_t len, const char* schedule, uint8_t hash[16]) {
+    uint64_t lanes[2] = {0x7461722d73746f72ULL, 0x636f6e74656e7421ULL};
+    prng_hash(content, len, lanes);
+    // The same archive with another schedule is another reproducer, the archives without one keep their hash
+    for (const char* c = schedule; c != NULL && *c != '\0'; c++) {
+        lanes[0] = prng_mix(lanes[0], (uint8_t) *c);
+        lanes[1] = prng_mix(lanes[1], (uint8_t) *c ^ lanes[0]);
+    }
+    memcpy(hash, lanes, 16);
+}
+
+
+static void hash_to_hex(const uint8_t hash[16], char hex[33]) {
+    for (int i = 0; i < 16; i++) {
+        sprintf(hex + 2 * i, "%02x", hash[i]);
+    }
+}
+
+
+/**
+ * Creates the index of a new store with its header, see scratch_create_file()
+ * @return 0 on success, -1 on error
+ */
+static int create_index(void) {
+    char path[PATH_MAX + 32];
+    snprintf(path, sizeof(path), "%s/" INDEX_FILE, store_path);
+
+    struct store_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, STORE_MAGIC, sizeof(header.magic));
+    header.version = STORE_VERSION;
+    header.record_size = sizeof(struct store_record);
+    return scratch_create_file(path, &header, sizeof(header));
+}
+
+
+int store_open(const char* path, uint32_t worker) {
+    if (mkdir(path, 0755) == -1 && errno != EEXIST) {
+        perror(path);
+        return -1;
+    }
+    if (realpath(path, store_path) == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    char objects[PATH_MAX + 32];
+    snprintf(objects, sizeof(objects), "%s/" OBJECTS_DIRECTORY, store_path);
+    if (mkdir(objects, 0755) == -1 && errno != EEXIST) {
+        perror(objects);
+        return -1;
+    }
+    if (create_index() == -1) {
+        return -1;
+    }
+
+    char index[PATH_MAX + 32];
+    snprintf(index, sizeof(index), "%s/" INDEX_FILE, store_path);
+    index_fd = open(index, O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (index_fd == -1) {
+        perror(index);
+        return -1;
+    }
+    store_worker = worker;
+    return 0;
+}
+
+
+/**
+ * Writes an object unless another process already did, with its fault schedule next to it
+ * @return 1 if this call stored it, 0 if it was there, -1 on error
+ */
+static int write_object(const uint8_t hash[16], const uint8_t* content, size_t len, const char* schedule) {
+    char hex[33];
+    hash_to_hex(hash, hex);
+
+    // One directory per first byte, so that no directory holds millions of objects
+    char path[PATH_MAX + 64];
+    snprintf(path, sizeof(path), "%s/" OBJECTS_DIRECTORY "/%.2s", store_path, hex);
+    if (mkdir(path, 0755) == -1 && errno != EEXIST) {
+        perror(path);
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/" OBJECTS_DIRECTORY "/%.2s/%s.tar", store_path, hex, hex + 2);
+    if (access(path, F_OK) == 0) {
+        return 0;
+    }
+    // Before the archive: an object is never seen without the schedule it needs
+    if (schedule != NULL && fault_save_schedule(path, schedule) == -1) {
+        return -1;
+    }
+
+    char temporary[PATH_MAX + 64];
+    snprintf(temporary, sizeof(temporary), "%s/" OBJECTS_DIRECTORY "/%.2s/.%d.tmp", store_path, hex, (int) getpid());
+    int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        perror(temporary);
+        return -1;
+    }
+    bool written = write(fd, content, len) == (ssize_t) len;
+    close(fd);
+
+    int rv = -1;
+    if (!written) {
+        perror(temporary);
+    } else if (link(temporary, path) == 0) {
+        rv = 1;
+    } else if (errno == EEXIST) {
+        // Stored by another worker in the meantime
+        rv = 0;
+    } else {
+        perror(path);
+    }
+    unlink(temporary);
+    return rv;
+}
+
+
+int store_add(const char* archive, enum store_outcome outcome, const struct execution* execution) {
+    return store_add_case(archive, outcome, execution, campaign_case_id());
+}
+
+
+int store_add_case(const char* archive, enum store_outcome outcome, const struct execution* execution,
+                   uint64_t case_id) {
+    if (index_fd == -1) {
+        return 0;
+    }
+
+    size_t len = 0;
+    uint8_t* content = scratch_read_file(archive, &len);
+    if (content == NULL) {
+        perror(archive);
+        return -1;
+    }
+
+    // Set by the fault suite around the execution
+    const char* schedule = getenv(FAULT_SCHEDULE_VARIABLE);
+    if (schedule != NULL && schedule[0] == '\0') {
+        schedule = NULL;
+    }
+
+    struct store_record record;
+    memset(&record, 0, sizeof(record));
+    hash_content(content, len, schedule, record.hash);
+    int stored = write_object(record.hash, content, len, schedule);
+    free(content);
+    if (stored == -1) {
+        return -1;
+    }
+
+    record.case_id = case_id;
+    record.time = time(NULL);
+    record.wall_ms = (uint32_t) execution->wall_time;
+    record.cpu_ms = (uint32_t) (execution->user_time + execution->sys_time);
+    record.max_rss = (uint32_t) execution->max_rss;
+    record.size = (uint32_t) len;
+    record.worker = store_worker;
+    record.exit_status = WIFEXITED(execution->status) ? WEXITSTATUS(execution->status) : -1;
+    record.outcome = outcome;
+    record.signal = (uint8_t) execution->signal;
+    record.first = stored == 1;
+
+    // The field sweeps: index = position * 256 + character, the position of the header sweep includes its pass
+    enum suite suite = record.case_id >> 32;
+    if (suite <= SUITE_CHKSUM || suite == SUITE_HEADER) {
+        record.position = (uint16_t) ((uint32_t) record.case_id >> 8);
+        record.value = (uint8_t) record.case_id;
+    } else {
+        record.position = STORE_NO_POSITION;
+    }
+
+    // A single write with O_APPEND: the records of the workers never interleave
+    if (write(index_fd, &record, sizeof(record)) != sizeof(record)) {
+        perror(STORE_DIRECTORY "/" INDEX_FILE);
+        return -1;
+    }
+    return 0;
+}
+
+
+void store_close(void) {
+    if (index_fd != -1) {
+        close(index_fd);
+        index_fd = -1;
+    }
+}
+
+
+static int compare_hashes(const void* a, const void* b) {
+    return memcmp(a, b, 16);
+}
+
+
+/**
+ * Maps the index of a store
+ * @param path directory of the store
+ * @param size where to store the size of the mapping
+ * @param count where to store the number of complete records
+ * @return the mapping, the records after its header, NULL if the index cannot be read
+ */
+static const uint8_t* map_index(const char* path, size_t* size, size_t* count) {
+    char index[PATH_MAX + 32];
+    snprintf(index, sizeof(index), "%s/" INDEX_FILE, path);
+    int fd = open(index, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        perror(index);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t) st.st_size < sizeof(struct store_header)) {
+        fprintf(stderr, "%s: not a results store index\n", index);
+        close(fd);
+        return NULL;
+    }
+    const uint8_t* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(index);
+        return NULL;
+    }
+
+    const struct store_header* header = (const struct store_header*) map;
+    if (memcmp(header->magic, STORE_MAGIC, sizeof(header->magic)) != 0 || header->version != STORE_VERSION ||
+        header->record_size != sizeof(struct store_record)) {
+        fprintf(stderr, "%s: not a results store index, or another version\n", index);
+        munmap((void*) map, st.st_size);
+        return NULL;
+    }
+    // A record being appended is not complete yet
+    *size = st.st_size;
+    *count = (st.st_size - sizeof(*header)) / sizeof(struct store_record);
+    return map;
+}
+
+
+long store_query(const char* path, uint64_t case_id) {
+    size_t map_size;
+    size_t count;
+    const uint8_t* map = map_index(path, &map_size, &count);
+    if (map == NULL) {
+        return -1;
+    }
+    const struct store_record* records = (const struct store_record*) (map + sizeof(struct store_header));
+
+    // The hashes per outcome, to count the distinct archives
+    uint8_t (*hashes)[16] = malloc(count * 16 + 1);
+    size_t totals[STORE_OUTCOME_COUNT] = {0};
+    size_t offsets[STORE_OUTCOME_COUNT + 1] = {0};
+    for (size_t i = 0; i < count; i++) {
+        if (records[i].outcome < STORE_OUTCOME_COUNT && (case_id == UINT64_MAX || records[i].case_id == case_id)) {
+            totals[records[i].outcome]++;
+        }
+    }
+    for (int o = 0; o < STORE_OUTCOME_COUNT; o++) {
+        offsets[o + 1] = offsets[o] + totals[o];
+    }
+
+    printf("hash\tsuite\tindex\tposition\tvalue\toutcome\tsignal\texit\twall_ms\tcpu_ms\trss_kb\tsize\tworker\ttime"
+           "\tschedule\n");
+    long listed = 0;
+    size_t filled[STORE_OUTCOME_COUNT] = {0};
+    for (size_t i = 0; i < count; i++) {
+        const struct store_record* record = &records[i];
+        if (record->outcome >= STORE_OUTCOME_COUNT || (case_id != UINT64_MAX && record->case_id != case_id)) {
+            continue;
+        }
+        char hex[33];
+        hash_to_hex(record->hash, hex);
+        char position[16] = "-";
+        char value[16] = "-";
+        if (record->position != STORE_NO_POSITION) {
+            snprintf(position, sizeof(position), "%u", record->position);
+            snprintf(value, sizeof(value), "%u", record->value);
+        }
+        // Only the fault suite has objects with a schedule
+        char schedule[FAULT_SCHEDULE_SIZE] = "-";
+        if (record->case_id >> 32 == SUITE_FAULT) {
+            char object[PATH_MAX + 64];
+            snprintf(object, sizeof(object), "%s/" OBJECTS_DIRECTORY "/%.2s/%s.tar", path, hex, hex + 2);
+            if (fault_load_schedule(object, schedule, sizeof(schedule)) == -1) {
+                strcpy(schedule, "-");
+            }
+        }
+        printf("%s\t%s\t%u\t%s\t%s\t%s\t%u\t%d\t%u\t%u\t%u\t%u\t%u.%u\t%lld\t%s\n",
+               hex, suite_name(record->case_id >> 32), (unsigned int) record->case_id, position, value,
+               store_outcome_name(record->outcome), record->signal, record->exit_status, record->wall_ms,
+               record->cpu_ms, record->max_rss, record->size, record->worker >> 16, record->worker & 0xffff,
+               (long long) record->time, schedule);
+        if (hashes != NULL) {
+            memcpy(hashes[offsets[record->outcome] + filled[record->outcome]++], record->hash, 16);
+        }
+        listed++;
+    }
+
+    // Summary on stderr, the records can be piped
+    for (int o = 0; o < STORE_OUTCOME_COUNT; o++) {
+        if (totals[o] == 0) {
+            continue;
+        }
+        size_t distinct = 0;
+        if (hashes != NULL) {
+            qsort(hashes[offsets[o]], totals[o], 16, compare_hashes);
+            for (size_t i = 0; i < totals[o]; i++) {
+                distinct += i == 0 || memcmp(hashes[offsets[o] + i], hashes[offsets[o] + i - 1], 16) != 0;
+            }
+        }
+        fprintf(stderr, "%s: %zu findings, %zu distinct archives\n", store_outcome_name(o), totals[o], distinct);
+    }
+
+    free(hashes);
+    munmap((void*) map, map_size);
+    return listed;
+}
+
+
+/**
+ * Keeps the hashes of the objects of a store with a crash record, or a crash confirmed deterministic
+ * @return 0 on success, -1 if the index cannot be read
+ */
+static int load_crash_hashes(const char* path) {
+    free(crash_hashes);
+    crash_hashes = NULL;
+    crash_count = 0;
+    snprintf(crash_store, sizeof(crash_store), "%s", path);
+
+    size_t map_size;
+    size_t count;
+    const uint8_t* map = map_index(path, &map_size, &count);
+    if (map == NULL) {
+        return -1;
+    }
+    const struct store_record* records = (const struct store_record*) (map + sizeof(struct store_header));
+    crash_hashes = malloc(count * 16 + 1);
+    if (crash_hashes == NULL) {
+        perror("malloc");
+        munmap((void*) map, map_size);
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (records[i].outcome == STORE_CRASH || records[i].outcome == STORE_DETERMINISTIC) {
+            memcpy(crash_hashes[crash_count++], records[i].hash, 16);
+        }
+    }
+    qsort(crash_hashes, crash_count, 16, compare_hashes);
+    munmap((void*) map, map_size);
+    return 0;
+}
+
+
+int store_object_crashed(const char* object) {
+    // "<store>/objects/<xx>/<30 hex digits>.tar", split from the end
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s", object);
+    char* parts[2];
+    for (int p = 0; p < 2; p++) {
+        char* slash = strrchr(path, '/');
+        if (slash == NULL) {
+            return -1;
+        }
+        *slash = '\0';
+        parts[p] = slash + 1;
+    }
+    const char* name = parts[0];
+    const char* prefix = parts[1];
+    char* objects = strrchr(path, '/');
+    if (objects == NULL || strcmp(objects + 1, OBJECTS_DIRECTORY) != 0 || strlen(prefix) != 2 ||
+        strlen(name) != 30 + 4 || strcmp(name + 30, ".tar") != 0) {
+        return -1;
+    }
+    *objects = '\0';
+
+    char hex[33];
+    uint8_t hash[16];
+    snprintf(hex, sizeof(hex), "%s%.30s", prefix, name);
+    for (int i = 0; i < 16; i++) {
+        unsigned int byte;
+        if (sscanf(hex + 2 * i, "%2x", &byte) != 1) {
+            return -1;
+        }
+        hash[i] = (uint8_t) byte;
+    }
+
+    // Loaded once per store, an index that cannot be read is not tried again
+    if (strcmp(crash_store, path) != 0) {
+        load_crash_hashes(path);
+    }
+    if (crash_hashes == NULL) {
+        return -1;
+    }
+    return bsearch(hash, crash_hashes, crash_count, 16, compare_hashes) != NULL;
+}
@@ -0,0 +1,143 @@
+#ifndef FUZZER_STORE_H
+#define FUZZER_STORE_H
+
+#include <stdint.h>
+
+#include "executor.h"
+
+/*
+ * Content-addressed results store, shared by all the shards and workers of an output directory:
+ * every archive that crashed the extractor, hung it (CPU limit), hit another limit, cost too much or extracted
+ * another tree than the reference is kept once, as "objects/<xx>/<hash>.tar" named after a 128-bit hash of its
+ * content and of the fault schedule it ran with, and each finding appends a fixed-size record to "index" (test
+ * case, field position, signal, exit status, timing, memory...). The schedule of an object of the fault suite is
+ * kept next to it, as "<hash>.fault" (see faults.h), so that --regression replays it with its faults. With --confirm,
+ * each crash run again gets another record on its object, with its label as outcome.
+ *
+ * Nothing is ever renamed over another file: an object is written to a private temporary file and linked to its
+ * name, which fails harmlessly if another worker stored the same content first, and a record is a single write()
+ * to the index opened with O_APPEND. The index is an array of records after a header, it can be mapped as is.
+ */
+
+// Name of the store in the output directory
+#define STORE_DIRECTORY "store"
+
+#define STORE_MAGIC "TARSTOR1"
+#define STORE_VERSION 1
+
+// What a record is about
+enum store_outcome {
+    STORE_CRASH,
+    // Killed by the CPU limit: the extractor loops
+    STORE_HANG,
+    // Another limit (memory, file size, open files)
+    STORE_LIMIT,
+    STORE_RESOURCE,
+    STORE_SEMANTIC,
+    // Labels of a crash run again by --confirm, see confirm.h
+    STORE_DETERMINISTIC,
+    STORE_FLAKY,
+    STORE_ENVIRONMENT,
+    STORE_OUTCOME_COUNT
+};
+
+// Position of the records that are not part of a field sweep
+#define STORE_NO_POSITION UINT16_MAX
+
+// Beginning of the index
+struct store_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint8_t reserved[48];
+};
+
+// One finding, 64 bytes
+struct store_record {
+    // Hash of the archive, and name of its object
+    uint8_t hash[16];
+    // Test case: suite in the high 32 bits, index in the low ones
+    uint64_t case_id;
+    // When it was recorded, seconds since the epoch
+    int64_t time;
+    // Elapsed and CPU time in milliseconds, peak resident set size in kilobytes
+    uint32_t wall_ms;
+    uint32_t cpu_ms;
+    uint32_t max_rss;
+    // Size of the archive in bytes
+    uint32_t size;
+    // Shard in the high 16 bits, local worker in the low ones
+    uint32_t worker;
+    // Exit status, -1 if the extractor was killed by a signal
+    int16_t exit_status;
+    // Field sweeps: position in the field and character, STORE_NO_POSITION otherwise
+    uint16_t position;
+    uint8_t value;
+    // enum store_outcome
+    uint8_t outcome;
+    // Signal of the crash or of the limit, 0 if none
+    uint8_t signal;
+    // 1 if this record stored the object, 0 if the content was already known
+    uint8_t first;
+};
+
+_Static_assert(sizeof(struct store_header) == 64, "the header is 64 bytes");
+_Static_assert(sizeof(struct store_record) == 64, "a record is 64 bytes");
+
+/**
+ * @param outcome an outcome
+ * @return its name, as in the results files
+ */
+const char* store_outcome_name(enum store_outcome outcome);
+
+/**
+ * Opens the store, creating it if needed: its records go to the index from then on.
+ * Several processes can open the same store.
+ * @param path directory of the store
+ * @param worker identifier of this process, shard in the high 16 bits and local worker in the low ones
+ * @return 0 on success, -1 on error
+ */
+int store_open(const char* path, uint32_t worker);
+
+/**
+ * Stores an archive that made the current test case a finding, does nothing if the store is not open
+ * @param archive path of the archive
+ * @param outcome what happened
+ * @param execution the execution of the extractor on it
+ * @return 0 on success, -1 on error
+ */
+int store_add(const char* archive, enum store_outcome outcome, const struct execution* execution);
+
+/**
+ * Same as store_add(), for any test case, e.g. one whose crash another process confirmed
+ * @param archive path of the archive
+ * @param outcome what happened
+ * @param execution the execution of the extractor on it
+ * @param case_id the test case, see campaign_case_id()
+ * @return 0 on success, -1 on error
+ */
+int store_add_case(const char* archive, enum store_outcome outcome, const struct execution* execution,
+                   uint64_t case_id);
+
+/**
+ * Closes the store
+ */
+void store_close(void);
+
+/**
+ * Lists the records of a store, one per line, then the number of findings and of distinct archives per outcome
+ * @param path directory of the store
+ * @param case_id only list this test case, UINT64_MAX for all of them
+ * @return the number of records listed, -1 if the index cannot be read
+ */
+long store_query(const char* path, uint64_t case_id);
+
+/**
+ * Tells if a file is the object of a crash in its store: a record with the outcome crash, or deterministic.
+ * The index of the last store looked up is kept.
+ * @param object path of the file
+ * @return 1 if it is, 0 if it is the object of other findings only, -1 if it is not an object of a readable store
+ */
+int store_object_crashed(const char* object);
+
+#endif
@@ -0,0 +1,329 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+
+#include "sweep.h"
+#include "campaign.h"
+
+
+static const char* pass_names[SWEEP_PASS_COUNT] = {
+    [SWEEP_FIXED] = "fixed",
+    [SWEEP_RAW] = "raw",
+};
+
+#define CHKSUM_OFFSET 148
+#define CHKSUM_END 156
+#define PREFIX_OFFSET 345
+
+// What the sweep found at an offset
+struct offset_state {
+    unsigned int executed;
+    // One bit per value that made the extractor crash
+    uint8_t crashed[256 / 8];
+};
+
+static unsigned int enabled_passes = 0;
+static struct offset_state table[SWEEP_PASS_COUNT][TAR_BLOCK_SIZE];
+static struct tar_t golden;
+// Whether the table of the last checkpoint was written to SWEEP_NEXT_FILE
+static bool next_written = false;
+
+
+unsigned int sweep_parse_passes(const char* arg) {
+    if (strcmp(arg, "fixed") == 0) {
+        return SWEEP_FIXED_MASK;
+    }
+    if (strcmp(arg, "raw") == 0) {
+        return SWEEP_RAW_MASK;
+    }
+    if (strcmp(arg, "both") == 0) {
+        return SWEEP_FIXED_MASK | SWEEP_RAW_MASK;
+    }
+    return 0;
+}
+
+
+/**
+ * @return the number of values that made the extractor crash at an offset
+ */
+static unsigned int count_crashes(const struct offset_state* state) {
+    unsigned int crashes = 0;
+    for (size_t b = 0; b < sizeof(state->crashed); b++) {
+        crashes += __builtin_popcount(state->crashed[b]);
+    }
+    return crashes;
+}
+
+
+/**
+ * Writes the table to a file, only the enabled passes
+ * @param path the file
+ * @return 0 on success, -1 on error
+ */
+static int write_table(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+    fprintf(file, "pass\toffset\tfield\texecuted\tcrashes\tvalues\n");
+    for (int p = 0; p < SWEEP_PASS_COUNT; p++) {
+        if (!(enabled_passes & (1U << p))) {
+            continue;
+        }
+        for (unsigned int o = 0; o < TAR_BLOCK_SIZE; o++) {
+            const struct offset_state* state = &table[p][o];
+            fprintf(file, "%s\t%u\t%s\t%u\t%u\t", pass_names[p], o, sweep_field_name(o), state->executed,
+                    count_crashes(state));
+            for (size_t b = 0; b < sizeof(state->crashed); b++) {
+                fprintf(file, "%02x", state->crashed[b]);
+            }
+            fputc('\n', file);
+        }
+    }
+    if (fflush(file) == EOF || fsync(fileno(file)) == -1) {
+        perror(path);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+    return 0;
+}
+
+
+/**
+ * Adds a table written by write_table() to the one in memory: the executions are summed, the crashes put together
+ * @param path the file
+ * @return 0 on success, -1 on error
+ */
+static int read_table(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+    char line[256];
+    int rv = 0;
+    // The header line first
+    if (fgets(line, sizeof(line), file) == NULL) {
+        rv = -1;
+    }
+    while (rv == 0 && fgets(line, sizeof(line), file) != NULL) {
+        char pass[16];
+        char bits[2 * sizeof(table[0][0].crashed) + 1];
+        unsigned int offset, executed, crashes;
+        int p = 0;
+        if (sscanf(line, "%15s %u %*s %u %u %64s", pass, &offset, &executed, &crashes, bits) != 5 ||
+            offset >= TAR_BLOCK_SIZE || strlen(bits) != 2 * sizeof(table[0][0].crashed)) {
+            rv = -1;
+            break;
+        }
+        while (p < SWEEP_PASS_COUNT && strcmp(pass_names[p], pass) != 0) {
+            p++;
+        }
+        if (p == SWEEP_PASS_COUNT) {
+            rv = -1;
+            break;
+        }
+        enabled_passes |= 1U << p;
+        table[p][offset].executed += executed;
+        for (size_t b = 0; b < sizeof(table[p][offset].crashed); b++) {
+            unsigned int byte;
+            sscanf(bits + 2 * b, "%2x", &byte);
+            table[p][offset].crashed[b] |= (uint8_t) byte;
+        }
+    }
+    fclose(file);
+    return rv;
+}
+
+
+/**
+ * @return the number of test cases of the sweep executed so far
+ */
+static unsigned long count_executed(void) {
+    unsigned long executed = 0;
+    for (int p = 0; p < SWEEP_PASS_COUNT; p++) {
+        for (int o = 0; o < TAR_BLOCK_SIZE; o++) {
+            executed += table[p][o].executed;
+        }
+    }
+    return executed;
+}
+
+
+static void save_table(FILE* file) {
+    unsigned int offsets = 0;
+    for (int p = 0; p < SWEEP_PASS_COUNT; p++) {
+        for (int o = 0; o < TAR_BLOCK_SIZE; o++) {
+            offsets += table[p][o].executed > 0;
+        }
+    }
+    // The table only replaces the old one once the checkpoint is committed, see commit_table()
+    next_written = write_table(SWEEP_NEXT_FILE) == 0;
+    fprintf(file, "%s %u %lu", SWEEP_STATE_FILE, offsets, count_executed());
+}
+
+
+static void commit_table(void) {
+    if (next_written && rename(SWEEP_NEXT_FILE, SWEEP_STATE_FILE) == -1) {
+        perror(SWEEP_STATE_FILE);
+    }
+}
+
+
+static int load_table(const char* value) {
+    // Interrupted between the rename of the checkpoint and commit_table(): the new table is still the next one
+    unsigned long executed = 0;
+    bool counted = sscanf(value, "%*s %*u %lu", &executed) == 1;
+    if (read_table(SWEEP_STATE_FILE) == 0 && (!counted || count_executed() == executed)) {
+        return 0;
+    }
+    memset(table, 0, sizeof(table));
+    if (counted && access(SWEEP_NEXT_FILE, F_OK) == 0 && read_table(SWEEP_NEXT_FILE) == 0 &&
+        count_executed() == executed) {
+        return 0;
+    }
+    fprintf(stderr, "%s does not match the checkpoint (%lu test cases)\n", SWEEP_STATE_FILE, executed);
+    return -1;
+}
+
+
+void sweep_enable(unsigned int passes) {
+    enabled_passes = passes;
+    generate_golden_tar_header(&golden);
+    campaign_add_checkpoint_hook("header-sweep", save_table, load_table);
+    campaign_add_commit_hook(commit_table);
+}
+
+
+bool sweep_enabled(void) {
+    return enabled_passes != 0;
+}
+
+
+bool sweep_skipped(unsigned int index) {
+    unsigned int pass = index / (TAR_BLOCK_SIZE * 256);
+    unsigned int offset = index / 256 % TAR_BLOCK_SIZE;
+    unsigned int value = index % 256;
+
+    if (pass >= SWEEP_PASS_COUNT || !(enabled_passes & (1U << pass))) {
+        return true;
+    }
+    // The golden archive itself
+    if (value == ((const uint8_t*) &golden)[offset]) {
+        return true;
+    }
+    // An absolute path would be extracted outside of the working directory
+    if ((offset == 0 || offset == PREFIX_OFFSET) && value == '/') {
+        return true;
+    }
+    // The chksum field is never computed again, the first pass has those
+    return pass == SWEEP_RAW && (enabled_passes & SWEEP_FIXED_MASK) && offset >= CHKSUM_OFFSET && offset < CHKSUM_END;
+}
+
+
+void sweep_build_case(unsigned int index, struct tar_t* header) {
+    unsigned int pass = index / (TAR_BLOCK_SIZE * 256);
+    unsigned int offset = index / 256 % TAR_BLOCK_SIZE;
+
+    *header = golden;
+    ((uint8_t*) header)[offset] = (uint8_t) index;
+    if (pass == SWEEP_FIXED && (offset < CHKSUM_OFFSET || offset >= CHKSUM_END)) {
+        calculate_checksum(header);
+    }
+}
+
+
+const char* sweep_field_name(unsigned int offset) {
+    size_t f = TAR_FIELD_COUNT - 1;
+    while (f > 0 && tar_fields[f].offset > offset) {
+        f--;
+    }
+    return tar_fields[f].name;
+}
+
+
+void sweep_record(unsigned int index, bool crashed) {
+    unsigned int pass = index / (TAR_BLOCK_SIZE * 256);
+    unsigned int offset = index / 256 % TAR_BLOCK_SIZE;
+    unsigned int value = index % 256;
+    if (pass >= SWEEP_PASS_COUNT) {
+        return;
+    }
+    table[pass][offset].executed++;
+    if (crashed) {
+        table[pass][offset].crashed[value / 8] |= 1U << (value % 8);
+    }
+}
+
+
+int sweep_merge(const char* out_dir) {
+    DIR* dir = opendir(out_dir);
+    if (dir == NULL) {
+        perror(out_dir);
+        return -1;
+    }
+    // The table of each worker is in its working directory
+    unsigned int workers = 0;
+    int rv = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        unsigned int i, n, k, j;
+        int end = 0;
+        if (sscanf(entry->d_name, "shard-%u-of-%u.%u-of-%u%n", &i, &n, &k, &j, &end) != 4 ||
+            entry->d_name[end] != '\0') {
+            continue;
+        }
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s/%s", out_dir, entry->d_name, SWEEP_STATE_FILE);
+        if (access(path, F_OK) == -1) {
+            continue;
+        }
+        if (read_table(path) == -1) {
+            fprintf(stderr, "%s: invalid table, ignored\n", path);
+            rv = -1;
+            continue;
+        }
+        workers++;
+    }
+    closedir(dir);
+
+    if (workers == 0) {
+        return rv;
+    }
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", out_dir, SWEEP_STATE_FILE);
+    if (write_table(path) == -1) {
+        return -1;
+    }
+    printf("Header sweep tables of %u workers merged into %s\n", workers, path);
+    return rv;
+}
+
+
+void sweep_summary(void) {
+    for (int p = 0; p < SWEEP_PASS_COUNT; p++) {
+        if (!(enabled_passes & (1U << p))) {
+            continue;
+        }
+        for (size_t f = 0; f < TAR_FIELD_COUNT; f++) {
+            unsigned int start = tar_fields[f].offset;
+            unsigned int end = f + 1 < TAR_FIELD_COUNT ? tar_fields[f + 1].offset : TAR_BLOCK_SIZE;
+            unsigned int executed = 0, crashes = 0, offsets = 0;
+            for (unsigned int o = start; o < end; o++) {
+                unsigned int c = count_crashes(&table[p][o]);
+                executed += table[p][o].executed;
+                crashes += c;
+                offsets += c > 0;
+            }
+            if (executed > 0) {
+                printf("        > %s checksum, %s: %u crashes at %u of %u offsets, %u test cases\n",
+                       pass_names[p], tar_fields[f].name, crashes, offsets, end - start, executed);
+            }
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef FUZZER_SWEEP_H
+#define FUZZER_SWEEP_H
+
+#include <stdbool.h>
+
+#include "tar.h"
+
+/*
+ * Full header sweep: every byte of the header of the golden archive ("file.txt", 50 bytes of data) is set to each of
+ * the 256 values in turn, all 512 offsets included, where the field sweeps only cover 13 fields and some of their
+ * characters (devmajor, devminor, prefix and the padding of the header are never touched by them).
+ * The sweep has two passes: the checksum computed again after the change, so that the extractor parses the header,
+ * and the checksum of the golden header left as it is, to test its verification. The changes of the chksum field
+ * itself are in the first pass only. Test case index = (pass * 512 + offset) * 256 + value.
+ *
+ * Which values made the extractor crash at each offset is saved with the checkpoints in SWEEP_STATE_FILE, a table
+ * that is also the result of the sweep once it is over. Each worker has its own in its working directory, the merge
+ * of the results puts them together.
+ */
+
+// The passes of the sweep, and the masks given to sweep_enable()
+enum sweep_pass {
+    SWEEP_FIXED,
+    SWEEP_RAW,
+    SWEEP_PASS_COUNT
+};
+#define SWEEP_FIXED_MASK (1U << SWEEP_FIXED)
+#define SWEEP_RAW_MASK (1U << SWEEP_RAW)
+
+#define SWEEP_CASE_COUNT (SWEEP_PASS_COUNT * TAR_BLOCK_SIZE * 256)
+
+// Per offset state, in the working directory
+#define SWEEP_STATE_FILE "header_sweep.tsv"
+// The table written with a checkpoint, renamed over SWEEP_STATE_FILE once the checkpoint is committed
+#define SWEEP_NEXT_FILE SWEEP_STATE_FILE ".next"
+
+/**
+ * Parses the passes of the sweep
+ * @param arg "fixed", "raw" or "both"
+ * @return the mask of the passes, 0 if invalid
+ */
+unsigned int sweep_parse_passes(const char* arg);
+
+/**
+ * Enables the sweep, its table is saved in the checkpoint.
+ * Has to be called before campaign_open().
+ * @param passes mask of the passes to run
+ */
+void sweep_enable(unsigned int passes);
+
+/**
+ * @return whether the sweep was enabled
+ */
+bool sweep_enabled(void);
+
+/**
+ * Tells if a test case of the sweep is not run: its pass is not enabled, it gives the golden archive again or an
+ * absolute path, or the other pass already has it
+ * @param index the test case
+ * @return true if it is skipped
+ */
+bool sweep_skipped(unsigned int index);
+
+/**
+ * Builds the header of a test case
+ * @param index the test case
+ * @param header where to build the header
+ */
+void sweep_build_case(unsigned int index, struct tar_t* header);
+
+/**
+ * @param offset an offset in the header
+ * @return the name of the field at that offset
+ */
+const char* sweep_field_name(unsigned int offset);
+
+/**
+ * Counts the execution of a test case in the table
+ * @param index the test case
+ * @param crashed whether the extractor crashed
+ */
+void sweep_record(unsigned int index, bool crashed);
+
+/**
+ * Puts the tables of the workers of an output directory together in DIR/SWEEP_STATE_FILE: the executions are summed,
+ * the crashes of each offset put together. Nothing is written if no worker ran the sweep.
+ * @param out_dir the output directory
+ * @return 0 on success, -1 if a table could not be read or written
+ */
+int sweep_merge(const char* out_dir);
+
+/**
+ * Prints the crashes of the sweep field by field
+ */
+void sweep_summary(void);
+
+#endif
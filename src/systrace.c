@@ -0,0 +1,332 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+#include "systrace.h"
+#include "campaign.h"
+
+#if defined(__x86_64__)
+#include <sys/prctl.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/user.h>
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#endif
+
+
+// Longest path read from the child to classify it
+#define MAX_PATH_READ 256
+
+// How the arguments of a call are classified
+enum argument {
+    ARG_NONE,
+    ARG_OPEN_FLAGS,
+    ARG_MODE,
+    ARG_SIZE,
+    ARG_MMAP
+};
+
+#if defined(__x86_64__)
+
+// The traced calls: those that act on the filesystem or on the memory, the reads and writes are too frequent
+static const struct {
+    int nr;
+    // Argument holding a path, -1 if none
+    int path;
+    enum argument argument;
+    // Argument classified by the previous field
+    int position;
+} traced[] = {
+    {SYS_open, 0, ARG_OPEN_FLAGS, 1},
+    {SYS_openat, 1, ARG_OPEN_FLAGS, 2},
+    {SYS_creat, 0, ARG_MODE, 1},
+    {SYS_mkdir, 0, ARG_MODE, 1},
+    {SYS_mkdirat, 1, ARG_MODE, 2},
+    {SYS_mknod, 0, ARG_MODE, 1},
+    {SYS_mknodat, 1, ARG_MODE, 2},
+    {SYS_symlink, 0, ARG_NONE, 0},
+    {SYS_symlinkat, 0, ARG_NONE, 0},
+    {SYS_link, 0, ARG_NONE, 0},
+    {SYS_linkat, 1, ARG_NONE, 0},
+    {SYS_unlink, 0, ARG_NONE, 0},
+    {SYS_unlinkat, 1, ARG_NONE, 0},
+    {SYS_rmdir, 0, ARG_NONE, 0},
+    {SYS_rename, 0, ARG_NONE, 0},
+    {SYS_renameat, 1, ARG_NONE, 0},
+    {SYS_renameat2, 1, ARG_NONE, 0},
+    {SYS_chmod, 0, ARG_MODE, 1},
+    {SYS_fchmod, -1, ARG_MODE, 1},
+    {SYS_fchmodat, 1, ARG_MODE, 2},
+    {SYS_chown, 0, ARG_NONE, 0},
+    {SYS_lchown, 0, ARG_NONE, 0},
+    {SYS_fchown, -1, ARG_NONE, 0},
+    {SYS_fchownat, 1, ARG_NONE, 0},
+    {SYS_utime, 0, ARG_NONE, 0},
+    {SYS_utimes, 0, ARG_NONE, 0},
+    {SYS_utimensat, 1, ARG_NONE, 0},
+    {SYS_readlink, 0, ARG_NONE, 0},
+    {SYS_readlinkat, 1, ARG_NONE, 0},
+    {SYS_stat, 0, ARG_NONE, 0},
+    {SYS_lstat, 0, ARG_NONE, 0},
+    {SYS_newfstatat, 1, ARG_NONE, 0},
+    {SYS_truncate, 0, ARG_SIZE, 1},
+    {SYS_ftruncate, -1, ARG_SIZE, 1},
+    {SYS_mmap, -1, ARG_MMAP, 1},
+    {SYS_munmap, -1, ARG_SIZE, 1},
+    {SYS_mprotect, -1, ARG_NONE, 0},
+};
+#define TRACED_COUNT (sizeof(traced) / sizeof(traced[0]))
+
+#endif
+
+// Behaviours seen so far: a bit per order of magnitude of the count of each pair of events
+static uint8_t seen[SYSTRACE_MAP_SIZE];
+
+// Counts of the current execution
+static uint8_t counts[SYSTRACE_MAP_SIZE];
+static uint32_t previous_event;
+static uint64_t sequence_hash;
+
+
+#if defined(__x86_64__)
+
+bool systrace_supported(void) {
+    return true;
+}
+
+
+int systrace_install_filter(void) {
+    struct sock_filter filter[TRACED_COUNT + 6];
+    unsigned int n = 0;
+
+    // Another architecture (32-bit calls) is not traced
+    filter[n++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch));
+    filter[n++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_X86_64, 1, 0);
+    filter[n++] = (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW);
+    filter[n++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr));
+    for (unsigned int i = 0; i < TRACED_COUNT; i++) {
+        // A match jumps over the other comparisons and the ALLOW, to the TRACE
+        filter[n++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, traced[i].nr, TRACED_COUNT - i, 0);
+    }
+    filter[n++] = (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW);
+    filter[n++] = (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_TRACE);
+
+    struct sock_fprog program = {n, filter};
+    if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) == -1 || prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &program) == -1) {
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * @return the index of the highest bit set, 0 for 0
+ */
+static unsigned int magnitude(uint64_t value) {
+    unsigned int bits = 0;
+    while (value >>= 1) {
+        bits++;
+    }
+    return bits;
+}
+
+
+/**
+ * Classifies a path of the child: empty, absolute, with "..", long, and its depth
+ */
+static uint32_t path_class(pid_t pid, uint64_t address) {
+    char path[MAX_PATH_READ];
+    // Do not read past the page of the path, the next one may not be mapped
+    size_t len = 4096 - (address & 4095);
+    if (len > sizeof(path) - 1) {
+        len = sizeof(path) - 1;
+    }
+    struct iovec local = {path, len};
+    struct iovec remote = {(void*) address, len};
+    ssize_t got = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+    if (got <= 0) {
+        return 1;
+    }
+    path[got] = '\0';
+
+    unsigned int depth = 0;
+    for (const char* c = path; *c != '\0'; c++) {
+        depth += *c == '/';
+    }
+    uint32_t class = 2;
+    class |= (path[0] == '\0') << 2;
+    class |= (path[0] == '/') << 3;
+    class |= (strstr(path, "..") != NULL) << 4;
+    class |= (strlen(path) >= 100) << 5;
+    class |= (depth == 0 ? 0 : depth == 1 ? 1 : depth <= 4 ? 2 : 3) << 6;
+    return class;
+}
+
+
+/**
+ * Classifies an argument of a call
+ */
+static uint32_t argument_class(enum argument argument, uint64_t value, uint64_t next) {
+    switch (argument) {
+        case ARG_OPEN_FLAGS:
+        {
+            uint64_t flags = value & (O_CREAT | O_TRUNC | O_EXCL | O_APPEND | O_DIRECTORY | O_NOFOLLOW);
+            return (value & O_ACCMODE) | flags >> 4;
+        }
+        case ARG_MODE:
+            return ((value & S_IFMT) >> 12) | ((value & 07000) != 0) << 4 | ((value & 0777) == 0) << 5;
+        case ARG_SIZE:
+            return magnitude(value);
+        case ARG_MMAP:
+            // Length and protection
+            return magnitude(value) | (next & (PROT_READ | PROT_WRITE | PROT_EXEC)) << 6;
+        default:
+            return 0;
+    }
+}
+
+
+void systrace_record(pid_t pid) {
+    struct user_regs_struct regs;
+    if (ptrace(PTRACE_GETREGS, pid, NULL, &regs) == -1) {
+        return;
+    }
+    uint64_t args[6] = {regs.rdi, regs.rsi, regs.rdx, regs.r10, regs.r8, regs.r9};
+
+    for (unsigned int i = 0; i < TRACED_COUNT; i++) {
+        if (traced[i].nr != (int) regs.orig_rax) {
+            continue;
+        }
+
+        // Call, path and argument classes in separate bits
+        uint64_t event = regs.orig_rax << 24;
+        if (traced[i].path != -1) {
+            event |= path_class(pid, args[traced[i].path]) << 16;
+        }
+        if (traced[i].argument != ARG_NONE) {
+            int p = traced[i].position;
+            uint32_t class = argument_class(traced[i].argument, args[p], p < 5 ? args[p + 1] : 0);
+            if (traced[i].argument == ARG_MMAP) {
+                // Shared or private, anonymous or not, fixed or not
+                class |= (args[3] & (MAP_SHARED | MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED)) << 9;
+            }
+            event |= class;
+        }
+
+        // Spread the event over the map, then index the pair with the previous one (shifted: A then B != B then A)
+        uint32_t spread = (uint32_t) ((event * 0x9e3779b97f4a7c15ULL) >> 32);
+        uint32_t entry = (spread ^ (previous_event >> 1)) % SYSTRACE_MAP_SIZE;
+        if (counts[entry] < UINT8_MAX) {
+            counts[entry]++;
+        }
+        previous_event = spread;
+        sequence_hash = (sequence_hash ^ spread) * 0x100000001b3ULL;
+        return;
+    }
+}
+
+#else
+
+bool systrace_supported(void) {
+    return false;
+}
+
+
+int systrace_install_filter(void) {
+    errno = ENOSYS;
+    return -1;
+}
+
+
+void systrace_record(__attribute__((unused)) pid_t pid) {
+}
+
+#endif
+
+
+void systrace_start(void) {
+    memset(counts, 0, sizeof(counts));
+    previous_event = 0;
+    sequence_hash = 0xcbf29ce484222325ULL;
+}
+
+
+/**
+ * @return the bit of the order of magnitude of a count: 1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+
+ */
+static uint8_t count_bit(uint8_t count) {
+    if (count <= 3) {
+        return 1 << (count - 1);
+    } else if (count <= 7) {
+        return 1 << 3;
+    } else if (count <= 15) {
+        return 1 << 4;
+    } else if (count <= 31) {
+        return 1 << 5;
+    } else if (count <= 127) {
+        return 1 << 6;
+    }
+    return 1 << 7;
+}
+
+
+unsigned int systrace_finish(uint64_t* hash) {
+    unsigned int new_entries = 0;
+    for (size_t i = 0; i < SYSTRACE_MAP_SIZE; i++) {
+        if (counts[i] != 0) {
+            uint8_t bit = count_bit(counts[i]);
+            if ((seen[i] & bit) == 0) {
+                seen[i] |= bit;
+                new_entries++;
+            }
+        }
+    }
+    *hash = sequence_hash;
+    return new_entries;
+}
+
+
+static void save_map(FILE* file) {
+    unsigned int entries = 0;
+    for (size_t i = 0; i < SYSTRACE_MAP_SIZE; i++) {
+        entries += seen[i] != 0;
+    }
+
+    // Same as the checkpoint: a new file renamed over the old one
+    int fd = open(SYSTRACE_MAP_FILE ".tmp", O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1 || write(fd, seen, sizeof(seen)) != sizeof(seen) || fsync(fd) == -1 ||
+        rename(SYSTRACE_MAP_FILE ".tmp", SYSTRACE_MAP_FILE) == -1) {
+        perror(SYSTRACE_MAP_FILE);
+    }
+    if (fd != -1) {
+        close(fd);
+    }
+    fprintf(file, "%s %u", SYSTRACE_MAP_FILE, entries);
+}
+
+
+static int load_map(__attribute__((unused)) const char* value) {
+    int fd = open(SYSTRACE_MAP_FILE, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        perror(SYSTRACE_MAP_FILE);
+        return -1;
+    }
+    ssize_t got = read(fd, seen, sizeof(seen));
+    close(fd);
+    return got == sizeof(seen) ? 0 : -1;
+}
+
+
+void systrace_enable(void) {
+    campaign_add_checkpoint_hook("syscalls", save_map, load_map);
+}
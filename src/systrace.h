@@ -0,0 +1,61 @@
+#ifndef FUZZER_SYSTRACE_H
+#define FUZZER_SYSTRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * Syscall-trace feedback: without the sources of the extractor there is no edge coverage, but the system calls it
+ * makes on the filesystem (open, mkdir, symlink, mknod, ftruncate, mmap...) tell which code path it took.
+ * A seccomp-bpf filter stops the extractor on those calls only (SECCOMP_RET_TRACE, the others run at full speed),
+ * each call is reduced to an event (the call and the class of its arguments: open flags, file type, size
+ * magnitude, absolute path, "..", depth...) and each pair of consecutive events is counted in a 64 KiB map,
+ * like the edges of AFL. An execution is new behaviour when a pair appears for the first time
+ * or with a new order of magnitude of its count.
+ *
+ * Only available on x86_64, the architecture of the extractor.
+ */
+
+// Number of entries of the map
+#define SYSTRACE_MAP_SIZE 65536
+
+// Where the map of the behaviours seen so far is saved with the checkpoint
+#define SYSTRACE_MAP_FILE "syscalls.map"
+
+/**
+ * @return true if the system calls can be traced on this architecture
+ */
+bool systrace_supported(void);
+
+/**
+ * Saves the map of the behaviours seen so far with the checkpoint, has to be called before campaign_open()
+ */
+void systrace_enable(void);
+
+/**
+ * Installs the seccomp filter, in the child right before execv(): the traced calls then stop the child
+ * until the tracer resumes it, the child has to be traced (with PTRACE_O_TRACESECCOMP) first
+ * @return 0 on success, -1 on error
+ */
+int systrace_install_filter(void);
+
+/**
+ * Starts the trace of a new execution
+ */
+void systrace_start(void);
+
+/**
+ * Records a traced call, the child being stopped by the filter
+ * @param pid the child
+ */
+void systrace_record(pid_t pid);
+
+/**
+ * Ends the trace of an execution and adds it to the map of the behaviours seen so far
+ * @param hash where to store a hash of the whole sequence of events
+ * @return the number of new entries of the map, 0 if the execution did nothing new
+ */
+unsigned int systrace_finish(uint64_t* hash);
+
+#endif
@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "tar.h"
+#include "archive.h"
+
+
+#define FIELD(field) {#field, offsetof(struct tar_t, field), sizeof(((struct tar_t*) 0)->field)}
+
+const struct tar_field tar_fields[TAR_FIELD_COUNT] = {
+    FIELD(name), FIELD(mode), FIELD(uid), FIELD(gid), FIELD(size), FIELD(mtime), FIELD(chksum), FIELD(typeflag),
+    FIELD(linkname), FIELD(magic), FIELD(version), FIELD(uname), FIELD(gname), FIELD(devmajor), FIELD(devminor),
+    FIELD(prefix), FIELD(padding),
+};
+
+_Static_assert(sizeof(struct tar_t) == TAR_BLOCK_SIZE, "the fields fill the block");
+
+unsigned int calculate_checksum(struct tar_t* entry) {
+    // use spaces for the checksum bytes while calculating the checksum
+    memset(entry->chksum, ' ', 8);
+
+    // sum of entire metadata
+    unsigned int check = 0;
+    unsigned char* raw = (unsigned char*) entry;
+    for(int i = 0; i < 512; i++){
+        check += raw[i];
+    }
+
+    // Checksum is terminated by a null character and a space character (0x00 0x20)
+    snprintf(entry->chksum, sizeof(entry->chksum), "%06o0", check);
+
+    entry->chksum[6] = '\0';
+    entry->chksum[7] = ' ';
+    return check;
+}
+
+
+void generate_tar_header(struct tar_t *header, const char *name, const char *mode, const char *uid, const char *gid, const char *size,
+                         const char *mtime, const char *typeflag, const char *linkname, const char *magic, const char *version,
+                         const char *uname, const char *gname) {
+    // Copy the input parameters into the tar header fields
+    strncpy(header->name, name, sizeof(header->name));
+    strncpy(header->mode, mode, sizeof(header->mode));
+    strncpy(header->uid, uid, sizeof(header->uid));
+    strncpy(header->gid, gid, sizeof(header->gid));
+    strncpy(header->size, size, sizeof(header->size));
+    strncpy(header->mtime, mtime, sizeof(header->mtime));
+    strncpy(header->typeflag, typeflag, sizeof(header->typeflag));
+    strncpy(header->linkname, linkname, sizeof(header->linkname));
+    strncpy(header->magic, magic, sizeof(header->magic));
+    strncpy(header->version, version, sizeof(header->version));
+    strncpy(header->uname, uname, sizeof(header->uname));
+    strncpy(header->gname, gname, sizeof(header->gname));
+    strncpy(header->devmajor, "0000000", sizeof(header->devmajor));
+    strncpy(header->devminor, "0000000", sizeof(header->devminor));
+    strncpy(header->prefix, "", sizeof(header->prefix));
+    strncpy(header->padding, "", sizeof(header->padding));
+}
+
+void generate_golden_tar_header(struct tar_t *header) {
+    generate_tar_header(header, "file.txt", "0000664", "0001750", "0001750", "00000000062",
+                        "14413537165", "0", "", "ustar", "00", "michal", "michal");
+    calculate_checksum(header);
+}
+
+void write_tar_file(const char* filename, struct tar_t* header) {
+    struct archive archive;
+    archive_init(&archive);
+    archive_add_raw(&archive, header, sizeof(struct tar_t));
+    archive_write(&archive, filename);
+}
+
+void write_tar_file_with_data(const char* filename, struct tar_t* header, const char* data, int data_len) {
+    struct archive archive;
+    archive_init(&archive);
+    archive_add_member(&archive, header, data, data_len, true);
+    archive_write(&archive, filename);
+}
@@ -0,0 +1,91 @@
+#ifndef FUZZER_TAR_H
+#define FUZZER_TAR_H
+
+#include <stddef.h>
+
+// Size of a tar header and of the blocks of an archive
+#define TAR_BLOCK_SIZE 512
+
+// Header structure
+struct tar_t
+{                              /* byte offset */
+    char name[100];               /*   0 */
+    char mode[8];                 /* 100 */
+    char uid[8];                  /* 108 */
+    char gid[8];                  /* 116 */
+    char size[12];                /* 124 */
+    char mtime[12];               /* 136 */
+    char chksum[8];               /* 148 */
+    char typeflag[1];             /* 156 */
+    char linkname[100];           /* 157 */
+    char magic[6];                /* 257 */
+    char version[2];              /* 263 */
+    char uname[32];               /* 265 */
+    char gname[32];               /* 297 */
+    char devmajor[8];             /* 329 */
+    char devminor[8];             /* 337 */
+    char prefix[155];             /* 345 */
+    char padding[12];             /* 500 */
+};
+
+// A field of the header: its name, where it starts and its size
+struct tar_field {
+    const char* name;
+    size_t offset;
+    size_t size;
+};
+
+// The fields of struct tar_t, in order, the last one ends at the end of the block
+#define TAR_FIELD_COUNT 17
+extern const struct tar_field tar_fields[TAR_FIELD_COUNT];
+
+/**
+ * Computes the checksum for a tar header and encode it on the header
+ * @param entry: The tar header
+ * @return the value of the checksum
+ */
+unsigned int calculate_checksum(struct tar_t* entry);
+
+/**
+ * Generates a tar header given the inputed values
+ * @param header
+ * @param name
+ * @param mode
+ * @param uid
+ * @param gid
+ * @param size
+ * @param mtime
+ * @param typeflag
+ * @param linkname
+ * @param magic
+ * @param version
+ * @param uname
+ * @param gname
+ */
+void generate_tar_header(struct tar_t *header, const char *name, const char *mode, const char *uid, const char *gid, const char *size,
+                         const char *mtime, const char *typeflag, const char *linkname, const char *magic, const char *version,
+                         const char *uname, const char *gname);
+
+/**
+ * Generates the correct header used as a base by the suites ("file.txt", 50 bytes), checksum included
+ * @param header
+ */
+void generate_golden_tar_header(struct tar_t *header);
+
+/**
+ * Creates a .tar archive
+ * @param filename name of the archive to be created
+ * @param header header data to be added in the tar archive
+ */
+void write_tar_file(const char* filename, struct tar_t* header);
+
+/**
+ * Creates a .tar archive of a file with data and padding
+ * @param filename name of the archive to be created
+ * @param header header data to be added in the tar archive
+ * @param data data that has to be added
+ * @param data_len data size used to calculate the padding
+ */
+void write_tar_file_with_data(const char* filename, struct tar_t* header, const char* data, int data_len);
+
+#endif
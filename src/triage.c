@@ -0,0 +1,340 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <elf.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "triage.h"
+#include "campaign.h"
+
+#if defined(__x86_64__)
+#include <sys/ptrace.h>
+#include <sys/user.h>
+#endif
+
+
+// Deepest backtrace, and most mappings looked at
+#define MAX_FRAMES 32
+#define MAX_MAPPINGS 64
+
+// Size of a report: registers and backtrace
+#define REPORT_SIZE 4096
+
+// A function of the extractor
+struct symbol {
+    uint64_t value;
+    uint64_t size;
+    const char* name;
+};
+
+// A mapping of the child, from /proc/<pid>/maps
+struct mapping {
+    uint64_t start;
+    uint64_t end;
+    uint64_t offset;
+    char path[PATH_MAX];
+};
+
+static char extractor_path[PATH_MAX];
+// The whole file of the extractor: the names of the symbols point into it
+static char* image = NULL;
+static struct symbol* symbols = NULL;
+static size_t symbol_count = 0;
+
+static char report[REPORT_SIZE];
+static size_t report_length = 0;
+
+
+/**
+ * Appends to the report
+ */
+static void append(const char* format, ...) __attribute__((format(printf, 1, 2)));
+static void append(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (report_length < sizeof(report)) {
+        int n = vsnprintf(report + report_length, sizeof(report) - report_length, format, args);
+        if (n > 0) {
+            report_length += (size_t) n;
+        }
+        if (report_length > sizeof(report)) {
+            report_length = sizeof(report);
+        }
+    }
+    va_end(args);
+}
+
+
+/**
+ * Loads the functions of the symbol table of an ELF file
+ * @return 0 on success, -1 if the file cannot be read or is not a 64-bit ELF file
+ */
+static int load_symbols(const char* path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t) st.st_size < sizeof(Elf64_Ehdr) || (image = malloc(st.st_size)) == NULL ||
+        read(fd, image, st.st_size) != st.st_size) {
+        close(fd);
+        return -1;
+    }
+    close(fd);
+
+    const Elf64_Ehdr* header = (const Elf64_Ehdr*) image;
+    if (memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 || header->e_ident[EI_CLASS] != ELFCLASS64 ||
+        header->e_shoff + (uint64_t) header->e_shnum * sizeof(Elf64_Shdr) > (uint64_t) st.st_size) {
+        errno = ENOEXEC;
+        return -1;
+    }
+
+    // A stripped extractor only has its dynamic symbols: the backtrace then has offsets only
+    const Elf64_Shdr* sections = (const Elf64_Shdr*) (image + header->e_shoff);
+    for (unsigned int s = 0; s < header->e_shnum; s++) {
+        if (sections[s].sh_type != SHT_SYMTAB || sections[s].sh_link >= header->e_shnum) {
+            continue;
+        }
+        const Elf64_Shdr* strings = &sections[sections[s].sh_link];
+        if (sections[s].sh_offset + sections[s].sh_size > (uint64_t) st.st_size ||
+            strings->sh_offset + strings->sh_size > (uint64_t) st.st_size) {
+            continue;
+        }
+        const Elf64_Sym* entries = (const Elf64_Sym*) (image + sections[s].sh_offset);
+        size_t count = sections[s].sh_size / sizeof(Elf64_Sym);
+        symbols = calloc(count, sizeof(*symbols));
+        if (symbols == NULL) {
+            return -1;
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (ELF64_ST_TYPE(entries[i].st_info) == STT_FUNC && entries[i].st_value != 0 &&
+                entries[i].st_name < strings->sh_size) {
+                symbols[symbol_count].value = entries[i].st_value;
+                symbols[symbol_count].size = entries[i].st_size;
+                symbols[symbol_count].name = image + strings->sh_offset + entries[i].st_name;
+                symbol_count++;
+            }
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * @return the function of the extractor containing an address relative to its load address, NULL if none
+ */
+static const struct symbol* find_symbol(uint64_t address) {
+    const struct symbol* best = NULL;
+    for (size_t i = 0; i < symbol_count; i++) {
+        if (symbols[i].value <= address && (best == NULL || symbols[i].value > best->value) &&
+            (symbols[i].size == 0 || address < symbols[i].value + symbols[i].size)) {
+            best = &symbols[i];
+        }
+    }
+    return best;
+}
+
+
+static void save_report(const char* artifact) {
+    if (report_length == 0) {
+        return;
+    }
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s" TRIAGE_EXTENSION, artifact);
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        perror(path);
+        return;
+    }
+    fwrite(report, 1, report_length, file);
+    fclose(file);
+}
+
+
+int triage_enable(const char* extractor) {
+    snprintf(extractor_path, sizeof(extractor_path), "%s", extractor);
+    if (load_symbols(extractor) == -1) {
+        perror(extractor);
+        return -1;
+    }
+    campaign_add_crash_hook(save_report);
+    return 0;
+}
+
+
+void triage_start(void) {
+    report_length = 0;
+}
+
+
+bool triage_is_fatal(int sig) {
+    return sig == SIGSEGV || sig == SIGBUS || sig == SIGFPE || sig == SIGILL || sig == SIGABRT;
+}
+
+
+#if defined(__x86_64__)
+
+bool triage_supported(void) {
+    return true;
+}
+
+
+/**
+ * Reads the mappings of the child that belong to a file
+ * @return the number of mappings read
+ */
+static size_t read_mappings(pid_t pid, struct mapping* mappings, size_t max) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/maps", (int) pid);
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return 0;
+    }
+    size_t count = 0;
+    char line[PATH_MAX + 128];
+    while (count < max && fgets(line, sizeof(line), file) != NULL) {
+        struct mapping* mapping = &mappings[count];
+        mapping->path[0] = '\0';
+        int consumed = 0;
+        if (sscanf(line, "%" SCNx64 "-%" SCNx64 " %*s %" SCNx64 " %*s %*s %n", &mapping->start, &mapping->end,
+                   &mapping->offset, &consumed) < 3 || line[consumed] != '/') {
+            continue;
+        }
+        snprintf(mapping->path, sizeof(mapping->path), "%s", line + consumed);
+        mapping->path[strcspn(mapping->path, "\n")] = '\0';
+        count++;
+    }
+    fclose(file);
+    return count;
+}
+
+
+/**
+ * Writes where an address is: function of the extractor and offset, or library and offset
+ */
+static void describe_address(uint64_t address, const struct mapping* mappings, size_t count, uint64_t base) {
+    for (size_t m = 0; m < count; m++) {
+        if (address < mappings[m].start || address >= mappings[m].end) {
+            continue;
+        }
+        if (strcmp(mappings[m].path, extractor_path) == 0) {
+            const struct symbol* symbol = find_symbol(address - base);
+            if (symbol != NULL) {
+                append(" %s+0x%" PRIx64, symbol->name, address - base - symbol->value);
+            }
+            append(" (extractor+0x%" PRIx64 ")\n", address - base);
+        } else {
+            const char* name = strrchr(mappings[m].path, '/');
+            append(" (%s+0x%" PRIx64 ")\n", name + 1, address - mappings[m].start + mappings[m].offset);
+        }
+        return;
+    }
+    append(" ??\n");
+}
+
+
+static bool read_word(pid_t pid, uint64_t address, uint64_t* value) {
+    struct iovec local = {value, sizeof(*value)};
+    struct iovec remote = {(void*) address, sizeof(*value)};
+    return process_vm_readv(pid, &local, 1, &remote, 1, 0) == sizeof(*value);
+}
+
+
+/**
+ * @return true if an address is in a mapping of the extractor
+ */
+static bool in_extractor(uint64_t address, const struct mapping* mappings, size_t count) {
+    for (size_t m = 0; m < count; m++) {
+        if (address >= mappings[m].start && address < mappings[m].end && strcmp(mappings[m].path, extractor_path) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void triage_capture(pid_t pid, int sig) {
+    if (report_length > 0) {
+        return;
+    }
+
+    siginfo_t info;
+    struct user_regs_struct regs;
+    if (ptrace(PTRACE_GETSIGINFO, pid, NULL, &info) == -1 || ptrace(PTRACE_GETREGS, pid, NULL, &regs) == -1) {
+        return;
+    }
+
+    const char* name = sigabbrev_np(sig);
+    append("signal SIG%s code %d", name != NULL ? name : "?", info.si_code);
+    if (sig == SIGSEGV || sig == SIGBUS || sig == SIGFPE || sig == SIGILL) {
+        append(" address 0x%016llx", (unsigned long long) (uintptr_t) info.si_addr);
+    }
+    append("\nrip %016llx rsp %016llx rbp %016llx eflags %08llx\n"
+           "rax %016llx rbx %016llx rcx %016llx rdx %016llx\n"
+           "rsi %016llx rdi %016llx r8  %016llx r9  %016llx\n"
+           "r10 %016llx r11 %016llx r12 %016llx r13 %016llx\n"
+           "r14 %016llx r15 %016llx\n",
+           regs.rip, regs.rsp, regs.rbp, regs.eflags, regs.rax, regs.rbx, regs.rcx, regs.rdx,
+           regs.rsi, regs.rdi, regs.r8, regs.r9, regs.r10, regs.r11, regs.r12, regs.r13, regs.r14, regs.r15);
+
+    // The load address of the extractor (PIE): its first mapping
+    static struct mapping mappings[MAX_MAPPINGS];
+    size_t count = read_mappings(pid, mappings, MAX_MAPPINGS);
+    uint64_t base = 0;
+    for (size_t m = 0; m < count; m++) {
+        if (strcmp(mappings[m].path, extractor_path) == 0 && mappings[m].offset == 0) {
+            base = mappings[m].start;
+            break;
+        }
+    }
+
+    unsigned int frame = 0;
+    append("#%u %016llx", frame++, regs.rip);
+    describe_address(regs.rip, mappings, count, base);
+
+    // A library function without a frame of its own: its return address is on top of the stack
+    uint64_t return_address;
+    if (!in_extractor(regs.rip, mappings, count) && read_word(pid, regs.rsp, &return_address) &&
+        in_extractor(return_address, mappings, count)) {
+        append("#%u %016" PRIx64, frame++, return_address);
+        describe_address(return_address, mappings, count, base);
+    }
+
+    // Then the chain of the saved frame pointers, always going up the stack
+    uint64_t frame_pointer = regs.rbp;
+    while (frame < MAX_FRAMES && frame_pointer != 0) {
+        uint64_t next;
+        if (!read_word(pid, frame_pointer, &next) || !read_word(pid, frame_pointer + 8, &return_address) ||
+            return_address == 0) {
+            break;
+        }
+        append("#%u %016" PRIx64, frame++, return_address);
+        describe_address(return_address, mappings, count, base);
+        if (next <= frame_pointer) {
+            break;
+        }
+        frame_pointer = next;
+    }
+}
+
+#else
+
+bool triage_supported(void) {
+    return false;
+}
+
+
+void triage_capture(__attribute__((unused)) pid_t pid, __attribute__((unused)) int sig) {
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef FUZZER_TRIAGE_H
+#define FUZZER_TRIAGE_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/*
+ * Crash triage: the extractor is traced (ptrace), and stopped when a fatal signal (SIGSEGV, SIGBUS, SIGFPE, SIGILL,
+ * SIGABRT) is about to be delivered, before its crash handler runs. The signal, its fault address (si_addr),
+ * the registers and a backtrace (frame pointers, the extractor is built with them) are written to a report,
+ * symbolized with the symbol table of the extractor and /proc/<pid>/maps for the libraries.
+ * The report of the last execution is saved as "<archive>.crash" when the campaign records a crash, next to the
+ * archive kept. No core file is written (RLIMIT_CORE is 0 in the extractor).
+ *
+ * Only available on x86_64, the architecture of the extractor.
+ */
+
+// Extension of the reports, added to the name of the archive
+#define TRIAGE_EXTENSION ".crash"
+
+/**
+ * @return true if the crashes can be triaged on this architecture
+ */
+bool triage_supported(void);
+
+/**
+ * Reads the symbols of the extractor and saves the reports with the crashes from then on.
+ * The executor has to trace the extractor too, see executor_enable_triage().
+ * @param extractor absolute path of the extractor
+ * @return 0 on success, -1 if the extractor cannot be read
+ */
+int triage_enable(const char* extractor);
+
+/**
+ * Forgets the report of the previous execution
+ */
+void triage_start(void);
+
+/**
+ * Writes the report of a crash, the child being stopped before the delivery of the signal.
+ * Only the first fatal signal of an execution is reported.
+ * @param pid the child
+ * @param sig the signal
+ */
+void triage_capture(pid_t pid, int sig);
+
+/**
+ * @param sig a signal
+ * @return true if the signal is one that the crashes are made of
+ */
+bool triage_is_fatal(int sig);
+
+#endif
@@ -0,0 +1,93 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "executor.h"
+#include "faults.h"
+
+/*
+ * The limit hits are only found from the signals and the costs: the errors an extractor prints when its calls fail,
+ * injected or not, are not limits, and a crash printed after them stays a crash.
+ */
+
+// Prints the errors of the limits, as when the fault injector fails open() with EMFILE and malloc() with ENOMEM
+#define FAILING_EXTRACTOR "#!/bin/sh\n" \
+                          "echo \"open: Too many open files\" >&2\n" \
+                          "echo \"malloc: Cannot allocate memory\" >&2\n"
+#define CRASH_LINE "echo \"*** The program has crashed ***\"\n"
+// Writes past the size limit: SIGXFSZ
+#define WRITING_EXTRACTOR "#!/bin/sh\nexec head -c 65536 /dev/zero > written\n"
+
+static int failures = 0;
+
+
+/**
+ * Writes an extractor script in the current directory
+ * @return 0 on success, -1 on error
+ */
+static int write_extractor(const char* path, const char* script) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+    fputs(script, file);
+    fclose(file);
+    return chmod(path, 0755);
+}
+
+
+/**
+ * Runs an extractor and checks its outcome
+ */
+static void check(const char* name, const char* extractor, bool injected, bool crashed, enum executor_limit limit) {
+    struct execution execution;
+    if (injected) {
+        setenv(FAULT_SCHEDULE_VARIABLE, "open:1:24,malloc:1:12", 1);
+    }
+    int rv = executor_run(extractor, NULL, "archive.tar", injected, &execution);
+    unsetenv(FAULT_SCHEDULE_VARIABLE);
+    if (rv == -1 || execution.crashed != crashed || execution.limit != limit ||
+        (injected && execution.limit_error != 0)) {
+        char description[64];
+        executor_describe_limit(&execution, description, sizeof(description));
+        fprintf(stderr, "FAIL %s: crashed %d (expected %d), limit %s\n", name, execution.crashed, crashed,
+                description);
+        failures++;
+    } else {
+        printf("ok   %s\n", name);
+    }
+}
+
+
+int main(void) {
+    char directory[] = "/tmp/test_limits.XXXXXX";
+    if (mkdtemp(directory) == NULL || chdir(directory) == -1) {
+        perror(directory);
+        return 1;
+    }
+    if (write_extractor("failing", FAILING_EXTRACTOR) == -1 ||
+        write_extractor("crashing", FAILING_EXTRACTOR CRASH_LINE) == -1 ||
+        write_extractor("writing", WRITING_EXTRACTOR) == -1 || executor_parse_limit("fsize=4096") == -1) {
+        return 1;
+    }
+
+    check("injected EMFILE and ENOMEM are not a limit", "./failing", true, false, LIMIT_NONE);
+    check("EMFILE and ENOMEM alone are not a limit", "./failing", false, false, LIMIT_NONE);
+    check("a crash after injected errors stays a crash", "./crashing", true, true, LIMIT_NONE);
+    check("a crash after the same errors stays a crash", "./crashing", false, true, LIMIT_NONE);
+    check("SIGXFSZ is a limit", "./writing", false, false, LIMIT_FSIZE);
+    check("SIGXFSZ is a limit with injected faults", "./writing", true, false, LIMIT_FSIZE);
+
+    unlink("failing");
+    unlink("crashing");
+    unlink("writing");
+    unlink("written");
+    if (chdir("/") == 0) {
+        rmdir(directory);
+    }
+    return failures > 0;
+}